@@ -7,4 +7,8 @@ find_dependency(
         @QLMDB_REQUIRED_QT_DEPENDENCIES@
 )
 
+if(@QLMDB_WITH_ZLIB@)
+    find_dependency(ZLIB)
+endif()
+
 include("${CMAKE_CURRENT_LIST_DIR}/QLMDBTargets.cmake")
@@ -0,0 +1,772 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <limits>
+
+#include <QObject>
+
+#include "blobstore.h"
+#include "blobstoreprivate.h"
+#include "errors.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+/**
+ * @class BlobStore
+ * @brief Store large values split into chunks.
+ *
+ * LMDB stores values which don't fit into a page on overflow pages. These
+ * must be allocated as one contiguous range of pages, which fragments the
+ * file over time: Writing a large value fails with Errors::MapFull if there
+ * is plenty of free space, but no gap large enough. Additionally, reading
+ * and writing such values via a Database requires copying them into
+ * memory as a whole.
+ *
+ * A BlobStore instead splits values (blobs) into chunks of chunkSize()
+ * bytes, each of which fits into a page together with its key. Small blobs
+ * can be read and written as a whole via get() and put(). Large ones are
+ * best streamed via a BlobReader and BlobWriter, which only ever keep a
+ * bounded part of the blob in memory:
+ *
+ * ```
+ * BlobStore attachments(ctx, "attachments");
+ * QFile file("report.pdf");
+ * file.open(QIODevice::ReadOnly);
+ *
+ * BlobWriter writer(attachments, "report.pdf");
+ * writer.open(QIODevice::WriteOnly);
+ * while (!file.atEnd()) {
+ *     writer.write(file.read(64 * 1024));
+ * }
+ * writer.commit();
+ *
+ * BlobReader reader(attachments, "report.pdf");
+ * reader.open(QIODevice::ReadOnly);
+ * auto header = reader.read(1024);
+ * ```
+ *
+ * The chunks of a blob are stored in a Database under keys derived from
+ * the blob's key via the KeyBuilder, so they must not be accessed via
+ * other means. Keys of blobs should not exceed a few hundred bytes, as the
+ * derived keys must fit into LMDB's key size limit.
+ */
+
+
+/**
+ * @brief The default size of the chunks blobs are split into.
+ *
+ * This is chosen so that two chunks and their keys fit into a page of
+ * 4 KiB, the usual page size.
+ */
+const int BlobStore::DefaultChunkSize = 1536;
+
+
+/**
+ * @brief Constructor.
+ *
+ * Opens (and if needed creates) the database @p name in the @p context to
+ * store blobs in.
+ *
+ * Make sure there is no active Transaction ongoing in the current thread
+ * when using this constructor.
+ */
+BlobStore::BlobStore(Context &context, const QString &name) :
+    d_ptr(new BlobStorePrivate)
+{
+    Q_D(BlobStore);
+    d->database.reset(new Database(context, name));
+    if (!d->database->isValid()) {
+        d->setError(d->database->lastError(),
+                    d->database->lastErrorString());
+        return;
+    }
+    d->context = &context;
+}
+
+
+/**
+ * @brief Destructor.
+ */
+BlobStore::~BlobStore()
+{
+}
+
+
+/**
+ * @brief Is the store valid.
+ *
+ * This returns true if the underlying database could be opened.
+ */
+bool BlobStore::isValid() const
+{
+    const Q_D(BlobStore);
+    return d->context != nullptr && d->database->isValid();
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int BlobStore::lastError() const
+{
+    const Q_D(BlobStore);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString BlobStore::lastErrorString() const
+{
+    const Q_D(BlobStore);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void BlobStore::clearLastError()
+{
+    Q_D(BlobStore);
+    d->setError(Errors::NoError, QString());
+}
+
+
+/**
+ * @brief The database the chunks of blobs are stored in.
+ */
+Database *BlobStore::database() const
+{
+    const Q_D(BlobStore);
+    return d->database.data();
+}
+
+
+/**
+ * @brief The size (in bytes) of the chunks blobs are split into.
+ *
+ * @sa setChunkSize()
+ */
+int BlobStore::chunkSize() const
+{
+    const Q_D(BlobStore);
+    return d->chunkSize;
+}
+
+
+/**
+ * @brief Set the size of the chunks blobs are split into.
+ *
+ * The default is DefaultChunkSize. Larger chunks only pay off if the
+ * Context uses larger pages. The size of each blob's chunks is stored
+ * with the blob, so changing the chunk size only affects blobs written
+ * afterwards. Values less than 1 are ignored.
+ */
+void BlobStore::setChunkSize(int chunkSize)
+{
+    Q_D(BlobStore);
+    if (chunkSize > 0) {
+        d->chunkSize = chunkSize;
+    }
+}
+
+
+/**
+ * @brief Store the blob @p data under the @p key.
+ *
+ * Any blob previously stored under the @p key is replaced. Returns true on
+ * success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool BlobStore::put(const QByteArray &key, const QByteArray &data)
+{
+    Q_D(BlobStore);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context);
+        result = put(txn, key, data);
+        if (!result) {
+            txn.abort();
+        } else if (!txn.commit()) {
+            d->setError(txn.lastError(), txn.lastErrorString());
+            result = false;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Store the blob @p data under the @p key.
+ *
+ * This is an overloaded version of put(). It runs the operation in the
+ * given @p transaction.
+ */
+bool BlobStore::put(Transaction &transaction, const QByteArray &key,
+                    const QByteArray &data)
+{
+    Q_D(BlobStore);
+    if (!isValid() || !transaction.isValid()) {
+        return false;
+    }
+    BlobStorePrivate::Metadata metadata;
+    metadata.size = static_cast<quint64>(data.size());
+    metadata.chunkSize = static_cast<quint32>(d->chunkSize);
+    metadata.generation = d->generation(transaction);
+    auto error = d->writeChunks(transaction, key, metadata.generation,
+                                metadata.chunkSize, 0, data.constData(),
+                                data.size());
+    if (error == Errors::NoError) {
+        error = d->finish(transaction, key, metadata);
+    }
+    if (error == Errors::NoError) {
+        d->setError(Errors::NoError, QString());
+    }
+    return error == Errors::NoError;
+}
+
+
+/**
+ * @brief Get the blob stored under the @p key.
+ *
+ * The blob is read into memory as a whole. Use a BlobReader to read large
+ * blobs piece by piece instead. If there is no blob with the @p key, a null
+ * byte array is returned and lastError() is set to Errors::NotFound.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArray BlobStore::get(const QByteArray &key)
+{
+    Q_D(BlobStore);
+    QByteArray result;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = get(txn, key);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get the blob stored under the @p key.
+ *
+ * This is an overloaded version of get(). It runs the operation in the
+ * given @p transaction.
+ */
+QByteArray BlobStore::get(Transaction &transaction, const QByteArray &key)
+{
+    Q_D(BlobStore);
+    QByteArray result;
+    if (isValid() && transaction.isValid()) {
+        BlobStorePrivate::Metadata metadata;
+        if (d->readMetadata(transaction, key, metadata) != Errors::NoError) {
+            return result;
+        }
+        if (metadata.size > static_cast<quint64>(
+                    std::numeric_limits<int>::max())) {
+            d->setError(Errors::InvalidParameter,
+                        QObject::tr("The blob is too large to be read into "
+                                    "a byte array"));
+            return result;
+        }
+        result.resize(static_cast<int>(metadata.size));
+        if (d->read(transaction, key, metadata, 0, result.data(),
+                    result.size()) == Errors::NoError) {
+            d->setError(Errors::NoError, QString());
+        } else {
+            result = QByteArray();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief The size (in bytes) of the blob stored under the @p key.
+ *
+ * Returns -1 if there is no such blob or an error occurred.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+qint64 BlobStore::size(const QByteArray &key)
+{
+    Q_D(BlobStore);
+    qint64 result = -1;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = size(txn, key);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The size (in bytes) of the blob stored under the @p key.
+ *
+ * This is an overloaded version of size(). It runs the operation in the
+ * given @p transaction.
+ */
+qint64 BlobStore::size(Transaction &transaction, const QByteArray &key)
+{
+    Q_D(BlobStore);
+    qint64 result = -1;
+    if (isValid() && transaction.isValid()) {
+        BlobStorePrivate::Metadata metadata;
+        if (d->readMetadata(transaction, key, metadata) == Errors::NoError) {
+            result = static_cast<qint64>(metadata.size);
+            d->setError(Errors::NoError, QString());
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the blob stored under the @p key.
+ *
+ * This also removes chunks left behind by a BlobWriter which has not been
+ * committed, e.g. because the process crashed. Returns true on success or
+ * false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool BlobStore::remove(const QByteArray &key)
+{
+    Q_D(BlobStore);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context);
+        result = remove(txn, key);
+        if (!result) {
+            txn.abort();
+        } else if (!txn.commit()) {
+            d->setError(txn.lastError(), txn.lastErrorString());
+            result = false;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the blob stored under the @p key.
+ *
+ * This is an overloaded version of remove(). It runs the operation in the
+ * given @p transaction.
+ */
+bool BlobStore::remove(Transaction &transaction, const QByteArray &key)
+{
+    Q_D(BlobStore);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        auto removed = d->database->removePrefix(transaction,
+                                                 d->metadataKey(key));
+        if (d->database->lastError() != Errors::NoError &&
+                d->database->lastError() != Errors::NotFound) {
+            d->setError(d->database->lastError(),
+                        d->database->lastErrorString());
+        } else if (removed == 0) {
+            d->setError(Errors::NotFound,
+                        QObject::tr("No blob stored under the key"));
+        } else {
+            d->setError(Errors::NoError, QString());
+            result = true;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @class BlobReader
+ * @brief Read a blob from a BlobStore piece by piece.
+ *
+ * The reader is a random access QIODevice, so it can be passed e.g. to
+ * parsers reading from a device. Data is copied directly from the memory
+ * map into the buffers passed to read().
+ *
+ * If the reader is created without a Transaction, each read runs in a
+ * short read-only transaction of its own. In this case, the blob must not
+ * be overwritten or removed while reading it, otherwise read() fails.
+ * When created with a Transaction, all reads run in it. The transaction
+ * must stay alive as long as the reader is open.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a reader for the blob stored under the @p key in the @p store.
+ * Call open() before reading. The @p store must outlive the reader.
+ */
+BlobReader::BlobReader(BlobStore &store, const QByteArray &key,
+                       QObject *parent) :
+    QIODevice(parent),
+    d_ptr(new BlobReaderPrivate(store, nullptr, key))
+{
+}
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a reader for the blob stored under the @p key in the @p store,
+ * which reads in the given @p transaction.
+ */
+BlobReader::BlobReader(BlobStore &store, Transaction &transaction,
+                       const QByteArray &key, QObject *parent) :
+    QIODevice(parent),
+    d_ptr(new BlobReaderPrivate(store, &transaction, key))
+{
+}
+
+
+/**
+ * @brief Destructor.
+ */
+BlobReader::~BlobReader()
+{
+}
+
+
+/**
+ * @brief The key of the blob read.
+ */
+QByteArray BlobReader::key() const
+{
+    const Q_D(BlobReader);
+    return d->key;
+}
+
+
+/**
+ * @brief Open the reader.
+ *
+ * The @p mode must be QIODevice::ReadOnly. Fails if there is no blob
+ * stored under the key().
+ *
+ * @note Unless a Transaction has been passed to the constructor, this
+ * method must not be called when another Transaction is active in the
+ * same thread. The same applies to reading.
+ */
+bool BlobReader::open(OpenMode mode)
+{
+    Q_D(BlobReader);
+    if (isOpen() || (mode & WriteOnly) || !(mode & ReadOnly)) {
+        setErrorString(QObject::tr("Blobs can only be opened for "
+                                   "reading"));
+        return false;
+    }
+    auto store = d->store->d_func();
+    if (!d->store->isValid()) {
+        setErrorString(store->lastErrorString);
+        return false;
+    }
+    int error;
+    if (d->transaction != nullptr) {
+        error = store->readMetadata(*d->transaction, d->key, d->metadata);
+    } else {
+        Transaction txn(*store->context, Transaction::ReadOnly);
+        error = store->readMetadata(txn, d->key, d->metadata);
+    }
+    if (error != Errors::NoError) {
+        setErrorString(store->lastErrorString);
+        return false;
+    }
+    d->position = 0;
+    return QIODevice::open(mode);
+}
+
+
+/**
+ * @brief Close the reader.
+ */
+void BlobReader::close()
+{
+    Q_D(BlobReader);
+    QIODevice::close();
+    d->position = 0;
+}
+
+
+/**
+ * @brief The size of the blob.
+ *
+ * This is only available when the reader is open.
+ */
+qint64 BlobReader::size() const
+{
+    const Q_D(BlobReader);
+    return isOpen() ? static_cast<qint64>(d->metadata.size) : 0;
+}
+
+
+/**
+ * @brief Move the reader to the position @p pos.
+ */
+bool BlobReader::seek(qint64 pos)
+{
+    Q_D(BlobReader);
+    if (pos < 0 || pos > size() || !QIODevice::seek(pos)) {
+        return false;
+    }
+    d->position = pos;
+    return true;
+}
+
+
+/**
+ * @brief Read up to @p maxSize bytes into @p data.
+ */
+qint64 BlobReader::readData(char *data, qint64 maxSize)
+{
+    Q_D(BlobReader);
+    auto length = qMin(maxSize, size() - d->position);
+    if (length <= 0) {
+        return 0;
+    }
+    auto store = d->store->d_func();
+    int error;
+    if (d->transaction != nullptr) {
+        error = store->read(*d->transaction, d->key, d->metadata,
+                            d->position, data, length);
+    } else {
+        Transaction txn(*store->context, Transaction::ReadOnly);
+        error = store->read(txn, d->key, d->metadata, d->position, data,
+                            length);
+    }
+    if (error != Errors::NoError) {
+        setErrorString(store->lastErrorString);
+        return -1;
+    }
+    d->position += length;
+    return length;
+}
+
+
+/**
+ * @brief Writing is not supported.
+ */
+qint64 BlobReader::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+
+/**
+ * @class BlobWriter
+ * @brief Write a blob to a BlobStore piece by piece.
+ *
+ * The writer is a sequential QIODevice. Data written to it is buffered
+ * until enough chunks are collected, which are then written in a
+ * Transaction of their own. Hence, only a bounded part of the blob is kept
+ * in memory and writing a large blob does not block other writers for
+ * long.
+ *
+ * Like with a QSaveFile, the blob written only replaces the one previously
+ * stored under the key when calling commit(). Until then, readers see the
+ * old blob. Closing or destroying the writer without committing discards
+ * the data written. Writing the same key via several writers at once is
+ * not supported: Committing one of them might remove the chunks written by
+ * the others, which then fail to commit.
+ *
+ * @note As the writer runs transactions of its own, writing to it must not
+ * happen when another Transaction is active in the same thread.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a writer for the blob stored under the @p key in the @p store.
+ * Call open() before writing. The @p store must outlive the writer.
+ */
+BlobWriter::BlobWriter(BlobStore &store, const QByteArray &key,
+                       QObject *parent) :
+    QIODevice(parent),
+    d_ptr(new BlobWriterPrivate(store, key))
+{
+}
+
+
+/**
+ * @brief Destructor.
+ *
+ * Discards the data written unless commit() has been called.
+ */
+BlobWriter::~BlobWriter()
+{
+    close();
+}
+
+
+/**
+ * @brief The key of the blob written.
+ */
+QByteArray BlobWriter::key() const
+{
+    const Q_D(BlobWriter);
+    return d->key;
+}
+
+
+/**
+ * @brief Open the writer.
+ *
+ * The @p mode must be QIODevice::WriteOnly. The chunk size of the store is
+ * used for the blob written.
+ */
+bool BlobWriter::open(OpenMode mode)
+{
+    Q_D(BlobWriter);
+    if (isOpen() || (mode & ReadOnly) || !(mode & WriteOnly)) {
+        setErrorString(QObject::tr("Blobs can only be opened for "
+                                   "writing"));
+        return false;
+    }
+    if (!d->store->isValid()) {
+        setErrorString(d->store->lastErrorString());
+        return false;
+    }
+    d->discard();
+    d->chunkSize = static_cast<quint32>(d->store->chunkSize());
+    d->pending.reserve(static_cast<int>(d->chunkSize) *
+                       BlobWriterPrivate::ChunksPerTransaction);
+    return QIODevice::open(mode);
+}
+
+
+/**
+ * @brief Close the writer, discarding the data written.
+ *
+ * Use commit() to store the data written instead.
+ */
+void BlobWriter::close()
+{
+    Q_D(BlobWriter);
+    if (isOpen()) {
+        d->discard();
+        d->pending.squeeze();
+        QIODevice::close();
+    }
+}
+
+
+/**
+ * @brief The writer is sequential.
+ */
+bool BlobWriter::isSequential() const
+{
+    return true;
+}
+
+
+/**
+ * @brief Store the data written and close the writer.
+ *
+ * This atomically replaces the blob previously stored under the key() by
+ * the data written. Returns true on success or false otherwise. In the
+ * latter case, the data written is discarded.
+ */
+bool BlobWriter::commit()
+{
+    Q_D(BlobWriter);
+    if (!isOpen()) {
+        return false;
+    }
+    auto store = d->store->d_func();
+    bool result = false;
+    {
+        Transaction txn(*store->context);
+        BlobStorePrivate::Metadata metadata;
+        metadata.size = d->size;
+        metadata.chunkSize = d->chunkSize;
+        metadata.generation = d->generation != 0 ? d->generation
+                                                 : store->generation(txn);
+        auto error = store->writeChunks(txn, d->key, metadata.generation,
+                                        d->chunkSize, d->chunks,
+                                        d->pending.constData(),
+                                        d->pending.size());
+        if (error == Errors::NoError && d->chunks > 0 &&
+                store->database->get(txn, store->chunkKey(
+                                         d->key, metadata.generation, 0))
+                .isNull()) {
+            // Our chunks have been removed by another writer in the
+            // meantime:
+            store->setError(Errors::NotFound,
+                            QObject::tr("The blob has been written "
+                                        "concurrently"));
+            error = store->lastError;
+        }
+        if (error == Errors::NoError) {
+            error = store->finish(txn, d->key, metadata);
+        }
+        if (error != Errors::NoError) {
+            setErrorString(store->lastErrorString);
+            txn.abort();
+        } else if (!txn.commit()) {
+            setErrorString(txn.lastErrorString());
+        } else {
+            result = true;
+            d->generation = 0;
+        }
+    }
+    close();
+    return result;
+}
+
+
+/**
+ * @brief Reading is not supported.
+ */
+qint64 BlobWriter::readData(char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+
+/**
+ * @brief Append up to @p maxSize bytes of @p data to the blob.
+ */
+qint64 BlobWriter::writeData(const char *data, qint64 maxSize)
+{
+    Q_D(BlobWriter);
+    if (maxSize <= 0) {
+        return 0;
+    }
+    d->pending.append(data, static_cast<int>(maxSize));
+    d->size += static_cast<quint64>(maxSize);
+    if (!d->flush()) {
+        setErrorString(d->errorString);
+        return -1;
+    }
+    return maxSize;
+}
+
+} // namespace QLMDB
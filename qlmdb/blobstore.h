@@ -0,0 +1,131 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BLOBSTORE_H
+#define BLOBSTORE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QScopedPointer>
+#include <QString>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class BlobReaderPrivate;
+class BlobStorePrivate;
+class BlobWriterPrivate;
+class Context;
+class Database;
+class Transaction;
+
+class QLMDBSHARED_EXPORT BlobStore
+{
+    friend class BlobReader;
+    friend class BlobWriter;
+    friend class BlobWriterPrivate;
+public:
+    static const int DefaultChunkSize;
+
+    explicit BlobStore(Context &context, const QString &name = QString());
+    virtual ~BlobStore();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    Database *database() const;
+    int chunkSize() const;
+    void setChunkSize(int chunkSize);
+
+    bool put(const QByteArray &key, const QByteArray &data);
+    bool put(Transaction &transaction, const QByteArray &key,
+             const QByteArray &data);
+    QByteArray get(const QByteArray &key);
+    QByteArray get(Transaction &transaction, const QByteArray &key);
+    qint64 size(const QByteArray &key);
+    qint64 size(Transaction &transaction, const QByteArray &key);
+    bool remove(const QByteArray &key);
+    bool remove(Transaction &transaction, const QByteArray &key);
+
+private:
+    QScopedPointer<BlobStorePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(BlobStore)
+};
+
+
+class QLMDBSHARED_EXPORT BlobReader : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit BlobReader(BlobStore &store, const QByteArray &key,
+                        QObject *parent = nullptr);
+    explicit BlobReader(BlobStore &store, Transaction &transaction,
+                        const QByteArray &key, QObject *parent = nullptr);
+    ~BlobReader() override;
+
+    QByteArray key() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QScopedPointer<BlobReaderPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(BlobReader)
+};
+
+
+class QLMDBSHARED_EXPORT BlobWriter : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit BlobWriter(BlobStore &store, const QByteArray &key,
+                        QObject *parent = nullptr);
+    ~BlobWriter() override;
+
+    QByteArray key() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+
+    bool commit();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QScopedPointer<BlobWriterPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(BlobWriter)
+};
+
+} // namespace QLMDB
+
+#endif // BLOBSTORE_H
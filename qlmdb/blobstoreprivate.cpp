@@ -0,0 +1,351 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include <lmdb.h>
+
+#include <QObject>
+#include <QtEndian>
+
+#include "blobstoreprivate.h"
+#include "cursor.h"
+#include "errors.h"
+#include "keybuilder.h"
+#include "transaction.h"
+#include "transactionprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// A blob stored under a key is represented by the following entries:
+//
+// - The metadata, stored under the key encoded via KeyBuilder::appendBytes().
+//   It holds the size of the blob (64 bit big endian), the size of its
+//   chunks (32 bit big endian) and its generation (64 bit big endian).
+// - The chunks, stored under the encoded key followed by the generation and
+//   the index of the chunk (both as KeyBuilder::appendUInt64()). All chunks
+//   but the last one have the chunk size.
+//
+// Hence, all entries of a blob share the encoded key as prefix and the
+// chunks are sorted by their index. The generation is the ID of the
+// transaction which started writing the blob. Chunks written by a
+// BlobWriter thus don't mix with the ones of the current value until the
+// writer commits.
+const int MetadataSize = 8 + 4 + 8;
+
+} // namespace
+
+BlobStorePrivate::BlobStorePrivate() :
+    context(nullptr),
+    database(),
+    chunkSize(BlobStore::DefaultChunkSize),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+QByteArray BlobStorePrivate::metadataKey(const QByteArray &key)
+{
+    return KeyBuilder().appendBytes(key).toByteArray();
+}
+
+QByteArray BlobStorePrivate::chunkPrefix(const QByteArray &key,
+                                         quint64 generation)
+{
+    return KeyBuilder().appendBytes(key).appendUInt64(generation)
+            .toByteArray();
+}
+
+QByteArray BlobStorePrivate::chunkKey(const QByteArray &key,
+                                      quint64 generation, quint64 index)
+{
+    return KeyBuilder().appendBytes(key).appendUInt64(generation)
+            .appendUInt64(index).toByteArray();
+}
+
+/**
+ * @brief The first key sorting after all keys starting with the @p prefix.
+ */
+QByteArray BlobStorePrivate::prefixEnd(const QByteArray &prefix)
+{
+    QByteArray result = prefix;
+    while (!result.isEmpty() &&
+           static_cast<quint8>(result.at(result.size() - 1)) == 0xff) {
+        result.chop(1);
+    }
+    if (!result.isEmpty()) {
+        result[result.size() - 1] = static_cast<char>(
+                    static_cast<quint8>(result.at(result.size() - 1)) + 1);
+    }
+    return result;
+}
+
+QByteArray BlobStorePrivate::encodeMetadata(const Metadata &metadata)
+{
+    char data[MetadataSize];
+    qToBigEndian<quint64>(metadata.size, data);
+    qToBigEndian<quint32>(metadata.chunkSize, data + 8);
+    qToBigEndian<quint64>(metadata.generation, data + 12);
+    return QByteArray(data, MetadataSize);
+}
+
+bool BlobStorePrivate::decodeMetadata(const QByteArray &data,
+                                      Metadata &metadata)
+{
+    if (data.size() != MetadataSize) {
+        return false;
+    }
+    metadata.size = qFromBigEndian<quint64>(data.constData());
+    metadata.chunkSize = qFromBigEndian<quint32>(data.constData() + 8);
+    metadata.generation = qFromBigEndian<quint64>(data.constData() + 12);
+    return metadata.chunkSize > 0 || metadata.size == 0;
+}
+
+/**
+ * @brief The generation of blobs written in the write @p transaction.
+ *
+ * This is the ID of the transaction. It is unique among all committed write
+ * transactions, so blobs written in different ones never share their
+ * generation.
+ */
+quint64 BlobStorePrivate::generation(Transaction &transaction)
+{
+    return mdb_txn_id(transaction.d_ptr->txn);
+}
+
+/**
+ * @brief Read the metadata of the blob stored under the @p key.
+ */
+int BlobStorePrivate::readMetadata(Transaction &transaction,
+                                   const QByteArray &key, Metadata &metadata)
+{
+    auto data = database->get(transaction, metadataKey(key));
+    if (database->lastError() != Errors::NoError) {
+        setError(database->lastError(), database->lastErrorString());
+        return lastError;
+    }
+    if (!decodeMetadata(data, metadata)) {
+        setError(Errors::Corrupted,
+                 QObject::tr("Invalid metadata stored for blob"));
+        return lastError;
+    }
+    return Errors::NoError;
+}
+
+/**
+ * @brief Read @p size bytes starting at @p offset from a blob.
+ *
+ * The bytes are copied from the memory map directly into the @p data
+ * buffer. Fails with Errors::NotFound if one of the chunks is missing,
+ * i.e. if the blob has been overwritten or removed since the @p metadata
+ * has been read in another transaction.
+ */
+int BlobStorePrivate::read(Transaction &transaction, const QByteArray &key,
+                           const Metadata &metadata, qint64 offset,
+                           char *data, qint64 size)
+{
+    if (size <= 0) {
+        return Errors::NoError;
+    }
+    auto index = static_cast<quint64>(offset) / metadata.chunkSize;
+    auto skip = static_cast<qint64>(
+                static_cast<quint64>(offset) % metadata.chunkSize);
+    auto prefix = chunkPrefix(key, metadata.generation);
+    Cursor cursor(transaction, *database);
+    auto item = cursor.findKey(chunkKey(key, metadata.generation, index));
+    while (size > 0) {
+        if (!item.isValid()) {
+            if (cursor.lastError() == Errors::NoError ||
+                    cursor.lastError() == Errors::NotFound) {
+                setError(Errors::NotFound,
+                         QObject::tr("The blob has been changed or "
+                                     "removed"));
+            } else {
+                setError(cursor.lastError(), cursor.lastErrorString());
+            }
+            return lastError;
+        }
+        auto chunk = item.key();
+        auto value = item.value();
+        auto expected = qMin<quint64>(metadata.chunkSize, metadata.size -
+                                      index * metadata.chunkSize);
+        if (qFromBigEndian<quint64>(chunk.constData() + chunk.size() - 8) !=
+                index || static_cast<quint64>(value.size()) != expected) {
+            setError(Errors::Corrupted,
+                     QObject::tr("Invalid chunk stored for blob"));
+            return lastError;
+        }
+        auto length = qMin<qint64>(size, value.size() - skip);
+        std::memcpy(data, value.constData() + skip,
+                    static_cast<size_t>(length));
+        data += length;
+        size -= length;
+        skip = 0;
+        ++index;
+        if (size > 0) {
+            item = cursor.nextWithPrefix(prefix);
+        }
+    }
+    return Errors::NoError;
+}
+
+/**
+ * @brief Store @p size bytes of @p data as chunks of a blob.
+ *
+ * The first chunk written gets the given @p index.
+ */
+int BlobStorePrivate::writeChunks(Transaction &transaction,
+                                  const QByteArray &key, quint64 generation,
+                                  quint32 chunkSize, quint64 index,
+                                  const char *data, qint64 size)
+{
+    KeyBuilder chunk;
+    for (qint64 offset = 0; offset < size; offset += chunkSize, ++index) {
+        auto length = qMin<qint64>(chunkSize, size - offset);
+        chunk.clear();
+        chunk.appendBytes(key).appendUInt64(generation).appendUInt64(index);
+        if (!database->put(transaction, chunk.data(), chunk.size(),
+                           data + offset, static_cast<size_t>(length))) {
+            setError(database->lastError(), database->lastErrorString());
+            return lastError;
+        }
+    }
+    return Errors::NoError;
+}
+
+/**
+ * @brief Make the chunks of a blob the current value of the @p key.
+ *
+ * This removes the chunks of all other generations and stores the
+ * @p metadata.
+ */
+int BlobStorePrivate::finish(Transaction &transaction, const QByteArray &key,
+                             const Metadata &metadata)
+{
+    auto prefix = metadataKey(key);
+    auto own = chunkPrefix(key, metadata.generation);
+    database->removeRange(transaction, chunkPrefix(key, 0), own);
+    if (database->lastError() == Errors::NoError ||
+            database->lastError() == Errors::NotFound) {
+        database->removeRange(transaction, prefixEnd(own), prefixEnd(prefix));
+    }
+    if (database->lastError() != Errors::NoError &&
+            database->lastError() != Errors::NotFound) {
+        setError(database->lastError(), database->lastErrorString());
+        return lastError;
+    }
+    if (!database->put(transaction, prefix, encodeMetadata(metadata))) {
+        setError(database->lastError(), database->lastErrorString());
+        return lastError;
+    }
+    return Errors::NoError;
+}
+
+void BlobStorePrivate::setError(int error, const QString &errorString)
+{
+    lastError = error;
+    lastErrorString = errorString;
+}
+
+BlobReaderPrivate::BlobReaderPrivate(BlobStore &store,
+                                     Transaction *transaction,
+                                     const QByteArray &key) :
+    store(&store),
+    transaction(transaction),
+    key(key),
+    metadata(),
+    position(0)
+{
+
+}
+
+const int BlobWriterPrivate::ChunksPerTransaction = 512;
+
+BlobWriterPrivate::BlobWriterPrivate(BlobStore &store, const QByteArray &key) :
+    store(&store),
+    key(key),
+    pending(),
+    generation(0),
+    chunkSize(0),
+    chunks(0),
+    size(0),
+    errorString()
+{
+
+}
+
+/**
+ * @brief Write the chunks buffered so far if there are enough of them.
+ *
+ * Each ChunksPerTransaction chunks are written in a transaction of their
+ * own.
+ */
+bool BlobWriterPrivate::flush()
+{
+    auto d = store->d_func();
+    auto batchSize = static_cast<int>(chunkSize) * ChunksPerTransaction;
+    int offset = 0;
+    bool result = true;
+    while (pending.size() - offset >= batchSize) {
+        Transaction txn(*d->context);
+        if (generation == 0) {
+            generation = d->generation(txn);
+        }
+        if (d->writeChunks(txn, key, generation, chunkSize, chunks,
+                           pending.constData() + offset,
+                           batchSize) != Errors::NoError) {
+            errorString = d->lastErrorString;
+            txn.abort();
+            result = false;
+            break;
+        }
+        if (!txn.commit()) {
+            errorString = txn.lastErrorString();
+            result = false;
+            break;
+        }
+        offset += batchSize;
+        chunks += static_cast<quint64>(ChunksPerTransaction);
+    }
+    pending.remove(0, offset);
+    if (!result && chunks == 0) {
+        // The transaction assigning the generation failed, so another one
+        // might get the same ID:
+        generation = 0;
+    }
+    return result;
+}
+
+/**
+ * @brief Remove all chunks written so far.
+ */
+void BlobWriterPrivate::discard()
+{
+    if (generation != 0) {
+        auto d = store->d_func();
+        d->database->removePrefix(d->chunkPrefix(key, generation));
+    }
+    pending.clear();
+    generation = 0;
+    chunks = 0;
+    size = 0;
+}
+
+} // namespace QLMDB
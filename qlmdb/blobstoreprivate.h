@@ -0,0 +1,112 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BLOBSTOREPRIVATE_H
+#define BLOBSTOREPRIVATE_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+
+#include "blobstore.h"
+#include "context.h"
+#include "database.h"
+
+namespace QLMDB {
+
+//! @private
+class BlobStorePrivate
+{
+public:
+    /**
+     * @brief Describes a stored blob.
+     */
+    struct Metadata {
+        quint64 size;       //!< The size of the blob in bytes.
+        quint32 chunkSize;  //!< The size of the chunks the blob is split into.
+        quint64 generation; //!< Distinguishes subsequent writes of the blob.
+    };
+
+    BlobStorePrivate();
+
+    Context *context;
+    QScopedPointer<Database> database;
+    int chunkSize;
+    int lastError;
+    QString lastErrorString;
+
+    static QByteArray metadataKey(const QByteArray &key);
+    static QByteArray chunkPrefix(const QByteArray &key, quint64 generation);
+    static QByteArray chunkKey(const QByteArray &key, quint64 generation,
+                               quint64 index);
+    static QByteArray prefixEnd(const QByteArray &prefix);
+    static QByteArray encodeMetadata(const Metadata &metadata);
+    static bool decodeMetadata(const QByteArray &data, Metadata &metadata);
+    static quint64 generation(Transaction &transaction);
+
+    int readMetadata(Transaction &transaction, const QByteArray &key,
+                     Metadata &metadata);
+    int read(Transaction &transaction, const QByteArray &key,
+             const Metadata &metadata, qint64 offset, char *data,
+             qint64 size);
+    int writeChunks(Transaction &transaction, const QByteArray &key,
+                    quint64 generation, quint32 chunkSize, quint64 index,
+                    const char *data, qint64 size);
+    int finish(Transaction &transaction, const QByteArray &key,
+               const Metadata &metadata);
+    void setError(int error, const QString &errorString);
+};
+
+
+//! @private
+class BlobReaderPrivate
+{
+public:
+    BlobReaderPrivate(BlobStore &store, Transaction *transaction,
+                      const QByteArray &key);
+
+    BlobStore *store;
+    Transaction *transaction;
+    QByteArray key;
+    BlobStorePrivate::Metadata metadata;
+    qint64 position;
+};
+
+
+//! @private
+class BlobWriterPrivate
+{
+public:
+    static const int ChunksPerTransaction;
+
+    BlobWriterPrivate(BlobStore &store, const QByteArray &key);
+
+    BlobStore *store;
+    QByteArray key;
+    QByteArray pending;
+    quint64 generation;
+    quint32 chunkSize;
+    quint64 chunks;
+    quint64 size;
+    QString errorString;
+
+    bool flush();
+    void discard();
+};
+
+} // namespace QLMDB
+
+#endif // BLOBSTOREPRIVATE_H
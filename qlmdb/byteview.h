@@ -0,0 +1,78 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BYTEVIEW_H
+#define BYTEVIEW_H
+
+#include <cstddef>
+#include <type_traits>
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <QByteArrayView>
+#endif
+
+#if defined(__has_include)
+#   if __has_include(<string_view>) && (__cplusplus >= 201703L || \
+        (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#       include <string_view>
+#       define QLMDB_HAS_STRING_VIEW
+#   endif
+#endif
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+/**
+ * @brief Identifies types which can be used as views on keys and values.
+ *
+ * The Database and Cursor classes provide overloads of their member
+ * functions which accept any type for which this trait is true. Such types
+ * refer to a contiguous range of bytes, which is accessed via their `data()`
+ * and `size()` member functions, without owning it. This allows to pass in
+ * keys and values held in other buffers without first copying them into a
+ * QByteArray.
+ *
+ * Out of the box, this is true for:
+ *
+ * - `QByteArrayView` (when building against Qt 6)
+ * - `std::string_view` (when building with C++17 or later)
+ * - `QByteArray`, so byte arrays can be mixed with views in one call
+ *
+ * Further types can be added by specializing the trait.
+ */
+template<typename T>
+struct IsByteView : std::false_type {};
+
+template<>
+struct IsByteView<QByteArray> : std::true_type {};
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+template<>
+struct IsByteView<QByteArrayView> : std::true_type {};
+#endif
+
+#ifdef QLMDB_HAS_STRING_VIEW
+template<>
+struct IsByteView<std::string_view> : std::true_type {};
+#endif
+
+} // namespace QLMDB
+
+#endif // BYTEVIEW_H
@@ -0,0 +1,272 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+
+#include "changelog.h"
+#include "changelogprivate.h"
+#include "context.h"
+#include "cursor.h"
+#include "database.h"
+#include "errors.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+/**
+ * @class ChangeLog
+ * @brief Read the log of writes made to a Context.
+ *
+ * If the change log is enabled via Context::enableChangeLog(), each write
+ * made via a Database or Cursor is appended to a log in the same
+ * transaction as the write itself. Hence, the log contains exactly the
+ * committed writes, in the order they were committed. Consumers like caches
+ * or search indexers can use it to update incrementally instead of
+ * re-scanning whole databases:
+ *
+ * ```
+ * ChangeLog log(ctx);
+ * quint64 position = loadPosition();
+ * for (auto entry : log.read(position + 1)) {
+ *     switch (entry.operation) {
+ *     case ChangeLog::Put:
+ *         cache.insert(entry.database, entry.key, entry.value);
+ *         break;
+ *     // ...
+ *     }
+ *     position = entry.sequence;
+ * }
+ * savePosition(position);
+ * ```
+ *
+ * Each Entry has a unique, increasing sequence number, starting with 1.
+ * Bulk operations are logged as a single entry: Database::removeRange()
+ * yields a RemoveRange, Database::removePrefix() a RemovePrefix and
+ * Database::clear() a Clear entry. Writes made by an Index to its own
+ * database are not logged, as they can be derived from the primary.
+ *
+ * The log grows until it is truncated. Once all consumers processed the
+ * entries up to some sequence number, call truncate() to remove them.
+ *
+ * The log is stored in the database named by DatabaseName.
+ */
+
+
+/**
+ * @brief The name of the database the change log is stored in.
+ */
+const char *ChangeLog::DatabaseName = "qlmdb.changelog";
+
+
+/**
+ * @brief Constructor.
+ *
+ * Opens the change log of the @p context. This works regardless of
+ * whether the change log is enabled in the @p context, so a separate,
+ * read-only consumer can read the log written by another process.
+ */
+ChangeLog::ChangeLog(Context &context) :
+    d_ptr(new ChangeLogPrivate)
+{
+    Q_D(ChangeLog);
+    d->database = context.database(DatabaseName);
+    if (d->database == nullptr) {
+        d->lastError = Errors::NotFound;
+        d->lastErrorString = QObject::tr("Unable to open the change log");
+    } else {
+        d->context = &context;
+    }
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ChangeLog::~ChangeLog()
+{
+}
+
+
+/**
+ * @brief Indicates if the change log could be opened.
+ */
+bool ChangeLog::isValid() const
+{
+    const Q_D(ChangeLog);
+    return d->context != nullptr && d->database->isValid();
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int ChangeLog::lastError() const
+{
+    const Q_D(ChangeLog);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString ChangeLog::lastErrorString() const
+{
+    const Q_D(ChangeLog);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void ChangeLog::clearLastError()
+{
+    Q_D(ChangeLog);
+    d->lastError = Errors::NoError;
+    d->lastErrorString.clear();
+}
+
+
+/**
+ * @brief Read entries from the log.
+ *
+ * Returns up to @p maxEntries entries with a sequence number greater than
+ * or equal to @p from, ordered by their sequence numbers. To tail the log,
+ * call this repeatedly, passing the sequence number following the one of
+ * the last entry processed.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QList<ChangeLog::Entry> ChangeLog::read(quint64 from, int maxEntries)
+{
+    Q_D(ChangeLog);
+    QList<Entry> result;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = read(txn, from, maxEntries);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Read entries from the log.
+ *
+ * This is an overloaded version of read(). It runs the operation in the
+ * given @p transaction.
+ */
+QList<ChangeLog::Entry> ChangeLog::read(Transaction &transaction,
+                                        quint64 from, int maxEntries)
+{
+    Q_D(ChangeLog);
+    QList<Entry> result;
+    if (isValid() && transaction.isValid()) {
+        Cursor cursor(transaction, *d->database);
+        auto item = cursor.findFirstAfter(d->sequenceKey(from));
+        while (item.isValid() && result.length() < maxEntries) {
+            Entry entry;
+            if (!d->decode(item.key(), item.value(), entry)) {
+                d->lastError = Errors::Corrupted;
+                d->lastErrorString = QObject::tr("Invalid entry in the "
+                                                 "change log");
+                return result;
+            }
+            result << entry;
+            item = cursor.next();
+        }
+        if (cursor.lastError() == Errors::NoError ||
+                cursor.lastError() == Errors::NotFound) {
+            clearLastError();
+        } else {
+            d->lastError = cursor.lastError();
+            d->lastErrorString = cursor.lastErrorString();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief The sequence number of the last entry in the log.
+ *
+ * Returns 0 if the log is empty or an error occurred.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+quint64 ChangeLog::lastSequence()
+{
+    Q_D(ChangeLog);
+    quint64 result = 0;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = lastSequence(txn);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The sequence number of the last entry in the log.
+ *
+ * This is an overloaded version of lastSequence(). It runs the operation
+ * in the given @p transaction.
+ */
+quint64 ChangeLog::lastSequence(Transaction &transaction)
+{
+    Q_D(ChangeLog);
+    quint64 result = 0;
+    if (isValid() && transaction.isValid()) {
+        Cursor cursor(transaction, *d->database);
+        auto item = cursor.last();
+        Entry entry;
+        if (item.isValid() && d->decode(item.key(), item.value(), entry)) {
+            result = entry.sequence;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove old entries from the log.
+ *
+ * This removes all entries with a sequence number less than @p before and
+ * returns the number of removed entries. The last entry is always kept, as
+ * the sequence number of the next entry is derived from it. Hence,
+ * sequence numbers are never reused.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t ChangeLog::truncate(quint64 before)
+{
+    Q_D(ChangeLog);
+    size_t result = 0;
+    if (isValid()) {
+        before = qMin(before, lastSequence());
+        result = d->database->removeRange(QByteArray(),
+                                          d->sequenceKey(before));
+        d->lastError = d->database->lastError();
+        d->lastErrorString = d->database->lastErrorString();
+    }
+    return result;
+}
+
+} // namespace QLMDB
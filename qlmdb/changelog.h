@@ -0,0 +1,84 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHANGELOG_H
+#define CHANGELOG_H
+
+#include <QByteArray>
+#include <QList>
+#include <QScopedPointer>
+#include <QString>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class ChangeLogPrivate;
+class Context;
+class Transaction;
+
+class QLMDBSHARED_EXPORT ChangeLog
+{
+public:
+    static const char *DatabaseName;
+
+    /**
+     * @brief The kind of write recorded in an Entry.
+     */
+    enum Operation {
+        Put = 1,      //!< The key has been set to the value.
+        Remove,       //!< The key (or only the value, if set) was removed.
+        RemoveRange,  //!< Keys from key (incl.) to value (excl.) removed.
+        RemovePrefix, //!< All keys starting with key were removed.
+        Clear,        //!< All entries of the database were removed.
+        Drop          //!< The database was dropped.
+    };
+
+    /**
+     * @brief A single entry in the change log.
+     */
+    struct Entry {
+        quint64 sequence;    //!< The position of the entry in the log.
+        Operation operation; //!< The kind of write.
+        QString database;    //!< The name of the database written to.
+        QByteArray key;      //!< The key written (if any).
+        QByteArray value;    //!< The value written (if any).
+    };
+
+    explicit ChangeLog(Context &context);
+    virtual ~ChangeLog();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    QList<Entry> read(quint64 from, int maxEntries = 1000);
+    QList<Entry> read(Transaction &transaction, quint64 from,
+                      int maxEntries = 1000);
+    quint64 lastSequence();
+    quint64 lastSequence(Transaction &transaction);
+    size_t truncate(quint64 before);
+
+private:
+    QScopedPointer<ChangeLogPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ChangeLog)
+};
+
+} // namespace QLMDB
+
+#endif // CHANGELOG_H
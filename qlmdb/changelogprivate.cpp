@@ -0,0 +1,157 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtEndian>
+
+#include "changelogprivate.h"
+#include "cursorprivate.h"
+#include "errors.h"
+
+namespace QLMDB {
+
+namespace {
+
+// Entries are stored under their sequence number (as 64 bit big endian
+// integer, so they sort in order). The value is encoded as:
+//
+// - the operation (1 byte), with HasValueFlag set if a value is stored
+// - the length of the database name (16 bit big endian) and the name
+// - the length of the key (32 bit big endian) and the key
+// - the value (up to the end of the entry)
+const char HasValueFlag = '\x80';
+const int HeaderSize = 1 + 2 + 4;
+
+template<typename T>
+inline void appendBigEndian(QByteArray &buffer, T value)
+{
+    char bytes[sizeof(T)];
+    qToBigEndian<T>(value, bytes);
+    buffer.append(bytes, static_cast<int>(sizeof(T)));
+}
+
+} // namespace
+
+ChangeLogPrivate::ChangeLogPrivate() :
+    context(nullptr),
+    database(nullptr),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+QByteArray ChangeLogPrivate::sequenceKey(quint64 sequence)
+{
+    QByteArray result;
+    appendBigEndian<quint64>(result, sequence);
+    return result;
+}
+
+/**
+ * @brief Append an entry to the change @p log in the @p txn.
+ *
+ * The entry gets the sequence number following the one of the last entry
+ * in the log. As write transactions are serialized, sequence numbers are
+ * unique and appear in the order the transactions were committed.
+ */
+int ChangeLogPrivate::append(MDB_txn *txn, MDB_dbi log,
+                             const QByteArray &database,
+                             ChangeLog::Operation operation,
+                             const MDB_val *key, const MDB_val *value)
+{
+    MDB_cursor *cursor = nullptr;
+    auto result = mdb_cursor_open(txn, log, &cursor);
+    if (result != Errors::NoError) {
+        return result;
+    }
+    MDB_val k, v;
+    quint64 sequence = 1;
+    result = mdb_cursor_get(cursor, &k, &v, MDB_LAST);
+    if (result == Errors::NoError && k.mv_size == sizeof(quint64)) {
+        sequence = qFromBigEndian<quint64>(k.mv_data) + 1;
+    } else if (result == Errors::NotFound) {
+        result = Errors::NoError;
+    }
+    if (result == Errors::NoError) {
+        auto keySize = key != nullptr ? key->mv_size : 0;
+        auto valueSize = value != nullptr ? value->mv_size : 0;
+        QByteArray entry;
+        entry.reserve(HeaderSize + database.size() +
+                      static_cast<int>(keySize + valueSize));
+        auto op = static_cast<char>(operation);
+        if (value != nullptr) {
+            op |= HasValueFlag;
+        }
+        entry.append(op);
+        appendBigEndian<quint16>(entry, static_cast<quint16>(database.size()));
+        entry.append(database);
+        appendBigEndian<quint32>(entry, static_cast<quint32>(keySize));
+        if (keySize > 0) {
+            entry.append(static_cast<const char*>(key->mv_data),
+                         static_cast<int>(keySize));
+        }
+        if (valueSize > 0) {
+            entry.append(static_cast<const char*>(value->mv_data),
+                         static_cast<int>(valueSize));
+        }
+        auto sequenceData = sequenceKey(sequence);
+        k = bytearray_to_value(sequenceData);
+        v = bytearray_to_value(entry);
+        // Sequence numbers only grow, so the entry can always be appended
+        // without searching the tree:
+        result = mdb_cursor_put(cursor, &k, &v, MDB_APPEND);
+    }
+    mdb_cursor_close(cursor);
+    return result;
+}
+
+/**
+ * @brief Decode a change log entry.
+ *
+ * Returns false if the @p key and @p value do not form a valid entry.
+ */
+bool ChangeLogPrivate::decode(const QByteArray &key, const QByteArray &value,
+                              ChangeLog::Entry &entry)
+{
+    if (key.size() != sizeof(quint64) || value.size() < HeaderSize) {
+        return false;
+    }
+    auto data = value.constData();
+    auto size = value.size();
+    entry.sequence = qFromBigEndian<quint64>(key.constData());
+    bool hasValue = data[0] & HasValueFlag;
+    entry.operation = static_cast<ChangeLog::Operation>(
+                data[0] & ~HasValueFlag);
+    int nameSize = qFromBigEndian<quint16>(data + 1);
+    if (HeaderSize + nameSize > size) {
+        return false;
+    }
+    entry.database = QString::fromUtf8(data + 3, nameSize);
+    auto keySize = static_cast<qint64>(
+                qFromBigEndian<quint32>(data + 3 + nameSize));
+    auto offset = 3 + nameSize + 4;
+    if (offset + keySize > size) {
+        return false;
+    }
+    entry.key = QByteArray(data + offset, static_cast<int>(keySize));
+    offset += static_cast<int>(keySize);
+    entry.value = hasValue ? QByteArray(data + offset, size - offset)
+                           : QByteArray();
+    return true;
+}
+
+} // namespace QLMDB
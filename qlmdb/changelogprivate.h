@@ -0,0 +1,52 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CHANGELOGPRIVATE_H
+#define CHANGELOGPRIVATE_H
+
+#include "lmdb.h"
+
+#include <QByteArray>
+#include <QString>
+
+#include "changelog.h"
+
+namespace QLMDB {
+
+class Database;
+
+//! @private
+class ChangeLogPrivate
+{
+public:
+    ChangeLogPrivate();
+
+    Context *context;
+    Database *database;
+    int lastError;
+    QString lastErrorString;
+
+    static QByteArray sequenceKey(quint64 sequence);
+    static int append(MDB_txn *txn, MDB_dbi log, const QByteArray &database,
+                      ChangeLog::Operation operation, const MDB_val *key,
+                      const MDB_val *value);
+    static bool decode(const QByteArray &key, const QByteArray &value,
+                       ChangeLog::Entry &entry);
+};
+
+} // namespace QLMDB
+
+#endif // CHANGELOGPRIVATE_H
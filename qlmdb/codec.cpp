@@ -0,0 +1,132 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "codec.h"
+#include "errors.h"
+
+namespace QLMDB {
+
+/**
+ * @class Codec
+ * @brief Encodes values before they are stored in a database.
+ *
+ * A codec transforms values, e.g. by compressing them. Codecs are used by
+ * the CompressedDatabase class. Implement this interface to plug in other
+ * algorithms like LZ4 or zstd. Codecs may be used by several threads at
+ * once, so encode() and decode() must be thread safe.
+ *
+ * @sa ZlibCodec
+ */
+
+
+/**
+ * @brief Destructor.
+ */
+Codec::~Codec()
+{
+}
+
+
+/**
+ * @brief Handle a failed decode() of the @p data.
+ *
+ * Codecs depending on state stored in the database, like the dictionaries
+ * of a DictionaryCodec, can load the state missing to decode the @p data
+ * here. If the @p transaction is not null, it is the one the @p data has
+ * been read in. Return Errors::NoError to have decode() retried once,
+ * Errors::NotFound if the state needed does not exist or
+ * Errors::Corrupted if the @p data is invalid.
+ *
+ * The default implementation returns Errors::Corrupted.
+ */
+int Codec::decodeFailed(Transaction *transaction,
+                        const QByteArray &data) const
+{
+    Q_UNUSED(transaction);
+    Q_UNUSED(data);
+    return Errors::Corrupted;
+}
+
+
+/**
+ * @class ZlibCodec
+ * @brief A Codec compressing values using zlib.
+ *
+ * This codec uses qCompress() and qUncompress(), so no additional
+ * dependencies are needed. It works best for values of at least a few
+ * hundred bytes, like JSON documents.
+ */
+
+
+/**
+ * @brief The ID of the ZlibCodec.
+ */
+const quint8 ZlibCodec::Id = 1;
+
+
+/**
+ * @brief Constructor.
+ *
+ * The compression @p level ranges from 0 (no compression) to 9 (best
+ * compression). The default of -1 uses the default level of zlib.
+ */
+ZlibCodec::ZlibCodec(int level) :
+    compressionLevel(level)
+{
+}
+
+
+/**
+ * @brief The compression level.
+ */
+int ZlibCodec::level() const
+{
+    return compressionLevel;
+}
+
+
+/**
+ * @brief The ID of the codec.
+ *
+ * This is ZlibCodec::Id.
+ */
+quint8 ZlibCodec::id() const
+{
+    return Id;
+}
+
+
+/**
+ * @brief Compress the @p value.
+ */
+bool ZlibCodec::encode(const QByteArray &value, QByteArray &result) const
+{
+    result = qCompress(value, compressionLevel);
+    return !result.isEmpty();
+}
+
+
+/**
+ * @brief Uncompress the @p data.
+ */
+bool ZlibCodec::decode(const QByteArray &data, QByteArray &result) const
+{
+    result = qUncompress(data);
+    return !result.isEmpty();
+}
+
+} // namespace QLMDB
@@ -0,0 +1,85 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CODEC_H
+#define CODEC_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Transaction;
+
+class QLMDBSHARED_EXPORT Codec
+{
+public:
+    virtual ~Codec();
+
+    /**
+     * @brief The ID of the codec.
+     *
+     * The ID is stored in front of each encoded value, so the value can be
+     * decoded later on. It must be unique among the codecs used for a
+     * database and must not change. The ID 0 is reserved for values
+     * stored as is.
+     */
+    virtual quint8 id() const = 0;
+
+    /**
+     * @brief Encode the @p value.
+     *
+     * Stores the encoded value in @p result and returns true on success.
+     * If the value cannot be encoded, false is returned.
+     */
+    virtual bool encode(const QByteArray &value, QByteArray &result) const = 0;
+
+    /**
+     * @brief Decode the @p data.
+     *
+     * Stores the decoded value in @p result and returns true on success or
+     * false if the @p data is invalid. The @p data might point into the
+     * memory map of LMDB; it must not be referenced by the @p result.
+     */
+    virtual bool decode(const QByteArray &data, QByteArray &result) const = 0;
+
+    virtual int decodeFailed(Transaction *transaction,
+                             const QByteArray &data) const;
+};
+
+
+class QLMDBSHARED_EXPORT ZlibCodec : public Codec
+{
+public:
+    static const quint8 Id;
+
+    explicit ZlibCodec(int level = -1);
+
+    int level() const;
+
+    quint8 id() const override;
+    bool encode(const QByteArray &value, QByteArray &result) const override;
+    bool decode(const QByteArray &data, QByteArray &result) const override;
+
+private:
+    int compressionLevel;
+};
+
+} // namespace QLMDB
+
+#endif // CODEC_H
@@ -0,0 +1,419 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+
+#include "codec.h"
+#include "compresseddatabase.h"
+#include "compresseddatabaseprivate.h"
+#include "cursor.h"
+#include "errors.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+/**
+ * @class CompressedDatabase
+ * @brief A database which compresses its values.
+ *
+ * The CompressedDatabase class wraps a Database and transparently encodes
+ * values when storing them and decodes them when reading them back:
+ *
+ * ```
+ * Context ctx;
+ * ctx.setPath("/tmp/db/");
+ * ctx.setMaxDBs(10);
+ * if (ctx.open()) {
+ *     CompressedDatabase documents(ctx, "documents");
+ *     documents.put("doc-1", QJsonDocument(json).toJson());
+ *     auto data = documents.get("doc-1");
+ * }
+ * ```
+ *
+ * By default, values are compressed using a ZlibCodec. Other algorithms
+ * can be plugged in by passing another Codec to the constructor. Each
+ * stored value starts with a header byte holding the ID of the codec
+ * used to encode it (or 0 if it is stored as is). Hence, values written
+ * with another codec can still be read, provided the codec has been
+ * registered via addCodec().
+ *
+ * Compressing small values rarely pays off. Hence, values smaller than
+ * the threshold() are stored as is. Values which do not get smaller when
+ * being encoded are stored as is as well.
+ *
+ * Compression trades CPU time for a smaller database. For compressible
+ * values like JSON documents, more of the data fits into the page cache,
+ * which usually saves more time on reads than decompressing costs.
+ *
+ * The database must only be written via this class. Values read via a
+ * Cursor on the underlying database() can be decoded using decode(), and
+ * values written via a Cursor must be encoded using encode(). The
+ * database cannot hold multiple values per key, as encoded values would
+ * not sort like the original ones.
+ */
+
+
+/**
+ * @brief Values smaller than this are stored as is by default.
+ */
+const int CompressedDatabase::DefaultThreshold = 64;
+
+
+/**
+ * @brief Open a CompressedDatabase.
+ *
+ * This opens (and if needed creates) the database @p name in the given
+ * @p context. New values are encoded using the @p codec. If no codec is
+ * given, a ZlibCodec is used. If opening the database succeeded,
+ * isValid() is true. The database is invalid and lastError() is
+ * Errors::InvalidParameter if the @p codec uses the reserved ID 0.
+ *
+ * Make sure there is no active Transaction ongoing in the current thread
+ * when using this constructor.
+ */
+CompressedDatabase::CompressedDatabase(Context &context, const QString &name,
+                                       QSharedPointer<Codec> codec) :
+    d_ptr(new CompressedDatabasePrivate)
+{
+    Q_D(CompressedDatabase);
+    if (codec.isNull()) {
+        codec.reset(new ZlibCodec);
+    }
+    bool codecAdded = addCodec(codec);
+    if (codecAdded) {
+        d->codec = codec;
+    }
+    d->database.reset(new Database(context, name));
+    if (!d->database->isValid()) {
+        d->setError(d->database->lastError(),
+                    d->database->lastErrorString());
+        return;
+    }
+    if (!codecAdded) {
+        return;
+    }
+    d->context = &context;
+}
+
+
+/**
+ * @brief Destructor.
+ */
+CompressedDatabase::~CompressedDatabase()
+{
+}
+
+
+/**
+ * @brief Is the database valid.
+ */
+bool CompressedDatabase::isValid() const
+{
+    const Q_D(CompressedDatabase);
+    return d->context != nullptr && d->database->isValid();
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int CompressedDatabase::lastError() const
+{
+    const Q_D(CompressedDatabase);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString CompressedDatabase::lastErrorString() const
+{
+    const Q_D(CompressedDatabase);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void CompressedDatabase::clearLastError()
+{
+    Q_D(CompressedDatabase);
+    d->setError(Errors::NoError, QString());
+}
+
+
+/**
+ * @brief The underlying database.
+ *
+ * Use it e.g. to iterate over the entries using a Cursor or to remove
+ * ranges of keys. Values read from it must be decoded using decode().
+ */
+Database *CompressedDatabase::database() const
+{
+    const Q_D(CompressedDatabase);
+    return d->database.data();
+}
+
+
+/**
+ * @brief The codec used to encode new values.
+ */
+QSharedPointer<Codec> CompressedDatabase::codec() const
+{
+    const Q_D(CompressedDatabase);
+    return d->codec;
+}
+
+
+/**
+ * @brief Register a @p codec for decoding values.
+ *
+ * Values are decoded by the codec matching the ID stored with them. The
+ * codec used for encoding is registered automatically. Use this to read
+ * values which have been written using another codec, e.g. after
+ * switching to another compression algorithm. A codec registered
+ * earlier with the same ID is replaced.
+ *
+ * The ID 0 is reserved for values stored as is. If the @p codec is null or
+ * uses this ID, it is not registered, lastError() is set to
+ * Errors::InvalidParameter and false is returned.
+ *
+ * The codecs must not be changed while the database is used by other
+ * threads.
+ */
+bool CompressedDatabase::addCodec(QSharedPointer<Codec> codec)
+{
+    Q_D(CompressedDatabase);
+    if (codec.isNull()) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("No codec given"));
+        return false;
+    }
+    if (codec->id() == CompressedDatabasePrivate::RawId) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("The codec ID %1 is reserved for values "
+                                "stored as is")
+                    .arg(QString::number(codec->id())));
+        return false;
+    }
+    d->codecs.insert(codec->id(), codec);
+    return true;
+}
+
+
+/**
+ * @brief The size (in bytes) below which values are stored as is.
+ *
+ * @sa setThreshold()
+ */
+int CompressedDatabase::threshold() const
+{
+    const Q_D(CompressedDatabase);
+    return d->threshold;
+}
+
+
+/**
+ * @brief Set the size below which values are stored as is.
+ *
+ * Values smaller than @p threshold bytes are not encoded. The default is
+ * DefaultThreshold. Changing the threshold does not affect values already
+ * stored.
+ */
+void CompressedDatabase::setThreshold(int threshold)
+{
+    Q_D(CompressedDatabase);
+    d->threshold = threshold;
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * Returns true on success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool CompressedDatabase::put(const QByteArray &key, const QByteArray &value)
+{
+    Q_D(CompressedDatabase);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context);
+        result = put(txn, key, value);
+        if (!result) {
+            txn.abort();
+        } else if (!txn.commit()) {
+            d->setError(txn.lastError(), txn.lastErrorString());
+            result = false;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * This is an overloaded version of put(). It runs the operation in the
+ * given @p transaction.
+ */
+bool CompressedDatabase::put(Transaction &transaction, const QByteArray &key,
+                             const QByteArray &value)
+{
+    Q_D(CompressedDatabase);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        result = d->database->put(transaction, key, d->encode(value));
+        d->setError(d->database->lastError(), d->database->lastErrorString());
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * If the key is not in the database, a null byte array is returned and
+ * lastError() is set to Errors::NotFound.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArray CompressedDatabase::get(const QByteArray &key)
+{
+    Q_D(CompressedDatabase);
+    QByteArray result;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = get(txn, key);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * This is an overloaded version of get(). It runs the operation in the
+ * given @p transaction.
+ */
+QByteArray CompressedDatabase::get(Transaction &transaction,
+                                   const QByteArray &key)
+{
+    Q_D(CompressedDatabase);
+    QByteArray result;
+    if (isValid() && transaction.isValid()) {
+        Cursor cursor(transaction, *d->database);
+        auto current = cursor.findKey(key);
+        if (current.isValid()) {
+            // Decode directly from the memory map:
+            auto value = current.value();
+            if (d->decode(&transaction, value.constData(), value.size(),
+                          result)) {
+                d->setError(Errors::NoError, QString());
+            } else {
+                result = QByteArray();
+            }
+        } else {
+            d->setError(cursor.lastError(), cursor.lastErrorString());
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p key from the database.
+ *
+ * Returns true on success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool CompressedDatabase::remove(const QByteArray &key)
+{
+    Q_D(CompressedDatabase);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context);
+        result = remove(txn, key);
+        if (!result) {
+            txn.abort();
+        } else if (!txn.commit()) {
+            d->setError(txn.lastError(), txn.lastErrorString());
+            result = false;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p key from the database.
+ *
+ * This is an overloaded version of remove(). It runs the operation in the
+ * given @p transaction.
+ */
+bool CompressedDatabase::remove(Transaction &transaction,
+                                const QByteArray &key)
+{
+    Q_D(CompressedDatabase);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        result = d->database->remove(transaction, key);
+        d->setError(d->database->lastError(), d->database->lastErrorString());
+    }
+    return result;
+}
+
+
+/**
+ * @brief Encode the @p value the way put() stores it.
+ *
+ * Use this to write values via a Cursor on the underlying database().
+ */
+QByteArray CompressedDatabase::encode(const QByteArray &value)
+{
+    Q_D(CompressedDatabase);
+    return d->encode(value);
+}
+
+
+/**
+ * @brief Decode the stored @p data.
+ *
+ * Use this to decode values read via a Cursor on the underlying
+ * database(). If the @p data cannot be decoded, a null byte array is
+ * returned and lastError() is set accordingly.
+ */
+QByteArray CompressedDatabase::decode(const QByteArray &data)
+{
+    Q_D(CompressedDatabase);
+    QByteArray result;
+    if (d->decode(nullptr, data.constData(), data.size(), result)) {
+        d->setError(Errors::NoError, QString());
+    } else {
+        result = QByteArray();
+    }
+    return result;
+}
+
+} // namespace QLMDB
@@ -0,0 +1,75 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef COMPRESSEDDATABASE_H
+#define COMPRESSEDDATABASE_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Codec;
+class CompressedDatabasePrivate;
+class Context;
+class Database;
+class Transaction;
+
+class QLMDBSHARED_EXPORT CompressedDatabase
+{
+public:
+    static const int DefaultThreshold;
+
+    explicit CompressedDatabase(
+            Context &context, const QString &name = QString(),
+            QSharedPointer<Codec> codec = QSharedPointer<Codec>());
+    virtual ~CompressedDatabase();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    Database *database() const;
+    QSharedPointer<Codec> codec() const;
+    bool addCodec(QSharedPointer<Codec> codec);
+    int threshold() const;
+    void setThreshold(int threshold);
+
+    bool put(const QByteArray &key, const QByteArray &value);
+    bool put(Transaction &transaction, const QByteArray &key,
+             const QByteArray &value);
+    QByteArray get(const QByteArray &key);
+    QByteArray get(Transaction &transaction, const QByteArray &key);
+    bool remove(const QByteArray &key);
+    bool remove(Transaction &transaction, const QByteArray &key);
+
+    QByteArray encode(const QByteArray &value);
+    QByteArray decode(const QByteArray &data);
+
+private:
+    QScopedPointer<CompressedDatabasePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(CompressedDatabase)
+};
+
+} // namespace QLMDB
+
+#endif // COMPRESSEDDATABASE_H
@@ -0,0 +1,121 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+
+#include "compresseddatabaseprivate.h"
+#include "errors.h"
+
+namespace QLMDB {
+
+// Values stored as is are marked with this codec ID:
+const quint8 CompressedDatabasePrivate::RawId = 0;
+
+CompressedDatabasePrivate::CompressedDatabasePrivate() :
+    context(nullptr),
+    database(),
+    codec(),
+    codecs(),
+    threshold(CompressedDatabase::DefaultThreshold),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+/**
+ * @brief Encode the @p value for storing it in the database.
+ *
+ * The result starts with the ID of the codec used. The value is stored
+ * as is if it is smaller than the threshold or encoding it did not make
+ * it smaller.
+ */
+QByteArray CompressedDatabasePrivate::encode(const QByteArray &value) const
+{
+    QByteArray result;
+    QByteArray encoded;
+    if (!codec.isNull() && value.size() >= threshold && !value.isEmpty() &&
+            codec->encode(value, encoded) && encoded.size() < value.size()) {
+        result.reserve(encoded.size() + 1);
+        result.append(static_cast<char>(codec->id()));
+        result.append(encoded);
+    } else {
+        result.reserve(value.size() + 1);
+        result.append(static_cast<char>(RawId));
+        result.append(value);
+    }
+    return result;
+}
+
+/**
+ * @brief Decode a stored value.
+ *
+ * The @p data might point into the memory map. The @p result is a deep
+ * copy in any case. If the @p transaction is not null, it is the one the
+ * @p data has been read in; codecs use it to load state they are missing
+ * (see Codec::decodeFailed()).
+ */
+bool CompressedDatabasePrivate::decode(Transaction *transaction,
+                                       const char *data, int size,
+                                       QByteArray &result)
+{
+    if (size < 1) {
+        setError(Errors::Corrupted,
+                 QObject::tr("Missing codec ID in stored value"));
+        return false;
+    }
+    auto id = static_cast<quint8>(data[0]);
+    if (id == RawId) {
+        result = QByteArray(data + 1, size - 1);
+        return true;
+    }
+    auto decoder = codecs.value(id);
+    if (decoder.isNull()) {
+        setError(Errors::InvalidParameter,
+                 QObject::tr("No codec with ID %1 available")
+                 .arg(QString::number(id)));
+        return false;
+    }
+    auto encoded = QByteArray::fromRawData(data + 1, size - 1);
+    if (decoder->decode(encoded, result)) {
+        return true;
+    }
+    auto error = decoder->decodeFailed(transaction, encoded);
+    if (error == Errors::NoError && decoder->decode(encoded, result)) {
+        return true;
+    }
+    if (error == Errors::NotFound) {
+        setError(Errors::NotFound,
+                 QObject::tr("State needed to decode value using codec %1 "
+                             "not found")
+                 .arg(QString::number(id)));
+    } else {
+        setError(Errors::Corrupted,
+                 QObject::tr("Failed to decode value using codec %1")
+                 .arg(QString::number(id)));
+    }
+    return false;
+}
+
+void CompressedDatabasePrivate::setError(int error,
+                                         const QString &errorString)
+{
+    lastError = error;
+    lastErrorString = errorString;
+}
+
+} // namespace QLMDB
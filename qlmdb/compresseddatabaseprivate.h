@@ -0,0 +1,57 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef COMPRESSEDDATABASEPRIVATE_H
+#define COMPRESSEDDATABASEPRIVATE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+
+#include "codec.h"
+#include "compresseddatabase.h"
+#include "context.h"
+#include "database.h"
+
+namespace QLMDB {
+
+//! @private
+class CompressedDatabasePrivate
+{
+public:
+    CompressedDatabasePrivate();
+
+    static const quint8 RawId;
+
+    Context *context;
+    QScopedPointer<Database> database;
+    QSharedPointer<Codec> codec;
+    QHash<quint8, QSharedPointer<Codec>> codecs;
+    int threshold;
+    int lastError;
+    QString lastErrorString;
+
+    QByteArray encode(const QByteArray &value) const;
+    bool decode(Transaction *transaction, const char *data, int size,
+                QByteArray &result);
+    void setError(int error, const QString &errorString);
+};
+
+} // namespace QLMDB
+
+#endif // COMPRESSEDDATABASEPRIVATE_H
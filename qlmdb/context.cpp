@@ -14,8 +14,24 @@
  * You should have received a copy of the GNU General Public License
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+
+#include <QDir>
+#include <QFile>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+#include "changelog.h"
 #include "context.h"
 #include "contextprivate.h"
+#include "database.h"
+#include "databaseprivate.h"
+#include "errors.h"
+#include "statisticsprivate.h"
+#include "transactionprivate.h"
 
 namespace QLMDB {
 
@@ -72,6 +88,8 @@ const unsigned int Context::NoLock = MDB_NOLOCK;
 
 /**
  * @brief Turn off readahead.
+ *
+ * @sa setAccessPattern()
  */
 const unsigned int Context::NoReadAhead = MDB_NORDAHEAD;
 
@@ -139,12 +157,30 @@ const unsigned int Context::NoMemInit = MDB_NOMEMINIT;
  * }
  * ```
  *
+ * ## Accessing Databases
+ *
+ * Opening a Database requires a write transaction (to create it if needed),
+ * so creating Database objects on demand, e.g. per request, serializes on
+ * the single writer lock of LMDB. Instead, use database() to get a Database
+ * which is cached by the context:
+ *
+ * ```
+ * auto users = ctx.database("users");
+ * if (users) {
+ *     auto user = users->get(userId);
+ * }
+ * ```
+ *
+ * Each database is opened only once, when it is requested for the first
+ * time. Afterwards, database() just looks it up by its name.
+ *
  * ## Notes About Multi-Threading
  *
  * After a context is configured and successfully opened, it may be used from
  * multiple threads to create further classes like a Transaction. However,
- * note that you must not call any non-const member function of the context as
- * there is no locking to ensure write access is serialized.
+ * note that you must not call any non-const member function of the context
+ * (except database()) as there is no locking to ensure write access is
+ * serialized.
  *
  * It is important to note, that a context (i.e. a path on disk) must
  * not be opened multiple times from within the same process. If you need
@@ -167,6 +203,11 @@ Context::Context() :
  */
 Context::~Context()
 {
+    Q_D(Context);
+    stopWatchdog();
+    // Close cached databases while the environment is still open:
+    qDeleteAll(d->databases);
+    qDeleteAll(d->droppedDatabases);
 }
 
 
@@ -417,10 +458,573 @@ bool Context::open()
                     d->openEnv()) {
                 d->open = true;
                 result = true;
+                d->applyMapAdvice();
             }
         }
     }
     return result;
 }
 
+
+/**
+ * @brief Get the database with the given @p name.
+ *
+ * This returns a Database owned by the context. The first call for a
+ * @p name opens the database using the given @p flags and comparison
+ * functions @p keyCompare and @p valueCompare (see the Database constructor
+ * for details). Subsequent calls return the same object without touching
+ * LMDB, so in particular no write transaction is needed to get a database
+ * which already has been opened. The flags and comparison functions are
+ * ignored in this case.
+ *
+ * If the database cannot be opened, a null pointer is returned. Opening is
+ * retried on the next call then.
+ *
+ * The returned Database is valid until the context is destroyed or the
+ * database is dropped. Do not delete it. Other Database objects opened for
+ * the same name share its handle, which stays open until all of them are
+ * gone. If it is dropped, the next call to this method opens the database
+ * again and returns a new object.
+ *
+ * This method may be called from multiple threads concurrently. The
+ * returned object is shared, though, and stores the error of the last
+ * operation. It must not be used by several threads at once; open a
+ * Database of their own in each thread instead.
+ */
+Database *Context::database(const QString &name, unsigned int flags,
+                            Database::CompareFunction keyCompare,
+                            Database::CompareFunction valueCompare)
+{
+    Q_D(Context);
+    {
+        QMutexLocker locker(&d->databasesLock);
+        auto db = d->databases.value(name, nullptr);
+        if (db != nullptr) {
+            if (db->isValid()) {
+                return db;
+            }
+            // The database has been dropped. Keep the object alive, as
+            // there might still be users of it, and re-open below.
+            d->databases.remove(name);
+            d->droppedDatabases.append(db);
+        }
+    }
+
+    // Open the database without holding the lock: This might need a write
+    // transaction (when creating the database or if this thread already has
+    // a read transaction), and another thread owning the writer lock might
+    // call us at the same time.
+    auto db = new Database(*this, name, flags, keyCompare, valueCompare);
+    if (!db->isValid()) {
+        delete db;
+        return nullptr;
+    }
+
+    QMutexLocker locker(&d->databasesLock);
+    auto existing = d->databases.value(name, nullptr);
+    if (existing != nullptr && existing->isValid()) {
+        // Another thread opened the database in the meantime. Both refer
+        // to the same handle, which stays open as long as one of them
+        // exists:
+        delete db;
+        return existing;
+    }
+    if (existing != nullptr) {
+        d->droppedDatabases.append(existing);
+    }
+    d->databases.insert(name, db);
+    return db;
+}
+
+
+/**
+ * @brief Record all writes in the change log.
+ *
+ * After calling this, all writes made via Database and Cursor objects are
+ * appended to the change log in the transaction they are made in. Use a
+ * ChangeLog to read them. See the ChangeLog class for details.
+ *
+ * The change log is stored in a database of its own, so maxDBs() must
+ * account for it. The setting is not persistent: Each Context writing to
+ * the environment must enable the change log after opening it. Enable it
+ * before passing the context to other threads.
+ *
+ * Returns true if the change log has been enabled or false otherwise.
+ */
+bool Context::enableChangeLog()
+{
+    Q_D(Context);
+    if (d->changeLog == nullptr && d->open) {
+        d->changeLog = database(ChangeLog::DatabaseName);
+        if (d->changeLog == nullptr) {
+            d->lastError = Errors::NotFound;
+            d->lastErrorString = QObject::tr("Failed to open the change log");
+        }
+    }
+    return d->changeLog != nullptr;
+}
+
+
+/**
+ * @brief Indicates if writes are recorded in the change log.
+ *
+ * @sa enableChangeLog()
+ */
+bool Context::isChangeLogEnabled() const
+{
+    const Q_D(Context);
+    return d->changeLog != nullptr;
+}
+
+
+/**
+ * @brief Enable or disable recording operation statistics.
+ *
+ * While enabled, the context counts transactions, reads, writes and
+ * cursor steps and records their durations and errors. This costs a few
+ * atomic increments and two clock readings per operation, so statistics
+ * are disabled by default. Disabling them keeps the numbers recorded so
+ * far.
+ *
+ * @sa statistics(), Statistics
+ */
+void Context::setStatisticsEnabled(bool enabled)
+{
+    Q_D(Context);
+    QMutexLocker locker(&d->statisticsLock);
+    if (enabled && d->statistics.isNull()) {
+        d->statistics.reset(new StatisticsRecorder);
+    }
+    d->statisticsEnabled.storeRelease(enabled ? 1 : 0);
+}
+
+
+/**
+ * @brief Indicates if operation statistics are recorded.
+ *
+ * @sa setStatisticsEnabled()
+ */
+bool Context::isStatisticsEnabled() const
+{
+    const Q_D(Context);
+    return d->statisticsEnabled.loadAcquire() != 0;
+}
+
+
+/**
+ * @brief A snapshot of the operation statistics recorded so far.
+ *
+ * If statistics have never been enabled, the result is empty.
+ */
+Statistics Context::statistics() const
+{
+    const Q_D(Context);
+    QMutexLocker locker(&d->statisticsLock);
+    Statistics result;
+    if (!d->statistics.isNull()) {
+        result = d->statistics->snapshot();
+    }
+    return result;
+}
+
+
+/**
+ * @brief Set all operation statistics back to zero.
+ *
+ * Operations finishing concurrently might still be counted.
+ */
+void Context::resetStatistics()
+{
+    Q_D(Context);
+    QMutexLocker locker(&d->statisticsLock);
+    if (!d->statistics.isNull()) {
+        d->statistics->reset();
+    }
+}
+
+/**
+ * @brief The threshold (in milliseconds) above which operations are
+ * reported.
+ *
+ * @sa setSlowOperationThreshold()
+ */
+int Context::slowOperationThreshold() const
+{
+    const Q_D(Context);
+    return d->slowOperationThreshold.loadAcquire();
+}
+
+
+/**
+ * @brief Report operations taking longer than @p msecs milliseconds.
+ *
+ * Once set, the following operations are reported if they take at least
+ * the given time:
+ *
+ * - Committing a write Transaction. The report includes the number of
+ *   bytes of keys and values written via Database::put() and
+ *   Cursor::put().
+ * - Read-only transactions, measured from their creation until they are
+ *   committed or aborted. Long-lived readers prevent LMDB from reusing
+ *   pages freed by later writes, so the database file grows.
+ * - Cursors, measured from their creation (or renewal) until they are
+ *   destroyed or renewed. The report includes the database name and the
+ *   number of steps the cursor made.
+ *
+ * Reports are passed to the handler set via setSlowOperationHandler().
+ * Without a handler, they are logged as warnings in the `qlmdb.slow`
+ * logging category. A threshold of 0 (the default) disables reporting.
+ * Only transactions and cursors created after setting the threshold are
+ * measured.
+ */
+void Context::setSlowOperationThreshold(int msecs)
+{
+    Q_D(Context);
+    d->slowOperationThreshold.storeRelease(qMax(msecs, 0));
+}
+
+
+/**
+ * @brief Set the @p handler receiving reports of slow operations.
+ *
+ * Pass an empty handler to log reports again.
+ *
+ * @sa setSlowOperationThreshold()
+ */
+void Context::setSlowOperationHandler(SlowOperationHandler handler)
+{
+    Q_D(Context);
+    QMutexLocker locker(&d->slowOperationLock);
+    d->slowOperationHandler = handler;
+}
+
+
+
+/**
+ * @brief Enable or disable tracking open transactions.
+ *
+ * While enabled, the context keeps a list of all open transactions, which
+ * can be retrieved via activeTransactions(). This costs a lock and a
+ * hash lookup when beginning and ending a transaction, so tracking is
+ * disabled by default. Only transactions created after enabling it are
+ * tracked. Disabling it clears the list.
+ *
+ * @sa startWatchdog()
+ */
+void Context::setTransactionTrackingEnabled(bool enabled)
+{
+    Q_D(Context);
+    QMutexLocker locker(&d->transactionsLock);
+    d->transactionTracking.storeRelease(enabled ? 1 : 0);
+    if (!enabled) {
+        d->transactions.clear();
+    }
+}
+
+
+/**
+ * @brief Indicates if open transactions are tracked.
+ *
+ * @sa setTransactionTrackingEnabled()
+ */
+bool Context::isTransactionTrackingEnabled() const
+{
+    const Q_D(Context);
+    return d->transactionTracking.loadAcquire() != 0;
+}
+
+
+/**
+ * @brief The transactions which are currently open, oldest first.
+ *
+ * This is empty unless tracking transactions is enabled.
+ *
+ * @sa setTransactionTrackingEnabled()
+ */
+QList<Context::TransactionInfo> Context::activeTransactions() const
+{
+    const Q_D(Context);
+    QList<TransactionInfo> result;
+    {
+        QMutexLocker locker(&d->transactionsLock);
+        for (auto transaction : d->transactions) {
+            TransactionInfo info;
+            info.transactionId = transaction->id;
+            info.readOnly = (transaction->flags & MDB_RDONLY) != 0;
+            info.age = transaction->age.elapsed();
+            info.thread = transaction->thread;
+            result << info;
+        }
+    }
+    std::sort(result.begin(), result.end(),
+              [](const TransactionInfo &a, const TransactionInfo &b) {
+        return a.age > b.age;
+    });
+    return result;
+}
+
+
+/**
+ * @brief Watch for read transactions open for @p maxAge milliseconds.
+ *
+ * Old read transactions pin the snapshot they have been started on: LMDB
+ * cannot reuse pages freed by later writes, so the database file grows.
+ * This starts a thread which regularly checks the open transactions and
+ * reports read-only ones older than @p maxAge milliseconds once, passing a
+ * SlowOperation of type SlowOperation::StaleReader to the slow operation
+ * handler (or logging it in the `qlmdb.slow` category). The slow operation
+ * threshold does not need to be set for this.
+ *
+ * If the @p action is ResetStaleReaders, such transactions are reset as
+ * well. As transactions must only be used by the thread which created
+ * them, this happens the next time their thread uses them, i.e. runs a
+ * Database operation in them, creates or renews a Cursor on them or
+ * commits or aborts them: the transaction becomes invalid and operations
+ * on it fail. Checking Transaction::isValid() does not reset it.
+ *
+ * @note A reader which is idle or has been forgotten is never reset, as
+ * its owner never uses it again: it keeps its snapshot until it is
+ * destroyed. The report is the only way to find such readers.
+ *
+ * Starting the watchdog enables tracking transactions (see
+ * setTransactionTrackingEnabled()); transactions opened before are not
+ * watched. If a watchdog is already running, it is restarted with the
+ * new settings.
+ */
+void Context::startWatchdog(int maxAge, WatchdogAction action)
+{
+    Q_D(Context);
+    stopWatchdog();
+    setTransactionTrackingEnabled(true);
+    d->watchdog.reset(new TransactionWatchdog(d, qMax(maxAge, 0), action));
+    d->watchdog->start();
+}
+
+
+/**
+ * @brief Stop watching for old read transactions.
+ *
+ * This stops the watchdog thread (if one is running) and waits for it to
+ * finish. Transactions stay tracked.
+ */
+void Context::stopWatchdog()
+{
+    Q_D(Context);
+    if (d->watchdog) {
+        d->watchdog->stop();
+        d->watchdog.reset();
+    }
+}
+
+
+/**
+ * @brief Indicates if the watchdog is running.
+ */
+bool Context::isWatchdogRunning() const
+{
+    const Q_D(Context);
+    return d->watchdog && d->watchdog->isRunning();
+}
+
+
+
+/**
+ * @brief Load the data of the context into the page cache.
+ *
+ * After a restart, the data file is usually not cached by the operating
+ * system, so the first reads have to wait for the disk. This reads the
+ * used part of the data file using @p threadCount threads (by default,
+ * as many as there are cores), so later accesses via the memory map are
+ * served from memory. On Linux, the kernel is asked to read ahead the
+ * whole range as well.
+ *
+ * The method blocks until the data has been read. If a @p progress
+ * handler is given, it is called in the calling thread before starting,
+ * regularly while reading and when done; if it returns false, the warmup
+ * is cancelled.
+ *
+ * Returns true if the whole file has been read. If an error occurred,
+ * lastError() is set. Warming up only makes sense if the data fits into
+ * memory; to warm up parts of it, use Database::prefetch().
+ */
+bool Context::warmup(int threadCount, WarmupProgress progress)
+{
+    Q_D(Context);
+    if (!d->open) {
+        d->lastError = Errors::InvalidParameter;
+        d->lastErrorString = QObject::tr("The context is not open");
+        return false;
+    }
+
+    MDB_envinfo info;
+    MDB_stat stat;
+    d->lastError = mdb_env_info(d->env, &info);
+    if (d->lastError == Errors::NoError) {
+        d->lastError = mdb_env_stat(d->env, &stat);
+    }
+    if (d->lastError != Errors::NoError) {
+        d->lastErrorString = QObject::tr("Failed to get the size of the "
+                                         "environment");
+        return false;
+    }
+
+    WarmupReader::Work work;
+    work.fileName = (d->flags & MDB_NOSUBDIR) ?
+                d->path : QDir(d->path).filePath("data.mdb");
+    work.size = (static_cast<quint64>(info.me_last_pgno) + 1) *
+            static_cast<quint64>(stat.ms_psize);
+    work.nextChunk = 0;
+    work.bytesRead = 0;
+    work.cancelled = false;
+    work.failed = false;
+    {
+        // The file might be smaller than the map, e.g. with WriteMap:
+        QFile file(work.fileName);
+        if (file.open(QIODevice::ReadOnly)) {
+            work.size = qMin(work.size, static_cast<quint64>(file.size()));
+        }
+    }
+
+#ifdef Q_OS_LINUX
+    mdb_filehandle_t fd;
+    if (mdb_env_get_fd(d->env, &fd) == Errors::NoError) {
+        posix_fadvise(fd, 0, static_cast<off_t>(work.size),
+                      POSIX_FADV_WILLNEED);
+    }
+#endif
+
+    auto chunks = (work.size + WarmupReader::Work::ChunkSize - 1) /
+            WarmupReader::Work::ChunkSize;
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+    threadCount = static_cast<int>(qBound<quint64>(
+                                       1, static_cast<quint64>(threadCount),
+                                       qMax<quint64>(chunks, 1)));
+    if (progress && !progress(0, work.size)) {
+        work.cancelled = true;
+    }
+    QList<WarmupReader*> readers;
+    for (int i = 0; i < threadCount; ++i) {
+        auto reader = new WarmupReader(&work);
+        reader->start();
+        readers << reader;
+    }
+    for (auto reader : readers) {
+        while (!reader->wait(100)) {
+            if (progress && !progress(work.bytesRead, work.size)) {
+                work.cancelled = true;
+            }
+        }
+    }
+    qDeleteAll(readers);
+
+    if (work.failed) {
+        d->lastError = Errors::IOError;
+        d->lastErrorString = QObject::tr("Failed to read the data file %1")
+                .arg(work.fileName);
+        return false;
+    }
+    d->clearLastError();
+    if (progress && !work.cancelled) {
+        progress(work.bytesRead, work.size);
+    }
+    return !work.cancelled;
+}
+
+
+
+/**
+ * @brief The way the memory map is expected to be accessed.
+ *
+ * @sa setAccessPattern()
+ */
+Context::AccessPattern Context::accessPattern() const
+{
+    const Q_D(Context);
+    QMutexLocker locker(&d->mapAdviceLock);
+    return d->accessPattern;
+}
+
+
+/**
+ * @brief Tell the operating system how the memory map is accessed.
+ *
+ * This controls how much data the kernel reads ahead when a page of the
+ * map is accessed which is not in memory. Point lookups work best with
+ * RandomAccess, which avoids reading pages that are not needed and
+ * evicting useful ones from the page cache. Scans over large parts of the
+ * data benefit from SequentialAccess. The setting can be changed at any
+ * time, e.g. while running a nightly scan; use ScopedAccessPattern to
+ * switch it temporarily.
+ *
+ * If the context is not open yet, the pattern is applied when opening it.
+ * Setting a pattern overrides the NoReadAhead flag, which corresponds to
+ * RandomAccess. Without setting one, accessPattern() is RandomAccess if
+ * the environment is opened with NoReadAhead and NormalAccess otherwise.
+ *
+ * This is only supported on Linux. Returns true if the pattern has been
+ * applied. Otherwise, lastError() is set and the pattern is not changed.
+ */
+bool Context::setAccessPattern(AccessPattern pattern)
+{
+    Q_D(Context);
+    QMutexLocker locker(&d->mapAdviceLock);
+    if (d->open) {
+        d->lastError = d->adviseMap(pattern);
+        if (d->lastError != Errors::NoError) {
+            d->lastErrorString = QObject::tr("Failed to set the access "
+                                             "pattern of the memory map");
+            return false;
+        }
+        d->clearLastError();
+    }
+    d->accessPattern = pattern;
+    d->accessPatternSet = true;
+    return true;
+}
+
+
+/**
+ * @brief Indicates if the memory map should use huge pages.
+ *
+ * @sa setHugePagesEnabled()
+ */
+bool Context::isHugePagesEnabled() const
+{
+    const Q_D(Context);
+    QMutexLocker locker(&d->mapAdviceLock);
+    return d->hugePages;
+}
+
+
+/**
+ * @brief Ask the operating system to back the memory map by huge pages.
+ *
+ * Huge pages reduce the number of TLB misses when accessing a large map.
+ * On Linux, this requires transparent huge pages for file mappings to be
+ * supported and enabled for the file system of the environment; the
+ * kernel decides whether to actually use them. If the context is not open
+ * yet, the setting is applied when opening it.
+ *
+ * Returns true if the advice has been given. Otherwise, lastError() is
+ * set and the setting is not changed.
+ */
+bool Context::setHugePagesEnabled(bool enabled)
+{
+    Q_D(Context);
+    QMutexLocker locker(&d->mapAdviceLock);
+    if (d->open) {
+        d->lastError = d->adviseHugePages(enabled);
+        if (d->lastError != Errors::NoError) {
+            d->lastErrorString = QObject::tr("Failed to set the huge page "
+                                             "advice of the memory map");
+            return false;
+        }
+        d->clearLastError();
+    }
+    d->hugePages = enabled;
+    return true;
+}
+
 } // namespace QLMDB
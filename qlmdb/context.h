@@ -17,10 +17,16 @@
 #ifndef CONTEXT_H
 #define CONTEXT_H
 
+#include <functional>
+
 #include <QtGlobal>
+#include <QList>
 #include <QScopedPointer>
+#include <QString>
 
+#include "database.h"
 #include "qlmdb_global.h"
+#include "statistics.h"
 
 
 namespace QLMDB {
@@ -31,7 +37,10 @@ class Database;
 
 class QLMDBSHARED_EXPORT Context
 {
+    friend class ContextWatcher;
+    friend class Cursor;
     friend class Transaction;
+    friend class TransactionPrivate;
     friend class Database;
     friend class DatabasePrivate;
 public:
@@ -47,6 +56,82 @@ public:
     static const unsigned int NoReadAhead;
     static const unsigned int NoMemInit;
 
+    /**
+     * @brief An operation which took longer than the configured threshold.
+     *
+     * @sa setSlowOperationThreshold()
+     */
+    struct SlowOperation {
+
+        /**
+         * @brief The kinds of operations which are reported.
+         */
+        enum Type {
+            Commit,          //!< Committing a write Transaction.
+            ReadTransaction, //!< A read-only Transaction was kept open.
+            CursorScan,      //!< A Cursor was in use.
+            StaleReader      //!< The watchdog found an old read Transaction.
+        };
+
+        Type type;             //!< The kind of operation.
+        qint64 duration;       //!< The duration in milliseconds.
+        quint64 transactionId; //!< The ID of the LMDB transaction.
+        QString database;      //!< The database scanned by a Cursor.
+        quint64 bytesWritten;  //!< Bytes written by a committed transaction.
+        quint64 steps;         //!< The number of steps a Cursor made.
+    };
+
+    /**
+     * @brief A function receiving the reports of slow operations.
+     *
+     * The function is called in the thread which ran the @p operation.
+     * Stale readers are reported from the watchdog thread instead.
+     */
+    typedef std::function<void(const SlowOperation &operation)>
+    SlowOperationHandler;
+
+    /**
+     * @brief A function receiving the progress of warmup().
+     *
+     * It gets the number of bytes read so far and the total number of
+     * bytes to read. Return false to cancel the warmup.
+     */
+    typedef std::function<bool(quint64 bytesRead, quint64 bytesTotal)>
+    WarmupProgress;
+
+    /**
+     * @brief How the memory map of the environment is accessed.
+     *
+     * @sa setAccessPattern()
+     */
+    enum AccessPattern {
+        NormalAccess,    //!< Moderate read ahead (the system default).
+        RandomAccess,    //!< No read ahead, for point lookups.
+        SequentialAccess //!< Aggressive read ahead, for large scans.
+    };
+
+    /**
+     * @brief A transaction which is currently open.
+     *
+     * @sa activeTransactions()
+     */
+    struct TransactionInfo {
+        quint64 transactionId; //!< The ID of the LMDB transaction.
+        bool readOnly;         //!< The transaction is read-only.
+        qint64 age;            //!< Milliseconds since it has been created.
+        Qt::HANDLE thread;     //!< The thread which created it.
+    };
+
+    /**
+     * @brief What the watchdog does with stale read transactions.
+     *
+     * @sa startWatchdog()
+     */
+    enum WatchdogAction {
+        ReportStaleReaders, //!< Only report them.
+        ResetStaleReaders   //!< Report and reset them.
+    };
+
     Context();
     virtual ~Context();
 
@@ -75,6 +160,38 @@ public:
     bool isOpen() const;
     bool open();
 
+    Database *database(const QString &name = QString(),
+                       unsigned int flags = Database::Create,
+                       Database::CompareFunction keyCompare = nullptr,
+                       Database::CompareFunction valueCompare = nullptr);
+
+    bool enableChangeLog();
+    bool isChangeLogEnabled() const;
+
+    void setStatisticsEnabled(bool enabled);
+    bool isStatisticsEnabled() const;
+    Statistics statistics() const;
+    void resetStatistics();
+
+    int slowOperationThreshold() const;
+    void setSlowOperationThreshold(int msecs);
+    void setSlowOperationHandler(SlowOperationHandler handler);
+
+    void setTransactionTrackingEnabled(bool enabled);
+    bool isTransactionTrackingEnabled() const;
+    QList<TransactionInfo> activeTransactions() const;
+
+    void startWatchdog(int maxAge, WatchdogAction action = ReportStaleReaders);
+    void stopWatchdog();
+    bool isWatchdogRunning() const;
+
+    bool warmup(int threadCount = 0, WarmupProgress progress = nullptr);
+
+    AccessPattern accessPattern() const;
+    bool setAccessPattern(AccessPattern pattern);
+    bool isHugePagesEnabled() const;
+    bool setHugePagesEnabled(bool enabled);
+
 private:
 
     QScopedPointer<ContextPrivate> d_ptr;
@@ -14,13 +14,132 @@
  * You should have received a copy of the GNU General Public License
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cerrno>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
 #include <QObject>
+#include <QPair>
+#include <QVector>
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <cstdio>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
 
 #include "contextprivate.h"
+#include "cursor.h"
+#include "databaseprivate.h"
+#include "statisticsprivate.h"
+#include "transactionprivate.h"
 
 
 namespace QLMDB {
 
+namespace {
+
+Q_LOGGING_CATEGORY(slowOperations, "qlmdb.slow")
+
+// The maximum number of cursors pooled per database:
+const int MaxPooledCursors = 32;
+
+#ifdef Q_OS_LINUX
+
+/**
+ * @brief The path of the data file of the @p env, with symlinks resolved.
+ */
+QByteArray dataFilePath(MDB_env *env)
+{
+    const char *path = nullptr;
+    unsigned int flags = 0;
+    if (mdb_env_get_path(env, &path) != Errors::NoError ||
+            mdb_env_get_flags(env, &flags) != Errors::NoError) {
+        return QByteArray();
+    }
+    auto fileName = QFile::decodeName(path);
+    if (!(flags & MDB_NOSUBDIR)) {
+        fileName = QDir(fileName).filePath("data.mdb");
+    }
+    return QFile::encodeName(QFileInfo(fileName).canonicalFilePath());
+}
+
+/**
+ * @brief Give the @p advice about the memory map of the @p env.
+ *
+ * LMDB does not expose the address of its map, so it is looked up in the
+ * mappings of the process by the device and inode of the data file. Some
+ * file systems (e.g. overlayfs) report a different device in the mappings
+ * than fstat() does, so mappings with the same inode and the path of the
+ * data file are accepted as well. Earlier advice might have split the map
+ * into several areas, each of which is advised separately.
+ *
+ * Returns 0 on success or an error code from errno.
+ */
+int adviseMapping(MDB_env *env, int advice)
+{
+    mdb_filehandle_t fd;
+    struct stat info;
+    if (mdb_env_get_fd(env, &fd) != Errors::NoError) {
+        return Errors::InvalidParameter;
+    }
+    if (fstat(fd, &info) != 0) {
+        return errno;
+    }
+    auto path = dataFilePath(env);
+    auto maps = std::fopen("/proc/self/maps", "r");
+    if (maps == nullptr) {
+        return errno;
+    }
+    // Collect the areas first, as advising might change the mappings:
+    QVector<QPair<unsigned long long, unsigned long long>> areas;
+    char *line = nullptr;
+    size_t lineSize = 0;
+    while (getline(&line, &lineSize, maps) != -1) {
+        unsigned long long start, stop, inode;
+        unsigned int deviceMajor, deviceMinor;
+        int pathOffset = 0;
+        if (std::sscanf(line, "%llx-%llx %*s %*x %x:%x %llu %n",
+                        &start, &stop, &deviceMajor, &deviceMinor,
+                        &inode, &pathOffset) != 5 ||
+                inode != static_cast<unsigned long long>(info.st_ino)) {
+            continue;
+        }
+        bool sameDevice = deviceMajor == major(info.st_dev) &&
+                deviceMinor == minor(info.st_dev);
+        if (!sameDevice) {
+            auto mappedPath = QByteArray(line + pathOffset).trimmed();
+            if (path.isEmpty() || mappedPath != path) {
+                continue;
+            }
+        }
+        areas.append(qMakePair(start, stop));
+    }
+    std::free(line);
+    std::fclose(maps);
+    if (areas.isEmpty()) {
+        return Errors::InvalidParameter;
+    }
+    for (const auto &area : areas) {
+        if (madvise(reinterpret_cast<void*>(
+                        static_cast<quintptr>(area.first)),
+                    static_cast<size_t>(area.second - area.first),
+                    advice) != 0) {
+            return errno;
+        }
+    }
+    return Errors::NoError;
+}
+
+#endif // Q_OS_LINUX
+
+} // namespace
+
 ContextPrivate::ContextPrivate() :
     env(nullptr),
     lastError(0),
@@ -31,7 +150,34 @@ ContextPrivate::ContextPrivate() :
     maxDBs(0),
     maxReaders(0),
     mapSize(0),
-    open(false)
+    open(false),
+    cursorPoolLock(),
+    cursorPool(),
+    cursorGenerations(),
+    databasesLock(),
+    databases(),
+    droppedDatabases(),
+    openDatabaseLock(),
+    handleUsers(),
+    changeLog(nullptr),
+    watchersLock(),
+    watchers(),
+    watcherCount(0),
+    modifiedDatabases(),
+    statisticsLock(),
+    statistics(),
+    statisticsEnabled(0),
+    slowOperationThreshold(0),
+    slowOperationLock(),
+    slowOperationHandler(),
+    transactionsLock(),
+    transactions(),
+    transactionTracking(0),
+    watchdog(),
+    mapAdviceLock(),
+    accessPattern(Context::NormalAccess),
+    accessPatternSet(false),
+    hugePages(false)
 {
     lastError = mdb_env_create(&env);
     if (lastError != 0) {
@@ -41,9 +187,341 @@ ContextPrivate::ContextPrivate() :
 
 ContextPrivate::~ContextPrivate()
 {
+    for (auto cursors : cursorPool) {
+        qDeleteAll(cursors);
+    }
     if (env != nullptr) {
         mdb_env_close(env);
     }
 }
 
+/**
+ * @brief Take a cursor for the database @p db from the pool.
+ *
+ * The returned cursor has been created in a read-only transaction which
+ * has ended in the meantime; it must be renewed before it can be used. If
+ * there is no pooled cursor for the database, a null pointer is returned.
+ */
+Cursor *ContextPrivate::takeCursor(MDB_dbi db)
+{
+    QMutexLocker locker(&cursorPoolLock);
+    Cursor *result = nullptr;
+    auto it = cursorPool.find(db);
+    if (it != cursorPool.end() && !it->isEmpty()) {
+        result = it->takeLast();
+    }
+    return result;
+}
+
+/**
+ * @brief The current generation of the database handle @p db.
+ *
+ * Cursors remember the generation of the handle when they are cached by a
+ * transaction, so they can be discarded if the handle has been closed in
+ * the meantime.
+ */
+quint64 ContextPrivate::cursorGeneration(MDB_dbi db)
+{
+    QMutexLocker locker(&cursorPoolLock);
+    return cursorGenerations.value(db);
+}
+
+/**
+ * @brief Put the read-only @p cursor for the database @p db into the pool.
+ *
+ * The cursor is closed instead if the database handle has been closed
+ * since the given @p generation or if the pool of the database is full.
+ */
+void ContextPrivate::putCursor(MDB_dbi db, Cursor *cursor,
+                               quint64 generation)
+{
+    {
+        QMutexLocker locker(&cursorPoolLock);
+        if (generation == cursorGenerations.value(db)) {
+            auto &cursors = cursorPool[db];
+            if (cursors.length() < MaxPooledCursors) {
+                cursors.append(cursor);
+                return;
+            }
+        }
+    }
+    delete cursor;
+}
+
+/**
+ * @brief Close all pooled cursors of the database @p db.
+ *
+ * This must be called before the database handle is closed.
+ */
+void ContextPrivate::closeCursors(MDB_dbi db)
+{
+    QList<Cursor*> cursors;
+    {
+        QMutexLocker locker(&cursorPoolLock);
+        cursors = cursorPool.take(db);
+        ++cursorGenerations[db];
+    }
+    qDeleteAll(cursors);
+}
+
+/**
+ * @brief Register the @p user of the database handle @p db.
+ *
+ * The caller must hold the openDatabaseLock, so the handle cannot be closed
+ * between opening and registering it.
+ */
+void ContextPrivate::addHandleUser(MDB_dbi db, DatabasePrivate *user)
+{
+    handleUsers[db].insert(user);
+}
+
+/**
+ * @brief Unregister the @p user of the database handle @p db.
+ *
+ * If this was the last user, the handle is closed.
+ */
+void ContextPrivate::removeHandleUser(MDB_dbi db, DatabasePrivate *user)
+{
+    QMutexLocker locker(&openDatabaseLock);
+    auto it = handleUsers.find(db);
+    if (it != handleUsers.end() && it->remove(user) && it->isEmpty()) {
+        handleUsers.erase(it);
+        closeCursors(db);
+        mdb_dbi_close(env, db);
+    }
+}
+
+/**
+ * @brief Invalidate all users of the database handle @p db.
+ *
+ * This must be called after dropping the database, which closes the
+ * handle, so it might be reused for another database.
+ */
+void ContextPrivate::dropHandle(MDB_dbi db)
+{
+    QMutexLocker locker(&openDatabaseLock);
+    for (auto user : handleUsers.take(db)) {
+        user->valid = false;
+    }
+}
+
+/**
+ * @brief Advise the kernel that the map is accessed in the given @p pattern.
+ *
+ * Returns 0 on success or an error code.
+ */
+int ContextPrivate::adviseMap(Context::AccessPattern pattern)
+{
+#ifdef Q_OS_LINUX
+    switch (pattern) {
+    case Context::NormalAccess:
+        return adviseMapping(env, MADV_NORMAL);
+    case Context::RandomAccess:
+        return adviseMapping(env, MADV_RANDOM);
+    case Context::SequentialAccess:
+        return adviseMapping(env, MADV_SEQUENTIAL);
+    }
+    return Errors::InvalidParameter;
+#else
+    Q_UNUSED(pattern);
+    return ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Advise the kernel to back the map by huge pages if @p enabled.
+ *
+ * Returns 0 on success or an error code.
+ */
+int ContextPrivate::adviseHugePages(bool enabled)
+{
+#if defined(Q_OS_LINUX) && defined(MADV_HUGEPAGE)
+    return adviseMapping(env, enabled ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#else
+    Q_UNUSED(enabled);
+    return ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Apply the advice set before the environment has been opened.
+ *
+ * Errors are ignored, as the advice only affects performance.
+ */
+void ContextPrivate::applyMapAdvice()
+{
+    QMutexLocker locker(&mapAdviceLock);
+    if (accessPatternSet) {
+        adviseMap(accessPattern);
+    } else if (flags & MDB_NORDAHEAD) {
+        // LMDB advises random access itself in this case:
+        accessPattern = Context::RandomAccess;
+    }
+    if (hugePages) {
+        adviseHugePages(true);
+    }
+}
+
+/**
+ * @brief Report a slow @p operation.
+ *
+ * The operation is passed to the handler set by the user. If there is
+ * none, it is logged in the `qlmdb.slow` logging category.
+ */
+void ContextPrivate::reportSlowOperation(
+        const Context::SlowOperation &operation)
+{
+    Context::SlowOperationHandler handler;
+    {
+        QMutexLocker locker(&slowOperationLock);
+        handler = slowOperationHandler;
+    }
+    if (handler) {
+        handler(operation);
+        return;
+    }
+    switch (operation.type) {
+    case Context::SlowOperation::Commit:
+        qCWarning(slowOperations).noquote() << QString(
+                    "Committing transaction %1 took %2 ms "
+                    "(%3 bytes written)").arg(operation.transactionId)
+                    .arg(operation.duration).arg(operation.bytesWritten);
+        break;
+    case Context::SlowOperation::ReadTransaction:
+        qCWarning(slowOperations).noquote() << QString(
+                    "Read transaction %1 was open for %2 ms").arg(
+                    operation.transactionId).arg(operation.duration);
+        break;
+    case Context::SlowOperation::CursorScan:
+        qCWarning(slowOperations).noquote() << QString(
+                    "Cursor on database '%1' in transaction %2 was in use "
+                    "for %3 ms (%4 steps)").arg(operation.database)
+                    .arg(operation.transactionId).arg(operation.duration)
+                    .arg(operation.steps);
+        break;
+    case Context::SlowOperation::StaleReader:
+        qCWarning(slowOperations).noquote() << QString(
+                    "Read transaction %1 is open since %2 ms").arg(
+                    operation.transactionId).arg(operation.duration);
+        break;
+    }
+}
+
+/**
+ * @brief Find read-only transactions open for @p maxAge milliseconds.
+ *
+ * Each of them is reported once. If the @p action says so, the
+ * transactions are also asked to reset themselves. LMDB transactions must
+ * only be used by the thread which created them, so this cannot happen
+ * here; instead, the transaction is reset the next time its owner uses it.
+ */
+void ContextPrivate::checkTransactions(int maxAge,
+                                       Context::WatchdogAction action)
+{
+    QList<Context::SlowOperation> reports;
+    {
+        QMutexLocker locker(&transactionsLock);
+        for (auto transaction : transactions) {
+            if (!(transaction->flags & MDB_RDONLY) || transaction->stale) {
+                continue;
+            }
+            auto age = transaction->age.elapsed();
+            if (age >= maxAge) {
+                transaction->stale = true;
+                if (action == Context::ResetStaleReaders) {
+                    transaction->resetRequested.storeRelease(1);
+                }
+                Context::SlowOperation operation;
+                operation.type = Context::SlowOperation::StaleReader;
+                operation.duration = age;
+                operation.transactionId = transaction->id;
+                operation.bytesWritten = 0;
+                operation.steps = 0;
+                reports << operation;
+            }
+        }
+    }
+    // Report without holding the lock, so the handler can safely query the
+    // context:
+    for (const auto &operation : reports) {
+        reportSlowOperation(operation);
+    }
+}
+
+TransactionWatchdog::TransactionWatchdog(ContextPrivate *context, int maxAge,
+                                         Context::WatchdogAction action) :
+    QThread(),
+    context(context),
+    maxAge(maxAge),
+    action(action),
+    mutex(),
+    condition(),
+    stopped(false)
+{
+
+}
+
+/**
+ * @brief Stop the watchdog and wait for it to finish.
+ */
+void TransactionWatchdog::stop()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopped = true;
+        condition.wakeAll();
+    }
+    wait();
+}
+
+void TransactionWatchdog::run()
+{
+    // Check often enough that transactions are not reported much later
+    // than they exceed the maximum age:
+    auto interval = static_cast<unsigned long>(qBound(1, maxAge / 4, 1000));
+    mutex.lock();
+    while (!stopped) {
+        mutex.unlock();
+        context->checkTransactions(maxAge, action);
+        mutex.lock();
+        if (!stopped) {
+            condition.wait(&mutex, interval);
+        }
+    }
+    mutex.unlock();
+}
+
+const quint64 WarmupReader::Work::ChunkSize = 1024 * 1024;
+
+WarmupReader::WarmupReader(Work *work) :
+    QThread(),
+    work(work)
+{
+
+}
+
+void WarmupReader::run()
+{
+    QFile file(work->fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        work->failed = true;
+        return;
+    }
+    QByteArray buffer(static_cast<int>(Work::ChunkSize), Qt::Uninitialized);
+    while (!work->cancelled && !work->failed) {
+        auto offset = work->nextChunk.fetch_add(1) * Work::ChunkSize;
+        if (offset >= work->size) {
+            break;
+        }
+        auto length = qMin(Work::ChunkSize, work->size - offset);
+        if (!file.seek(static_cast<qint64>(offset)) ||
+                file.read(buffer.data(), static_cast<qint64>(length)) !=
+                static_cast<qint64>(length)) {
+            work->failed = true;
+            break;
+        }
+        work->bytesRead += length;
+    }
+}
+
 } // namespace QLMDB
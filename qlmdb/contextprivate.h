@@ -19,15 +19,33 @@
 
 #include <lmdb.h>
 
+#include <atomic>
+
 #include <QObject>
 #include <QString>
 #include <QDir>
+#include <QAtomicInt>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
 
+#include "context.h"
 #include "errors.h"
 
 namespace QLMDB {
 
+class ContextWatcherPrivate;
+class Cursor;
+class Database;
+class DatabasePrivate;
+class StatisticsRecorder;
 class Transaction;
+class TransactionPrivate;
+class TransactionWatchdog;
 
 //! @private
 class ContextPrivate
@@ -49,6 +67,79 @@ public:
     size_t mapSize;
     bool open;
 
+    // Read-only cursors kept for reuse by later transactions. Closing a
+    // database handle bumps its generation, so cursors on it which are still
+    // cached by open transactions are not pooled again afterwards:
+    QMutex cursorPoolLock;
+    QHash<MDB_dbi, QList<Cursor*>> cursorPool;
+    QHash<MDB_dbi, quint64> cursorGenerations;
+
+    Cursor *takeCursor(MDB_dbi db);
+    quint64 cursorGeneration(MDB_dbi db);
+    void putCursor(MDB_dbi db, Cursor *cursor, quint64 generation);
+    void closeCursors(MDB_dbi db);
+
+    QMutex databasesLock;
+    QHash<QString, Database*> databases;
+    QList<Database*> droppedDatabases;
+
+    // LMDB does not allow opening databases from concurrent transactions.
+    // Opening a database holds this lock until the transaction used to
+    // open it ends. Threads must begin write transactions before taking
+    // it, never while holding it:
+    QMutex openDatabaseLock;
+
+    // The Database objects sharing each database handle. The handle is
+    // closed when the last of them is destroyed. Guarded by
+    // openDatabaseLock:
+    QHash<MDB_dbi, QSet<DatabasePrivate*>> handleUsers;
+
+    void addHandleUser(MDB_dbi db, DatabasePrivate *user);
+    void removeHandleUser(MDB_dbi db, DatabasePrivate *user);
+    void dropHandle(MDB_dbi db);
+
+    // The database of the change log, if enabled (owned by databases):
+    Database *changeLog;
+
+    // Watchers to notify on commits. The lock is held while committing
+    // write transactions if there are watchers:
+    QMutex watchersLock;
+    QList<ContextWatcherPrivate*> watchers;
+    QAtomicInt watcherCount;
+    QHash<MDB_txn*, QSet<QString>> modifiedDatabases;
+
+    // Operation statistics. The recorder is created when statistics are
+    // enabled for the first time and kept until the context is destroyed,
+    // so operations still running when disabling them can finish safely:
+    mutable QMutex statisticsLock;
+    QScopedPointer<StatisticsRecorder> statistics;
+    QAtomicInt statisticsEnabled;
+
+    // Reporting slow operations (a threshold of 0 disables it):
+    QAtomicInt slowOperationThreshold;
+    QMutex slowOperationLock;
+    Context::SlowOperationHandler slowOperationHandler;
+
+    void reportSlowOperation(const Context::SlowOperation &operation);
+
+    // The open transactions, if tracking them is enabled:
+    mutable QMutex transactionsLock;
+    QSet<TransactionPrivate*> transactions;
+    QAtomicInt transactionTracking;
+    QScopedPointer<TransactionWatchdog> watchdog;
+
+    void checkTransactions(int maxAge, Context::WatchdogAction action);
+
+    // Advice given to the kernel about accesses to the memory map. The
+    // settings are kept to apply them when the environment is opened:
+    mutable QMutex mapAdviceLock;
+    Context::AccessPattern accessPattern;
+    bool accessPatternSet;
+    bool hugePages;
+
+    int adviseMap(Context::AccessPattern pattern);
+    int adviseHugePages(bool enabled);
+    void applyMapAdvice();
 
     inline void clearLastError() {
         lastError = 0;
@@ -147,6 +238,56 @@ public:
     }
 };
 
+
+//! @private
+class TransactionWatchdog : public QThread
+{
+public:
+    TransactionWatchdog(ContextPrivate *context, int maxAge,
+                        Context::WatchdogAction action);
+
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    ContextPrivate *context;
+    int maxAge;
+    Context::WatchdogAction action;
+    QMutex mutex;
+    QWaitCondition condition;
+    bool stopped;
+};
+
+
+//! @private
+class WarmupReader : public QThread
+{
+public:
+
+    // The work shared by all readers. The file is read in chunks, each
+    // reader takes the next unread one:
+    struct Work {
+        static const quint64 ChunkSize;
+
+        QString fileName;
+        quint64 size;
+        std::atomic<quint64> nextChunk;
+        std::atomic<quint64> bytesRead;
+        std::atomic<bool> cancelled;
+        std::atomic<bool> failed;
+    };
+
+    explicit WarmupReader(Work *work);
+
+protected:
+    void run() override;
+
+private:
+    Work *work;
+};
+
 } // namespace QLMDB
 
 #endif // CONTEXTPRIVATE_H
@@ -0,0 +1,235 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QMutexLocker>
+#include <QTimer>
+
+#include "context.h"
+#include "contextprivate.h"
+#include "contextwatcher.h"
+#include "contextwatcherprivate.h"
+
+namespace QLMDB {
+
+/**
+ * @class ContextWatcher
+ * @brief Get notified when data in a Context changes.
+ *
+ * Instead of re-reading data periodically, readers can use a watcher to
+ * learn when a write transaction has been committed:
+ *
+ * ```
+ * auto watcher = new ContextWatcher(ctx, this);
+ * connect(watcher, &ContextWatcher::committed,
+ *         [=](quint64 id, const QStringList &databases) {
+ *     if (databases.contains("users")) {
+ *         reloadUsers();
+ *     }
+ * });
+ * connect(watcher, &ContextWatcher::changedExternally,
+ *         [=](quint64 id) {
+ *     reloadEverything();
+ * });
+ * ```
+ *
+ * The committed() signal is emitted for each write transaction committed
+ * via the Context, regardless of the thread the transaction is committed
+ * in. It carries the ID of the transaction and the names of the databases
+ * written to by Database and Cursor objects. The signal is delivered via a
+ * queued connection in the thread of the watcher, so an event loop must be
+ * running.
+ *
+ * Other processes (and other Context objects opened on the same
+ * environment) write without the watcher knowing about it. To detect
+ * such writes, the watcher polls the ID of the last committed transaction
+ * of the environment every pollInterval() milliseconds and emits
+ * changedExternally() if it moved on. As the databases written to are not
+ * known in this case, readers have to assume anything changed. Polling is
+ * cheap, as it only reads the meta page of the environment. Call poll()
+ * to check immediately.
+ *
+ * While a watcher exists, committing write transactions requires taking
+ * a lock shared with the watchers, and the names of modified databases are
+ * collected during write transactions. Hence, destroy watchers which are
+ * no longer needed. The Context must outlive the watchers attached to it.
+ */
+
+
+/**
+ * @brief The poll interval used by default, in milliseconds.
+ */
+const int ContextWatcher::DefaultPollInterval = 1000;
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a watcher for the @p context, which must already be open.
+ * Polling for external changes starts immediately, using the
+ * DefaultPollInterval.
+ */
+ContextWatcher::ContextWatcher(Context &context, QObject *parent) :
+    QObject(parent),
+    d_ptr(new ContextWatcherPrivate(this))
+{
+    Q_D(ContextWatcher);
+    d->timer = new QTimer(this);
+    d->timer->setInterval(DefaultPollInterval);
+    connect(d->timer, &QTimer::timeout, this, &ContextWatcher::poll);
+    if (context.isOpen()) {
+        d->context = &context;
+        auto ctx = context.d_ptr.data();
+        QMutexLocker locker(&ctx->watchersLock);
+        MDB_envinfo info;
+        if (mdb_env_info(ctx->env, &info) == 0) {
+            d->lastTransactionId = static_cast<quint64>(info.me_last_txnid);
+        }
+        ctx->watchers.append(d);
+        ctx->watcherCount.ref();
+        d->timer->start();
+    }
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ContextWatcher::~ContextWatcher()
+{
+    Q_D(ContextWatcher);
+    if (d->context != nullptr) {
+        auto ctx = d->context->d_ptr.data();
+        QMutexLocker locker(&ctx->watchersLock);
+        ctx->watchers.removeOne(d);
+        ctx->watcherCount.deref();
+    }
+}
+
+
+/**
+ * @brief Indicates if the watcher is attached to a Context.
+ *
+ * This is false if the context was not open when creating the watcher.
+ */
+bool ContextWatcher::isValid() const
+{
+    const Q_D(ContextWatcher);
+    return d->context != nullptr;
+}
+
+
+/**
+ * @brief The interval in milliseconds in which to check for changes.
+ *
+ * @sa setPollInterval()
+ */
+int ContextWatcher::pollInterval() const
+{
+    const Q_D(ContextWatcher);
+    return d->timer->interval();
+}
+
+
+/**
+ * @brief Set the interval in which to check for external changes.
+ *
+ * Sets the poll @p interval in milliseconds. Use 0 or a negative value to
+ * disable polling, e.g. if only a single process accesses the environment.
+ * This must be called from the thread of the watcher.
+ */
+void ContextWatcher::setPollInterval(int interval)
+{
+    Q_D(ContextWatcher);
+    if (interval > 0) {
+        d->timer->setInterval(interval);
+        if (isValid()) {
+            d->timer->start();
+        }
+    } else {
+        d->timer->setInterval(0);
+        d->timer->stop();
+    }
+}
+
+
+/**
+ * @brief The ID of the last committed transaction known to the watcher.
+ */
+quint64 ContextWatcher::lastTransactionId() const
+{
+    const Q_D(ContextWatcher);
+    quint64 result = 0;
+    if (d->context != nullptr) {
+        QMutexLocker locker(&d->context->d_ptr->watchersLock);
+        result = d->lastTransactionId;
+    }
+    return result;
+}
+
+
+/**
+ * @brief Check for changes made outside of the watched Context.
+ *
+ * If the ID of the last transaction committed in the environment is
+ * newer than the last one known to the watcher, changedExternally() is
+ * emitted. This is called periodically (see pollInterval()), but can also
+ * be called explicitly.
+ */
+void ContextWatcher::poll()
+{
+    Q_D(ContextWatcher);
+    quint64 transactionId = 0;
+    if (d->context != nullptr) {
+        auto ctx = d->context->d_ptr.data();
+        QMutexLocker locker(&ctx->watchersLock);
+        MDB_envinfo info;
+        if (mdb_env_info(ctx->env, &info) == 0) {
+            auto last = static_cast<quint64>(info.me_last_txnid);
+            if (last > d->lastTransactionId) {
+                d->lastTransactionId = last;
+                transactionId = last;
+            }
+        }
+    }
+    if (transactionId != 0) {
+        emit changedExternally(transactionId);
+    }
+}
+
+
+/**
+ * @fn ContextWatcher::committed()
+ * @brief A write transaction has been committed via the Context.
+ *
+ * The @p transactionId identifies the transaction. The @p databases
+ * contain the sorted names of the databases written to in the transaction
+ * (the main database is named by an empty string). It is empty if the
+ * transaction changed the environment without writing via a Database or
+ * Cursor, e.g. by only opening a new database. Transactions which did not
+ * change anything are not reported.
+ */
+
+
+/**
+ * @fn ContextWatcher::changedExternally()
+ * @brief The environment has been changed by another process.
+ *
+ * The @p transactionId is the ID of the last transaction committed in the
+ * environment.
+ */
+
+} // namespace QLMDB
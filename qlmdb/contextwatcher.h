@@ -0,0 +1,62 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONTEXTWATCHER_H
+#define CONTEXTWATCHER_H
+
+#include <QObject>
+#include <QScopedPointer>
+#include <QStringList>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Context;
+class ContextWatcherPrivate;
+
+class QLMDBSHARED_EXPORT ContextWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DefaultPollInterval;
+
+    explicit ContextWatcher(Context &context, QObject *parent = nullptr);
+    ~ContextWatcher() override;
+
+    bool isValid() const;
+
+    int pollInterval() const;
+    void setPollInterval(int interval);
+    quint64 lastTransactionId() const;
+
+public Q_SLOTS:
+    void poll();
+
+Q_SIGNALS:
+    void committed(quint64 transactionId, const QStringList &databases);
+    void changedExternally(quint64 transactionId);
+
+private:
+    QScopedPointer<ContextWatcherPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ContextWatcher)
+};
+
+} // namespace QLMDB
+
+#endif // CONTEXTWATCHER_H
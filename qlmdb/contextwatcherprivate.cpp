@@ -0,0 +1,52 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QMetaObject>
+
+#include "contextwatcherprivate.h"
+
+namespace QLMDB {
+
+ContextWatcherPrivate::ContextWatcherPrivate(ContextWatcher *q) :
+    q_ptr(q),
+    context(nullptr),
+    timer(nullptr),
+    lastTransactionId(0)
+{
+
+}
+
+/**
+ * @brief Tell the watcher about a committed transaction.
+ *
+ * This is called by the thread committing the transaction, with the lock
+ * of the watchers held. The signal is emitted in the thread of the
+ * watcher, once control returns to its event loop.
+ */
+void ContextWatcherPrivate::notifyCommitted(quint64 transactionId,
+                                            const QStringList &databases)
+{
+    if (transactionId > lastTransactionId) {
+        lastTransactionId = transactionId;
+    }
+    auto q = q_ptr;
+    QMetaObject::invokeMethod(q, [=]() {
+        emit q->committed(transactionId, databases);
+    }, Qt::QueuedConnection);
+}
+
+} // namespace QLMDB
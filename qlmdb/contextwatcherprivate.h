@@ -0,0 +1,46 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONTEXTWATCHERPRIVATE_H
+#define CONTEXTWATCHERPRIVATE_H
+
+#include <QStringList>
+
+#include "contextwatcher.h"
+
+class QTimer;
+
+namespace QLMDB {
+
+class Context;
+
+//! @private
+class ContextWatcherPrivate
+{
+public:
+    explicit ContextWatcherPrivate(ContextWatcher *q);
+
+    ContextWatcher *q_ptr;
+    Context *context;
+    QTimer *timer;
+    quint64 lastTransactionId;
+
+    void notifyCommitted(quint64 transactionId, const QStringList &databases);
+};
+
+} // namespace QLMDB
+
+#endif // CONTEXTWATCHERPRIVATE_H
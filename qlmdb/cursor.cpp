@@ -22,6 +22,7 @@
 #include "database.h"
 #include "databaseprivate.h"
 #include "errors.h"
+#include "tracingprivate.h"
 #include "transaction.h"
 #include "transactionprivate.h"
 
@@ -72,7 +73,9 @@ namespace QLMDB {
  * - findNearest()
  * - findKey()
  * - findFirstAfter()
+ * - findFirstWithPrefix()
  * - next()
+ * - nextWithPrefix()
  * - nextForCurrentKey()
  * - nextKey()
  * - previous()
@@ -97,6 +100,26 @@ namespace QLMDB {
  * per key - all values of the current key.
  *
  *
+ * ## Reusing Cursors
+ *
+ * Cursors which have been created in a read-only Transaction are not freed
+ * when their transaction ends. Instead of creating a new Cursor for each
+ * read-only transaction, an existing one can be attached to the next
+ * transaction using renew(). This avoids the allocation and initialization
+ * costs of the underlying LMDB cursor:
+ *
+ * ```
+ * Transaction txn(context, Transaction::ReadOnly);
+ * Cursor c(txn, db);
+ * // Read some data...
+ * txn.commit();
+ *
+ * Transaction txn2(context, Transaction::ReadOnly);
+ * c.renew(txn2);
+ * // Read some more data...
+ * ```
+ *
+ *
  * ## Notes About Multi-Threading
  *
  * A Cursor must only be used in the thread it has been created in. Note that
@@ -142,6 +165,10 @@ const unsigned int Cursor::NoOverrideKey = MDB_NOOVERWRITE;
  * If specified, as much space as occupied by the value is reserved in
  * the database. This is useful if the actual data is generated later.
  * No copying of the data in the value to the database occurs.
+ *
+ * As indexes, the change log and watchers would see the uninitialized
+ * space, this cannot be used on databases with an Index attached, while
+ * the change log is enabled or while a ContextWatcher is watching.
  */
 const unsigned int Cursor::Reserve = MDB_RESERVE;
 
@@ -220,12 +247,16 @@ Cursor::Cursor(Transaction &transaction, Database &database) :
     d_ptr(new CursorPrivate)
 {
     Q_D(Cursor);
-    if (transaction.isValid() && database.isValid()) {
+    if (transaction.d_ptr->isUsable() && database.isValid()) {
         d->lastError = mdb_cursor_open(transaction.d_ptr->txn,
                                        database.d_ptr->db,
                                        &d->cursor);
         if (d->lastError == 0) {
             d->valid = true;
+            d->database = database.d_ptr.data();
+            d->context = transaction.d_ptr->context.d_ptr.data();
+            d->transaction = transaction.d_ptr.data();
+            d->startScan();
         } else if (d->lastError == Errors::InvalidParameter) {
             d->lastErrorString = QObject::tr("Invalid parameters encountered "
                                              "when creating Cursor");
@@ -248,6 +279,7 @@ Cursor::~Cursor()
 {
     Q_D(Cursor);
     if (d->valid) {
+        d->finishScan();
         mdb_cursor_close(d->cursor);
     }
 }
@@ -299,6 +331,49 @@ void Cursor::clearLastError()
 }
 
 
+/**
+ * @brief Attach the cursor to another read-only @p transaction.
+ *
+ * A cursor which has been created in a read-only Transaction stays allocated
+ * after its transaction has been committed or aborted. Renewing attaches it
+ * to the given @p transaction, which must be read-only, too. Afterwards, the
+ * cursor can be used to read data from the same Database as before.
+ *
+ * Returns true if the cursor has been renewed or false otherwise. Cursors
+ * created in read-write transactions cannot be renewed; trying to do so
+ * sets lastError() to Errors::InvalidParameter.
+ */
+bool Cursor::renew(Transaction &transaction)
+{
+    Q_D(Cursor);
+    bool result = false;
+    if (d->valid && transaction.d_ptr->isUsable()) {
+        d->finishScan();
+        d->lastError = mdb_cursor_renew(transaction.d_ptr->txn, d->cursor);
+        if (d->lastError == Errors::NoError) {
+            d->lastErrorString.clear();
+            d->transaction = transaction.d_ptr.data();
+            d->startScan();
+            result = true;
+        } else if (d->lastError == Errors::InvalidParameter) {
+            d->lastErrorString = QObject::tr("Only cursors of read-only "
+                                             "transactions can be renewed");
+        } else if (d->lastError == Errors::BadTransaction) {
+            d->lastErrorString = QObject::tr("Cannot renew Cursor in a "
+                                             "failed transaction");
+        } else {
+            d->lastErrorString = QObject::tr("Unexpected error renewing "
+                                             "Cursor");
+        }
+    } else {
+        d->lastError = Errors::InvalidParameter;
+        d->lastErrorString = QObject::tr("Renewing a Cursor requires a valid "
+                                         "Cursor and Transaction");
+    }
+    return result;
+}
+
+
 /**
  * @brief Store data in the database.
  *
@@ -321,25 +396,63 @@ void Cursor::clearLastError()
  * Note: When using the flags NoDuplicateData or NoOverrideKey, the operation
  * returns false and sets lastError() to Errors::KeyExists to indicate that
  * the data has not been inserted to avoid duplicates.
+ *
+ * Indexes are attached to a Database object and only updated by cursors
+ * created on that object. Writing via a Cursor on another Database object
+ * opened for the same name bypasses them.
  */
 bool Cursor::put(const QByteArray &key, const QByteArray &data,
                  unsigned int flags)
+{
+    return put(key.constData(), static_cast<size_t>(key.size()),
+               data.constData(), static_cast<size_t>(data.size()), flags);
+}
+
+
+/**
+ * @brief Store data in the database.
+ *
+ * This is an overloaded version of put(), which takes the @p key and @p data
+ * as pointers to raw bytes together with their sizes. Use it to write data
+ * kept in other buffers without copying them into a QByteArray first.
+ */
+bool Cursor::put(const char *key, size_t keySize,
+                 const char *data, size_t dataSize,
+                 unsigned int flags)
 {
     Q_D(Cursor);
     bool result = false;
     if (isValid()) {
-        MDB_val k;
-        k.mv_data = const_cast<char*>(key.constData());
-        k.mv_size = static_cast<size_t>(key.size());
-
-        MDB_val v;
-        v.mv_data = const_cast<char*>(data.constData());
-        v.mv_size = static_cast<size_t>(data.size());
-
-        d->lastError = mdb_cursor_put(d->cursor, &k, &v, flags);
+        MDB_val k = data_to_value(key, keySize);
+        MDB_val v = data_to_value(data, dataSize);
+
+        if (d->database == nullptr || !d->database->hasWriteHooks()) {
+            d->lastError = mdb_cursor_put(d->cursor, &k, &v, flags);
+        } else if (flags & MDB_RESERVE) {
+            // The hooks would only see the uninitialized space:
+            d->lastError = Errors::InvalidParameter;
+        } else {
+            // Keep indexes and change log of the database up to date:
+            auto txn = mdb_cursor_txn(d->cursor);
+            QByteArray oldValue;
+            d->lastError = Errors::NoError;
+            if (!d->database->indexes.isEmpty()) {
+                d->lastError = d->database->copyValue(txn, k, oldValue);
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = mdb_cursor_put(d->cursor, &k, &v, flags);
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = d->database->afterPut(
+                            txn, k, oldValue.isNull() ? nullptr : &oldValue,
+                            v);
+            }
+        }
+        QLMDB_TRACE(cursorPut, mdb_cursor_dbi(d->cursor), flags, d->lastError);
 
         if (d->lastError == Errors::NoError) {
             d->lastErrorString.clear();
+            d->transaction->bytesWritten += keySize + dataSize;
             result = true;
         } else if (d->lastError == Errors::MapFull) {
             d->lastErrorString = QObject::tr("No more space in database");
@@ -492,7 +605,8 @@ Cursor::FindResult Cursor::lastForCurrentKey()
  * @note This operation is only valid for databases opened with support for
  * multiple values per key.
  */
-Cursor::FindResult Cursor::find(QByteArray key, QByteArray value)
+Cursor::FindResult Cursor::find(const QByteArray &key,
+                                const QByteArray &value)
 {
     Q_D(Cursor);
     MDB_val k = bytearray_to_value(key);
@@ -501,6 +615,22 @@ Cursor::FindResult Cursor::find(QByteArray key, QByteArray value)
 }
 
 
+/**
+ * @brief Position the cursor at the given key/value pair.
+ *
+ * This is an overloaded version of find(), which takes the @p key and
+ * @p value as pointers to raw bytes together with their sizes.
+ */
+Cursor::FindResult Cursor::find(const char *key, size_t keySize,
+                                const char *value, size_t valueSize)
+{
+    Q_D(Cursor);
+    MDB_val k = data_to_value(key, keySize);
+    MDB_val v = data_to_value(value, valueSize);
+    return d->get(k, v, MDB_GET_BOTH);
+}
+
+
 /**
  * @brief Position the cursor at the given key/value pair or somewhere near.
  *
@@ -510,7 +640,8 @@ Cursor::FindResult Cursor::find(QByteArray key, QByteArray value)
  * @note This operation is only valid for databases opened with support for
  * multiple values per key.
  */
-Cursor::FindResult Cursor::findNearest(QByteArray key, QByteArray value)
+Cursor::FindResult Cursor::findNearest(const QByteArray &key,
+                                       const QByteArray &value)
 {
     Q_D(Cursor);
     MDB_val k = bytearray_to_value(key);
@@ -519,10 +650,26 @@ Cursor::FindResult Cursor::findNearest(QByteArray key, QByteArray value)
 }
 
 
+/**
+ * @brief Position the cursor at the given key/value pair or somewhere near.
+ *
+ * This is an overloaded version of findNearest(), which takes the @p key and
+ * @p value as pointers to raw bytes together with their sizes.
+ */
+Cursor::FindResult Cursor::findNearest(const char *key, size_t keySize,
+                                       const char *value, size_t valueSize)
+{
+    Q_D(Cursor);
+    MDB_val k = data_to_value(key, keySize);
+    MDB_val v = data_to_value(value, valueSize);
+    return d->get(k, v, MDB_GET_BOTH_RANGE);
+}
+
+
 /**
  * @brief Get the key/value pair for the given @p key.
  */
-Cursor::FindResult Cursor::findKey(QByteArray key)
+Cursor::FindResult Cursor::findKey(const QByteArray &key)
 {
     Q_D(Cursor);
     MDB_val k = bytearray_to_value(key);
@@ -531,13 +678,28 @@ Cursor::FindResult Cursor::findKey(QByteArray key)
 }
 
 
+/**
+ * @brief Get the key/value pair for the given @p key.
+ *
+ * This is an overloaded version of findKey(), which takes the @p key as a
+ * pointer to raw bytes and its @p keySize.
+ */
+Cursor::FindResult Cursor::findKey(const char *key, size_t keySize)
+{
+    Q_D(Cursor);
+    MDB_val k = data_to_value(key, keySize);
+    MDB_val value;
+    return d->get(k, value, MDB_SET_KEY);
+}
+
+
 /**
  * @brief Position the cursor on or next to a given key.
  *
  * This position the cursor either at the specified @p key or the
  * one next to it according to sorting.
  */
-Cursor::FindResult Cursor::findFirstAfter(QByteArray key)
+Cursor::FindResult Cursor::findFirstAfter(const QByteArray &key)
 {
     Q_D(Cursor);
     MDB_val k = bytearray_to_value(key);
@@ -546,6 +708,68 @@ Cursor::FindResult Cursor::findFirstAfter(QByteArray key)
 }
 
 
+/**
+ * @brief Position the cursor on or next to a given key.
+ *
+ * This is an overloaded version of findFirstAfter(), which takes the @p key
+ * as a pointer to raw bytes and its @p keySize.
+ */
+Cursor::FindResult Cursor::findFirstAfter(const char *key, size_t keySize)
+{
+    Q_D(Cursor);
+    MDB_val k = data_to_value(key, keySize);
+    MDB_val value;
+    return d->get(k, value, MDB_SET_RANGE);
+}
+
+
+/**
+ * @brief Position the cursor on the first key starting with a @p prefix.
+ *
+ * This positions the cursor on the first key/value pair whose key starts
+ * with the given @p prefix and returns it. If there is no such key, an
+ * invalid result is returned and lastError() is set to Errors::NotFound.
+ *
+ * Together with nextWithPrefix(), this allows to iterate over all entries
+ * whose keys share a common prefix without scanning the whole database:
+ *
+ * ```
+ * for (auto item = cursor.findFirstWithPrefix(prefix); item.isValid();
+ *      item = cursor.nextWithPrefix(prefix)) {
+ *     // ...
+ * }
+ * ```
+ *
+ * Composite keys which can be queried this way can be created using the
+ * KeyBuilder class.
+ *
+ * @note This is only meaningful for databases using the default key order.
+ */
+Cursor::FindResult Cursor::findFirstWithPrefix(const QByteArray &prefix)
+{
+    return findFirstWithPrefix(prefix.constData(),
+                               static_cast<size_t>(prefix.size()));
+}
+
+
+/**
+ * @brief Position the cursor on the first key starting with a @p prefix.
+ *
+ * This is an overloaded version of findFirstWithPrefix(), which takes the
+ * @p prefix as a pointer to raw bytes and its @p prefixSize.
+ */
+Cursor::FindResult Cursor::findFirstWithPrefix(const char *prefix,
+                                               size_t prefixSize)
+{
+    Q_D(Cursor);
+    MDB_val k = data_to_value(prefix, prefixSize);
+    MDB_val value;
+    // LMDB refuses to look up empty keys, but every key has an empty prefix:
+    auto op = prefixSize > 0 ? MDB_SET_RANGE : MDB_FIRST;
+    return d->getWithPrefix(k, value, op, prefix, prefixSize);
+}
+
+
 /**
  * @brief Get the next key/value pair.
  */
@@ -557,6 +781,37 @@ Cursor::FindResult Cursor::next()
 }
 
 
+/**
+ * @brief Move the cursor to the next key/value pair with the @p prefix.
+ *
+ * This moves the cursor to the next key/value pair. If its key starts with
+ * the given @p prefix, it is returned. Otherwise, an invalid result is
+ * returned and lastError() is set to Errors::NotFound.
+ *
+ * @sa findFirstWithPrefix()
+ */
+Cursor::FindResult Cursor::nextWithPrefix(const QByteArray &prefix)
+{
+    return nextWithPrefix(prefix.constData(),
+                          static_cast<size_t>(prefix.size()));
+}
+
+
+/**
+ * @brief Move the cursor to the next key/value pair with the @p prefix.
+ *
+ * This is an overloaded version of nextWithPrefix(), which takes the
+ * @p prefix as a pointer to raw bytes and its @p prefixSize.
+ */
+Cursor::FindResult Cursor::nextWithPrefix(const char *prefix,
+                                          size_t prefixSize)
+{
+    Q_D(Cursor);
+    MDB_val key, value;
+    return d->getWithPrefix(key, value, MDB_NEXT, prefix, prefixSize);
+}
+
+
 /**
  * @brief Position the cursor at the next key/value pair for the current key.
  *
@@ -643,7 +898,40 @@ bool Cursor::remove(unsigned int flags)
     Q_D(Cursor);
     bool result = false;
     if (d->valid) {
-        d->lastError = mdb_cursor_del(d->cursor, flags);
+        if (d->database == nullptr || !d->database->hasWriteHooks()) {
+            d->lastError = mdb_cursor_del(d->cursor, flags);
+        } else {
+            // Keep indexes and change log of the database up to date:
+            auto txn = mdb_cursor_txn(d->cursor);
+            MDB_val key, value;
+            QByteArray k, v;
+            unsigned int dbFlags = 0;
+            d->lastError = mdb_cursor_get(d->cursor, &key, &value,
+                                          MDB_GET_CURRENT);
+            if (d->lastError == Errors::NoError) {
+                d->lastError = mdb_dbi_flags(
+                            txn, mdb_cursor_dbi(d->cursor), &dbFlags);
+            }
+            if (d->lastError == Errors::NoError) {
+                k = QByteArray(static_cast<const char*>(key.mv_data),
+                               static_cast<int>(key.mv_size));
+                v = QByteArray(static_cast<const char*>(value.mv_data),
+                               static_cast<int>(value.mv_size));
+                d->lastError = mdb_cursor_del(d->cursor, flags);
+            }
+            if (d->lastError == Errors::NoError) {
+                // In databases with MultiValues, only the current value is
+                // removed unless requested otherwise:
+                auto removedValue = bytearray_to_value(v);
+                bool singleValue = (dbFlags & MDB_DUPSORT) &&
+                        !(flags & MDB_NODUPDATA);
+                d->lastError = d->database->afterRemove(
+                            txn, bytearray_to_value(k), &v,
+                            singleValue ? &removedValue : nullptr);
+            }
+        }
+        QLMDB_TRACE(cursorRemove, mdb_cursor_dbi(d->cursor), flags,
+                    d->lastError);
         if (d->lastError == Errors::NoError) {
             d->lastErrorString.clear();
             result = true;
@@ -661,6 +949,47 @@ bool Cursor::remove(unsigned int flags)
     return result;
 }
 
+/**
+ * @brief The number of values stored under the current key.
+ *
+ * This returns the number of values of the key the cursor currently points
+ * to. In databases with MultiValues, LMDB keeps track of this number, so
+ * the values do not have to be iterated. In other databases, this is
+ * always 1 if the cursor is positioned on an entry.
+ *
+ * If the cursor is not positioned or an error occurs, 0 is returned and
+ * lastError() is set.
+ */
+size_t Cursor::valueCount()
+{
+    Q_D(Cursor);
+    size_t result = 0;
+    if (d->valid) {
+        mdb_size_t count = 0;
+        d->lastError = mdb_cursor_count(d->cursor, &count);
+        if (d->lastError == Errors::Incompatible) {
+            // Not a database with multiple values per key:
+            MDB_val key, value;
+            d->lastError = mdb_cursor_get(d->cursor, &key, &value,
+                                          MDB_GET_CURRENT);
+            count = 1;
+        }
+        if (d->lastError == Errors::NoError) {
+            d->lastErrorString.clear();
+            result = static_cast<size_t>(count);
+        } else if (d->lastError == Errors::NotFound ||
+                   d->lastError == Errors::InvalidParameter) {
+            d->lastErrorString = QObject::tr("Cursor is not positioned on "
+                                             "an entry");
+        } else {
+            d->lastErrorString = QObject::tr("Unexpected error counting "
+                                             "values");
+        }
+    }
+    return result;
+}
+
+
 /**
  * @private
  * @brief Helper function: Converts a Cursor::FindResult to a string.
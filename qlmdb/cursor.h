@@ -22,6 +22,7 @@
 #include <QString>
 #include <QScopedPointer>
 
+#include "byteview.h"
 #include "qlmdb_global.h"
 
 namespace QLMDB {
@@ -32,6 +33,7 @@ class CursorPrivate;
 
 class QLMDBSHARED_EXPORT Cursor
 {
+    friend class TransactionPrivate;
 public:
     // Flags for data insertion:
     static const unsigned int ReplaceCurrent;
@@ -76,8 +78,16 @@ public:
     QString lastErrorString() const;
     void clearLastError();
 
+    bool renew(Transaction &transaction);
+
     bool put(const QByteArray &key, const QByteArray &data,
              unsigned int flags = 0);
+    bool put(const char *key, size_t keySize,
+             const char *data, size_t dataSize,
+             unsigned int flags = 0);
+    template<typename K, typename V>
+    typename std::enable_if<IsByteView<K>::value && IsByteView<V>::value,
+    bool>::type put(const K &key, const V &data, unsigned int flags = 0);
     QByteArray currentKey();
     QByteArray currentValue();
     FindResult current();
@@ -85,23 +95,169 @@ public:
     FindResult last();
     FindResult firstForCurrentKey();
     FindResult lastForCurrentKey();
-    FindResult find(QByteArray key, QByteArray value);
-    FindResult findNearest(QByteArray key, QByteArray value);
-    FindResult findKey(QByteArray key);
-    FindResult findFirstAfter(QByteArray key);
+    FindResult find(const QByteArray &key, const QByteArray &value);
+    FindResult find(const char *key, size_t keySize,
+                    const char *value, size_t valueSize);
+    template<typename K, typename V>
+    typename std::enable_if<IsByteView<K>::value && IsByteView<V>::value,
+    FindResult>::type find(const K &key, const V &value);
+    FindResult findNearest(const QByteArray &key, const QByteArray &value);
+    FindResult findNearest(const char *key, size_t keySize,
+                           const char *value, size_t valueSize);
+    template<typename K, typename V>
+    typename std::enable_if<IsByteView<K>::value && IsByteView<V>::value,
+    FindResult>::type findNearest(const K &key, const V &value);
+    FindResult findKey(const QByteArray &key);
+    FindResult findKey(const char *key, size_t keySize);
+    template<typename K>
+    typename std::enable_if<IsByteView<K>::value, FindResult>::type
+    findKey(const K &key);
+    FindResult findFirstAfter(const QByteArray &key);
+    FindResult findFirstAfter(const char *key, size_t keySize);
+    template<typename K>
+    typename std::enable_if<IsByteView<K>::value, FindResult>::type
+    findFirstAfter(const K &key);
+    FindResult findFirstWithPrefix(const QByteArray &prefix);
+    FindResult findFirstWithPrefix(const char *prefix, size_t prefixSize);
+    template<typename P>
+    typename std::enable_if<IsByteView<P>::value, FindResult>::type
+    findFirstWithPrefix(const P &prefix);
     FindResult next();
+    FindResult nextWithPrefix(const QByteArray &prefix);
+    FindResult nextWithPrefix(const char *prefix, size_t prefixSize);
+    template<typename P>
+    typename std::enable_if<IsByteView<P>::value, FindResult>::type
+    nextWithPrefix(const P &prefix);
     FindResult nextForCurrentKey();
     FindResult nextKey();
     FindResult previous();
     FindResult previousForCurrentKey();
     FindResult previousKey();
     bool remove(unsigned int flags = 0);
+    size_t valueCount();
 
 private:
     QScopedPointer<CursorPrivate> d_ptr;
     Q_DECLARE_PRIVATE(Cursor)
 };
 
+
+/**
+ * @brief Store data in the database.
+ *
+ * This is an overloaded version of put(), which takes the @p key and
+ * @p data as views on bytes, e.g. a `std::string_view` or `QByteArrayView`.
+ *
+ * @sa IsByteView
+ */
+template<typename K, typename V>
+inline typename std::enable_if<IsByteView<K>::value && IsByteView<V>::value,
+bool>::type Cursor::put(const K &key, const V &data, unsigned int flags)
+{
+    return put(key.data(), static_cast<size_t>(key.size()),
+               data.data(), static_cast<size_t>(data.size()), flags);
+}
+
+
+/**
+ * @brief Position the cursor at the given key/value pair.
+ *
+ * This is an overloaded version of find(), which takes the @p key and
+ * @p value as views on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K, typename V>
+inline typename std::enable_if<IsByteView<K>::value && IsByteView<V>::value,
+Cursor::FindResult>::type Cursor::find(const K &key, const V &value)
+{
+    return find(key.data(), static_cast<size_t>(key.size()),
+                value.data(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Position the cursor at the given key/value pair or somewhere near.
+ *
+ * This is an overloaded version of findNearest(), which takes the @p key and
+ * @p value as views on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K, typename V>
+inline typename std::enable_if<IsByteView<K>::value && IsByteView<V>::value,
+Cursor::FindResult>::type Cursor::findNearest(const K &key, const V &value)
+{
+    return findNearest(key.data(), static_cast<size_t>(key.size()),
+                       value.data(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Get the key/value pair for the given @p key.
+ *
+ * This is an overloaded version of findKey(), which takes the @p key as a
+ * view on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, Cursor::FindResult>::type
+Cursor::findKey(const K &key)
+{
+    return findKey(key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Position the cursor on or next to a given key.
+ *
+ * This is an overloaded version of findFirstAfter(), which takes the @p key
+ * as a view on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, Cursor::FindResult>::type
+Cursor::findFirstAfter(const K &key)
+{
+    return findFirstAfter(key.data(), static_cast<size_t>(key.size()));
+}
+
+
+
+/**
+ * @brief Position the cursor on the first key starting with a @p prefix.
+ *
+ * This is an overloaded version of findFirstWithPrefix(), which takes the
+ * @p prefix as a view on bytes, e.g. a KeyBuilder.
+ *
+ * @sa IsByteView
+ */
+template<typename P>
+inline typename std::enable_if<IsByteView<P>::value, Cursor::FindResult>::type
+Cursor::findFirstWithPrefix(const P &prefix)
+{
+    return findFirstWithPrefix(prefix.data(),
+                               static_cast<size_t>(prefix.size()));
+}
+
+
+/**
+ * @brief Move the cursor to the next key/value pair with the @p prefix.
+ *
+ * This is an overloaded version of nextWithPrefix(), which takes the
+ * @p prefix as a view on bytes, e.g. a KeyBuilder.
+ *
+ * @sa IsByteView
+ */
+template<typename P>
+inline typename std::enable_if<IsByteView<P>::value, Cursor::FindResult>::type
+Cursor::nextWithPrefix(const P &prefix)
+{
+    return nextWithPrefix(prefix.data(), static_cast<size_t>(prefix.size()));
+}
+
 } // namespace QLMDB
 
 #endif // CURSOR_H
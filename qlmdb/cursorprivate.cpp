@@ -15,7 +15,9 @@
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "contextprivate.h"
 #include "cursorprivate.h"
+#include "databaseprivate.h"
 #include "errors.h"
 
 namespace QLMDB {
@@ -24,9 +26,60 @@ CursorPrivate::CursorPrivate() :
     cursor(nullptr),
     lastError(Errors::NoError),
     lastErrorString(),
-    valid(false)
+    valid(false),
+    database(nullptr),
+    context(nullptr),
+    transaction(nullptr),
+    generation(0),
+    scanTime(),
+    steps(0),
+    transactionId(0),
+    databaseName()
 {
 
 }
 
+/**
+ * @brief Start measuring the cursor if slow operations are reported.
+ *
+ * The details needed for the report are taken right away, as the
+ * transaction and database might be gone when the cursor is destroyed.
+ */
+void CursorPrivate::startScan()
+{
+    steps = 0;
+    if (context != nullptr &&
+            context->slowOperationThreshold.loadAcquire() > 0) {
+        transactionId = static_cast<quint64>(
+                    mdb_txn_id(mdb_cursor_txn(cursor)));
+        databaseName = database != nullptr ? database->name : QByteArray();
+        scanTime.start();
+    } else {
+        scanTime.invalidate();
+    }
+}
+
+/**
+ * @brief Report the cursor if it has been in use for too long.
+ */
+void CursorPrivate::finishScan()
+{
+    if (!scanTime.isValid()) {
+        return;
+    }
+    auto threshold = context->slowOperationThreshold.loadAcquire();
+    auto duration = scanTime.elapsed();
+    scanTime.invalidate();
+    if (threshold > 0 && duration >= threshold) {
+        Context::SlowOperation operation;
+        operation.type = Context::SlowOperation::CursorScan;
+        operation.duration = duration;
+        operation.transactionId = transactionId;
+        operation.database = QString::fromUtf8(databaseName);
+        operation.bytesWritten = 0;
+        operation.steps = steps;
+        context->reportSlowOperation(operation);
+    }
+}
+
 } // namespace QLMDB
@@ -17,17 +17,26 @@
 #ifndef CURSORPRIVATE_H
 #define CURSORPRIVATE_H
 
+#include <cstring>
+
 #include <lmdb.h>
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QString>
 
 #include "cursor.h"
 #include "errors.h"
+#include "statisticsprivate.h"
+#include "tracingprivate.h"
 
 
 namespace QLMDB {
 
+class ContextPrivate;
+class DatabasePrivate;
+class TransactionPrivate;
+
 //! @private
 class CursorPrivate
 {
@@ -38,9 +47,28 @@ public:
     int lastError;
     QString lastErrorString;
     bool valid;
+    DatabasePrivate *database;
+    ContextPrivate *context;
+    TransactionPrivate *transaction;
+
+    // The generation of the database handle when the cursor got cached by
+    // a transaction (see ContextPrivate::cursorGeneration()):
+    quint64 generation;
+
+    // Measures the cursor if slow operations are reported:
+    QElapsedTimer scanTime;
+    quint64 steps;
+    quint64 transactionId;
+    QByteArray databaseName;
+
+    void startScan();
+    void finishScan();
 
     inline Cursor::FindResult get(
             MDB_val &key, MDB_val &value, MDB_cursor_op op);
+    inline Cursor::FindResult getWithPrefix(
+            MDB_val &key, MDB_val &value, MDB_cursor_op op,
+            const char *prefix, size_t prefixSize);
 };
 
 
@@ -81,6 +109,23 @@ inline MDB_val bytearray_to_value(const QByteArray &byteArray)
 }
 
 
+/**
+ * @private
+ * @brief Convert raw data to a MDB_val.
+ *
+ * This initializes the fields of an MDB_val to refer to the @p size bytes
+ * stored at @p data. The caller must ensure that the data remains valid for
+ * as long as the returned value is in use.
+ */
+inline MDB_val data_to_value(const char *data, size_t size)
+{
+    MDB_val result;
+    result.mv_data = const_cast<char*>(data);
+    result.mv_size = size;
+    return result;
+}
+
+
 /**
  * @brief Retrieve data via the cursor.
  */
@@ -89,7 +134,12 @@ Cursor::FindResult CursorPrivate::get(MDB_val &key, MDB_val &value,
 {
     Cursor::FindResult result;
     if (valid) {
+        OperationTimer timer(context, Statistics::CursorStep);
         lastError = mdb_cursor_get(cursor, &key, &value, op);
+        timer.finish(lastError);
+        QLMDB_TRACE(cursorGet, mdb_cursor_dbi(cursor), static_cast<int>(op),
+                    lastError);
+        ++steps;
         if (lastError == Errors::NoError) {
             lastErrorString.clear();
             result = Cursor::FindResult(
@@ -105,6 +155,29 @@ Cursor::FindResult CursorPrivate::get(MDB_val &key, MDB_val &value,
     return result;
 }
 
+
+/**
+ * @brief Retrieve data via the cursor, restricted to keys with a prefix.
+ *
+ * This runs the operation like get() does. If the key found does not start
+ * with the @p prefix of @p prefixSize bytes, an invalid result is returned
+ * and the last error is set to Errors::NotFound.
+ */
+Cursor::FindResult CursorPrivate::getWithPrefix(
+        MDB_val &key, MDB_val &value, MDB_cursor_op op,
+        const char *prefix, size_t prefixSize)
+{
+    auto result = get(key, value, op);
+    if (result.isValid() && (key.mv_size < prefixSize || (prefixSize > 0 &&
+            std::memcmp(key.mv_data, prefix, prefixSize) != 0))) {
+        lastError = Errors::NotFound;
+        lastErrorString = QObject::tr("No further key with the given prefix "
+                                      "in the database");
+        result = Cursor::FindResult();
+    }
+    return result;
+}
+
 } // namespace QLMDB
 
 #endif // CURSORPRIVATE_H
@@ -14,19 +14,35 @@
  * You should have received a copy of the GNU General Public License
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
 #include "lmdb.h"
 
+#include <QString>
+
+#include "changelog.h"
 #include "context.h"
 #include "cursor.h"
+#include "cursorprivate.h"
 #include "database.h"
 #include "databaseprivate.h"
 #include "errors.h"
+#include "index.h"
+#include "indexprivate.h"
+#include "statisticsprivate.h"
 #include "transaction.h"
 #include "transactionprivate.h"
 
 
 namespace QLMDB {
 
+static_assert(sizeof(Database::Item) == sizeof(MDB_val) &&
+              offsetof(Database::Item, size) == offsetof(MDB_val, mv_size) &&
+              offsetof(Database::Item, data) == offsetof(MDB_val, mv_data),
+              "Database::Item must be layout compatible with MDB_val");
+
 /**
  * @class Database
  * @brief Represents a Database within a Context.
@@ -127,6 +143,52 @@ namespace QLMDB {
  * need to access your databases very frequently, try to bundle multiple
  * accesses in a single Transaction.
  *
+ * Single key operations like get(), put() and remove() directly use the
+ * corresponding LMDB functions and hence do not need a cursor at all.
+ * Functions which need one, like getAll(), create at most one cursor per
+ * Transaction and reuse it for subsequent calls in the same transaction.
+ * Cursors used in read-only transactions are kept in the Context after
+ * the transaction ended and are renewed for the next read-only
+ * transaction on the same database, so they are not recreated on each call
+ * either.
+ *
+ * Keys and values usually are passed in as QByteArray objects. If they are
+ * already held in some other buffer, use the overloads taking a pointer and
+ * a size or a view type like `std::string_view` or `QByteArrayView` (see
+ * IsByteView) instead. These pass the data on to LMDB without copying it into
+ * a temporary QByteArray first.
+ *
+ *
+ * ### Custom Sort Orders
+ *
+ * By default, keys (and values in databases with MultiValues) are sorted by
+ * comparing their bytes. Keys which are numbers or strings which shall be
+ * sorted case insensitively hence need to be stored in special encodings
+ * (e.g. using a KeyBuilder) or padded to a fixed size. Alternatively,
+ * own comparison functions can be passed to the constructors:
+ *
+ * ```
+ * Database db(ctx, "users", Database::Create,
+ *             Database::compareCaseInsensitiveUtf8);
+ * ```
+ *
+ * There are several built-in comparison functions:
+ *
+ * - compareUnsignedBigEndian() sorts unsigned big endian integers of any size.
+ * - compareSignedBigEndian() sorts signed (two's complement) big endian
+ *   integers of any size.
+ * - compareFloat() and compareDouble() sort floating point numbers in native
+ *   representation.
+ * - compareCaseInsensitiveUtf8() sorts UTF-8 strings ignoring their case.
+ *
+ * Comparison functions are not stored in the database. They have to be
+ * passed each time a Database object is created for a database. This
+ * includes other processes accessing it. All Database objects for the same
+ * database must use the same functions, otherwise the database is
+ * corrupted. In particular, do not use custom key comparison on the
+ * default database if named databases are used, as their names are stored
+ * as keys in it.
+ *
  *
  * ## Notes About Multi-Threading
  *
@@ -138,9 +200,13 @@ namespace QLMDB {
  * threads where you need access to the data.
  *
  * Bear in mind that a Database class acts as a RAII wrapper around a LMDB
- * database. This in particular means that the underlying LMDB database
- * handle is closed as soon as the destructor runs. Hence, ensure that there
- * are no further Transaction and Cursor objects referencing the Database.
+ * database. Database objects opened for the same name in a Context share
+ * the underlying LMDB database handle, which is closed as soon as the
+ * destructor of the last of them runs. Hence, ensure that there are no
+ * further Transaction and Cursor objects referencing the Database then.
+ *
+ * An Index is attached to one Database object, though. Writes made via
+ * other objects opened for the same name bypass it.
  */
 
 /**
@@ -208,16 +274,30 @@ const unsigned int Database::Create = MDB_CREATE;
  * database on a Context which is not open will also cause the Database
  * to be invalid, but no error to be set.
  *
+ * Optionally, the functions used to sort the keys and - in databases with
+ * MultiValues - the values of a key can be set via @p keyCompare and
+ * @p valueCompare. If they are null, LMDB's default order (as selected by
+ * the @p flags) is used. See the section about custom sort orders in the
+ * class documentation.
+ *
+ * Named databases which already exist are opened in a read-only
+ * transaction, so no writer lock is taken. The same applies to the default
+ * database if the Create flag is not set or the @p context has been opened
+ * with Context::ReadOnly. A write transaction is only used if the database
+ * might need to be created.
+ *
  * ## Notes on Multi-Threading
  *
  * If you use this constructor, make sure there is no active Transaction
  * ongoing.
  */
-Database::Database(Context &context, const QString &name, unsigned int flags) :
+Database::Database(Context &context, const QString &name, unsigned int flags,
+                   CompareFunction keyCompare, CompareFunction valueCompare) :
     d_ptr(new DatabasePrivate)
 {
     Q_D(Database);
-    d->initFromContext(context, nullptr, name, flags);
+    d->initFromContext(context, nullptr, name, flags,
+                       keyCompare, valueCompare);
 }
 
 
@@ -225,7 +305,8 @@ Database::Database(Context &context, const QString &name, unsigned int flags) :
  * @brief Open a Database.
  *
  * This is an overloaded constructor. It takes a @p transaction and opens
- * the database named @p name with the given @p flags.
+ * the database named @p name with the given @p flags and comparison
+ * functions @p keyCompare and @p valueCompare.
  *
  * ## Notes on Multi-Threading
  *
@@ -234,13 +315,14 @@ Database::Database(Context &context, const QString &name, unsigned int flags) :
  * after the current transaction has either been comitted or aborted.
  */
 Database::Database(Transaction &transaction, const QString &name,
-                   unsigned int flags) :
+                   unsigned int flags, CompareFunction keyCompare,
+                   CompareFunction valueCompare) :
     d_ptr(new DatabasePrivate)
 {
-    if (transaction.isValid()) {
+    if (transaction.d_ptr->isUsable()) {
         Q_D(Database);
         d->initFromContext(transaction.d_ptr->context, &transaction,
-                           name, flags);
+                           name, flags, keyCompare, valueCompare);
     }
 }
 
@@ -251,8 +333,11 @@ Database::Database(Transaction &transaction, const QString &name,
 Database::~Database()
 {
     Q_D(Database);
+    for (auto index : d->indexes) {
+        index->primary = nullptr;
+    }
     if (d->valid) {
-        mdb_dbi_close(d->context->d_ptr->env, d->db);
+        d->context->d_ptr->removeHandleUser(d->db, d);
     }
 }
 
@@ -330,6 +415,9 @@ bool Database::put(const QByteArray &key, const QByteArray &value)
     if (d->context != nullptr) {
         Transaction txn(*d->context);
         result = put(txn, key, value);
+        if (!result) {
+            txn.abort();
+        }
     }
     return result;
 }
@@ -344,8 +432,78 @@ bool Database::put(const QByteArray &key, const QByteArray &value)
 bool Database::put(Transaction &transaction, const QByteArray &key,
                    const QByteArray &value)
 {
-    Cursor cursor(transaction, *this);
-    return cursor.put(key, value);
+    return put(transaction,
+               key.constData(), static_cast<size_t>(key.size()),
+               value.constData(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Insert the @p key - @p value pair into the database.
+ *
+ * This is an overloaded version of put() which takes the key and value as
+ * pointers to raw bytes together with their sizes. Use it to store data
+ * held in other buffers without copying them into a QByteArray first.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Database::put(const char *key, size_t keySize,
+                   const char *value, size_t valueSize)
+{
+    Q_D(Database);
+    bool result = false;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context);
+        result = put(txn, key, keySize, value, valueSize);
+        if (!result) {
+            txn.abort();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Insert the @p key - @p value pair into the database.
+ *
+ * This is an overloaded version of put() which takes the key and value as
+ * pointers to raw bytes and runs the operation in the given @p transaction.
+ */
+bool Database::put(Transaction &transaction, const char *key, size_t keySize,
+                   const char *value, size_t valueSize)
+{
+    Q_D(Database);
+    bool result = false;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        OperationTimer timer(d->context->d_ptr.data(), Statistics::Put);
+        auto txn = transaction.d_ptr->txn;
+        auto k = data_to_value(key, keySize);
+        auto v = data_to_value(value, valueSize);
+        if (!d->hasWriteHooks()) {
+            d->lastError = mdb_put(txn, d->db, &k, &v, 0);
+        } else {
+            QByteArray oldValue;
+            d->lastError = Errors::NoError;
+            if (!d->indexes.isEmpty()) {
+                d->lastError = d->copyValue(txn, k, oldValue);
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = mdb_put(txn, d->db, &k, &v, 0);
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = d->afterPut(
+                            txn, k, oldValue.isNull() ? nullptr : &oldValue,
+                            v);
+            }
+        }
+        timer.finish(d->lastError);
+        result = d->evaluateWriteError();
+        if (result) {
+            transaction.d_ptr->bytesWritten += keySize + valueSize;
+        }
+    }
+    return result;
 }
 
 
@@ -382,8 +540,56 @@ QByteArray Database::get(const QByteArray &key)
  */
 QByteArray Database::get(Transaction &transaction, const QByteArray &key)
 {
-    Cursor cursor(transaction, *this);
-    return cursor.findKey(key).value();
+    return get(transaction, key.constData(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Get the value for the given @p key from the database.
+ *
+ * This is an overloaded version of get() which takes the key as a pointer
+ * to raw bytes and its @p keySize.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArray Database::get(const char *key, size_t keySize)
+{
+    Q_D(Database);
+    QByteArray result;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = get(txn, key, keySize);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get the value for the given @p key from the database.
+ *
+ * This is an overloaded version of get() which takes the key as a pointer
+ * to raw bytes and runs the operation in the given @p transaction.
+ */
+QByteArray Database::get(Transaction &transaction,
+                         const char *key, size_t keySize)
+{
+    Q_D(Database);
+    QByteArray result;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        OperationTimer timer(d->context->d_ptr.data(), Statistics::Get);
+        auto k = data_to_value(key, keySize);
+        MDB_val v;
+        d->lastError = mdb_get(transaction.d_ptr->txn, d->db, &k, &v);
+        timer.finish(d->lastError);
+        if (d->evaluateReadError()) {
+            // The value points into the memory map, which is only valid as
+            // long as the transaction is, hence do a deep copy:
+            result = QByteArray(static_cast<const char*>(v.mv_data),
+                                static_cast<int>(v.mv_size));
+        }
+    }
+    return result;
 }
 
 
@@ -421,12 +627,62 @@ QByteArrayList Database::getAll(const QByteArray &key)
 QByteArrayList Database::getAll(Transaction &transaction,
                                 const QByteArray &key)
 {
-    Cursor cursor(transaction, *this);
+    return getAll(transaction,
+                  key.constData(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Get all values for the given @p key from the database.
+ *
+ * This is an overloaded version of getAll() which takes the key as a pointer
+ * to raw bytes and its @p keySize.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArrayList Database::getAll(const char *key, size_t keySize)
+{
+    Q_D(Database);
     QByteArrayList result;
-    auto item = cursor.findKey(key);
-    while (item.isValid()) {
-        result << item.value();
-        item = cursor.nextForCurrentKey();
+    if (d->context != nullptr) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = getAll(txn, key, keySize);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get all values for the given @p key from the database.
+ *
+ * This is an overloaded version of getAll() which takes the key as a pointer
+ * to raw bytes and runs the operation in the given @p transaction.
+ */
+QByteArrayList Database::getAll(Transaction &transaction,
+                                const char *key, size_t keySize)
+{
+    Q_D(Database);
+    QByteArrayList result;
+    unsigned int flags = 0;
+    if (isValid() && transaction.d_ptr->isUsable() &&
+            mdb_dbi_flags(transaction.d_ptr->txn, d->db, &flags) ==
+            Errors::NoError && !(flags & MDB_DUPSORT)) {
+        // Without multiple values per key, moving to the next duplicate
+        // would move on to the next key, hence just look up the single value:
+        auto value = get(transaction, key, keySize);
+        if (d->lastError == Errors::NoError) {
+            result << value;
+        }
+        return result;
+    }
+    auto cursor = transaction.d_ptr->cursor(transaction, *this);
+    if (cursor != nullptr) {
+        auto item = cursor->findKey(key, keySize);
+        while (item.isValid()) {
+            result << item.value();
+            item = cursor->nextForCurrentKey();
+        }
     }
     return result;
 }
@@ -449,6 +705,9 @@ bool Database::remove(const QByteArray &key)
     if (d->context != nullptr) {
         Transaction txn(*d->context);
         result = remove(txn, key);
+        if (!result) {
+            txn.abort();
+        }
     }
     return result;
 }
@@ -462,11 +721,69 @@ bool Database::remove(const QByteArray &key)
  */
 bool Database::remove(Transaction &transaction, const QByteArray &key)
 {
-    Cursor c(transaction, *this);
-    if (c.findKey(key).isValid()) {
-        return c.remove(Cursor::RemoveAll);
+    return remove(transaction,
+                  key.constData(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Remove all values for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the key as a pointer
+ * to raw bytes and its @p keySize.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Database::remove(const char *key, size_t keySize)
+{
+    Q_D(Database);
+    bool result = false;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context);
+        result = remove(txn, key, keySize);
+        if (!result) {
+            txn.abort();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove all values for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the key as a pointer
+ * to raw bytes and runs the operation in the given @p transaction.
+ */
+bool Database::remove(Transaction &transaction,
+                      const char *key, size_t keySize)
+{
+    Q_D(Database);
+    bool result = false;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        OperationTimer timer(d->context->d_ptr.data(), Statistics::Remove);
+        auto txn = transaction.d_ptr->txn;
+        auto k = data_to_value(key, keySize);
+        if (!d->hasWriteHooks()) {
+            d->lastError = mdb_del(txn, d->db, &k, nullptr);
+        } else {
+            QByteArray oldValue;
+            d->lastError = Errors::NoError;
+            if (!d->indexes.isEmpty()) {
+                d->lastError = d->copyValue(txn, k, oldValue);
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = mdb_del(txn, d->db, &k, nullptr);
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = d->afterRemove(txn, k, &oldValue, nullptr);
+            }
+        }
+        timer.finish(d->lastError);
+        result = d->evaluateWriteError();
     }
-    return false;
+    return result;
 }
 
 
@@ -487,6 +804,9 @@ bool Database::remove(const QByteArray &key, const QByteArray &value)
     if (d->context != nullptr) {
         Transaction txn(*d->context);
         result = remove(txn, key, value);
+        if (!result) {
+            txn.abort();
+        }
     }
     return result;
 }
@@ -501,11 +821,79 @@ bool Database::remove(const QByteArray &key, const QByteArray &value)
 bool Database::remove(Transaction &transaction, const QByteArray &key,
                       const QByteArray &value)
 {
-    Cursor c(transaction, *this);
-    if (c.find(key, value).isValid()) {
-        return c.remove();
+    return remove(transaction,
+                  key.constData(), static_cast<size_t>(key.size()),
+                  value.constData(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Remove a specific @p value for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the key and value
+ * as pointers to raw bytes together with their sizes.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Database::remove(const char *key, size_t keySize,
+                      const char *value, size_t valueSize)
+{
+    Q_D(Database);
+    bool result = false;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context);
+        result = remove(txn, key, keySize, value, valueSize);
+        if (!result) {
+            txn.abort();
+        }
     }
-    return false;
+    return result;
+}
+
+
+/**
+ * @brief Remove a specific @p value for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the key and value
+ * as pointers to raw bytes and runs the operation in the given
+ * @p transaction.
+ */
+bool Database::remove(Transaction &transaction, const char *key,
+                      size_t keySize, const char *value, size_t valueSize)
+{
+    Q_D(Database);
+    bool result = false;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        OperationTimer timer(d->context->d_ptr.data(), Statistics::Remove);
+        auto txn = transaction.d_ptr->txn;
+        auto k = data_to_value(key, keySize);
+        auto v = data_to_value(value, valueSize);
+        unsigned int flags = 0;
+        d->lastError = mdb_dbi_flags(txn, d->db, &flags);
+        if (d->lastError == Errors::NoError && !(flags & MDB_DUPSORT)) {
+            // mdb_del() ignores the value for databases with single values
+            // per key, so check ourselves that the value matches:
+            MDB_val current;
+            d->lastError = mdb_get(txn, d->db, &k, &current);
+            if (d->lastError == Errors::NoError &&
+                    (current.mv_size != valueSize || (valueSize > 0 &&
+                     std::memcmp(current.mv_data, value, valueSize) != 0))) {
+                d->lastError = Errors::NotFound;
+            }
+        }
+        if (d->lastError == Errors::NoError) {
+            d->lastError = mdb_del(txn, d->db, &k, &v);
+        }
+        if (d->lastError == Errors::NoError && d->hasWriteHooks()) {
+            auto oldValue = QByteArray::fromRawData(
+                        value, static_cast<int>(valueSize));
+            d->lastError = d->afterRemove(txn, k, &oldValue, &v);
+        }
+        timer.finish(d->lastError);
+        result = d->evaluateWriteError();
+    }
+    return result;
 }
 
 
@@ -540,11 +928,18 @@ bool Database::clear(Transaction &transaction)
 {
     Q_D(Database);
     bool result = false;
-    if (isValid() && transaction.isValid()) {
+    if (isValid() && transaction.d_ptr->isUsable()) {
         auto ret = mdb_drop(
                     transaction.d_ptr->txn,
                     d->db,
                     0);
+        if (ret == Errors::NoError) {
+            ret = d->clearIndexes(transaction.d_ptr->txn);
+        }
+        if (ret == Errors::NoError) {
+            ret = d->recordChange(transaction.d_ptr->txn, ChangeLog::Clear,
+                               nullptr, nullptr);
+        }
         if (ret == Errors::NoError) {
             clearLastError();
             result = true;
@@ -590,15 +985,26 @@ bool Database::drop(Transaction &transaction)
 {
     Q_D(Database);
     bool result = false;
-    if (isValid() && transaction.isValid()) {
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        transaction.d_ptr->releaseCursor(d->db);
+        d->context->d_ptr->closeCursors(d->db);
         auto ret = mdb_drop(
                     transaction.d_ptr->txn,
                     d->db,
                     1);
+        if (ret == Errors::NoError) {
+            ret = d->clearIndexes(transaction.d_ptr->txn);
+        }
+        if (ret == Errors::NoError) {
+            ret = d->recordChange(transaction.d_ptr->txn, ChangeLog::Drop,
+                               nullptr, nullptr);
+        }
         if (ret == Errors::NoError) {
             clearLastError();
             result = true;
-            d->valid = false;
+            // Dropping closed the handle, which might be shared with other
+            // Database objects:
+            d->context->d_ptr->dropHandle(d->db);
         } else {
             d->lastErrorString = QObject::tr("Unexpected error while "
                                              "dropping the database");
@@ -607,4 +1013,445 @@ bool Database::drop(Transaction &transaction)
     return result;
 }
 
+
+/**
+ * @brief Remove all entries in a range of keys.
+ *
+ * This removes all entries whose keys are greater than or equal to
+ * @p begin and less than @p end. An empty @p begin refers to the start
+ * and an empty @p end to the end of the database. In databases with
+ * MultiValues, all values of the keys in the range are removed.
+ *
+ * The entries are removed using a single cursor. In order to keep the
+ * size of transactions bounded, huge ranges are deleted in several
+ * subsequent write transactions, each of which is committed once it
+ * removed a few ten thousand entries. Hence, if an error occurs, some of
+ * the entries might already have been removed.
+ *
+ * Returns the number of removed entries. If an error occurred, lastError()
+ * is set.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Database::removeRange(const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid()) {
+        result = d->removeRange(begin, end, false);
+        d->evaluateWriteError();
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries in a range of keys.
+ *
+ * This is an overloaded version of removeRange(). It runs the operation in
+ * the given @p transaction. All entries are removed within this
+ * transaction, regardless of the size of the range.
+ */
+size_t Database::removeRange(Transaction &transaction,
+                             const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        bool done;
+        result = d->removeRange(transaction.d_ptr->txn, begin, end, false, 0,
+                                done);
+        d->evaluateWriteError();
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries whose keys start with the @p prefix.
+ *
+ * This works like removeRange(), but removes all entries whose keys start
+ * with the given @p prefix. An empty @p prefix matches all keys.
+ *
+ * Returns the number of removed entries. If an error occurred, lastError()
+ * is set.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Database::removePrefix(const QByteArray &prefix)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid()) {
+        result = d->removeRange(prefix, QByteArray(), true);
+        d->evaluateWriteError();
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries whose keys start with the @p prefix.
+ *
+ * This is an overloaded version of removePrefix(). It runs the operation in
+ * the given @p transaction.
+ */
+size_t Database::removePrefix(Transaction &transaction,
+                              const QByteArray &prefix)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        bool done;
+        result = d->removeRange(transaction.d_ptr->txn, prefix, QByteArray(),
+                                true, 0, done);
+        d->evaluateWriteError();
+    }
+    return result;
+}
+
+
+/**
+ * @brief The number of entries in the database.
+ *
+ * This returns the number of key/value pairs stored in the database. In
+ * databases with MultiValues, each value is counted. The number is
+ * maintained by LMDB, so this does not need to iterate over the entries.
+ *
+ * On error, 0 is returned and lastError() is set.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Database::count()
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = count(txn);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The number of entries in the database.
+ *
+ * This is an overloaded version of count(). It runs the operation in the
+ * given @p transaction.
+ */
+size_t Database::count(Transaction &transaction)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        MDB_stat stat;
+        d->lastError = mdb_stat(transaction.d_ptr->txn, d->db, &stat);
+        if (d->evaluateReadError()) {
+            result = static_cast<size_t>(stat.ms_entries);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Estimate the number of entries in a range of keys.
+ *
+ * This returns the number of entries whose keys are greater than or equal
+ * to @p begin and less than @p end. An empty @p begin refers to the start
+ * and an empty @p end to the end of the database.
+ *
+ * Small ranges are counted exactly, by iterating over their entries. For
+ * ranges with more than a few thousand entries, the number is estimated
+ * by interpolating the position of the range boundaries between the first
+ * and the last key of the database and scaling the total number of
+ * entries. This is accurate if the keys are distributed evenly (like e.g.
+ * timestamps, counters or hashes), but might be far off for skewed key
+ * distributions. Databases using IntegerKeys or a custom key comparison
+ * function are always counted exactly, as their order does not follow the
+ * bytes of the keys.
+ *
+ * On error, 0 is returned and lastError() is set.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Database::rangeCount(const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = rangeCount(txn, begin, end);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Estimate the number of entries in a range of keys.
+ *
+ * This is an overloaded version of rangeCount(). It runs the operation in
+ * the given @p transaction.
+ */
+size_t Database::rangeCount(Transaction &transaction, const QByteArray &begin,
+                            const QByteArray &end)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        auto txn = transaction.d_ptr->txn;
+        MDB_cursor *cursor = nullptr;
+        d->lastError = mdb_cursor_open(txn, d->db, &cursor);
+        if (d->lastError == Errors::NoError) {
+            result = d->rangeCount(txn, cursor, begin, end);
+            mdb_cursor_close(cursor);
+        }
+        if (d->lastError == Errors::NotFound) {
+            d->lastError = Errors::NoError;
+        }
+        d->evaluateReadError();
+    }
+    return result;
+}
+
+
+/**
+ * @brief Load the entries in a range of keys into memory.
+ *
+ * This reads all entries whose keys are greater than or equal to @p begin
+ * and less than @p end, so the pages holding them are in the page cache
+ * when they are accessed later. An empty @p begin refers to the start and
+ * an empty @p end to the end of the database. Nothing is copied, the
+ * pages are only touched via the memory map.
+ *
+ * Use this to warm up the parts of a database which are needed right
+ * after starting an application. Different ranges can be prefetched in
+ * parallel by calling this from several threads. To load the whole
+ * environment, Context::warmup() is faster.
+ *
+ * Returns the number of entries in the range. On error, lastError() is
+ * set.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Database::prefetch(const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (d->context != nullptr) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = prefetch(txn, begin, end);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Load the entries in a range of keys into memory.
+ *
+ * This is an overloaded version of prefetch(). It runs the operation in
+ * the given @p transaction.
+ */
+size_t Database::prefetch(Transaction &transaction, const QByteArray &begin,
+                          const QByteArray &end)
+{
+    Q_D(Database);
+    size_t result = 0;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        auto txn = transaction.d_ptr->txn;
+        MDB_cursor *cursor = nullptr;
+        d->lastError = mdb_cursor_open(txn, d->db, &cursor);
+        if (d->lastError == Errors::NoError) {
+            result = d->prefetch(txn, cursor, begin, end);
+            mdb_cursor_close(cursor);
+        }
+        if (d->lastError == Errors::NotFound) {
+            d->lastError = Errors::NoError;
+        }
+        d->evaluateReadError();
+    }
+    return result;
+}
+
+
+/**
+ * @brief Compare unsigned big endian integers.
+ *
+ * This comparison function can be passed to the constructors to sort keys
+ * or values which are unsigned integers stored in big endian byte order.
+ * The items can have any size, i.e. they do not have to be padded to a
+ * common length.
+ */
+int Database::compareUnsignedBigEndian(const Item *a, const Item *b)
+{
+    auto dataA = static_cast<const unsigned char*>(a->data);
+    auto dataB = static_cast<const unsigned char*>(b->data);
+    auto sizeA = a->size;
+    auto sizeB = b->size;
+    // Leading zeros do not change the value:
+    while (sizeA > 0 && *dataA == 0) {
+        ++dataA;
+        --sizeA;
+    }
+    while (sizeB > 0 && *dataB == 0) {
+        ++dataB;
+        --sizeB;
+    }
+    if (sizeA != sizeB) {
+        return sizeA < sizeB ? -1 : 1;
+    }
+    return sizeA > 0 ? std::memcmp(dataA, dataB, sizeA) : 0;
+}
+
+
+/**
+ * @brief Compare signed big endian integers.
+ *
+ * This comparison function can be passed to the constructors to sort keys
+ * or values which are signed integers stored in two's complement and big
+ * endian byte order. The items can have any size. An empty item is
+ * treated as zero.
+ */
+int Database::compareSignedBigEndian(const Item *a, const Item *b)
+{
+    auto dataA = static_cast<const unsigned char*>(a->data);
+    auto dataB = static_cast<const unsigned char*>(b->data);
+    bool negativeA = a->size > 0 && (dataA[0] & 0x80);
+    bool negativeB = b->size > 0 && (dataB[0] & 0x80);
+    if (negativeA != negativeB) {
+        return negativeA ? -1 : 1;
+    }
+    if (!negativeA) {
+        return compareUnsignedBigEndian(a, b);
+    }
+    // Leading 0xFF bytes do not change the value of negative numbers,
+    // provided the next byte still has its sign bit set:
+    auto sizeA = a->size;
+    auto sizeB = b->size;
+    while (sizeA > 1 && dataA[0] == 0xFF && (dataA[1] & 0x80)) {
+        ++dataA;
+        --sizeA;
+    }
+    while (sizeB > 1 && dataB[0] == 0xFF && (dataB[1] & 0x80)) {
+        ++dataB;
+        --sizeB;
+    }
+    if (sizeA != sizeB) {
+        return sizeA < sizeB ? 1 : -1;
+    }
+    return std::memcmp(dataA, dataB, sizeA);
+}
+
+
+/**
+ * @private
+ * @brief Compare two items holding floating point numbers of type T.
+ *
+ * NaN values sort after all other numbers. Items of unexpected size sort
+ * before all numbers.
+ */
+template<typename T>
+static int compareFloatingPoint(const Database::Item *a,
+                                const Database::Item *b)
+{
+    bool validA = a->size == sizeof(T);
+    bool validB = b->size == sizeof(T);
+    if (!validA || !validB) {
+        return validA == validB ? 0 : (validA ? 1 : -1);
+    }
+    T valueA, valueB;
+    std::memcpy(&valueA, a->data, sizeof(T));
+    std::memcpy(&valueB, b->data, sizeof(T));
+    bool nanA = std::isnan(valueA);
+    bool nanB = std::isnan(valueB);
+    if (nanA || nanB) {
+        return nanA == nanB ? 0 : (nanA ? 1 : -1);
+    }
+    return valueA < valueB ? -1 : (valueB < valueA ? 1 : 0);
+}
+
+
+/**
+ * @brief Compare single precision floating point numbers.
+ *
+ * This comparison function can be passed to the constructors to sort keys
+ * or values which are `float` values in native representation.
+ */
+int Database::compareFloat(const Item *a, const Item *b)
+{
+    return compareFloatingPoint<float>(a, b);
+}
+
+
+/**
+ * @brief Compare double precision floating point numbers.
+ *
+ * This comparison function can be passed to the constructors to sort keys
+ * or values which are `double` values in native representation.
+ */
+int Database::compareDouble(const Item *a, const Item *b)
+{
+    return compareFloatingPoint<double>(a, b);
+}
+
+
+/**
+ * @brief Compare UTF-8 encoded strings ignoring their case.
+ *
+ * This comparison function can be passed to the constructors to sort keys
+ * or values which are UTF-8 encoded strings ignoring their case. Strings
+ * which only differ in their case are ordered by their bytes, so they are
+ * still stored as distinct keys.
+ *
+ * ASCII strings are compared directly. Only if a non-ASCII character is
+ * encountered, the remainder of the strings is case folded using QString.
+ */
+int Database::compareCaseInsensitiveUtf8(const Item *a, const Item *b)
+{
+    auto dataA = static_cast<const char*>(a->data);
+    auto dataB = static_cast<const char*>(b->data);
+    auto size = qMin(a->size, b->size);
+    size_t i = 0;
+    for (; i < size; ++i) {
+        auto charA = static_cast<unsigned char>(dataA[i]);
+        auto charB = static_cast<unsigned char>(dataB[i]);
+        if ((charA | charB) & 0x80) {
+            break;
+        }
+        if (charA != charB) {
+            if (charA >= 'A' && charA <= 'Z') {
+                charA += 'a' - 'A';
+            }
+            if (charB >= 'A' && charB <= 'Z') {
+                charB += 'a' - 'A';
+            }
+            if (charA != charB) {
+                return charA < charB ? -1 : 1;
+            }
+        }
+    }
+    if (i < size) {
+        auto restA = QString::fromUtf8(dataA + i, static_cast<int>(a->size - i));
+        auto restB = QString::fromUtf8(dataB + i, static_cast<int>(b->size - i));
+        auto result = restA.compare(restB, Qt::CaseInsensitive);
+        if (result != 0) {
+            return result < 0 ? -1 : 1;
+        }
+    } else if (a->size != b->size) {
+        return a->size < b->size ? -1 : 1;
+    }
+    // Equal ignoring case - fall back to bytes to get a total order:
+    auto result = size > 0 ? std::memcmp(dataA, dataB, size) : 0;
+    if (result == 0 && a->size != b->size) {
+        result = a->size < b->size ? -1 : 1;
+    }
+    return result;
+}
+
 } // namespace QLMDB
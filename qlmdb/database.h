@@ -24,6 +24,7 @@
 #include <QScopedPointer>
 #include <QString>
 
+#include "byteview.h"
 #include "qlmdb_global.h"
 
 namespace QLMDB {
@@ -35,7 +36,14 @@ class Transaction;
 
 class QLMDBSHARED_EXPORT Database
 {
+    friend class Context;
     friend class Cursor;
+    friend class DatabasePrivate;
+    friend class Index;
+    friend class IndexPrivate;
+    friend class KeyspacePrivate;
+    friend class ShardedDatabase;
+    friend class TransactionPrivate;
 public:
     static const unsigned int ReverseKey;
     static const unsigned int MultiValues;
@@ -45,12 +53,32 @@ public:
     static const unsigned int ReverseKeyMultiValues;
     static const unsigned int Create;
 
+    /**
+     * @brief A key or value passed to a CompareFunction.
+     */
+    struct Item {
+        size_t size;      //!< The size of the item in bytes.
+        const void *data; //!< Pointer to the data of the item.
+    };
+
+    /**
+     * @brief A function used to sort keys or values in a database.
+     *
+     * The function must return a value less than, equal to or greater than
+     * zero if @p a sorts before, equal to or after @p b.
+     */
+    typedef int (*CompareFunction)(const Item *a, const Item *b);
+
     explicit Database(Context &context,
              const QString &name = QString(),
-             unsigned int flags = Create);
+             unsigned int flags = Create,
+             CompareFunction keyCompare = nullptr,
+             CompareFunction valueCompare = nullptr);
     explicit Database(Transaction &transaction,
              const QString &name = QString(),
-             unsigned int flags = Create);
+             unsigned int flags = Create,
+             CompareFunction keyCompare = nullptr,
+             CompareFunction valueCompare = nullptr);
     virtual ~Database();
 
     bool isValid() const;
@@ -61,21 +89,57 @@ public:
     bool put(const QByteArray &key, const QByteArray &value);
     bool put(QLMDB::Transaction &transaction, const QByteArray &key,
              const QByteArray &value);
+    bool put(const char *key, size_t keySize,
+             const char *value, size_t valueSize);
+    bool put(Transaction &transaction, const char *key, size_t keySize,
+             const char *value, size_t valueSize);
     QByteArray get(const QByteArray &key);
     QByteArray get(Transaction &transaction, const QByteArray &key);
+    QByteArray get(const char *key, size_t keySize);
+    QByteArray get(Transaction &transaction, const char *key, size_t keySize);
     QByteArrayList getAll(const QByteArray &key);
     QByteArrayList getAll(Transaction &transaction,
                           const QByteArray &key);
+    QByteArrayList getAll(const char *key, size_t keySize);
+    QByteArrayList getAll(Transaction &transaction,
+                          const char *key, size_t keySize);
     inline QByteArray operator [](const QByteArray &key);
     bool remove(const QByteArray &key);
     bool remove(Transaction &transaction, const QByteArray &key);
+    bool remove(const char *key, size_t keySize);
+    bool remove(Transaction &transaction, const char *key, size_t keySize);
     bool remove(const QByteArray &key, const QByteArray &value);
     bool remove(Transaction &transaction, const QByteArray &key,
                 const QByteArray &value);
+    bool remove(const char *key, size_t keySize,
+                const char *value, size_t valueSize);
+    bool remove(Transaction &transaction, const char *key, size_t keySize,
+                const char *value, size_t valueSize);
     bool clear();
     bool clear(Transaction &txn);
     bool drop();
     bool drop(Transaction &transaction);
+    size_t removeRange(const QByteArray &begin, const QByteArray &end);
+    size_t removeRange(Transaction &transaction, const QByteArray &begin,
+                       const QByteArray &end);
+    size_t removePrefix(const QByteArray &prefix);
+    size_t removePrefix(Transaction &transaction, const QByteArray &prefix);
+
+    size_t count();
+    size_t count(Transaction &transaction);
+    size_t rangeCount(const QByteArray &begin, const QByteArray &end);
+    size_t rangeCount(Transaction &transaction, const QByteArray &begin,
+                      const QByteArray &end);
+
+    size_t prefetch(const QByteArray &begin, const QByteArray &end);
+    size_t prefetch(Transaction &transaction, const QByteArray &begin,
+                    const QByteArray &end);
+
+    static int compareUnsignedBigEndian(const Item *a, const Item *b);
+    static int compareSignedBigEndian(const Item *a, const Item *b);
+    static int compareFloat(const Item *a, const Item *b);
+    static int compareDouble(const Item *a, const Item *b);
+    static int compareCaseInsensitiveUtf8(const Item *a, const Item *b);
 
     template<typename T>
     inline bool put(
@@ -126,6 +190,50 @@ public:
             typename std::enable_if<std::is_integral<T>::value, T>::type key,
             const QByteArray &value);
 
+    template<typename K, typename V>
+    inline typename std::enable_if<
+    IsByteView<K>::value && IsByteView<V>::value, bool>::type
+    put(const K &key, const V &value);
+
+    template<typename K, typename V>
+    inline typename std::enable_if<
+    IsByteView<K>::value && IsByteView<V>::value, bool>::type
+    put(Transaction &transaction, const K &key, const V &value);
+
+    template<typename K>
+    inline typename std::enable_if<IsByteView<K>::value, QByteArray>::type
+    get(const K &key);
+
+    template<typename K>
+    inline typename std::enable_if<IsByteView<K>::value, QByteArray>::type
+    get(Transaction &transaction, const K &key);
+
+    template<typename K>
+    inline typename std::enable_if<IsByteView<K>::value, QByteArrayList>::type
+    getAll(const K &key);
+
+    template<typename K>
+    inline typename std::enable_if<IsByteView<K>::value, QByteArrayList>::type
+    getAll(Transaction &transaction, const K &key);
+
+    template<typename K>
+    inline typename std::enable_if<IsByteView<K>::value, bool>::type
+    remove(const K &key);
+
+    template<typename K>
+    inline typename std::enable_if<IsByteView<K>::value, bool>::type
+    remove(Transaction &transaction, const K &key);
+
+    template<typename K, typename V>
+    inline typename std::enable_if<
+    IsByteView<K>::value && IsByteView<V>::value, bool>::type
+    remove(const K &key, const V &value);
+
+    template<typename K, typename V>
+    inline typename std::enable_if<
+    IsByteView<K>::value && IsByteView<V>::value, bool>::type
+    remove(Transaction &transaction, const K &key, const V &value);
+
 private:
 
     QScopedPointer<DatabasePrivate> d_ptr;
@@ -163,8 +271,8 @@ bool Database::put(
         typename std::enable_if<std::is_integral<T>::value, T>::type key,
         const QByteArray &value)
 {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return put(k, value);
+    return put(reinterpret_cast<const char*>(&key), sizeof(key),
+               value.constData(), static_cast<size_t>(value.size()));
 }
 
 
@@ -179,8 +287,8 @@ bool Database::put(
         Transaction &transaction,
         typename std::enable_if<std::is_integral<T>::value, T>::type key,
         const QByteArray &value) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return put(transaction, k, value);
+    return put(transaction, reinterpret_cast<const char*>(&key), sizeof(key),
+               value.constData(), static_cast<size_t>(value.size()));
 }
 
 
@@ -196,8 +304,7 @@ bool Database::put(
 template<typename T>
 QByteArray Database::get(
         typename std::enable_if<std::is_integral<T>::value, T>::type key) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return get(k);
+    return get(reinterpret_cast<const char*>(&key), sizeof(key));
 }
 
 
@@ -211,8 +318,8 @@ template<typename T>
 inline QByteArray Database::get(
         Transaction &transaction,
         typename std::enable_if<std::is_integral<T>::value, T>::type key) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return get(transaction, k);
+    return get(transaction, reinterpret_cast<const char*>(&key),
+               sizeof(key));
 }
 
 
@@ -228,8 +335,7 @@ inline QByteArray Database::get(
 template<typename T>
 QByteArrayList Database::getAll(
         typename std::enable_if<std::is_integral<T>::value, T>::type key) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return  getAll(k);
+    return getAll(reinterpret_cast<const char*>(&key), sizeof(key));
 }
 
 
@@ -243,8 +349,8 @@ template<typename T>
 inline QByteArrayList Database::getAll(
         Transaction &transaction,
         typename std::enable_if<std::is_integral<T>::value, T>::type key) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return getAll(transaction, k);
+    return getAll(transaction, reinterpret_cast<const char*>(&key),
+                  sizeof(key));
 }
 
 
@@ -260,8 +366,7 @@ inline QByteArrayList Database::getAll(
 template<typename T>
 bool Database::remove(
         typename std::enable_if<std::is_integral<T>::value, T>::type key) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return remove(k);
+    return remove(reinterpret_cast<const char*>(&key), sizeof(key));
 }
 
 
@@ -275,8 +380,8 @@ template<typename T>
 inline bool Database::remove(
         Transaction &transaction,
         typename std::enable_if<std::is_integral<T>::value, T>::type key) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return remove(transaction, k);
+    return remove(transaction, reinterpret_cast<const char*>(&key),
+                  sizeof(key));
 }
 
 
@@ -293,8 +398,8 @@ template<typename T>
 bool Database::remove(
         typename std::enable_if<std::is_integral<T>::value, T>::type key,
         const QByteArray &value) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return remove(k, value);
+    return remove(reinterpret_cast<const char*>(&key), sizeof(key),
+                  value.constData(), static_cast<size_t>(value.size()));
 }
 
 
@@ -309,8 +414,169 @@ inline bool Database::remove(
         Transaction &transaction,
         typename std::enable_if<std::is_integral<T>::value, T>::type key,
         const QByteArray &value) {
-    QByteArray k(reinterpret_cast<const char*>(&key), sizeof(key));
-    return remove(transaction, k, value);
+    return remove(transaction, reinterpret_cast<const char*>(&key),
+                  sizeof(key), value.constData(),
+                  static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Insert the @p key - @p value pair into the database.
+ *
+ * This is an overloaded version of put() which takes the @p key and
+ * @p value as views on bytes, e.g. a `std::string_view` or `QByteArrayView`.
+ *
+ * @sa IsByteView
+ */
+template<typename K, typename V>
+inline typename std::enable_if<
+IsByteView<K>::value && IsByteView<V>::value, bool>::type
+Database::put(const K &key, const V &value)
+{
+    return put(key.data(), static_cast<size_t>(key.size()),
+               value.data(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Insert the @p key - @p value pair into the database.
+ *
+ * This is an overloaded version of put() which takes the @p key and
+ * @p value as views on bytes and runs the operation in the given
+ * @p transaction.
+ */
+template<typename K, typename V>
+inline typename std::enable_if<
+IsByteView<K>::value && IsByteView<V>::value, bool>::type
+Database::put(Transaction &transaction, const K &key, const V &value)
+{
+    return put(transaction, key.data(), static_cast<size_t>(key.size()),
+               value.data(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Get the value for the given @p key from the database.
+ *
+ * This is an overloaded version of get() which takes the @p key as a view
+ * on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, QByteArray>::type
+Database::get(const K &key)
+{
+    return get(key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Get the value for the given @p key from the database.
+ *
+ * This is an overloaded version of get() which takes the @p key as a view
+ * on bytes and runs the operation in the given @p transaction.
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, QByteArray>::type
+Database::get(Transaction &transaction, const K &key)
+{
+    return get(transaction, key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Get all values for the given @p key from the database.
+ *
+ * This is an overloaded version of getAll() which takes the @p key as a view
+ * on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, QByteArrayList>::type
+Database::getAll(const K &key)
+{
+    return getAll(key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Get all values for the given @p key from the database.
+ *
+ * This is an overloaded version of getAll() which takes the @p key as a view
+ * on bytes and runs the operation in the given @p transaction.
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, QByteArrayList>::type
+Database::getAll(Transaction &transaction, const K &key)
+{
+    return getAll(transaction, key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Remove all values for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the @p key as a view
+ * on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, bool>::type
+Database::remove(const K &key)
+{
+    return remove(key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Remove all values for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the @p key as a view
+ * on bytes and runs the operation in the given @p transaction.
+ */
+template<typename K>
+inline typename std::enable_if<IsByteView<K>::value, bool>::type
+Database::remove(Transaction &transaction, const K &key)
+{
+    return remove(transaction, key.data(), static_cast<size_t>(key.size()));
+}
+
+
+/**
+ * @brief Remove a specific @p value for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the @p key and
+ * @p value as views on bytes.
+ *
+ * @sa IsByteView
+ */
+template<typename K, typename V>
+inline typename std::enable_if<
+IsByteView<K>::value && IsByteView<V>::value, bool>::type
+Database::remove(const K &key, const V &value)
+{
+    return remove(key.data(), static_cast<size_t>(key.size()),
+                  value.data(), static_cast<size_t>(value.size()));
+}
+
+
+/**
+ * @brief Remove a specific @p value for the given @p key.
+ *
+ * This is an overloaded version of remove() which takes the @p key and
+ * @p value as views on bytes and runs the operation in the given
+ * @p transaction.
+ */
+template<typename K, typename V>
+inline typename std::enable_if<
+IsByteView<K>::value && IsByteView<V>::value, bool>::type
+Database::remove(Transaction &transaction, const K &key, const V &value)
+{
+    return remove(transaction, key.data(), static_cast<size_t>(key.size()),
+                  value.data(), static_cast<size_t>(value.size()));
 }
 
 
@@ -14,42 +14,130 @@
  * You should have received a copy of the GNU General Public License
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <atomic>
+#include <cstring>
+#include <limits>
+
+#include <QtEndian>
+
+#include "changelogprivate.h"
+#include "cursorprivate.h"
 #include "databaseprivate.h"
 #include "errors.h"
+#include "indexprivate.h"
+#include "tracingprivate.h"
 #include "transaction.h"
 #include "transactionprivate.h"
 
 namespace QLMDB {
 
+namespace {
+
+// The number of entries rangeCount() counts exactly before falling back
+// to an estimate:
+const size_t ExactRangeCountLimit = 4096;
+
+// The number of entries removeRange() deletes per transaction when it
+// runs its own transactions:
+const size_t RemoveRangeChunkSize = 50000;
+
+// Map the bytes of a key following the prefix it shares with the first
+// and last key of the database to a number, so keys can be interpolated.
+double keyToNumber(const MDB_val &key, size_t prefixLength)
+{
+    unsigned char bytes[sizeof(quint64)] = {};
+    if (key.mv_size > prefixLength) {
+        std::memcpy(bytes,
+                    static_cast<const char*>(key.mv_data) + prefixLength,
+                    qMin(sizeof(bytes), key.mv_size - prefixLength));
+    }
+    return static_cast<double>(qFromBigEndian<quint64>(bytes));
+}
+
+} // namespace
+
 DatabasePrivate::DatabasePrivate() :
     context(nullptr),
     db(),
     lastError(Errors::NoError),
     lastErrorString(),
-    valid(false)
+    valid(false),
+    customKeyCompare(false),
+    name(),
+    indexes()
 {
 
 }
 
 void DatabasePrivate::initFromContext(Context &context, Transaction *txn,
-                                      const QString &name, unsigned int flags)
+                                      const QString &name, unsigned int flags,
+                                      Database::CompareFunction keyCompare,
+                                      Database::CompareFunction valueCompare)
 {
     auto stdName = name.toUtf8();
+    this->name = stdName;
     const char *dbName = nullptr;
     if (!name.isEmpty()) {
         dbName = stdName.constData();
     }
     if (context.isOpen()) {
         {
+            auto ctx = context.d_ptr.data();
+            auto &openLock = ctx->openDatabaseLock;
             if (txn != nullptr) {
-                if (txn->isValid()) {
-                    lastError = mdb_dbi_open(
-                                txn->d_ptr->txn, dbName, flags, &db);
+                if (txn->d_ptr->isUsable()) {
+                    QMutexLocker locker(&openLock);
+                    lastError = openDatabase(txn->d_ptr->txn, dbName, flags,
+                                             keyCompare, valueCompare);
+                    if (lastError == Errors::NoError) {
+                        ctx->addHandleUser(db, this);
+                    }
                 }
             } else {
-                Transaction tmpTxn(context);
-                lastError = mdb_dbi_open(
-                            tmpTxn.d_ptr->txn, dbName, flags, &db);
+                bool readOnlyContext = context.d_ptr->flags & MDB_RDONLY;
+                bool create = (flags & MDB_CREATE) && !readOnlyContext;
+                bool opened = false;
+                if (!create || dbName != nullptr) {
+                    // Opening an existing named database only reads from
+                    // the environment, so avoid taking the writer lock if
+                    // possible. The default database always exists, but
+                    // creating it might need to persist its flags.
+                    // Starting the read transaction fails if this thread
+                    // already has one (unless using NoTLS); use a write
+                    // transaction then.
+                    Transaction tmpTxn(context, Transaction::ReadOnly);
+                    if (tmpTxn.isValid()) {
+                        QMutexLocker locker(&openLock);
+                        lastError = openDatabase(
+                                    tmpTxn.d_ptr->txn, dbName,
+                                    flags & ~MDB_CREATE, keyCompare,
+                                    valueCompare);
+                        tmpTxn.commit();
+                        if (lastError == Errors::NoError) {
+                            ctx->addHandleUser(db, this);
+                        }
+                        opened = !create || lastError != Errors::NotFound;
+                    }
+                }
+                if (!opened) {
+                    Transaction tmpTxn(context);
+                    if (tmpTxn.isValid()) {
+                        QMutexLocker locker(&openLock);
+                        lastError = openDatabase(
+                                    tmpTxn.d_ptr->txn, dbName,
+                                    create ? flags : flags & ~MDB_CREATE,
+                                    keyCompare, valueCompare);
+                        if (!tmpTxn.commit() &&
+                                lastError == Errors::NoError) {
+                            lastError = tmpTxn.lastError();
+                        }
+                        if (lastError == Errors::NoError) {
+                            ctx->addHandleUser(db, this);
+                        }
+                    } else {
+                        lastError = tmpTxn.lastError();
+                    }
+                }
             }
             valid = evaluateCreateError(name);
             this->context = &context;
@@ -57,6 +145,434 @@ void DatabasePrivate::initFromContext(Context &context, Transaction *txn,
     }
 }
 
+int DatabasePrivate::openDatabase(MDB_txn *txn, const char *name,
+                                  unsigned int flags,
+                                  Database::CompareFunction keyCompare,
+                                  Database::CompareFunction valueCompare)
+{
+    auto result = mdb_dbi_open(txn, name, flags, &db);
+    customKeyCompare = keyCompare != nullptr;
+    // Opening a database resets its comparison functions, so they have to
+    // be installed each time:
+    if (result == Errors::NoError && keyCompare != nullptr) {
+        result = mdb_set_compare(
+                    txn, db, reinterpret_cast<MDB_cmp_func*>(keyCompare));
+    }
+    if (result == Errors::NoError && valueCompare != nullptr) {
+        result = mdb_set_dupsort(
+                    txn, db, reinterpret_cast<MDB_cmp_func*>(valueCompare));
+    }
+    QLMDB_TRACE(databaseOpen, name, db, result);
+    return result;
+}
+
+/**
+ * @brief Remove the entries in the key range [begin, end) in @p txn.
+ *
+ * If @p prefix is true, @p begin is interpreted as a key prefix and all
+ * entries whose keys start with it are removed; @p end is ignored in this
+ * case. At most about @p limit entries are removed (0 means no limit). The
+ * @p done flag is set to true if the end of the range has been reached.
+ * Returns the number of removed entries.
+ */
+size_t DatabasePrivate::removeRange(MDB_txn *txn, const QByteArray &begin,
+                                    const QByteArray &end, bool prefix,
+                                    size_t limit, bool &done)
+{
+    size_t result = 0;
+    done = false;
+    unsigned int flags = 0;
+    MDB_cursor *cursor = nullptr;
+    lastError = mdb_dbi_flags(txn, db, &flags);
+    if (lastError == Errors::NoError) {
+        lastError = mdb_cursor_open(txn, db, &cursor);
+    }
+    if (lastError != Errors::NoError) {
+        return result;
+    }
+    bool multiValues = flags & MDB_DUPSORT;
+    QVector<IndexUpdate> indexUpdates;
+    MDB_val endKey = bytearray_to_value(end);
+    MDB_val key, value;
+    if (begin.isEmpty()) {
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_FIRST);
+    } else {
+        key = bytearray_to_value(begin);
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_SET_RANGE);
+    }
+    while (lastError == Errors::NoError && (limit == 0 || result < limit)) {
+        if (prefix) {
+            if (key.mv_size < static_cast<size_t>(begin.size()) ||
+                    (!begin.isEmpty() && std::memcmp(
+                         key.mv_data, begin.constData(),
+                         static_cast<size_t>(begin.size())) != 0)) {
+                break;
+            }
+        } else if (!end.isEmpty() && mdb_cmp(txn, db, &key, &endKey) >= 0) {
+            break;
+        }
+        mdb_size_t count = 1;
+        if (multiValues) {
+            lastError = mdb_cursor_count(cursor, &count);
+        }
+        for (auto index : indexes) {
+            // Collecting copies the key and value, so they remain valid
+            // after deleting:
+            auto oldValue = value_to_bytearray(value);
+            index->collect(value_to_bytearray(key), &oldValue, nullptr,
+                           indexUpdates);
+        }
+        if (lastError == Errors::NoError) {
+            // Remove all values of the key at once:
+            lastError = mdb_cursor_del(cursor, multiValues ? MDB_NODUPDATA : 0);
+        }
+        if (lastError == Errors::NoError) {
+            result += static_cast<size_t>(count);
+            // After deleting, MDB_NEXT yields the entry following the
+            // deleted one:
+            lastError = mdb_cursor_get(cursor, &key, &value, MDB_NEXT);
+        }
+    }
+    if (lastError == Errors::NotFound) {
+        lastError = Errors::NoError;
+        done = true;
+    } else if (lastError == Errors::NoError) {
+        done = limit == 0 || result < limit;
+    }
+    mdb_cursor_close(cursor);
+    if (lastError == Errors::NoError && !indexUpdates.isEmpty()) {
+        // Apply the index updates of the whole range at once, in key order:
+        lastError = IndexPrivate::apply(txn, indexUpdates);
+    }
+    if (lastError == Errors::NoError && result > 0) {
+        auto k = bytearray_to_value(begin);
+        auto v = bytearray_to_value(end);
+        lastError = recordChange(txn, prefix ? ChangeLog::RemovePrefix
+                                             : ChangeLog::RemoveRange,
+                                 &k, prefix ? nullptr : &v);
+    }
+    return result;
+}
+
+/**
+ * @brief Remove the entries in the key range [begin, end).
+ *
+ * This runs removeRange() in a series of write transactions, each of which
+ * removes up to RemoveRangeChunkSize entries. This keeps the number of
+ * dirty pages per transaction bounded and allows readers to see progress
+ * when huge ranges are deleted.
+ */
+size_t DatabasePrivate::removeRange(const QByteArray &begin,
+                                    const QByteArray &end, bool prefix)
+{
+    size_t result = 0;
+    bool done = false;
+    while (!done && context != nullptr) {
+        Transaction txn(*context);
+        if (!txn.isValid()) {
+            lastError = txn.lastError();
+            break;
+        }
+        auto removed = removeRange(txn.d_ptr->txn, begin, end, prefix,
+                                   RemoveRangeChunkSize, done);
+        if (lastError != Errors::NoError) {
+            txn.abort();
+            break;
+        }
+        if (!txn.commit()) {
+            lastError = txn.lastError();
+            break;
+        }
+        result += removed;
+    }
+    return result;
+}
+
+/**
+ * @brief Get a deep copy of the value stored under the @p key.
+ *
+ * If the key is not found, @p value is set to a null byte array and
+ * Errors::NoError is returned.
+ */
+int DatabasePrivate::copyValue(MDB_txn *txn, const MDB_val &key,
+                               QByteArray &value)
+{
+    MDB_val k = key;
+    MDB_val v;
+    auto result = mdb_get(txn, db, &k, &v);
+    if (result == Errors::NoError) {
+        value = QByteArray(static_cast<const char*>(v.mv_data),
+                           static_cast<int>(v.mv_size));
+    } else if (result == Errors::NotFound) {
+        value = QByteArray();
+        result = Errors::NoError;
+    }
+    return result;
+}
+
+/**
+ * @brief Update the attached indexes after an entry changed.
+ *
+ * The entry stored under @p key changed from @p oldValue to @p newValue.
+ * Either of them is null if the entry has been added or removed.
+ */
+int DatabasePrivate::updateIndexes(MDB_txn *txn, const MDB_val &key,
+                                   const QByteArray *oldValue,
+                                   const MDB_val *newValue)
+{
+    QVector<IndexUpdate> updates;
+    auto k = value_to_bytearray(key);
+    QByteArray v;
+    if (newValue != nullptr) {
+        v = value_to_bytearray(*newValue);
+    }
+    for (auto index : indexes) {
+        index->collect(k, oldValue, newValue != nullptr ? &v : nullptr,
+                       updates);
+    }
+    return IndexPrivate::apply(txn, updates);
+}
+
+/**
+ * @brief Remove all entries from the attached indexes.
+ */
+int DatabasePrivate::clearIndexes(MDB_txn *txn)
+{
+    int result = Errors::NoError;
+    for (auto index : indexes) {
+        if (result == Errors::NoError) {
+            result = mdb_drop(txn, index->dbi(), 0);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Record a write for the change log and context watchers.
+ *
+ * The write is appended to the change log, if it is enabled. If there are
+ * ContextWatcher objects, the database is remembered as modified by the
+ * @p txn, so the watchers can be told about it once it is committed.
+ */
+int DatabasePrivate::recordChange(MDB_txn *txn, ChangeLog::Operation operation,
+                                  const MDB_val *key, const MDB_val *value)
+{
+    int result = Errors::NoError;
+    if (isWatched()) {
+        // Write transactions are serialized by LMDB, so there is no need
+        // to lock:
+        context->d_ptr->modifiedDatabases[txn].insert(
+                    QString::fromUtf8(name));
+    }
+    if (isLogging()) {
+        result = ChangeLogPrivate::append(
+                    txn, context->d_ptr->changeLog->d_ptr->db, name,
+                    operation, key, value);
+    }
+    return result;
+}
+
+/**
+ * @brief Update indexes and change log after the @p key has been written.
+ *
+ * The @p oldValue is the value stored before (if there was one and
+ * indexes are attached).
+ */
+int DatabasePrivate::afterPut(MDB_txn *txn, const MDB_val &key,
+                              const QByteArray *oldValue,
+                              const MDB_val &value)
+{
+    int result = Errors::NoError;
+    if (!indexes.isEmpty()) {
+        result = updateIndexes(txn, key, oldValue, &value);
+    }
+    if (result == Errors::NoError) {
+        result = recordChange(txn, ChangeLog::Put, &key, &value);
+    }
+    return result;
+}
+
+/**
+ * @brief Update indexes and change log after the @p key has been removed.
+ *
+ * The @p oldValue is the value stored before (if indexes are attached). If
+ * only a single @p value of the key has been removed, it is given as well.
+ */
+int DatabasePrivate::afterRemove(MDB_txn *txn, const MDB_val &key,
+                                 const QByteArray *oldValue,
+                                 const MDB_val *value)
+{
+    int result = Errors::NoError;
+    if (!indexes.isEmpty()) {
+        result = updateIndexes(txn, key, oldValue, nullptr);
+    }
+    if (result == Errors::NoError) {
+        result = recordChange(txn, ChangeLog::Remove, &key, value);
+    }
+    return result;
+}
+
+/**
+ * @brief Count or estimate the entries in the key range [begin, end).
+ *
+ * The @p cursor is used to iterate the database. Up to ExactRangeCountLimit
+ * entries are counted exactly. For larger ranges, the result is
+ * interpolated from the positions of @p begin and @p end between the first
+ * and the last key of the database. LMDB does not expose the position of
+ * a cursor within the B-tree, so this is the best estimate we can get
+ * without walking the pages.
+ *
+ * The interpolation assumes that keys are ordered like big-endian numbers.
+ * Ranges of databases with integer or reversed keys or a custom key
+ * comparison function are always counted exactly.
+ */
+size_t DatabasePrivate::rangeCount(MDB_txn *txn, MDB_cursor *cursor,
+                                   const QByteArray &begin,
+                                   const QByteArray &end)
+{
+    MDB_val beginKey = bytearray_to_value(begin);
+    MDB_val endKey = bytearray_to_value(end);
+    MDB_val key, value;
+
+    unsigned int dbFlags = 0;
+    lastError = mdb_dbi_flags(txn, db, &dbFlags);
+    if (lastError != Errors::NoError) {
+        return 0;
+    }
+    bool interpolate = !customKeyCompare &&
+            !(dbFlags & (MDB_INTEGERKEY | MDB_REVERSEKEY));
+    auto limit = interpolate ? ExactRangeCountLimit
+                             : std::numeric_limits<size_t>::max();
+
+    if (begin.isEmpty()) {
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_FIRST);
+    } else {
+        key = beginKey;
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_SET_RANGE);
+    }
+    size_t count = 0;
+    while (lastError == Errors::NoError && count < limit) {
+        if (!end.isEmpty() && mdb_cmp(txn, db, &key, &endKey) >= 0) {
+            return count;
+        }
+        ++count;
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_NEXT);
+    }
+    if (lastError != Errors::NoError) {
+        return count;
+    }
+
+    // The range is large - estimate its size:
+    MDB_stat stat;
+    MDB_val first, last;
+    lastError = mdb_stat(txn, db, &stat);
+    if (lastError == Errors::NoError) {
+        lastError = mdb_cursor_get(cursor, &first, &value, MDB_FIRST);
+    }
+    if (lastError == Errors::NoError) {
+        lastError = mdb_cursor_get(cursor, &last, &value, MDB_LAST);
+    }
+    if (lastError != Errors::NoError) {
+        return count;
+    }
+    size_t prefixLength = 0;
+    auto firstData = static_cast<const char*>(first.mv_data);
+    auto lastData = static_cast<const char*>(last.mv_data);
+    while (prefixLength < first.mv_size && prefixLength < last.mv_size &&
+           firstData[prefixLength] == lastData[prefixLength]) {
+        ++prefixLength;
+    }
+    auto firstNumber = keyToNumber(first, prefixLength);
+    auto lastNumber = keyToNumber(last, prefixLength);
+    auto position = [&](const MDB_val &boundary, double fallback) {
+        if (boundary.mv_size == 0) {
+            return fallback;
+        }
+        if (mdb_cmp(txn, db, &boundary, &first) <= 0) {
+            return 0.0;
+        }
+        if (mdb_cmp(txn, db, &boundary, &last) > 0) {
+            return 1.0;
+        }
+        if (lastNumber <= firstNumber) {
+            return 0.5;
+        }
+        auto number = keyToNumber(boundary, prefixLength);
+        return qBound(0.0, (number - firstNumber) / (lastNumber - firstNumber),
+                      1.0);
+    };
+    auto fraction = qMax(0.0,
+                         position(endKey, 1.0) - position(beginKey, 0.0));
+    auto estimate = static_cast<size_t>(
+                fraction * static_cast<double>(stat.ms_entries) + 0.5);
+    return qMax(estimate, count);
+}
+
+/**
+ * @brief Check if keys are sorted by their bytes.
+ *
+ * Sets @p result to false if the database uses integer or reversed keys or
+ * a custom key comparison function. This runs a read-only transaction.
+ * Returns 0 on success or an error code.
+ */
+int DatabasePrivate::hasDefaultKeyOrder(bool &result)
+{
+    Transaction txn(*context, Transaction::ReadOnly);
+    if (!txn.isValid()) {
+        return txn.lastError();
+    }
+    unsigned int flags = 0;
+    auto error = mdb_dbi_flags(txn.d_ptr->txn, db, &flags);
+    result = !customKeyCompare &&
+            !(flags & (MDB_INTEGERKEY | MDB_REVERSEKEY));
+    return error;
+}
+
+/**
+ * @brief Read the pages of the entries in the key range [begin, end).
+ *
+ * Iterating the entries reads the B-tree pages holding the keys, touching
+ * one byte per page of each value also reads overflow pages of large
+ * values. Returns the number of entries in the range.
+ */
+size_t DatabasePrivate::prefetch(MDB_txn *txn, MDB_cursor *cursor,
+                                 const QByteArray &begin,
+                                 const QByteArray &end)
+{
+    MDB_val endKey = bytearray_to_value(end);
+    MDB_val key, value;
+    MDB_stat stat;
+    lastError = mdb_env_stat(mdb_txn_env(txn), &stat);
+    if (lastError != Errors::NoError) {
+        return 0;
+    }
+    size_t pageSize = qMax(stat.ms_psize, 1U);
+
+    if (begin.isEmpty()) {
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_FIRST);
+    } else {
+        key = bytearray_to_value(begin);
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_SET_RANGE);
+    }
+    size_t count = 0;
+    unsigned char checksum = 0;
+    while (lastError == Errors::NoError) {
+        if (!end.isEmpty() && mdb_cmp(txn, db, &key, &endKey) >= 0) {
+            break;
+        }
+        auto data = static_cast<const unsigned char*>(value.mv_data);
+        for (size_t offset = 0; offset < value.mv_size; offset += pageSize) {
+            checksum ^= data[offset];
+        }
+        ++count;
+        lastError = mdb_cursor_get(cursor, &key, &value, MDB_NEXT);
+    }
+    // Make sure the compiler does not optimize the reads away:
+    static std::atomic<unsigned char> sink(0);
+    sink.store(checksum, std::memory_order_relaxed);
+    return count;
+}
+
 bool DatabasePrivate::evaluateCreateError(const QString &name)
 {
     bool result = false;
@@ -71,4 +587,47 @@ bool DatabasePrivate::evaluateCreateError(const QString &name)
     return result;
 }
 
+bool DatabasePrivate::evaluateReadError()
+{
+    bool result = false;
+    if (lastError == Errors::NoError) {
+        lastErrorString.clear();
+        result = true;
+    } else if (lastError == Errors::NotFound) {
+        lastErrorString = QObject::tr("Unable to find key in the database");
+    } else if (lastError == Errors::InvalidParameter) {
+        lastErrorString = QObject::tr("Invalid parameter passed to "
+                                      "database read operation");
+    } else {
+        lastErrorString = QObject::tr("Unexpected error reading from "
+                                      "database");
+    }
+    return result;
+}
+
+bool DatabasePrivate::evaluateWriteError()
+{
+    bool result = false;
+    if (lastError == Errors::NoError) {
+        lastErrorString.clear();
+        result = true;
+    } else if (lastError == Errors::NotFound) {
+        lastErrorString = QObject::tr("Unable to find key in the database");
+    } else if (lastError == Errors::MapFull) {
+        lastErrorString = QObject::tr("No more space in database");
+    } else if (lastError == Errors::TooManyTransactions) {
+        lastErrorString = QObject::tr("Transaction has too many dirty pages");
+    } else if (lastError == Errors::NoAccessToPath) {
+        lastErrorString = QObject::tr("Cannot write in a readonly "
+                                      "transaction");
+    } else if (lastError == Errors::InvalidParameter) {
+        lastErrorString = QObject::tr("Invalid parameters when trying to "
+                                      "write to database");
+    } else {
+        lastErrorString = QObject::tr("Unexpected error writing to "
+                                      "database");
+    }
+    return result;
+}
+
 } // namespace QLMDB
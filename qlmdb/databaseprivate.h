@@ -19,13 +19,18 @@
 
 #include "lmdb.h"
 
+#include <QList>
 #include <QString>
 
+#include "changelog.h"
 #include "context.h"
 #include "contextprivate.h"
+#include "database.h"
 
 namespace QLMDB {
 
+class IndexPrivate;
+
 //! @private
 class DatabasePrivate
 {
@@ -37,13 +42,74 @@ public:
     int lastError;
     QString lastErrorString;
     bool valid;
+    bool customKeyCompare;
+    QByteArray name;
+    QList<IndexPrivate*> indexes;
 
     void initFromContext(Context &context, Transaction *txn,
                          const QString &name,
-                         unsigned int flags);
+                         unsigned int flags,
+                         Database::CompareFunction keyCompare,
+                         Database::CompareFunction valueCompare);
+    int openDatabase(MDB_txn *txn, const char *name, unsigned int flags,
+                     Database::CompareFunction keyCompare,
+                     Database::CompareFunction valueCompare);
+    size_t removeRange(MDB_txn *txn, const QByteArray &begin,
+                       const QByteArray &end, bool prefix, size_t limit,
+                       bool &done);
+    size_t removeRange(const QByteArray &begin, const QByteArray &end,
+                       bool prefix);
+    int copyValue(MDB_txn *txn, const MDB_val &key, QByteArray &value);
+    int updateIndexes(MDB_txn *txn, const MDB_val &key,
+                      const QByteArray *oldValue, const MDB_val *newValue);
+    int clearIndexes(MDB_txn *txn);
+    inline bool isLogging() const;
+    inline bool hasWriteHooks() const;
+    inline bool isWatched() const;
+    int recordChange(MDB_txn *txn, ChangeLog::Operation operation,
+                     const MDB_val *key, const MDB_val *value);
+    int afterPut(MDB_txn *txn, const MDB_val &key, const QByteArray *oldValue,
+                 const MDB_val &value);
+    int afterRemove(MDB_txn *txn, const MDB_val &key,
+                    const QByteArray *oldValue, const MDB_val *value);
+    size_t rangeCount(MDB_txn *txn, MDB_cursor *cursor,
+                      const QByteArray &begin, const QByteArray &end);
+    size_t prefetch(MDB_txn *txn, MDB_cursor *cursor,
+                    const QByteArray &begin, const QByteArray &end);
+    int hasDefaultKeyOrder(bool &result);
     bool evaluateCreateError(const QString &name);
+    bool evaluateReadError();
+    bool evaluateWriteError();
 };
 
+
+/**
+ * @brief Indicates if writes to the database are recorded in the change log.
+ */
+bool DatabasePrivate::isLogging() const
+{
+    auto log = context->d_ptr->changeLog;
+    return log != nullptr && log->d_ptr->valid && log->d_ptr->db != db;
+}
+
+
+/**
+ * @brief Indicates if writes to the database are reported to watchers.
+ */
+bool DatabasePrivate::isWatched() const
+{
+    return context->d_ptr->watcherCount.loadAcquire() > 0;
+}
+
+
+/**
+ * @brief Indicates if anything needs to be done after writing.
+ */
+bool DatabasePrivate::hasWriteHooks() const
+{
+    return !indexes.isEmpty() || isLogging() || isWatched();
+}
+
 } // namespace QLMDB
 
 #endif // DATABASEPRIVATE_H
@@ -0,0 +1,579 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <QHash>
+#include <QObject>
+#include <QReadLocker>
+#include <QSet>
+#include <QVector>
+#include <QWriteLocker>
+#include <QtEndian>
+
+#include "compresseddatabase.h"
+#include "cursor.h"
+#include "dictionarycodec.h"
+#include "dictionarycodecprivate.h"
+#include "errors.h"
+#include "transaction.h"
+#include "transactionprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// Length of the substrings whose frequency is counted when building a
+// dictionary:
+const int GramSize = 8;
+
+// Length of the pieces of samples the dictionary is built from:
+const int SegmentSize = 32;
+
+inline quint32 gramHash(const char *data)
+{
+    quint64 value;
+    std::memcpy(&value, data, sizeof(value));
+    return static_cast<quint32>((value * Q_UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+}
+
+struct Segment
+{
+    int sample;
+    int offset;
+    int length;
+    qint64 score;
+};
+
+} // namespace
+
+/**
+ * @class DictionaryCodec
+ * @brief A Codec compressing small values using a shared dictionary.
+ *
+ * Small values (e.g. records of a few hundred bytes) compress poorly on
+ * their own, as the compressor cannot learn anything about the data before
+ * it ends. If the values are similar to each other, compressing them with
+ * a dictionary built from typical values helps a lot: Repeated field names
+ * and common values are found in the dictionary and encoded as short
+ * references to it.
+ *
+ * Dictionaries are trained from existing values and stored in a separate
+ * database of the Context. They are versioned: Each compressed value
+ * records the version of the dictionary it was compressed with, so
+ * training a new dictionary does not invalidate existing values. New
+ * values always use the latest dictionary:
+ *
+ * ```
+ * auto codec = QSharedPointer<DictionaryCodec>::create(
+ *             ctx, "records.dictionaries");
+ * CompressedDatabase records(ctx, "records", codec);
+ * records.setThreshold(32);
+ *
+ * // ... store some records; they are stored as is until there is a
+ * // dictionary.
+ *
+ * codec->train(records);
+ * ```
+ *
+ * Values are compressed using raw deflate streams. This codec is only
+ * available if QLMDB has been built with zlib support (see the
+ * QLMDB_WITH_ZLIB CMake option or the qlmdb_with_zlib qmake option).
+ *
+ * If another process trains a new dictionary, values compressed with it
+ * are decoded after loading it on demand (see decodeFailed()). Call
+ * reload() to compress new values with it as well.
+ */
+
+
+/**
+ * @brief The ID of the DictionaryCodec.
+ */
+const quint8 DictionaryCodec::Id = 2;
+
+
+/**
+ * @brief The default size of trained dictionaries.
+ *
+ * This is the size of the deflate window. Larger dictionaries cannot be
+ * used by deflate.
+ */
+const int DictionaryCodec::DefaultDictionarySize = 32 * 1024;
+
+
+/**
+ * @brief The default number of values sampled when training.
+ */
+const int DictionaryCodec::DefaultSampleCount = 2000;
+
+
+/**
+ * @brief Constructor.
+ *
+ * Opens (and if needed creates) the database @p name in the @p context to
+ * store the dictionaries in and loads existing dictionaries. The
+ * compression @p level ranges from 0 to 9 (-1 uses zlib's default level).
+ *
+ * Make sure there is no active Transaction ongoing in the current thread
+ * when using this constructor.
+ */
+DictionaryCodec::DictionaryCodec(Context &context, const QString &name,
+                                 int level) :
+    Codec(),
+    d_ptr(new DictionaryCodecPrivate)
+{
+    Q_D(DictionaryCodec);
+    d->level = level;
+    d->database.reset(new Database(context, name));
+    if (!d->database->isValid()) {
+        d->setError(*d->database);
+        return;
+    }
+    d->context = &context;
+    reload();
+}
+
+
+/**
+ * @brief Destructor.
+ */
+DictionaryCodec::~DictionaryCodec()
+{
+}
+
+
+/**
+ * @brief Indicates if the dictionary database could be opened.
+ */
+bool DictionaryCodec::isValid() const
+{
+    const Q_D(DictionaryCodec);
+    return d->context != nullptr && d->database->isValid();
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int DictionaryCodec::lastError() const
+{
+    const Q_D(DictionaryCodec);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString DictionaryCodec::lastErrorString() const
+{
+    const Q_D(DictionaryCodec);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void DictionaryCodec::clearLastError()
+{
+    Q_D(DictionaryCodec);
+    d->setError(Errors::NoError, QString());
+}
+
+
+/**
+ * @brief The version of the dictionary used to compress new values.
+ *
+ * This is 0 if there is no dictionary yet. In this case, encode() fails,
+ * so a CompressedDatabase stores values as is.
+ */
+quint16 DictionaryCodec::currentVersion() const
+{
+    const Q_D(DictionaryCodec);
+    QReadLocker locker(&d->lock);
+    return d->currentVersion;
+}
+
+
+/**
+ * @brief The dictionary with the given @p version.
+ *
+ * Returns a null byte array if there is no such dictionary.
+ */
+QByteArray DictionaryCodec::dictionary(quint16 version) const
+{
+    const Q_D(DictionaryCodec);
+    QReadLocker locker(&d->lock);
+    return d->dictionaries.value(version);
+}
+
+
+/**
+ * @brief Store a new version of the @p dictionary.
+ *
+ * The dictionary gets the version following the latest one stored in the
+ * database and is used for new values from now on. Returns true on
+ * success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool DictionaryCodec::addDictionary(const QByteArray &dictionary)
+{
+    Q_D(DictionaryCodec);
+    if (!isValid()) {
+        return false;
+    }
+    if (dictionary.isEmpty()) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("Empty dictionaries cannot be used"));
+        return false;
+    }
+    Transaction txn(*d->context);
+    quint16 version = 1;
+    {
+        // Determine the version in the write transaction, so concurrent
+        // writers (e.g. in other processes) don't use the same one:
+        Cursor cursor(txn, *d->database);
+        auto last = cursor.last();
+        if (last.isValid() && last.key().size() == sizeof(quint16)) {
+            version = qFromBigEndian<quint16>(last.key().constData()) + 1;
+        }
+        if (version == 0) {
+            d->setError(Errors::InvalidParameter,
+                        QObject::tr("No more dictionary versions available"));
+            txn.abort();
+            return false;
+        }
+    }
+    if (!d->database->put(txn, d->versionKey(version), dictionary)) {
+        d->setError(*d->database);
+        txn.abort();
+        return false;
+    }
+    if (!txn.commit()) {
+        d->setError(txn.lastError(), txn.lastErrorString());
+        return false;
+    }
+    QWriteLocker locker(&d->lock);
+    d->dictionaries.insert(version, dictionary);
+    d->currentVersion = qMax(d->currentVersion, version);
+    d->setError(Errors::NoError, QString());
+    return true;
+}
+
+
+/**
+ * @brief Build and store a dictionary from the @p samples.
+ *
+ * The dictionary is built via buildDictionary() and stored as a new
+ * version via addDictionary(). It has up to @p dictionarySize bytes.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool DictionaryCodec::train(const QByteArrayList &samples, int dictionarySize)
+{
+    Q_D(DictionaryCodec);
+    auto dictionary = buildDictionary(samples, dictionarySize);
+    if (dictionary.isEmpty()) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("No samples to build a dictionary from"));
+        return false;
+    }
+    return addDictionary(dictionary);
+}
+
+
+/**
+ * @brief Build and store a dictionary from the values of the @p database.
+ *
+ * Up to @p sampleCount values are sampled evenly from the whole database
+ * and used to build a dictionary with up to @p dictionarySize bytes.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool DictionaryCodec::train(CompressedDatabase &database, int sampleCount,
+                            int dictionarySize)
+{
+    Q_D(DictionaryCodec);
+    if (!isValid() || !database.isValid() || sampleCount <= 0) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("Invalid database or sample count"));
+        return false;
+    }
+    QByteArrayList samples;
+    {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        auto count = database.database()->count(txn);
+        auto stride = qMax<size_t>(1, count / static_cast<size_t>(
+                                       sampleCount));
+        Cursor cursor(txn, *database.database());
+        size_t index = 0;
+        for (auto item = cursor.first(); item.isValid() &&
+             samples.length() < sampleCount; item = cursor.next()) {
+            if (index++ % stride == 0) {
+                auto value = database.decode(item.value());
+                if (!value.isEmpty()) {
+                    samples << value;
+                }
+            }
+        }
+    }
+    return train(samples, dictionarySize);
+}
+
+
+/**
+ * @brief Load the dictionaries from the database.
+ *
+ * This is done on construction. Call it again to use dictionaries
+ * added by other processes or other DictionaryCodec objects.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool DictionaryCodec::reload()
+{
+    Q_D(DictionaryCodec);
+    if (!isValid()) {
+        return false;
+    }
+    Transaction txn(*d->context, Transaction::ReadOnly);
+    QString errorString;
+    auto error = d->load(txn, errorString);
+    d->setError(error, errorString);
+    return error == Errors::NoError;
+}
+
+
+/**
+ * @brief Build a dictionary from the @p samples.
+ *
+ * The dictionary consists of the pieces of the samples which share the
+ * most content with other samples, up to @p dictionarySize bytes. The
+ * most valuable pieces are put at the end of the dictionary, where they
+ * can be referenced most cheaply. If the samples fit into the dictionary
+ * as a whole, they are just concatenated.
+ */
+QByteArray DictionaryCodec::buildDictionary(const QByteArrayList &samples,
+                                            int dictionarySize)
+{
+    QByteArray result;
+    if (dictionarySize <= 0) {
+        return result;
+    }
+    qint64 totalSize = 0;
+    for (const auto &sample : samples) {
+        totalSize += sample.size();
+    }
+    if (totalSize <= dictionarySize) {
+        for (const auto &sample : samples) {
+            result.append(sample);
+        }
+        return result;
+    }
+
+    // Count in how many samples each substring of GramSize bytes occurs:
+    QHash<quint32, int> frequencies;
+    for (const auto &sample : samples) {
+        QSet<quint32> seen;
+        for (int i = 0; i + GramSize <= sample.size(); ++i) {
+            auto hash = gramHash(sample.constData() + i);
+            if (!seen.contains(hash)) {
+                seen.insert(hash);
+                ++frequencies[hash];
+            }
+        }
+    }
+
+    // Score the (overlapping) segments of all samples by the number of
+    // other samples sharing their content:
+    QVector<Segment> segments;
+    for (int s = 0; s < samples.length(); ++s) {
+        const auto &sample = samples.at(s);
+        for (int offset = 0; offset + GramSize <= sample.size();
+             offset += SegmentSize / 2) {
+            auto length = qMin(SegmentSize, sample.size() - offset);
+            qint64 score = 0;
+            for (int i = offset; i + GramSize <= offset + length; ++i) {
+                score += frequencies.value(
+                            gramHash(sample.constData() + i)) - 1;
+            }
+            if (score > 0) {
+                segments.append({s, offset, length, score});
+            }
+        }
+    }
+    std::stable_sort(segments.begin(), segments.end(),
+                     [](const Segment &a, const Segment &b) {
+        return a.score > b.score;
+    });
+
+    // Pick the best segments, skipping ones mostly covered already:
+    QSet<quint32> covered;
+    QVector<const Segment*> picked;
+    int size = 0;
+    for (const auto &segment : segments) {
+        if (size + segment.length > dictionarySize) {
+            continue;
+        }
+        auto data = samples.at(segment.sample).constData() + segment.offset;
+        qint64 score = 0;
+        for (int i = 0; i + GramSize <= segment.length; ++i) {
+            auto hash = gramHash(data + i);
+            if (!covered.contains(hash)) {
+                score += frequencies.value(hash) - 1;
+            }
+        }
+        if (score * 2 < segment.score) {
+            continue;
+        }
+        for (int i = 0; i + GramSize <= segment.length; ++i) {
+            covered.insert(gramHash(data + i));
+        }
+        picked.append(&segment);
+        size += segment.length;
+        if (size + GramSize > dictionarySize) {
+            break;
+        }
+    }
+
+    result.reserve(size);
+    for (auto it = picked.crbegin(); it != picked.crend(); ++it) {
+        auto segment = *it;
+        result.append(samples.at(segment->sample).constData() +
+                      segment->offset, segment->length);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The ID of the codec.
+ *
+ * This is DictionaryCodec::Id.
+ */
+quint8 DictionaryCodec::id() const
+{
+    return Id;
+}
+
+
+/**
+ * @brief Compress the @p value using the current dictionary.
+ *
+ * Fails if there is no dictionary yet.
+ */
+bool DictionaryCodec::encode(const QByteArray &value,
+                             QByteArray &result) const
+{
+    const Q_D(DictionaryCodec);
+    quint16 version;
+    QByteArray dictionary;
+    {
+        QReadLocker locker(&d->lock);
+        version = d->currentVersion;
+        dictionary = d->dictionaries.value(version);
+    }
+    if (version == 0) {
+        return false;
+    }
+    result = d->versionKey(version);
+    return d->compress(dictionary, d->level, value, result);
+}
+
+
+/**
+ * @brief Uncompress the @p data using the dictionary it was compressed with.
+ *
+ * Fails if the dictionary is not known (see reload()).
+ */
+bool DictionaryCodec::decode(const QByteArray &data,
+                             QByteArray &result) const
+{
+    const Q_D(DictionaryCodec);
+    if (data.size() < static_cast<int>(sizeof(quint16))) {
+        return false;
+    }
+    auto version = qFromBigEndian<quint16>(data.constData());
+    QByteArray dictionary;
+    {
+        QReadLocker locker(&d->lock);
+        dictionary = d->dictionaries.value(version);
+    }
+    if (dictionary.isNull()) {
+        return false;
+    }
+    return d->uncompress(dictionary, data.constData() + sizeof(quint16),
+                         data.size() - static_cast<int>(sizeof(quint16)),
+                         result);
+}
+
+
+/**
+ * @brief Load the dictionary the @p data was compressed with, if unknown.
+ *
+ * If decode() fails because the dictionary is not known, the dictionaries
+ * are reloaded once - e.g. another process might have trained a new one.
+ * They are read in the @p transaction, if it belongs to the context of
+ * the codec, or in a read-only transaction of their own otherwise.
+ *
+ * Returns Errors::NoError if the dictionary has been loaded,
+ * Errors::NotFound if it does not exist (or could not be read) and
+ * Errors::Corrupted if the dictionary is known, i.e. the @p data is
+ * invalid. In contrast to reload(), lastError() is not changed, as this is
+ * called by concurrent decode() calls.
+ */
+int DictionaryCodec::decodeFailed(Transaction *transaction,
+                                  const QByteArray &data) const
+{
+    const Q_D(DictionaryCodec);
+    if (data.size() < static_cast<int>(sizeof(quint16))) {
+        return Errors::Corrupted;
+    }
+    auto version = qFromBigEndian<quint16>(data.constData());
+    {
+        QReadLocker locker(&d->lock);
+        if (d->dictionaries.contains(version)) {
+            return Errors::Corrupted;
+        }
+    }
+    if (d->database.isNull() || !d->database->isValid()) {
+        return Errors::NotFound;
+    }
+    QString errorString;
+    int error;
+    if (transaction != nullptr &&
+            &transaction->d_ptr->context == d->context) {
+        error = d->load(*transaction, errorString);
+    } else {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        error = d->load(txn, errorString);
+    }
+    if (error != Errors::NoError) {
+        return Errors::NotFound;
+    }
+    QReadLocker locker(&d->lock);
+    return d->dictionaries.contains(version) ? Errors::NoError
+                                             : Errors::NotFound;
+}
+
+} // namespace QLMDB
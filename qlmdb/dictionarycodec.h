@@ -0,0 +1,77 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DICTIONARYCODEC_H
+#define DICTIONARYCODEC_H
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QScopedPointer>
+#include <QString>
+
+#include "codec.h"
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class CompressedDatabase;
+class Context;
+class DictionaryCodecPrivate;
+
+class QLMDBSHARED_EXPORT DictionaryCodec : public Codec
+{
+public:
+    static const quint8 Id;
+    static const int DefaultDictionarySize;
+    static const int DefaultSampleCount;
+
+    explicit DictionaryCodec(Context &context, const QString &name,
+                             int level = -1);
+    ~DictionaryCodec() override;
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    quint16 currentVersion() const;
+    QByteArray dictionary(quint16 version) const;
+    bool addDictionary(const QByteArray &dictionary);
+    bool train(const QByteArrayList &samples,
+               int dictionarySize = DefaultDictionarySize);
+    bool train(CompressedDatabase &database,
+               int sampleCount = DefaultSampleCount,
+               int dictionarySize = DefaultDictionarySize);
+    bool reload();
+
+    static QByteArray buildDictionary(const QByteArrayList &samples,
+                                      int dictionarySize);
+
+    quint8 id() const override;
+    bool encode(const QByteArray &value, QByteArray &result) const override;
+    bool decode(const QByteArray &data, QByteArray &result) const override;
+    int decodeFailed(Transaction *transaction,
+                     const QByteArray &data) const override;
+
+private:
+    QScopedPointer<DictionaryCodecPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(DictionaryCodec)
+};
+
+} // namespace QLMDB
+
+#endif // DICTIONARYCODEC_H
@@ -0,0 +1,193 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <zlib.h>
+
+#include <QWriteLocker>
+#include <QtEndian>
+
+#include "cursor.h"
+#include "dictionarycodecprivate.h"
+#include "errors.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+namespace {
+
+// Values are compressed as raw deflate streams, i.e. without the zlib
+// header and checksum, which would add 6 bytes to each value:
+const int RawDeflateWindowBits = -15;
+
+// Memory level used by deflate (between 1 and 9, 8 is zlib's default):
+const int MemoryLevel = 8;
+
+} // namespace
+
+DictionaryCodecPrivate::DictionaryCodecPrivate() :
+    context(nullptr),
+    database(),
+    level(Z_DEFAULT_COMPRESSION),
+    lastError(Errors::NoError),
+    lastErrorString(),
+    lock(),
+    dictionaries(),
+    currentVersion(0)
+{
+
+}
+
+QByteArray DictionaryCodecPrivate::versionKey(quint16 version)
+{
+    char key[sizeof(quint16)];
+    qToBigEndian<quint16>(version, key);
+    return QByteArray(key, sizeof(key));
+}
+
+/**
+ * @brief Compress the @p value using the @p dictionary.
+ *
+ * The compressed data is appended to the @p result.
+ */
+bool DictionaryCodecPrivate::compress(const QByteArray &dictionary, int level,
+                                      const QByteArray &value,
+                                      QByteArray &result)
+{
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    if (deflateInit2(&stream, level, Z_DEFLATED, RawDeflateWindowBits,
+                     MemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+    bool ok = deflateSetDictionary(
+                &stream,
+                reinterpret_cast<const Bytef*>(dictionary.constData()),
+                static_cast<uInt>(dictionary.size())) == Z_OK;
+    if (ok) {
+        auto offset = result.size();
+        auto bound = deflateBound(&stream, static_cast<uLong>(value.size()));
+        result.resize(offset + static_cast<int>(bound));
+        stream.next_in = reinterpret_cast<Bytef*>(
+                    const_cast<char*>(value.constData()));
+        stream.avail_in = static_cast<uInt>(value.size());
+        stream.next_out = reinterpret_cast<Bytef*>(result.data() + offset);
+        stream.avail_out = static_cast<uInt>(bound);
+        ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+        result.resize(offset + static_cast<int>(stream.total_out));
+    }
+    deflateEnd(&stream);
+    return ok;
+}
+
+/**
+ * @brief Uncompress the @p data using the @p dictionary.
+ */
+bool DictionaryCodecPrivate::uncompress(const QByteArray &dictionary,
+                                        const char *data, int size,
+                                        QByteArray &result)
+{
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = static_cast<uInt>(size);
+    if (inflateInit2(&stream, RawDeflateWindowBits) != Z_OK) {
+        return false;
+    }
+    // For raw streams, the dictionary is set upfront:
+    bool ok = inflateSetDictionary(
+                &stream,
+                reinterpret_cast<const Bytef*>(dictionary.constData()),
+                static_cast<uInt>(dictionary.size())) == Z_OK;
+    int ret = Z_OK;
+    result.resize(qMax(256, size * 4));
+    while (ok) {
+        auto offset = static_cast<int>(stream.total_out);
+        stream.next_out = reinterpret_cast<Bytef*>(result.data() + offset);
+        stream.avail_out = static_cast<uInt>(result.size() - offset);
+        ret = inflate(&stream, Z_FINISH);
+        if (ret == Z_STREAM_END) {
+            break;
+        }
+        if ((ret != Z_BUF_ERROR && ret != Z_OK) || stream.avail_out != 0 ||
+                result.size() > (1 << 30)) {
+            // Corrupted, truncated or unreasonably large:
+            ok = false;
+        } else {
+            result.resize(result.size() * 2);
+        }
+    }
+    if (ok) {
+        result.resize(static_cast<int>(stream.total_out));
+    } else {
+        result.clear();
+    }
+    inflateEnd(&stream);
+    return ok;
+}
+
+/**
+ * @brief Load the dictionaries from the database within the @p transaction.
+ *
+ * Replaces the dictionaries known so far. Returns Errors::NoError on
+ * success or the error that occurred otherwise, with a description in the
+ * @p errorString.
+ */
+int DictionaryCodecPrivate::load(Transaction &transaction,
+                                 QString &errorString) const
+{
+    QHash<quint16, QByteArray> loaded;
+    quint16 latestVersion = 0;
+    Cursor cursor(transaction, *database);
+    for (auto item = cursor.first(); item.isValid(); item = cursor.next()) {
+        auto key = item.key();
+        if (key.size() == sizeof(quint16)) {
+            auto version = qFromBigEndian<quint16>(key.constData());
+            // Deep copy, as the value points into the memory map:
+            auto value = item.value();
+            loaded.insert(version, QByteArray(value.constData(),
+                                              value.size()));
+            latestVersion = qMax(latestVersion, version);
+        }
+    }
+    if (cursor.lastError() != Errors::NoError &&
+            cursor.lastError() != Errors::NotFound) {
+        errorString = cursor.lastErrorString();
+        return cursor.lastError();
+    }
+    QWriteLocker locker(&lock);
+    dictionaries = loaded;
+    currentVersion = latestVersion;
+    errorString.clear();
+    return Errors::NoError;
+}
+
+void DictionaryCodecPrivate::setError(int error, const QString &errorString)
+{
+    lastError = error;
+    lastErrorString = errorString;
+}
+
+void DictionaryCodecPrivate::setError(const Database &database)
+{
+    setError(database.lastError(), database.lastErrorString());
+}
+
+} // namespace QLMDB
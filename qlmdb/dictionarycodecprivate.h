@@ -0,0 +1,63 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef DICTIONARYCODECPRIVATE_H
+#define DICTIONARYCODECPRIVATE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QScopedPointer>
+#include <QString>
+
+#include "context.h"
+#include "database.h"
+#include "dictionarycodec.h"
+
+namespace QLMDB {
+
+//! @private
+class DictionaryCodecPrivate
+{
+public:
+    DictionaryCodecPrivate();
+
+    Context *context;
+    QScopedPointer<Database> database;
+    int level;
+    int lastError;
+    QString lastErrorString;
+
+    // Guards the dictionaries, which are used by concurrent encode() and
+    // decode() calls. They are mutable, as decoding loads missing ones:
+    mutable QReadWriteLock lock;
+    mutable QHash<quint16, QByteArray> dictionaries;
+    mutable quint16 currentVersion;
+
+    static QByteArray versionKey(quint16 version);
+    static bool compress(const QByteArray &dictionary, int level,
+                         const QByteArray &value, QByteArray &result);
+    static bool uncompress(const QByteArray &dictionary, const char *data,
+                           int size, QByteArray &result);
+
+    int load(Transaction &transaction, QString &errorString) const;
+    void setError(int error, const QString &errorString);
+    void setError(const Database &database);
+};
+
+} // namespace QLMDB
+
+#endif // DICTIONARYCODECPRIVATE_H
@@ -0,0 +1,487 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+
+#include "errors.h"
+#include "expiringdatabase.h"
+#include "expiringdatabaseprivate.h"
+
+namespace QLMDB {
+
+/**
+ * @class ExpiringDatabase
+ * @brief A database whose entries can expire after a time-to-live.
+ *
+ * The ExpiringDatabase class wraps a named Database and allows to store
+ * entries which are removed automatically once their time-to-live (TTL)
+ * elapsed:
+ *
+ * ```
+ * Context ctx;
+ * ctx.setPath("/tmp/db/");
+ * ctx.setMaxDBs(10);
+ * if (ctx.open()) {
+ *     ExpiringDatabase sessions(ctx, "sessions");
+ *     sessions.startSweeper();
+ *
+ *     // Keep the session for one hour:
+ *     sessions.put("session-id", "user-data", 60 * 60 * 1000);
+ * }
+ * ```
+ *
+ * Each value is stored with its expiry time in front of it. In addition,
+ * the keys of entries with a TTL are tracked in a second database (named
+ * like the data database with an `.expiry` suffix) which is ordered by
+ * expiry time. Hence, the Context must be configured to allow at least two
+ * named databases per ExpiringDatabase. The databases should only be
+ * accessed via this class.
+ *
+ * ## Expiry
+ *
+ * Reading an entry via get() ignores it if it expired, even if it has not
+ * yet been removed. Expired entries are removed in bounded batches by
+ * removeExpired(). Each batch runs in its own write transaction. Hence,
+ * the writer lock is only held for short periods of time and foreground
+ * writes can proceed in between the batches. As the expiry index is
+ * ordered, removing entries only touches the expired ones instead of
+ * scanning the whole database.
+ *
+ * Instead of calling removeExpired() manually, a background thread can be
+ * started via startSweeper(). It periodically removes expired entries
+ * until stopSweeper() is called or the ExpiringDatabase is destroyed.
+ * Note that the Context must outlive the ExpiringDatabase.
+ */
+
+
+/**
+ * @brief Open an ExpiringDatabase.
+ *
+ * This opens (and if needed creates) the database @p name and its expiry
+ * index in the given @p context. The @p name must not be empty. If opening
+ * the databases succeeded, isValid() is true.
+ *
+ * Make sure there is no active Transaction ongoing in the current thread
+ * when using this constructor.
+ */
+ExpiringDatabase::ExpiringDatabase(Context &context, const QString &name) :
+    d_ptr(new ExpiringDatabasePrivate)
+{
+    Q_D(ExpiringDatabase);
+    if (name.isEmpty()) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("An ExpiringDatabase requires a named "
+                                "database"));
+        return;
+    }
+    d->data.reset(new Database(context, name));
+    if (!d->data->isValid()) {
+        d->setError(*d->data);
+        return;
+    }
+    d->index.reset(new Database(context, name + QStringLiteral(".expiry")));
+    if (!d->index->isValid()) {
+        d->setError(*d->index);
+        return;
+    }
+    d->context = &context;
+}
+
+
+/**
+ * @brief Destructor.
+ *
+ * If a sweeper is running, it is stopped.
+ */
+ExpiringDatabase::~ExpiringDatabase()
+{
+}
+
+
+/**
+ * @brief Is the database valid.
+ */
+bool ExpiringDatabase::isValid() const
+{
+    const Q_D(ExpiringDatabase);
+    return d->context != nullptr && d->data->isValid() &&
+            d->index->isValid();
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int ExpiringDatabase::lastError() const
+{
+    const Q_D(ExpiringDatabase);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString ExpiringDatabase::lastErrorString() const
+{
+    const Q_D(ExpiringDatabase);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void ExpiringDatabase::clearLastError()
+{
+    Q_D(ExpiringDatabase);
+    d->setError(Errors::NoError, QString());
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * The entry expires after @p ttl milliseconds. If @p ttl is zero or
+ * negative, the entry never expires. Any existing value (and expiry) of
+ * the key is replaced. Returns true on success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool ExpiringDatabase::put(const QByteArray &key, const QByteArray &value,
+                           qint64 ttl)
+{
+    Q_D(ExpiringDatabase);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context);
+        result = put(txn, key, value, ttl);
+        if (!result) {
+            // Don't leave the value and expiry index out of sync:
+            txn.abort();
+        } else if (!txn.commit()) {
+            d->setError(txn);
+            result = false;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * This is an overloaded version of put(). It runs the operation in the
+ * given @p transaction.
+ */
+bool ExpiringDatabase::put(Transaction &transaction, const QByteArray &key,
+                           const QByteArray &value, qint64 ttl)
+{
+    Q_D(ExpiringDatabase);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        qint64 expiry = 0;
+        if (ttl > 0) {
+            expiry = QDateTime::currentMSecsSinceEpoch() + ttl;
+        }
+        if (d->removeIndexEntry(transaction, key)) {
+            if (!d->data->put(transaction, key,
+                              d->encodeValue(expiry, value))) {
+                d->setError(*d->data);
+            } else if (expiry != 0 && !d->index->put(
+                           transaction, d->indexKey(expiry, key),
+                           QByteArray())) {
+                d->setError(*d->index);
+            } else {
+                d->setError(Errors::NoError, QString());
+                result = true;
+            }
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * If the key is not in the database or it expired, a null byte array is
+ * returned and lastError() is set to Errors::NotFound. If the stored
+ * value is too short to hold an expiry, lastError() is set to
+ * Errors::Corrupted.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArray ExpiringDatabase::get(const QByteArray &key)
+{
+    Q_D(ExpiringDatabase);
+    QByteArray result;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = get(txn, key);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * This is an overloaded version of get(). It runs the operation in the
+ * given @p transaction.
+ */
+QByteArray ExpiringDatabase::get(Transaction &transaction,
+                                 const QByteArray &key)
+{
+    Q_D(ExpiringDatabase);
+    QByteArray result;
+    if (isValid() && transaction.isValid()) {
+        Cursor cursor(transaction, *d->data);
+        auto current = cursor.findKey(key);
+        if (current.isValid()) {
+            auto value = current.value();
+            auto size = static_cast<size_t>(value.size());
+            auto expiry = d->decodeExpiry(value.constData(), size);
+            if (size < sizeof(quint64)) {
+                d->setError(Errors::Corrupted,
+                            QObject::tr("Missing expiry in stored value"));
+            } else if (expiry != 0 &&
+                       expiry <= QDateTime::currentMSecsSinceEpoch()) {
+                d->setError(Errors::NotFound,
+                            QObject::tr("The entry has expired"));
+            } else {
+                // The value points into the memory map, deep copy it:
+                result = QByteArray(value.constData() + sizeof(quint64),
+                                    value.size() -
+                                    static_cast<int>(sizeof(quint64)));
+                d->setError(Errors::NoError, QString());
+            }
+        } else {
+            d->setError(cursor);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief The time when the entry of the @p key expires.
+ *
+ * If the entry does not expire, is not in the database or an error
+ * occurred, an invalid QDateTime is returned.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QDateTime ExpiringDatabase::expiresAt(const QByteArray &key)
+{
+    Q_D(ExpiringDatabase);
+    QDateTime result;
+    if (isValid()) {
+        Transaction txn(*d->context, Transaction::ReadOnly);
+        result = expiresAt(txn, key);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The time when the entry of the @p key expires.
+ *
+ * This is an overloaded version of expiresAt(). It runs the operation in
+ * the given @p transaction.
+ */
+QDateTime ExpiringDatabase::expiresAt(Transaction &transaction,
+                                      const QByteArray &key)
+{
+    Q_D(ExpiringDatabase);
+    QDateTime result;
+    if (isValid() && transaction.isValid()) {
+        Cursor cursor(transaction, *d->data);
+        auto current = cursor.findKey(key);
+        if (current.isValid()) {
+            auto value = current.value();
+            auto size = static_cast<size_t>(value.size());
+            auto expiry = d->decodeExpiry(value.constData(), size);
+            if (size < sizeof(quint64)) {
+                d->setError(Errors::Corrupted,
+                            QObject::tr("Missing expiry in stored value"));
+            } else {
+                if (expiry != 0) {
+                    result = QDateTime::fromMSecsSinceEpoch(expiry);
+                }
+                d->setError(Errors::NoError, QString());
+            }
+        } else {
+            d->setError(cursor);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the entry of the @p key.
+ *
+ * Returns true if the entry was removed or false if it was not found or
+ * an error occurred.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool ExpiringDatabase::remove(const QByteArray &key)
+{
+    Q_D(ExpiringDatabase);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context);
+        result = remove(txn, key);
+        if (!result) {
+            txn.abort();
+        } else if (!txn.commit()) {
+            d->setError(txn);
+            result = false;
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the entry of the @p key.
+ *
+ * This is an overloaded version of remove(). It runs the operation in the
+ * given @p transaction.
+ */
+bool ExpiringDatabase::remove(Transaction &transaction, const QByteArray &key)
+{
+    Q_D(ExpiringDatabase);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        if (d->removeIndexEntry(transaction, key)) {
+            result = d->data->remove(transaction, key);
+            d->setError(*d->data);
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove expired entries.
+ *
+ * This removes all expired entries from the database. The entries are
+ * removed in batches of up to @p batchSize entries, each of which runs in
+ * its own write transaction. Returns the number of removed entries.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t ExpiringDatabase::removeExpired(size_t batchSize)
+{
+    Q_D(ExpiringDatabase);
+    size_t result = 0;
+    if (isValid()) {
+        size_t removed = 0;
+        do {
+            Transaction txn(*d->context);
+            removed = removeExpired(txn, batchSize);
+            if (d->lastError != Errors::NoError) {
+                txn.abort();
+                break;
+            }
+            if (!txn.commit()) {
+                d->setError(txn);
+                break;
+            }
+            result += removed;
+        } while (batchSize != 0 && removed == batchSize);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove expired entries.
+ *
+ * This is an overloaded version of removeExpired(). It removes up to
+ * @p limit expired entries in the given @p transaction. If @p limit is 0,
+ * all expired entries are removed.
+ */
+size_t ExpiringDatabase::removeExpired(Transaction &transaction, size_t limit)
+{
+    Q_D(ExpiringDatabase);
+    size_t result = 0;
+    if (isValid() && transaction.isValid()) {
+        result = d->removeExpired(
+                    transaction, *d->data, *d->index,
+                    QDateTime::currentMSecsSinceEpoch(), limit,
+                    d->lastError, d->lastErrorString);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Start removing expired entries in the background.
+ *
+ * This starts a thread which calls removeExpired() every @p interval
+ * milliseconds with the given @p batchSize. If a sweeper is already
+ * running, it is restarted with the new settings.
+ *
+ * Errors occurring in the sweeper are not reported, the sweeper just tries
+ * again in its next round.
+ */
+void ExpiringDatabase::startSweeper(int interval, size_t batchSize)
+{
+    Q_D(ExpiringDatabase);
+    if (isValid()) {
+        stopSweeper();
+        d->sweeper.reset(new ExpirySweeper(d, interval, batchSize));
+        d->sweeper->start();
+    }
+}
+
+
+/**
+ * @brief Stop removing expired entries in the background.
+ *
+ * This stops the sweeper thread (if one is running) and waits for it to
+ * finish.
+ */
+void ExpiringDatabase::stopSweeper()
+{
+    Q_D(ExpiringDatabase);
+    if (d->sweeper) {
+        d->sweeper->stop();
+        d->sweeper.reset();
+    }
+}
+
+
+/**
+ * @brief Indicates if the background sweeper is running.
+ */
+bool ExpiringDatabase::isSweeperRunning() const
+{
+    const Q_D(ExpiringDatabase);
+    return d->sweeper && d->sweeper->isRunning();
+}
+
+} // namespace QLMDB
@@ -0,0 +1,69 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EXPIRINGDATABASE_H
+#define EXPIRINGDATABASE_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QScopedPointer>
+#include <QString>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Context;
+class ExpiringDatabasePrivate;
+class Transaction;
+
+class QLMDBSHARED_EXPORT ExpiringDatabase
+{
+public:
+    explicit ExpiringDatabase(Context &context, const QString &name);
+    virtual ~ExpiringDatabase();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    bool put(const QByteArray &key, const QByteArray &value, qint64 ttl = 0);
+    bool put(Transaction &transaction, const QByteArray &key,
+             const QByteArray &value, qint64 ttl = 0);
+    QByteArray get(const QByteArray &key);
+    QByteArray get(Transaction &transaction, const QByteArray &key);
+    QDateTime expiresAt(const QByteArray &key);
+    QDateTime expiresAt(Transaction &transaction, const QByteArray &key);
+    bool remove(const QByteArray &key);
+    bool remove(Transaction &transaction, const QByteArray &key);
+
+    size_t removeExpired(size_t batchSize = 1000);
+    size_t removeExpired(Transaction &transaction, size_t limit = 0);
+
+    void startSweeper(int interval = 1000, size_t batchSize = 1000);
+    void stopSweeper();
+    bool isSweeperRunning() const;
+
+private:
+    QScopedPointer<ExpiringDatabasePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ExpiringDatabase)
+};
+
+} // namespace QLMDB
+
+#endif // EXPIRINGDATABASE_H
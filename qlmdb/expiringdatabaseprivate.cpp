@@ -0,0 +1,257 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QtEndian>
+
+#include "errors.h"
+#include "expiringdatabaseprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// Values are prefixed with their expiry time in milliseconds since the
+// epoch, stored as big endian integer. Zero means the entry never expires.
+const int ExpirySize = sizeof(quint64);
+
+} // namespace
+
+ExpiringDatabasePrivate::ExpiringDatabasePrivate() :
+    context(nullptr),
+    data(),
+    index(),
+    sweeper(),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+ExpiringDatabasePrivate::~ExpiringDatabasePrivate()
+{
+    if (sweeper) {
+        sweeper->stop();
+    }
+}
+
+QByteArray ExpiringDatabasePrivate::encodeValue(qint64 expiry,
+                                                const QByteArray &value)
+{
+    char bytes[ExpirySize];
+    qToBigEndian<quint64>(static_cast<quint64>(expiry), bytes);
+    QByteArray result;
+    result.reserve(ExpirySize + value.size());
+    result.append(bytes, ExpirySize);
+    result.append(value);
+    return result;
+}
+
+qint64 ExpiringDatabasePrivate::decodeExpiry(const char *data, size_t size)
+{
+    qint64 result = 0;
+    if (size >= ExpirySize) {
+        result = static_cast<qint64>(qFromBigEndian<quint64>(data));
+    }
+    return result;
+}
+
+QByteArray ExpiringDatabasePrivate::indexKey(qint64 expiry,
+                                             const QByteArray &key)
+{
+    // The index is ordered by expiry time first, so the sweeper can stop
+    // as soon as it reaches the first entry which did not yet expire:
+    return encodeValue(expiry, key);
+}
+
+/**
+ * @brief Remove the expiry index entry of the @p key, if there is one.
+ */
+bool ExpiringDatabasePrivate::removeIndexEntry(Transaction &transaction,
+                                               const QByteArray &key)
+{
+    Cursor cursor(transaction, *data);
+    auto current = cursor.findKey(key);
+    if (!current.isValid()) {
+        if (cursor.lastError() == Errors::NotFound) {
+            return true;
+        }
+        setError(cursor);
+        return false;
+    }
+    auto value = current.value();
+    auto expiry = decodeExpiry(value.constData(),
+                               static_cast<size_t>(value.size()));
+    if (expiry != 0 && !index->remove(transaction, indexKey(expiry, key)) &&
+            index->lastError() != Errors::NotFound) {
+        setError(*index);
+        return false;
+    }
+    return true;
+}
+
+void ExpiringDatabasePrivate::setError(int error, const QString &errorString)
+{
+    lastError = error;
+    lastErrorString = errorString;
+}
+
+void ExpiringDatabasePrivate::setError(const Database &database)
+{
+    setError(database.lastError(), database.lastErrorString());
+}
+
+void ExpiringDatabasePrivate::setError(const Cursor &cursor)
+{
+    setError(cursor.lastError(), cursor.lastErrorString());
+}
+
+void ExpiringDatabasePrivate::setError(const Transaction &transaction)
+{
+    setError(transaction.lastError(), transaction.lastErrorString());
+}
+
+/**
+ * @brief Remove entries which expired at time @p now.
+ *
+ * This removes up to @p limit expired entries (or all, if the limit is 0)
+ * from the @p data database together with their entries in the @p index.
+ * Only Cursor objects local to this function are used, so this can safely
+ * run in the sweeper thread while the Database objects are used
+ * elsewhere. Errors are reported via @p error and @p errorString.
+ */
+size_t ExpiringDatabasePrivate::removeExpired(
+        Transaction &transaction, Database &data, Database &index,
+        qint64 now, size_t limit, int &error, QString &errorString)
+{
+    size_t result = 0;
+    error = Errors::NoError;
+    errorString.clear();
+    Cursor indexCursor(transaction, index);
+    Cursor dataCursor(transaction, data);
+    auto item = indexCursor.first();
+    while (item.isValid() && (limit == 0 || result < limit)) {
+        auto entry = item.key();
+        auto expiry = decodeExpiry(entry.constData(),
+                                   static_cast<size_t>(entry.size()));
+        if (expiry > now) {
+            break;
+        }
+        // Deep copy the key, deleting invalidates the memory it points to:
+        QByteArray key(entry.constData() + ExpirySize,
+                       qMax(0, entry.size() - ExpirySize));
+        if (!indexCursor.remove()) {
+            break;
+        }
+        auto current = dataCursor.findKey(key);
+        if (current.isValid()) {
+            auto value = current.value();
+            // Only remove the value if it has not been overwritten:
+            if (decodeExpiry(value.constData(),
+                             static_cast<size_t>(value.size())) == expiry) {
+                if (!dataCursor.remove()) {
+                    error = dataCursor.lastError();
+                    errorString = dataCursor.lastErrorString();
+                    return result;
+                }
+                ++result;
+            }
+        } else if (dataCursor.lastError() != Errors::NotFound) {
+            error = dataCursor.lastError();
+            errorString = dataCursor.lastErrorString();
+            return result;
+        }
+        // After removing, next() yields the entry following the removed
+        // one:
+        item = indexCursor.next();
+    }
+    if (!indexCursor.isValid() ||
+            (indexCursor.lastError() != Errors::NoError &&
+             indexCursor.lastError() != Errors::NotFound)) {
+        error = indexCursor.lastError();
+        errorString = indexCursor.lastErrorString();
+    }
+    return result;
+}
+
+
+ExpirySweeper::ExpirySweeper(ExpiringDatabasePrivate *database,
+                             int interval, size_t batchSize) :
+    QThread(),
+    database(database),
+    interval(interval),
+    batchSize(batchSize),
+    mutex(),
+    condition(),
+    stopped(false)
+{
+
+}
+
+/**
+ * @brief Stop the sweeper and wait for it to finish.
+ */
+void ExpirySweeper::stop()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopped = true;
+        condition.wakeAll();
+    }
+    wait();
+}
+
+void ExpirySweeper::run()
+{
+    while (!isStopped()) {
+        size_t removed = 0;
+        do {
+            // Each batch runs in its own transaction, so the writer lock is
+            // released regularly and foreground writes are not blocked for
+            // long:
+            Transaction txn(*database->context);
+            int error;
+            QString errorString;
+            removed = ExpiringDatabasePrivate::removeExpired(
+                        txn, *database->data, *database->index,
+                        QDateTime::currentMSecsSinceEpoch(), batchSize,
+                        error, errorString);
+            if (error == Errors::NoError) {
+                txn.commit();
+            } else {
+                // Try again in the next round:
+                txn.abort();
+                removed = 0;
+            }
+        } while (removed == batchSize && !isStopped());
+
+        mutex.lock();
+        if (!stopped) {
+            condition.wait(&mutex, static_cast<unsigned long>(interval));
+        }
+        mutex.unlock();
+    }
+}
+
+bool ExpirySweeper::isStopped()
+{
+    QMutexLocker locker(&mutex);
+    return stopped;
+}
+
+} // namespace QLMDB
@@ -0,0 +1,91 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EXPIRINGDATABASEPRIVATE_H
+#define EXPIRINGDATABASEPRIVATE_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QScopedPointer>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "context.h"
+#include "cursor.h"
+#include "database.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+class ExpirySweeper;
+
+//! @private
+class ExpiringDatabasePrivate
+{
+public:
+    ExpiringDatabasePrivate();
+    ~ExpiringDatabasePrivate();
+
+    Context *context;
+    QScopedPointer<Database> data;
+    QScopedPointer<Database> index;
+    QScopedPointer<ExpirySweeper> sweeper;
+    int lastError;
+    QString lastErrorString;
+
+    static QByteArray encodeValue(qint64 expiry, const QByteArray &value);
+    static qint64 decodeExpiry(const char *data, size_t size);
+    static QByteArray indexKey(qint64 expiry, const QByteArray &key);
+
+    bool removeIndexEntry(Transaction &transaction, const QByteArray &key);
+    void setError(int error, const QString &errorString);
+    void setError(const Database &database);
+    void setError(const Cursor &cursor);
+    void setError(const Transaction &transaction);
+
+    static size_t removeExpired(Transaction &transaction, Database &data,
+                                Database &index, qint64 now, size_t limit,
+                                int &error, QString &errorString);
+};
+
+
+//! @private
+class ExpirySweeper : public QThread
+{
+public:
+    ExpirySweeper(ExpiringDatabasePrivate *database, int interval,
+                  size_t batchSize);
+
+    void stop();
+
+protected:
+    void run() override;
+
+private:
+    ExpiringDatabasePrivate *database;
+    int interval;
+    size_t batchSize;
+    QMutex mutex;
+    QWaitCondition condition;
+    bool stopped;
+
+    bool isStopped();
+};
+
+} // namespace QLMDB
+
+#endif // EXPIRINGDATABASEPRIVATE_H
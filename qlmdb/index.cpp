@@ -0,0 +1,382 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+
+#include "cursor.h"
+#include "cursorprivate.h"
+#include "databaseprivate.h"
+#include "errors.h"
+#include "index.h"
+#include "indexprivate.h"
+#include "transaction.h"
+#include "transactionprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// The number of primary entries rebuild() reads before writing their index
+// entries:
+const int RebuildBatchSize = 10000;
+
+} // namespace
+
+
+/**
+ * @class Index
+ * @brief A secondary index on a Database.
+ *
+ * An Index allows to look up entries of a (primary) Database by something
+ * else than their key. For each entry, a user provided KeyFunction
+ * calculates the index keys from the entry's key and value. The index
+ * keys are stored in a separate database with MultiValues, mapping each
+ * index key to the keys of the primary entries it was calculated from:
+ *
+ * ```
+ * Database users(ctx, "users");
+ * Index byCity(users, "users.city",
+ *              [](const QByteArray &key, const QByteArray &value) {
+ *     return QByteArrayList({parseUser(value).city});
+ * });
+ *
+ * users.put("alice", serializeUser(...));
+ * for (auto userKey : byCity.find("Berlin")) {
+ *     // ...
+ * }
+ * ```
+ *
+ * ## Maintenance
+ *
+ * Once created, the index is attached to the primary Database object and
+ * updated automatically whenever entries are written or removed using
+ * that object - or a Cursor created on it. The index is updated in the
+ * same Transaction as the primary. If updating the index fails, the write
+ * operation fails as well; the overloads of Database::put() and
+ * Database::remove() which run their own transaction abort it in this
+ * case, so the primary and its indexes cannot get out of sync. Only the
+ * index keys which actually changed are written, and updates of bulk
+ * operations like Database::removeRange() are sorted and applied in one
+ * go to keep the number of touched pages low.
+ *
+ * Writes made via other Database objects opened on the same database are
+ * not seen by the index. If the primary already contains entries when an
+ * index is created for the first time, call rebuild() to populate it.
+ *
+ * Indexes can only be attached to databases without MultiValues. As the
+ * primary keys are stored as values of the index database, they must not
+ * exceed LMDB's maximum key size.
+ */
+
+
+/**
+ * @brief Create an index on the @p database.
+ *
+ * This opens (and if needed creates) the index database @p name in the
+ * Context of the @p database and attaches the index to it. The
+ * @p keyFunction is used to calculate the index keys of the entries. The
+ * Index must be destroyed before the Context it lives in.
+ *
+ * Make sure there is no active Transaction ongoing in the current thread
+ * when using this constructor.
+ */
+Index::Index(Database &database, const QString &name,
+             KeyFunction keyFunction) :
+    d_ptr(new IndexPrivate)
+{
+    Q_D(Index);
+    d->keyFunction = keyFunction;
+    if (!database.isValid() || name.isEmpty() || !keyFunction) {
+        d->lastError = Errors::InvalidParameter;
+        d->lastErrorString = QObject::tr("An Index requires a valid database, "
+                                         "a name and a key function");
+        return;
+    }
+    auto primary = database.d_ptr.data();
+    {
+        Transaction txn(*primary->context, Transaction::ReadOnly);
+        unsigned int flags = 0;
+        d->lastError = mdb_dbi_flags(txn.d_ptr->txn, primary->db, &flags);
+        if (d->lastError != Errors::NoError) {
+            d->lastErrorString = QObject::tr("Unable to read the flags of "
+                                             "the database");
+            return;
+        }
+        if (flags & MDB_DUPSORT) {
+            d->lastError = Errors::InvalidParameter;
+            d->lastErrorString = QObject::tr("Indexes can only be attached to "
+                                             "databases with a single value "
+                                             "per key");
+            return;
+        }
+    }
+    d->database.reset(new Database(*primary->context, name,
+                                   Database::Create | Database::MultiValues));
+    if (!d->database->isValid()) {
+        d->lastError = d->database->lastError();
+        d->lastErrorString = d->database->lastErrorString();
+        return;
+    }
+    d->primary = primary;
+    primary->indexes.append(d);
+}
+
+
+/**
+ * @brief Destructor.
+ *
+ * This detaches the index from its database.
+ */
+Index::~Index()
+{
+    Q_D(Index);
+    if (d->primary != nullptr) {
+        d->primary->indexes.removeOne(d);
+    }
+}
+
+
+/**
+ * @brief Indicates if the index is valid.
+ *
+ * An index is valid if its database could be opened and it is attached to
+ * its primary database.
+ */
+bool Index::isValid() const
+{
+    const Q_D(Index);
+    return d->primary != nullptr && d->primary->valid;
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int Index::lastError() const
+{
+    const Q_D(Index);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString Index::lastErrorString() const
+{
+    const Q_D(Index);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void Index::clearLastError()
+{
+    Q_D(Index);
+    d->lastError = Errors::NoError;
+    d->lastErrorString.clear();
+}
+
+
+/**
+ * @brief Find the keys of the primary entries with the given @p indexKey.
+ *
+ * The keys are returned in ascending order. If there are none, an empty
+ * list is returned and lastError() is set to Errors::NotFound.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArrayList Index::find(const QByteArray &indexKey)
+{
+    Q_D(Index);
+    QByteArrayList result;
+    if (isValid()) {
+        Transaction txn(*d->primary->context, Transaction::ReadOnly);
+        result = find(txn, indexKey);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Find the keys of the primary entries with the given @p indexKey.
+ *
+ * This is an overloaded version of find(). It runs the operation in the
+ * given @p transaction.
+ */
+QByteArrayList Index::find(Transaction &transaction,
+                           const QByteArray &indexKey)
+{
+    Q_D(Index);
+    QByteArrayList result;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        Cursor cursor(transaction, *d->database);
+        auto item = cursor.findKey(indexKey);
+        while (item.isValid()) {
+            // The value points into the memory map, deep copy it:
+            auto key = item.value();
+            result << QByteArray(key.constData(), key.size());
+            item = cursor.nextForCurrentKey();
+        }
+        if (result.isEmpty()) {
+            d->lastError = cursor.lastError();
+            d->lastErrorString = cursor.lastErrorString();
+        } else {
+            clearLastError();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Find the keys of the primary entries in a range of index keys.
+ *
+ * This returns the keys of all primary entries with index keys greater
+ * than or equal to @p begin and less than @p end, ordered by their index
+ * keys. An empty @p begin refers to the start and an empty @p end to the
+ * end of the index. A primary key is contained multiple times if more
+ * than one of its index keys are in the range.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArrayList Index::findRange(const QByteArray &begin,
+                                const QByteArray &end)
+{
+    Q_D(Index);
+    QByteArrayList result;
+    if (isValid()) {
+        Transaction txn(*d->primary->context, Transaction::ReadOnly);
+        result = findRange(txn, begin, end);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Find the keys of the primary entries in a range of index keys.
+ *
+ * This is an overloaded version of findRange(). It runs the operation in
+ * the given @p transaction.
+ */
+QByteArrayList Index::findRange(Transaction &transaction,
+                                const QByteArray &begin,
+                                const QByteArray &end)
+{
+    Q_D(Index);
+    QByteArrayList result;
+    if (isValid() && transaction.d_ptr->isUsable()) {
+        Cursor cursor(transaction, *d->database);
+        auto item = begin.isEmpty() ? cursor.first()
+                                    : cursor.findFirstAfter(begin);
+        while (item.isValid() && (end.isEmpty() || item.key() < end)) {
+            auto key = item.value();
+            result << QByteArray(key.constData(), key.size());
+            item = cursor.next();
+        }
+        if (cursor.lastError() == Errors::NoError ||
+                cursor.lastError() == Errors::NotFound) {
+            clearLastError();
+        } else {
+            d->lastError = cursor.lastError();
+            d->lastErrorString = cursor.lastErrorString();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Rebuild the index from scratch.
+ *
+ * This removes all entries from the index and recreates them from the
+ * entries of the primary database. Use it after creating a new index on
+ * a database which already contains data or after changing the
+ * KeyFunction. Returns true on success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Index::rebuild()
+{
+    Q_D(Index);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->primary->context);
+        result = rebuild(txn);
+        if (!result) {
+            txn.abort();
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Rebuild the index from scratch.
+ *
+ * This is an overloaded version of rebuild(). It runs the operation in the
+ * given @p transaction.
+ */
+bool Index::rebuild(Transaction &transaction)
+{
+    Q_D(Index);
+    if (!isValid() || !transaction.d_ptr->isUsable()) {
+        return false;
+    }
+    auto txn = transaction.d_ptr->txn;
+    MDB_cursor *cursor = nullptr;
+    d->lastError = mdb_drop(txn, d->dbi(), 0);
+    if (d->lastError == Errors::NoError) {
+        d->lastError = mdb_cursor_open(txn, d->primary->db, &cursor);
+    }
+    if (d->lastError == Errors::NoError) {
+        QVector<IndexUpdate> updates;
+        MDB_val key, value;
+        int count = 0;
+        d->lastError = mdb_cursor_get(cursor, &key, &value, MDB_FIRST);
+        while (d->lastError == Errors::NoError) {
+            auto v = value_to_bytearray(value);
+            d->collect(value_to_bytearray(key), nullptr, &v, updates);
+            if (++count == RebuildBatchSize) {
+                d->lastError = IndexPrivate::apply(txn, updates);
+                updates.clear();
+                count = 0;
+            }
+            if (d->lastError == Errors::NoError) {
+                d->lastError = mdb_cursor_get(cursor, &key, &value,
+                                              MDB_NEXT);
+            }
+        }
+        if (d->lastError == Errors::NotFound) {
+            d->lastError = IndexPrivate::apply(txn, updates);
+        }
+        mdb_cursor_close(cursor);
+    }
+    if (d->lastError == Errors::NoError) {
+        d->lastErrorString.clear();
+        return true;
+    }
+    d->lastErrorString = QObject::tr("Unexpected error rebuilding the index");
+    return false;
+}
+
+} // namespace QLMDB
@@ -0,0 +1,77 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INDEX_H
+#define INDEX_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QScopedPointer>
+#include <QString>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Database;
+class IndexPrivate;
+class Transaction;
+
+class QLMDBSHARED_EXPORT Index
+{
+    friend class Database;
+public:
+
+    /**
+     * @brief Calculates the index keys of an entry.
+     *
+     * The function is called with the @p key and @p value of an entry in
+     * the primary database and returns the keys under which the entry is
+     * found in the index. Empty keys are ignored.
+     */
+    typedef std::function<QByteArrayList(const QByteArray &key,
+                                         const QByteArray &value)>
+    KeyFunction;
+
+    explicit Index(Database &database, const QString &name,
+                   KeyFunction keyFunction);
+    virtual ~Index();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    QByteArrayList find(const QByteArray &indexKey);
+    QByteArrayList find(Transaction &transaction, const QByteArray &indexKey);
+    QByteArrayList findRange(const QByteArray &begin, const QByteArray &end);
+    QByteArrayList findRange(Transaction &transaction,
+                             const QByteArray &begin, const QByteArray &end);
+
+    bool rebuild();
+    bool rebuild(Transaction &transaction);
+
+private:
+    QScopedPointer<IndexPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(Index)
+};
+
+} // namespace QLMDB
+
+#endif // INDEX_H
@@ -0,0 +1,146 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <functional>
+
+#include "cursorprivate.h"
+#include "databaseprivate.h"
+#include "errors.h"
+#include "indexprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// Sort the index keys and drop duplicates and empty keys, which LMDB
+// cannot store.
+void normalizeKeys(QByteArrayList &keys)
+{
+    keys.removeAll(QByteArray());
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+inline QByteArray deepCopy(const QByteArray &data)
+{
+    return QByteArray(data.constData(), data.size());
+}
+
+} // namespace
+
+bool IndexUpdate::operator <(const IndexUpdate &other) const
+{
+    if (index != other.index) {
+        return std::less<IndexPrivate*>()(index, other.index);
+    }
+    if (indexKey != other.indexKey) {
+        return indexKey < other.indexKey;
+    }
+    return primaryKey < other.primaryKey;
+}
+
+IndexPrivate::IndexPrivate() :
+    primary(nullptr),
+    database(),
+    keyFunction(),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+/**
+ * @brief Collect the updates needed after an entry in the primary changed.
+ *
+ * The entry stored under the @p key changed from @p oldValue to
+ * @p newValue (either of which is null if the entry was added or removed).
+ * Only index keys which differ between the old and the new value are
+ * touched. The updates are appended to @p updates; all data is copied, so
+ * the arguments might point into the memory map.
+ */
+void IndexPrivate::collect(const QByteArray &key, const QByteArray *oldValue,
+                           const QByteArray *newValue,
+                           QVector<IndexUpdate> &updates)
+{
+    QByteArrayList oldKeys;
+    QByteArrayList newKeys;
+    if (oldValue != nullptr) {
+        oldKeys = keyFunction(key, *oldValue);
+        normalizeKeys(oldKeys);
+    }
+    if (newValue != nullptr) {
+        newKeys = keyFunction(key, *newValue);
+        normalizeKeys(newKeys);
+    }
+    auto primaryKey = deepCopy(key);
+    auto oldIt = oldKeys.constBegin();
+    auto newIt = newKeys.constBegin();
+    while (oldIt != oldKeys.constEnd() || newIt != newKeys.constEnd()) {
+        if (newIt == newKeys.constEnd() ||
+                (oldIt != oldKeys.constEnd() && *oldIt < *newIt)) {
+            updates.append({this, deepCopy(*oldIt), primaryKey, false});
+            ++oldIt;
+        } else if (oldIt == oldKeys.constEnd() || *newIt < *oldIt) {
+            updates.append({this, deepCopy(*newIt), primaryKey, true});
+            ++newIt;
+        } else {
+            // Unchanged:
+            ++oldIt;
+            ++newIt;
+        }
+    }
+}
+
+MDB_dbi IndexPrivate::dbi() const
+{
+    return database->d_ptr->db;
+}
+
+/**
+ * @brief Write the collected @p updates to the index databases.
+ *
+ * The updates are sorted first, so that entries next to each other are
+ * written one after the other and each page of the index is only touched
+ * once per batch.
+ */
+int IndexPrivate::apply(MDB_txn *txn, QVector<IndexUpdate> &updates)
+{
+    int result = Errors::NoError;
+    std::sort(updates.begin(), updates.end());
+    for (const auto &update : updates) {
+        auto k = bytearray_to_value(update.indexKey);
+        auto v = bytearray_to_value(update.primaryKey);
+        if (update.add) {
+            result = mdb_put(txn, update.index->dbi(), &k, &v, MDB_NODUPDATA);
+            if (result == Errors::KeyExists) {
+                result = Errors::NoError;
+            }
+        } else {
+            result = mdb_del(txn, update.index->dbi(), &k, &v);
+            if (result == Errors::NotFound) {
+                result = Errors::NoError;
+            }
+        }
+        if (result != Errors::NoError) {
+            break;
+        }
+    }
+    return result;
+}
+
+} // namespace QLMDB
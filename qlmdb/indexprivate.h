@@ -0,0 +1,67 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INDEXPRIVATE_H
+#define INDEXPRIVATE_H
+
+#include "lmdb.h"
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+#include "database.h"
+#include "index.h"
+
+namespace QLMDB {
+
+class DatabasePrivate;
+class IndexPrivate;
+
+//! @private
+struct IndexUpdate
+{
+    IndexPrivate *index;
+    QByteArray indexKey;
+    QByteArray primaryKey;
+    bool add;
+
+    bool operator <(const IndexUpdate &other) const;
+};
+
+//! @private
+class IndexPrivate
+{
+public:
+    IndexPrivate();
+
+    DatabasePrivate *primary;
+    QScopedPointer<Database> database;
+    Index::KeyFunction keyFunction;
+    int lastError;
+    QString lastErrorString;
+
+    void collect(const QByteArray &key, const QByteArray *oldValue,
+                 const QByteArray *newValue, QVector<IndexUpdate> &updates);
+    MDB_dbi dbi() const;
+
+    static int apply(MDB_txn *txn, QVector<IndexUpdate> &updates);
+};
+
+} // namespace QLMDB
+
+#endif // INDEXPRIVATE_H
@@ -0,0 +1,555 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include <QtEndian>
+
+#include "keybuilder.h"
+
+
+namespace QLMDB {
+
+namespace {
+
+const quint32 SignBit32 = 0x80000000u;
+const quint64 SignBit64 = Q_UINT64_C(0x8000000000000000);
+
+// Strings are terminated by this two byte sequence. A zero byte within a
+// string is escaped by following it with 0xFF, so the terminator sorts
+// before any string continuing with another byte.
+const char Escape = '\x00';
+const char EscapedZero = '\xFF';
+const char Terminator = '\x01';
+
+template<typename T>
+inline void appendBigEndian(QVarLengthArray<char, 64> &buffer, T value)
+{
+    char bytes[sizeof(T)];
+    qToBigEndian<T>(value, bytes);
+    buffer.append(bytes, static_cast<int>(sizeof(T)));
+}
+
+inline quint32 floatToBits(float value)
+{
+    if (value == 0.0f) {
+        value = 0.0f; // Normalize -0.0 to 0.0
+    }
+    quint32 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & SignBit32) ? ~bits : (bits | SignBit32);
+}
+
+inline float bitsToFloat(quint32 bits)
+{
+    bits = (bits & SignBit32) ? (bits & ~SignBit32) : ~bits;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+inline quint64 doubleToBits(double value)
+{
+    if (value == 0.0) {
+        value = 0.0; // Normalize -0.0 to 0.0
+    }
+    quint64 bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & SignBit64) ? ~bits : (bits | SignBit64);
+}
+
+inline double bitsToDouble(quint64 bits)
+{
+    bits = (bits & SignBit64) ? (bits & ~SignBit64) : ~bits;
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+
+/**
+ * @class KeyBuilder
+ * @brief Build composite keys which sort correctly.
+ *
+ * LMDB by default sorts keys by comparing their bytes (like memcmp()
+ * does). Composite keys which are built by simply concatenating their
+ * components in native representation usually do not sort in the expected
+ * way: Integers are stored in little endian byte order on most machines,
+ * negative numbers sort after positive ones and variable length strings
+ * mix with the components following them.
+ *
+ * The KeyBuilder encodes each component such that comparing the encoded
+ * keys byte by byte gives the same order as comparing the components one
+ * after the other:
+ *
+ * - Integers are stored in big endian byte order. For signed integers, the
+ *   sign bit is flipped, so negative numbers sort before positive ones.
+ * - Floating point numbers are stored in big endian byte order with the
+ *   sign bit flipped for positive and all bits flipped for negative numbers.
+ * - Strings and byte arrays have zero bytes escaped and are terminated by
+ *   a two byte sequence which sorts before any other content. Hence, a
+ *   string sorts before all strings it is a prefix of.
+ * - Each component can be sorted in Descending order, in which case all
+ *   bytes of its encoding are inverted.
+ *
+ * ```
+ * KeyBuilder key;
+ * key.appendUInt32(tenantId)
+ *    .appendInt64(timestamp, KeyBuilder::Descending)
+ *    .appendString(objectId);
+ * db.put(txn, key, value);
+ * ```
+ *
+ * Keys are built in a buffer on the stack, which only allocates memory for
+ * keys exceeding 64 bytes. A KeyBuilder can be passed directly to the
+ * Database and Cursor functions taking keys (see IsByteView). Use a
+ * KeyReader to decode the components of a key again.
+ *
+ * Keys which share their first components can be queried efficiently using
+ * Cursor::findFirstWithPrefix() and Cursor::nextWithPrefix():
+ *
+ * ```
+ * KeyBuilder prefix;
+ * prefix.appendUInt32(tenantId);
+ * Cursor cursor(txn, db);
+ * for (auto item = cursor.findFirstWithPrefix(prefix); item.isValid();
+ *      item = cursor.nextWithPrefix(prefix)) {
+ *     KeyReader reader(item.key());
+ *     reader.readUInt32();
+ *     auto timestamp = reader.readInt64(KeyBuilder::Descending);
+ *     // ...
+ * }
+ * ```
+ *
+ * @note The encodings only sort correctly in databases using the default
+ * key comparison, i.e. databases opened without Database::ReverseKey and
+ * Database::IntegerKeys.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates an empty key builder.
+ */
+KeyBuilder::KeyBuilder() :
+    buffer()
+{
+}
+
+
+/**
+ * @brief Append an unsigned 32 bit integer @p value.
+ */
+KeyBuilder &KeyBuilder::appendUInt32(quint32 value, Order order)
+{
+    auto start = buffer.size();
+    appendBigEndian<quint32>(buffer, value);
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append a signed 32 bit integer @p value.
+ */
+KeyBuilder &KeyBuilder::appendInt32(qint32 value, Order order)
+{
+    auto start = buffer.size();
+    appendBigEndian<quint32>(buffer, static_cast<quint32>(value) ^ SignBit32);
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append an unsigned 64 bit integer @p value.
+ */
+KeyBuilder &KeyBuilder::appendUInt64(quint64 value, Order order)
+{
+    auto start = buffer.size();
+    appendBigEndian<quint64>(buffer, value);
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append a signed 64 bit integer @p value.
+ */
+KeyBuilder &KeyBuilder::appendInt64(qint64 value, Order order)
+{
+    auto start = buffer.size();
+    appendBigEndian<quint64>(buffer, static_cast<quint64>(value) ^ SignBit64);
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append a single precision floating point @p value.
+ *
+ * Negative zero is stored as zero. NaN values sort after positive infinity
+ * (or before negative infinity if their sign bit is set).
+ */
+KeyBuilder &KeyBuilder::appendFloat(float value, Order order)
+{
+    auto start = buffer.size();
+    appendBigEndian<quint32>(buffer, floatToBits(value));
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append a double precision floating point @p value.
+ *
+ * Negative zero is stored as zero. NaN values sort after positive infinity
+ * (or before negative infinity if their sign bit is set).
+ */
+KeyBuilder &KeyBuilder::appendDouble(double value, Order order)
+{
+    auto start = buffer.size();
+    appendBigEndian<quint64>(buffer, doubleToBits(value));
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append @p size bytes of arbitrary binary @p data.
+ */
+KeyBuilder &KeyBuilder::appendBytes(const char *data, size_t size,
+                                    Order order)
+{
+    auto start = buffer.size();
+    buffer.reserve(start + static_cast<int>(size) + 2);
+    for (size_t i = 0; i < size; ++i) {
+        buffer.append(data[i]);
+        if (data[i] == Escape) {
+            buffer.append(EscapedZero);
+        }
+    }
+    buffer.append(Escape);
+    buffer.append(Terminator);
+    finishComponent(start, order);
+    return *this;
+}
+
+
+/**
+ * @brief Append the binary data in the byte array @p value.
+ */
+KeyBuilder &KeyBuilder::appendBytes(const QByteArray &value, Order order)
+{
+    return appendBytes(value.constData(), static_cast<size_t>(value.size()),
+                       order);
+}
+
+
+/**
+ * @brief Append the string @p value.
+ *
+ * The string is stored in UTF-8 encoding, hence strings sort by their
+ * code points.
+ */
+KeyBuilder &KeyBuilder::appendString(const QString &value, Order order)
+{
+    return appendBytes(value.toUtf8(), order);
+}
+
+
+/**
+ * @brief Remove all components from the key.
+ */
+void KeyBuilder::clear()
+{
+    buffer.clear();
+}
+
+
+/**
+ * @brief Indicates if no components have been appended yet.
+ */
+bool KeyBuilder::isEmpty() const
+{
+    return buffer.isEmpty();
+}
+
+
+/**
+ * @brief Pointer to the encoded key.
+ *
+ * The data is valid as long as the key builder is not modified or
+ * destroyed.
+ */
+const char *KeyBuilder::data() const
+{
+    return buffer.constData();
+}
+
+
+/**
+ * @brief The size of the encoded key in bytes.
+ */
+size_t KeyBuilder::size() const
+{
+    return static_cast<size_t>(buffer.size());
+}
+
+
+/**
+ * @brief Return a copy of the encoded key.
+ */
+QByteArray KeyBuilder::toByteArray() const
+{
+    return QByteArray(buffer.constData(), buffer.size());
+}
+
+
+/**
+ * @brief Invert the encoding of the last component if it sorts descending.
+ */
+void KeyBuilder::finishComponent(int start, Order order)
+{
+    if (order == Descending) {
+        auto end = buffer.size();
+        for (int i = start; i < end; ++i) {
+            buffer[i] = static_cast<char>(~buffer[i]);
+        }
+    }
+}
+
+
+/**
+ * @class KeyReader
+ * @brief Decode keys created by a KeyBuilder.
+ *
+ * A KeyReader reads the components of a key one after the other. The
+ * components must be read using the same types and orders they have been
+ * appended with to the KeyBuilder:
+ *
+ * ```
+ * KeyReader reader(cursor.currentKey());
+ * auto tenantId = reader.readUInt32();
+ * auto timestamp = reader.readInt64(KeyBuilder::Descending);
+ * auto objectId = reader.readString();
+ * if (!reader.isValid()) {
+ *     // The key has not been built the way we expected...
+ * }
+ * ```
+ *
+ * If a component cannot be read (because the key is too short or the
+ * encoding is broken), the read function returns a default constructed
+ * value and isValid() returns false afterwards.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a reader decoding the given @p key.
+ */
+KeyReader::KeyReader(const QByteArray &key) :
+    key(key),
+    data(this->key.constData()),
+    size(static_cast<size_t>(this->key.size())),
+    position(0),
+    valid(true)
+{
+}
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a reader decoding the key of @p size bytes stored at @p data. The
+ * data is not copied, so it must stay valid as long as the reader is used.
+ */
+KeyReader::KeyReader(const char *data, size_t size) :
+    key(),
+    data(data),
+    size(size),
+    position(0),
+    valid(true)
+{
+}
+
+
+/**
+ * @brief Indicates if all components read so far could be decoded.
+ */
+bool KeyReader::isValid() const
+{
+    return valid;
+}
+
+
+/**
+ * @brief Indicates if all components of the key have been read.
+ */
+bool KeyReader::atEnd() const
+{
+    return position >= size;
+}
+
+
+/**
+ * @brief Read an unsigned 32 bit integer.
+ */
+quint32 KeyReader::readUInt32(KeyBuilder::Order order)
+{
+    char bytes[sizeof(quint32)];
+    if (readFixed(bytes, sizeof(bytes), order)) {
+        return qFromBigEndian<quint32>(bytes);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Read a signed 32 bit integer.
+ */
+qint32 KeyReader::readInt32(KeyBuilder::Order order)
+{
+    char bytes[sizeof(quint32)];
+    if (readFixed(bytes, sizeof(bytes), order)) {
+        return static_cast<qint32>(qFromBigEndian<quint32>(bytes) ^ SignBit32);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Read an unsigned 64 bit integer.
+ */
+quint64 KeyReader::readUInt64(KeyBuilder::Order order)
+{
+    char bytes[sizeof(quint64)];
+    if (readFixed(bytes, sizeof(bytes), order)) {
+        return qFromBigEndian<quint64>(bytes);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Read a signed 64 bit integer.
+ */
+qint64 KeyReader::readInt64(KeyBuilder::Order order)
+{
+    char bytes[sizeof(quint64)];
+    if (readFixed(bytes, sizeof(bytes), order)) {
+        return static_cast<qint64>(qFromBigEndian<quint64>(bytes) ^ SignBit64);
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Read a single precision floating point number.
+ */
+float KeyReader::readFloat(KeyBuilder::Order order)
+{
+    char bytes[sizeof(quint32)];
+    if (readFixed(bytes, sizeof(bytes), order)) {
+        return bitsToFloat(qFromBigEndian<quint32>(bytes));
+    }
+    return 0.0f;
+}
+
+
+/**
+ * @brief Read a double precision floating point number.
+ */
+double KeyReader::readDouble(KeyBuilder::Order order)
+{
+    char bytes[sizeof(quint64)];
+    if (readFixed(bytes, sizeof(bytes), order)) {
+        return bitsToDouble(qFromBigEndian<quint64>(bytes));
+    }
+    return 0.0;
+}
+
+
+/**
+ * @brief Read binary data appended via KeyBuilder::appendBytes().
+ */
+QByteArray KeyReader::readBytes(KeyBuilder::Order order)
+{
+    QByteArray result;
+    if (!valid) {
+        return result;
+    }
+    const char mask = order == KeyBuilder::Descending ? '\xFF' : '\x00';
+    auto pos = position;
+    while (pos < size) {
+        char c = data[pos] ^ mask;
+        if (c != Escape) {
+            result.append(c);
+            ++pos;
+        } else if (pos + 1 < size) {
+            char next = data[pos + 1] ^ mask;
+            pos += 2;
+            if (next == EscapedZero) {
+                result.append(Escape);
+            } else if (next == Terminator) {
+                position = pos;
+                return result;
+            } else {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    valid = false;
+    return QByteArray();
+}
+
+
+/**
+ * @brief Read a string appended via KeyBuilder::appendString().
+ */
+QString KeyReader::readString(KeyBuilder::Order order)
+{
+    return QString::fromUtf8(readBytes(order));
+}
+
+
+/**
+ * @brief Read the next @p length bytes into @p dest.
+ */
+bool KeyReader::readFixed(char *dest, size_t length, KeyBuilder::Order order)
+{
+    if (!valid || size - position < length) {
+        valid = false;
+        return false;
+    }
+    std::memcpy(dest, data + position, length);
+    if (order == KeyBuilder::Descending) {
+        for (size_t i = 0; i < length; ++i) {
+            dest[i] = static_cast<char>(~dest[i]);
+        }
+    }
+    position += length;
+    return true;
+}
+
+} // namespace QLMDB
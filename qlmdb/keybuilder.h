@@ -0,0 +1,106 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef KEYBUILDER_H
+#define KEYBUILDER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVarLengthArray>
+
+#include "byteview.h"
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class QLMDBSHARED_EXPORT KeyBuilder
+{
+public:
+
+    /**
+     * @brief The order in which a key component sorts.
+     */
+    enum Order {
+        Ascending, //!< Smaller values sort first.
+        Descending //!< Larger values sort first.
+    };
+
+    KeyBuilder();
+
+    KeyBuilder &appendUInt32(quint32 value, Order order = Ascending);
+    KeyBuilder &appendInt32(qint32 value, Order order = Ascending);
+    KeyBuilder &appendUInt64(quint64 value, Order order = Ascending);
+    KeyBuilder &appendInt64(qint64 value, Order order = Ascending);
+    KeyBuilder &appendFloat(float value, Order order = Ascending);
+    KeyBuilder &appendDouble(double value, Order order = Ascending);
+    KeyBuilder &appendBytes(const char *data, size_t size,
+                            Order order = Ascending);
+    KeyBuilder &appendBytes(const QByteArray &value, Order order = Ascending);
+    KeyBuilder &appendString(const QString &value, Order order = Ascending);
+
+    void clear();
+    bool isEmpty() const;
+    const char *data() const;
+    size_t size() const;
+    QByteArray toByteArray() const;
+
+private:
+
+    QVarLengthArray<char, 64> buffer;
+
+    void finishComponent(int start, Order order);
+};
+
+
+class QLMDBSHARED_EXPORT KeyReader
+{
+public:
+    explicit KeyReader(const QByteArray &key);
+    explicit KeyReader(const char *data, size_t size);
+
+    bool isValid() const;
+    bool atEnd() const;
+
+    quint32 readUInt32(KeyBuilder::Order order = KeyBuilder::Ascending);
+    qint32 readInt32(KeyBuilder::Order order = KeyBuilder::Ascending);
+    quint64 readUInt64(KeyBuilder::Order order = KeyBuilder::Ascending);
+    qint64 readInt64(KeyBuilder::Order order = KeyBuilder::Ascending);
+    float readFloat(KeyBuilder::Order order = KeyBuilder::Ascending);
+    double readDouble(KeyBuilder::Order order = KeyBuilder::Ascending);
+    QByteArray readBytes(KeyBuilder::Order order = KeyBuilder::Ascending);
+    QString readString(KeyBuilder::Order order = KeyBuilder::Ascending);
+
+private:
+
+    QByteArray key;
+    const char *data;
+    size_t size;
+    size_t position;
+    bool valid;
+
+    bool readFixed(char *dest, size_t length, KeyBuilder::Order order);
+};
+
+
+/**
+ * @brief KeyBuilder objects can be passed in wherever keys are expected.
+ */
+template<>
+struct IsByteView<KeyBuilder> : std::true_type {};
+
+} // namespace QLMDB
+
+#endif // KEYBUILDER_H
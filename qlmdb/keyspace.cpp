@@ -0,0 +1,648 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+
+#include "errors.h"
+#include "keyspace.h"
+#include "keyspaceprivate.h"
+
+namespace QLMDB {
+
+/**
+ * @class Keyspace
+ * @brief A logical table inside a Database.
+ *
+ * Each named database is a separate B-tree, the number of which is limited
+ * by Context::setMaxDBs(). Applications which need many small tables, e.g.
+ * one per tenant, can instead store them in one database and tell them
+ * apart by a key prefix. The Keyspace class manages this prefix:
+ *
+ * ```
+ * Database db(ctx, "tenants");
+ * Keyspace tenant(db, tenantId);
+ * Keyspace orders(tenant, OrdersTable);
+ * orders.put("order-1", data);
+ * orders.scanPrefix("order-", [](const QByteArray &key,
+ *                                const QByteArray &value) {
+ *     // key is "order-1", "order-2" and so on
+ *     return true;
+ * });
+ * tenant.clear(); // Remove all data of the tenant
+ * ```
+ *
+ * The prefix of a keyspace is its @p id encoded as an unsigned LEB128
+ * varint (see encodeId()), so small IDs only take a single byte. No
+ * encoding is a prefix of another one, hence keyspaces with different IDs
+ * never overlap. Keyspaces can be nested: the prefix of a child keyspace
+ * is the prefix of its parent followed by the ID of the child. All entries
+ * of the children are part of the parent keyspace, so e.g. clearing a
+ * tenant removes all of its tables. Do not store entries in a keyspace
+ * which also has child keyspaces, as its keys could collide with the ones
+ * of the children.
+ *
+ * All keys passed to and returned from a keyspace are relative to it, and
+ * range and prefix operations never leave it. An empty @p begin of a range
+ * refers to the first and an empty @p end to the last key of the keyspace.
+ * To access the entries via a Cursor on the database(), use key() to get
+ * the full keys.
+ *
+ * Keyspaces need the database to use the default key comparison, i.e. it
+ * must not have been opened with Database::ReverseKey or
+ * Database::IntegerKeys. Note that the varint encoding does not preserve
+ * the order of the IDs, so the keyspaces do not sort by ID.
+ *
+ * Keyspace objects do not store anything in the database and are cheap to
+ * create, e.g. once per request.
+ */
+
+
+/**
+ * @brief Create the keyspace @p id in the @p database.
+ */
+Keyspace::Keyspace(Database &database, quint64 id) :
+    d_ptr(new KeyspacePrivate)
+{
+    Q_D(Keyspace);
+    d->database = &database;
+    d->id = id;
+    d->prefix = encodeId(id);
+}
+
+
+/**
+ * @brief Create the keyspace @p id nested inside the @p parent keyspace.
+ */
+Keyspace::Keyspace(const Keyspace &parent, quint64 id) :
+    d_ptr(new KeyspacePrivate)
+{
+    Q_D(Keyspace);
+    d->database = parent.d_ptr->database;
+    d->id = id;
+    d->prefix = parent.d_ptr->prefix + encodeId(id);
+}
+
+
+/**
+ * @brief Destructor.
+ */
+Keyspace::~Keyspace()
+{
+}
+
+
+/**
+ * @brief Is the keyspace valid.
+ *
+ * This is the case if the underlying database is valid.
+ */
+bool Keyspace::isValid() const
+{
+    const Q_D(Keyspace);
+    return d->database->isValid();
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int Keyspace::lastError() const
+{
+    const Q_D(Keyspace);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString Keyspace::lastErrorString() const
+{
+    const Q_D(Keyspace);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void Keyspace::clearLastError()
+{
+    Q_D(Keyspace);
+    d->setError(Errors::NoError, QString());
+}
+
+
+/**
+ * @brief The database the keyspace lives in.
+ */
+Database *Keyspace::database() const
+{
+    const Q_D(Keyspace);
+    return d->database;
+}
+
+
+/**
+ * @brief The ID of the keyspace within its parent.
+ */
+quint64 Keyspace::id() const
+{
+    const Q_D(Keyspace);
+    return d->id;
+}
+
+
+/**
+ * @brief The prefix of all keys in the keyspace.
+ *
+ * For nested keyspaces, this includes the prefixes of all parents.
+ */
+QByteArray Keyspace::prefix() const
+{
+    const Q_D(Keyspace);
+    return d->prefix;
+}
+
+
+/**
+ * @brief The full key in the database() of the given @p key.
+ */
+QByteArray Keyspace::key(const QByteArray &key) const
+{
+    const Q_D(Keyspace);
+    return d->prefix + key;
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * Returns true on success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Keyspace::put(const QByteArray &key, const QByteArray &value)
+{
+    Q_D(Keyspace);
+    auto result = d->database->put(d->prefix + key, value);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * This is an overloaded version of put(). It runs the operation in the
+ * given @p transaction.
+ */
+bool Keyspace::put(Transaction &transaction, const QByteArray &key,
+                   const QByteArray &value)
+{
+    Q_D(Keyspace);
+    auto result = d->database->put(transaction, d->prefix + key, value);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * If the key is not in the keyspace, a null byte array is returned and
+ * lastError() is set to Errors::NotFound.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArray Keyspace::get(const QByteArray &key)
+{
+    Q_D(Keyspace);
+    auto result = d->database->get(d->prefix + key);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * This is an overloaded version of get(). It runs the operation in the
+ * given @p transaction.
+ */
+QByteArray Keyspace::get(Transaction &transaction, const QByteArray &key)
+{
+    Q_D(Keyspace);
+    auto result = d->database->get(transaction, d->prefix + key);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Get all values of the @p key.
+ *
+ * This is useful in databases with Database::MultiValues.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+QByteArrayList Keyspace::getAll(const QByteArray &key)
+{
+    Q_D(Keyspace);
+    auto result = d->database->getAll(d->prefix + key);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Get all values of the @p key.
+ *
+ * This is an overloaded version of getAll(). It runs the operation in the
+ * given @p transaction.
+ */
+QByteArrayList Keyspace::getAll(Transaction &transaction,
+                                const QByteArray &key)
+{
+    Q_D(Keyspace);
+    auto result = d->database->getAll(transaction, d->prefix + key);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p key (and all of its values) from the keyspace.
+ *
+ * Returns true on success or false otherwise.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Keyspace::remove(const QByteArray &key)
+{
+    Q_D(Keyspace);
+    auto result = d->database->remove(d->prefix + key);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p key (and all of its values) from the keyspace.
+ *
+ * This is an overloaded version of remove(). It runs the operation in the
+ * given @p transaction.
+ */
+bool Keyspace::remove(Transaction &transaction, const QByteArray &key)
+{
+    Q_D(Keyspace);
+    auto result = d->database->remove(transaction, d->prefix + key);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p value of the @p key from the keyspace.
+ *
+ * This is useful in databases with Database::MultiValues.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Keyspace::remove(const QByteArray &key, const QByteArray &value)
+{
+    Q_D(Keyspace);
+    auto result = d->database->remove(d->prefix + key, value);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p value of the @p key from the keyspace.
+ *
+ * This is an overloaded version of remove(). It runs the operation in the
+ * given @p transaction.
+ */
+bool Keyspace::remove(Transaction &transaction, const QByteArray &key,
+                      const QByteArray &value)
+{
+    Q_D(Keyspace);
+    auto result = d->database->remove(transaction, d->prefix + key, value);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries of the keyspace.
+ *
+ * This includes the entries of all nested keyspaces. Like
+ * Database::removePrefix(), huge keyspaces are removed in several
+ * transactions.
+ *
+ * Returns the number of removed entries.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Keyspace::clear()
+{
+    Q_D(Keyspace);
+    auto result = d->database->removePrefix(d->prefix);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries of the keyspace.
+ *
+ * This is an overloaded version of clear(). It runs the operation in the
+ * given @p transaction.
+ */
+size_t Keyspace::clear(Transaction &transaction)
+{
+    Q_D(Keyspace);
+    auto result = d->database->removePrefix(transaction, d->prefix);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries in a range of keys.
+ *
+ * This removes the entries of the keyspace whose keys are greater than
+ * or equal to @p begin and less than @p end. An empty @p begin refers to
+ * the start and an empty @p end to the end of the keyspace.
+ *
+ * @sa Database::removeRange()
+ */
+size_t Keyspace::removeRange(const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Keyspace);
+    auto result = d->database->removeRange(
+                d->prefix + begin,
+                end.isEmpty() ? d->successor(d->prefix) : d->prefix + end);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries in a range of keys.
+ *
+ * This is an overloaded version of removeRange(). It runs the operation in
+ * the given @p transaction.
+ */
+size_t Keyspace::removeRange(Transaction &transaction,
+                             const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Keyspace);
+    auto result = d->database->removeRange(
+                transaction, d->prefix + begin,
+                end.isEmpty() ? d->successor(d->prefix) : d->prefix + end);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries whose keys start with the @p prefix.
+ *
+ * @sa Database::removePrefix()
+ */
+size_t Keyspace::removePrefix(const QByteArray &prefix)
+{
+    Q_D(Keyspace);
+    auto result = d->database->removePrefix(d->prefix + prefix);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Remove all entries whose keys start with the @p prefix.
+ *
+ * This is an overloaded version of removePrefix(). It runs the operation
+ * in the given @p transaction.
+ */
+size_t Keyspace::removePrefix(Transaction &transaction,
+                              const QByteArray &prefix)
+{
+    Q_D(Keyspace);
+    auto result = d->database->removePrefix(transaction, d->prefix + prefix);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief The number of entries in the keyspace.
+ *
+ * The entries are counted by iterating over the keyspace, so this takes
+ * time linear in its size. Use rangeCount() to get an estimate for large
+ * keyspaces quickly.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+size_t Keyspace::count()
+{
+    Q_D(Keyspace);
+    size_t result = 0;
+    if (isValid()) {
+        Transaction txn(*d->context(), Transaction::ReadOnly);
+        result = count(txn);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The number of entries in the keyspace.
+ *
+ * This is an overloaded version of count(). It runs the operation in the
+ * given @p transaction.
+ */
+size_t Keyspace::count(Transaction &transaction)
+{
+    Q_D(Keyspace);
+    size_t result = 0;
+    if (isValid() && transaction.isValid()) {
+        d->scan(transaction, d->prefix, d->successor(d->prefix),
+                [&](const QByteArray &, const QByteArray &) {
+            ++result;
+            return true;
+        });
+    }
+    return result;
+}
+
+
+/**
+ * @brief Estimate the number of entries in a range of keys.
+ *
+ * This counts the entries of the keyspace whose keys are greater than or
+ * equal to @p begin and less than @p end. An empty @p begin refers to the
+ * start and an empty @p end to the end of the keyspace.
+ *
+ * @sa Database::rangeCount()
+ */
+size_t Keyspace::rangeCount(const QByteArray &begin, const QByteArray &end)
+{
+    Q_D(Keyspace);
+    auto result = d->database->rangeCount(
+                d->prefix + begin,
+                end.isEmpty() ? d->successor(d->prefix) : d->prefix + end);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Estimate the number of entries in a range of keys.
+ *
+ * This is an overloaded version of rangeCount(). It runs the operation in
+ * the given @p transaction.
+ */
+size_t Keyspace::rangeCount(Transaction &transaction, const QByteArray &begin,
+                            const QByteArray &end)
+{
+    Q_D(Keyspace);
+    auto result = d->database->rangeCount(
+                transaction, d->prefix + begin,
+                end.isEmpty() ? d->successor(d->prefix) : d->prefix + end);
+    d->takeError();
+    return result;
+}
+
+
+/**
+ * @brief Visit the entries in a range of keys.
+ *
+ * The @p visitor is called in key order for each entry of the keyspace
+ * whose key is greater than or equal to @p begin and less than @p end. An
+ * empty @p begin refers to the start and an empty @p end to the end of the
+ * keyspace. The keys and values passed to the visitor point into the
+ * memory map and are only valid during the call.
+ *
+ * Returns false if an error occurred.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Keyspace::scan(const QByteArray &begin, const QByteArray &end,
+                    Visitor visitor)
+{
+    Q_D(Keyspace);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context(), Transaction::ReadOnly);
+        result = scan(txn, begin, end, visitor);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Visit the entries in a range of keys.
+ *
+ * This is an overloaded version of scan(). It runs the operation in the
+ * given @p transaction.
+ */
+bool Keyspace::scan(Transaction &transaction, const QByteArray &begin,
+                    const QByteArray &end, Visitor visitor)
+{
+    Q_D(Keyspace);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        result = d->scan(transaction, d->prefix + begin,
+                         end.isEmpty() ? d->successor(d->prefix)
+                                       : d->prefix + end,
+                         visitor);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Visit the entries whose keys start with the @p prefix.
+ *
+ * This works like scan(), but visits all entries of the keyspace whose
+ * keys start with the given @p prefix.
+ *
+ * @note This method must not be called when another Transaction is
+ * active in the same thread.
+ */
+bool Keyspace::scanPrefix(const QByteArray &prefix, Visitor visitor)
+{
+    Q_D(Keyspace);
+    bool result = false;
+    if (isValid()) {
+        Transaction txn(*d->context(), Transaction::ReadOnly);
+        result = scanPrefix(txn, prefix, visitor);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Visit the entries whose keys start with the @p prefix.
+ *
+ * This is an overloaded version of scanPrefix(). It runs the operation in
+ * the given @p transaction.
+ */
+bool Keyspace::scanPrefix(Transaction &transaction, const QByteArray &prefix,
+                          Visitor visitor)
+{
+    Q_D(Keyspace);
+    bool result = false;
+    if (isValid() && transaction.isValid()) {
+        auto begin = d->prefix + prefix;
+        result = d->scan(transaction, begin, d->successor(begin), visitor);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Encode an @p id the way it is stored in the prefix of a keyspace.
+ *
+ * IDs are encoded as unsigned LEB128 varints: Seven bits are stored per
+ * byte, starting with the least significant ones, and all but the last
+ * byte have their highest bit set. IDs below 128 take one byte, IDs below
+ * 16384 two bytes and so on.
+ */
+QByteArray Keyspace::encodeId(quint64 id)
+{
+    QByteArray result;
+    while (id >= 0x80) {
+        result.append(static_cast<char>((id & 0x7f) | 0x80));
+        id >>= 7;
+    }
+    result.append(static_cast<char>(id));
+    return result;
+}
+
+} // namespace QLMDB
@@ -0,0 +1,106 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEYSPACE_H
+#define KEYSPACE_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QScopedPointer>
+#include <QString>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Database;
+class KeyspacePrivate;
+class Transaction;
+
+class QLMDBSHARED_EXPORT Keyspace
+{
+public:
+    /**
+     * @brief A function visiting the entries found by a scan.
+     *
+     * The @p key is relative to the keyspace, i.e. it does not include the
+     * prefix(). Return true to continue or false to stop scanning.
+     */
+    typedef std::function<bool(const QByteArray &key,
+                               const QByteArray &value)> Visitor;
+
+    explicit Keyspace(Database &database, quint64 id);
+    explicit Keyspace(const Keyspace &parent, quint64 id);
+    virtual ~Keyspace();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    Database *database() const;
+    quint64 id() const;
+    QByteArray prefix() const;
+    QByteArray key(const QByteArray &key) const;
+
+    bool put(const QByteArray &key, const QByteArray &value);
+    bool put(Transaction &transaction, const QByteArray &key,
+             const QByteArray &value);
+    QByteArray get(const QByteArray &key);
+    QByteArray get(Transaction &transaction, const QByteArray &key);
+    QByteArrayList getAll(const QByteArray &key);
+    QByteArrayList getAll(Transaction &transaction, const QByteArray &key);
+    bool remove(const QByteArray &key);
+    bool remove(Transaction &transaction, const QByteArray &key);
+    bool remove(const QByteArray &key, const QByteArray &value);
+    bool remove(Transaction &transaction, const QByteArray &key,
+                const QByteArray &value);
+    size_t clear();
+    size_t clear(Transaction &transaction);
+    size_t removeRange(const QByteArray &begin, const QByteArray &end);
+    size_t removeRange(Transaction &transaction, const QByteArray &begin,
+                       const QByteArray &end);
+    size_t removePrefix(const QByteArray &prefix);
+    size_t removePrefix(Transaction &transaction, const QByteArray &prefix);
+
+    size_t count();
+    size_t count(Transaction &transaction);
+    size_t rangeCount(const QByteArray &begin, const QByteArray &end);
+    size_t rangeCount(Transaction &transaction, const QByteArray &begin,
+                      const QByteArray &end);
+
+    bool scan(const QByteArray &begin, const QByteArray &end,
+              Visitor visitor);
+    bool scan(Transaction &transaction, const QByteArray &begin,
+              const QByteArray &end, Visitor visitor);
+    bool scanPrefix(const QByteArray &prefix, Visitor visitor);
+    bool scanPrefix(Transaction &transaction, const QByteArray &prefix,
+                    Visitor visitor);
+
+    static QByteArray encodeId(quint64 id);
+
+private:
+    QScopedPointer<KeyspacePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(Keyspace)
+};
+
+} // namespace QLMDB
+
+#endif // KEYSPACE_H
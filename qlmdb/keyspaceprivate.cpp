@@ -0,0 +1,129 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "cursor.h"
+#include "databaseprivate.h"
+#include "errors.h"
+#include "keyspaceprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// Compare keys like LMDB's default key comparison does:
+inline int compareKeys(const QByteArray &a, const QByteArray &b)
+{
+    auto size = static_cast<size_t>(qMin(a.size(), b.size()));
+    auto result = size > 0 ? std::memcmp(a.constData(), b.constData(), size)
+                           : 0;
+    return result != 0 ? result : a.size() - b.size();
+}
+
+} // namespace
+
+KeyspacePrivate::KeyspacePrivate() :
+    database(nullptr),
+    id(0),
+    prefix(),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+/**
+ * @brief The context of the underlying database.
+ */
+Context *KeyspacePrivate::context() const
+{
+    return database->d_ptr->context;
+}
+
+/**
+ * @brief Visit the entries in the range from @p begin to @p end.
+ *
+ * The @p begin (inclusive) and @p end (exclusive) are full keys, i.e. they
+ * include the prefix. An empty @p end refers to the end of the database,
+ * as returned by successor() for prefixes without one. The visitor is
+ * called with the keys relative to the keyspace; keys and values point
+ * into the memory map.
+ */
+bool KeyspacePrivate::scan(Transaction &transaction, const QByteArray &begin,
+                           const QByteArray &end,
+                           const Keyspace::Visitor &visitor)
+{
+    setError(Errors::NoError, QString());
+    Cursor cursor(transaction, *database);
+    auto item = cursor.findFirstAfter(begin);
+    while (item.isValid()) {
+        auto key = item.key();
+        if (!end.isEmpty() && compareKeys(key, end) >= 0) {
+            break;
+        }
+        auto localKey = QByteArray::fromRawData(
+                    key.constData() + prefix.size(),
+                    key.size() - prefix.size());
+        if (!visitor(localKey, item.value())) {
+            break;
+        }
+        item = cursor.next();
+    }
+    if (cursor.lastError() != Errors::NoError &&
+            cursor.lastError() != Errors::NotFound) {
+        setError(cursor.lastError(), cursor.lastErrorString());
+    }
+    return lastError == Errors::NoError;
+}
+
+void KeyspacePrivate::setError(int error, const QString &errorString)
+{
+    lastError = error;
+    lastErrorString = errorString;
+}
+
+/**
+ * @brief Take over the error of the last operation on the database.
+ */
+void KeyspacePrivate::takeError()
+{
+    setError(database->lastError(), database->lastErrorString());
+}
+
+/**
+ * @brief The smallest key greater than all keys starting with @p key.
+ *
+ * Returns an empty byte array if there is no such key, i.e. if @p key
+ * only consists of 0xff bytes.
+ */
+QByteArray KeyspacePrivate::successor(const QByteArray &key)
+{
+    QByteArray result = key;
+    while (!result.isEmpty() &&
+           static_cast<quint8>(result.at(result.size() - 1)) == 0xff) {
+        result.chop(1);
+    }
+    if (!result.isEmpty()) {
+        auto last = result.size() - 1;
+        result[last] = static_cast<char>(
+                    static_cast<quint8>(result.at(last)) + 1);
+    }
+    return result;
+}
+
+} // namespace QLMDB
@@ -0,0 +1,54 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef KEYSPACEPRIVATE_H
+#define KEYSPACEPRIVATE_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "context.h"
+#include "database.h"
+#include "keyspace.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+//! @private
+class KeyspacePrivate
+{
+public:
+    KeyspacePrivate();
+
+    Database *database;
+    quint64 id;
+    QByteArray prefix;
+    int lastError;
+    QString lastErrorString;
+
+    Context *context() const;
+    bool scan(Transaction &transaction, const QByteArray &begin,
+              const QByteArray &end, const Keyspace::Visitor &visitor);
+    void setError(int error, const QString &errorString);
+    void takeError();
+
+    static QByteArray successor(const QByteArray &key);
+};
+
+} // namespace QLMDB
+
+#endif // KEYSPACEPRIVATE_H
@@ -0,0 +1,163 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "partitioner.h"
+
+namespace QLMDB {
+
+namespace {
+
+inline int compareKeys(const QByteArray &a, const QByteArray &b)
+{
+    auto size = static_cast<size_t>(qMin(a.size(), b.size()));
+    auto result = size > 0 ? std::memcmp(a.constData(), b.constData(), size)
+                           : 0;
+    return result != 0 ? result : a.size() - b.size();
+}
+
+} // namespace
+
+/**
+ * @class Partitioner
+ * @brief Maps keys to the shards of a ShardedContext.
+ *
+ * @sa HashPartitioner, RangePartitioner
+ */
+
+
+/**
+ * @brief Destructor.
+ */
+Partitioner::~Partitioner()
+{
+}
+
+
+/**
+ * @class HashPartitioner
+ * @brief Distribute keys evenly across shards.
+ *
+ * Keys are mapped to shards by a hash of their bytes. This spreads writes
+ * evenly, but keys which are next to each other in sort order usually end
+ * up in different shards. This is the default partitioner of a
+ * ShardedContext.
+ *
+ * The hash is stable, i.e. it does not depend on the process, platform or
+ * Qt version (unlike qHash()).
+ */
+
+
+/**
+ * @brief The shard of the @p key.
+ */
+int HashPartitioner::shard(const QByteArray &key, int shardCount) const
+{
+    if (shardCount <= 1) {
+        return 0;
+    }
+    return static_cast<int>(
+                hash(key.constData(), static_cast<size_t>(key.size())) %
+                static_cast<quint64>(shardCount));
+}
+
+
+/**
+ * @brief A stable 64 bit hash of @p size bytes of @p data.
+ *
+ * This is FNV-1a, followed by a final mixing step so that all bits of the
+ * result depend on all bytes of the input.
+ */
+quint64 HashPartitioner::hash(const char *data, size_t size)
+{
+    quint64 result = Q_UINT64_C(0xcbf29ce484222325);
+    for (size_t i = 0; i < size; ++i) {
+        result ^= static_cast<quint8>(data[i]);
+        result *= Q_UINT64_C(0x100000001b3);
+    }
+    result ^= result >> 33;
+    result *= Q_UINT64_C(0xff51afd7ed558ccd);
+    result ^= result >> 33;
+    result *= Q_UINT64_C(0xc4ceb9fe1a85ec53);
+    result ^= result >> 33;
+    return result;
+}
+
+
+/**
+ * @class RangePartitioner
+ * @brief Distribute keys across shards by key ranges.
+ *
+ * The partitioner is given a sorted list of boundary keys. Keys less than
+ * the first boundary go to the first shard, keys greater than or equal to
+ * the first and less than the second boundary to the second shard and so
+ * on. Hence, each shard holds a contiguous range of keys, so scans over
+ * a small range of keys only touch few shards.
+ *
+ * ```
+ * // Three shards: [..., "h"), ["h", "p"), ["p", ...)
+ * auto partitioner = QSharedPointer<RangePartitioner>::create(
+ *             QByteArrayList({"h", "p"}));
+ * ShardedContext ctx(3, partitioner);
+ * ```
+ *
+ * Use one boundary less than the number of shards. If there are more
+ * boundaries, keys beyond them go to the last shard.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * The @p boundaries are sorted by the constructor.
+ */
+RangePartitioner::RangePartitioner(const QByteArrayList &boundaries) :
+    Partitioner(),
+    bounds(boundaries)
+{
+    std::sort(bounds.begin(), bounds.end(),
+              [](const QByteArray &a, const QByteArray &b) {
+        return compareKeys(a, b) < 0;
+    });
+}
+
+
+/**
+ * @brief The sorted boundaries between the shards.
+ */
+QByteArrayList RangePartitioner::boundaries() const
+{
+    return bounds;
+}
+
+
+/**
+ * @brief The shard of the @p key.
+ */
+int RangePartitioner::shard(const QByteArray &key, int shardCount) const
+{
+    auto it = std::upper_bound(bounds.cbegin(), bounds.cend(), key,
+                               [](const QByteArray &a, const QByteArray &b) {
+        return compareKeys(a, b) < 0;
+    });
+    auto result = static_cast<int>(it - bounds.cbegin());
+    return qBound(0, result, qMax(shardCount - 1, 0));
+}
+
+} // namespace QLMDB
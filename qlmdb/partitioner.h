@@ -0,0 +1,69 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PARTITIONER_H
+#define PARTITIONER_H
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QtGlobal>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class QLMDBSHARED_EXPORT Partitioner
+{
+public:
+    virtual ~Partitioner();
+
+    /**
+     * @brief The index of the shard the @p key belongs to.
+     *
+     * The result must be in the range from 0 to @p shardCount - 1. It must
+     * only depend on the @p key and the @p shardCount, so the same key is
+     * always mapped to the same shard - also across processes and
+     * platforms.
+     */
+    virtual int shard(const QByteArray &key, int shardCount) const = 0;
+};
+
+
+class QLMDBSHARED_EXPORT HashPartitioner : public Partitioner
+{
+public:
+    int shard(const QByteArray &key, int shardCount) const override;
+
+    static quint64 hash(const char *data, size_t size);
+};
+
+
+class QLMDBSHARED_EXPORT RangePartitioner : public Partitioner
+{
+public:
+    explicit RangePartitioner(const QByteArrayList &boundaries);
+
+    QByteArrayList boundaries() const;
+
+    int shard(const QByteArray &key, int shardCount) const override;
+
+private:
+    QByteArrayList bounds;
+};
+
+} // namespace QLMDB
+
+#endif // PARTITIONER_H
@@ -37,6 +37,32 @@ SOURCES += \
     database.cpp \
     databaseprivate.cpp \
     cursor.cpp \
+    keybuilder.cpp \
+    expiringdatabase.cpp \
+    expiringdatabaseprivate.cpp \
+    index.cpp \
+    indexprivate.cpp \
+    changelog.cpp \
+    changelogprivate.cpp \
+    contextwatcher.cpp \
+    contextwatcherprivate.cpp \
+    codec.cpp \
+    compresseddatabase.cpp \
+    compresseddatabaseprivate.cpp \
+    blobstore.cpp \
+    blobstoreprivate.cpp \
+    valuedevice.cpp \
+    valuedeviceprivate.cpp \
+    partitioner.cpp \
+    shardedcontext.cpp \
+    shardedcontextprivate.cpp \
+    shardeddatabase.cpp \
+    shardeddatabaseprivate.cpp \
+    keyspace.cpp \
+    keyspaceprivate.cpp \
+    statistics.cpp \
+    statisticsprivate.cpp \
+    scopedaccesspattern.cpp \
     cursorprivate.cpp
 
 PUBLIC_HEADERS = \
@@ -46,12 +72,56 @@ PUBLIC_HEADERS = \
     transaction.h \
     database.h \
     cursor.h \
+    byteview.h \
+    keybuilder.h \
+    expiringdatabase.h \
+    index.h \
+    changelog.h \
+    contextwatcher.h \
+    codec.h \
+    compresseddatabase.h \
+    blobstore.h \
+    valuedevice.h \
+    partitioner.h \
+    shardedcontext.h \
+    shardeddatabase.h \
+    keyspace.h \
+    statistics.h \
+    scopedaccesspattern.h \
 
 PRIVATE_HEADERS = \
     contextprivate.h \
     transactionprivate.h \
     databaseprivate.h \
     cursorprivate.h \
+    expiringdatabaseprivate.h \
+    indexprivate.h \
+    changelogprivate.h \
+    contextwatcherprivate.h \
+    compresseddatabaseprivate.h \
+    blobstoreprivate.h \
+    valuedeviceprivate.h \
+    shardedcontextprivate.h \
+    shardeddatabaseprivate.h \
+    keyspaceprivate.h \
+    statisticsprivate.h \
+    tracingprivate.h \
+
+qlmdb_with_zlib {
+    # Build the DictionaryCodec against the system zlib
+    DEFINES += QLMDB_WITH_ZLIB
+    LIBS += -lz
+    SOURCES += dictionarycodec.cpp dictionarycodecprivate.cpp
+    PUBLIC_HEADERS += dictionarycodec.h
+    PRIVATE_HEADERS += dictionarycodecprivate.h
+}
+
+qlmdb_with_tracing {
+    # Build the trace points (and USDT probes if sys/sdt.h is available)
+    DEFINES += QLMDB_WITH_TRACING
+    SOURCES += tracing.cpp
+    PUBLIC_HEADERS += tracing.h
+}
 
 HEADERS += $$PRIVATE_HEADERS $$PUBLIC_HEADERS
 
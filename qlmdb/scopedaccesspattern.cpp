@@ -0,0 +1,99 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "scopedaccesspattern.h"
+
+namespace QLMDB {
+
+/**
+ * @class ScopedAccessPattern
+ * @brief Switch the access pattern of a Context temporarily.
+ *
+ * This sets the access pattern of a context when created and restores
+ * the previous one when destroyed. Use it to optimize the memory map for
+ * a large scan, while point lookups are optimized for the rest of the
+ * time:
+ *
+ * ```
+ * Context ctx;
+ * ctx.setAccessPattern(Context::RandomAccess);
+ * // ...
+ * {
+ *     ScopedAccessPattern scan(ctx, Context::SequentialAccess);
+ *     Transaction txn(ctx, Transaction::ReadOnly);
+ *     Cursor cursor(txn, *ctx.database());
+ *     for (auto item = cursor.first(); item.isValid();
+ *          item = cursor.next()) {
+ *         // ...
+ *     }
+ * }
+ * ```
+ *
+ * The pattern applies to the whole environment, i.e. other threads using
+ * the context are affected as well. If several scopes are nested, they
+ * must be destroyed in reverse order of their creation.
+ *
+ * @sa Context::setAccessPattern()
+ */
+
+
+/**
+ * @brief Set the access pattern of the @p context to @p pattern.
+ *
+ * If this fails, isActive() is false and the context is not changed.
+ */
+ScopedAccessPattern::ScopedAccessPattern(Context &context,
+                                         Context::AccessPattern pattern) :
+    context(&context),
+    previous(context.accessPattern()),
+    active(false)
+{
+    active = context.setAccessPattern(pattern);
+}
+
+
+/**
+ * @brief Destructor.
+ *
+ * This restores the previous access pattern.
+ */
+ScopedAccessPattern::~ScopedAccessPattern()
+{
+    restore();
+}
+
+
+/**
+ * @brief Indicates if the access pattern has been set by this object.
+ */
+bool ScopedAccessPattern::isActive() const
+{
+    return active;
+}
+
+
+/**
+ * @brief Restore the previous access pattern before leaving the scope.
+ */
+void ScopedAccessPattern::restore()
+{
+    if (active) {
+        context->setAccessPattern(previous);
+        active = false;
+    }
+}
+
+} // namespace QLMDB
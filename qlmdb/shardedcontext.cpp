@@ -0,0 +1,368 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QObject>
+
+#include "context.h"
+#include "errors.h"
+#include "shardedcontext.h"
+#include "shardedcontextprivate.h"
+
+namespace QLMDB {
+
+/**
+ * @class ShardedContext
+ * @brief Spread data across several LMDB environments.
+ *
+ * An LMDB environment allows only one write transaction at a time, which
+ * caps the write throughput of a single Context. A ShardedContext manages
+ * several contexts (the shards), each stored in its own environment. Keys
+ * are mapped to the shards by a Partitioner. Writes to different shards
+ * don't block each other and are committed independently, so they scale
+ * across cores.
+ *
+ * The shards are stored in sub-directories named `shard-<index>` of the
+ * path(). Configure the context and open it like a Context. The settings
+ * apply to each shard:
+ *
+ * ```
+ * ShardedContext ctx(4);
+ * ctx.setPath("/var/lib/myapp/data");
+ * ctx.setMapSize(1024 * 1024 * 1024);
+ * ctx.open();
+ *
+ * ShardedDatabase db(ctx, "events");
+ * db.put("foo", "bar");
+ * ```
+ *
+ * Use a ShardedDatabase to access the databases in the shards by key. For
+ * operations which must see a consistent state of all keys involved, keep
+ * the keys in the same shard (e.g. using a RangePartitioner), as there are
+ * no transactions spanning several shards.
+ *
+ * @note A sharded context must always be opened with the same partitioner,
+ * otherwise keys are looked up in the wrong shards. The number of shards is
+ * checked when opening the context.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a context with @p shardCount shards (at least one). Keys are
+ * mapped to shards using the @p partitioner. If it is null, a
+ * HashPartitioner is used.
+ */
+ShardedContext::ShardedContext(int shardCount,
+                               QSharedPointer<Partitioner> partitioner) :
+    d_ptr(new ShardedContextPrivate)
+{
+    Q_D(ShardedContext);
+    if (partitioner.isNull()) {
+        partitioner.reset(new HashPartitioner);
+    }
+    d->partitioner = partitioner;
+    for (int i = 0; i < qMax(shardCount, 1); ++i) {
+        d->shards << new Context;
+    }
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ShardedContext::~ShardedContext()
+{
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int ShardedContext::lastError() const
+{
+    const Q_D(ShardedContext);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString ShardedContext::lastErrorString() const
+{
+    const Q_D(ShardedContext);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void ShardedContext::clearLastError()
+{
+    Q_D(ShardedContext);
+    d->lastError = Errors::NoError;
+    d->lastErrorString.clear();
+}
+
+
+/**
+ * @brief The directory the shards are stored in.
+ */
+QString ShardedContext::path() const
+{
+    const Q_D(ShardedContext);
+    return d->path;
+}
+
+
+/**
+ * @brief Set the directory the shards are stored in.
+ *
+ * The directory and the ones of the shards are created when opening the
+ * context.
+ */
+void ShardedContext::setPath(const QString &path)
+{
+    Q_D(ShardedContext);
+    d->path = path;
+    for (int i = 0; i < d->shards.size(); ++i) {
+        d->shards[i]->setPath(d->shardPath(path, i));
+    }
+}
+
+
+/**
+ * @brief The flags used to open the shards.
+ *
+ * @sa Context::flags()
+ */
+unsigned int ShardedContext::flags() const
+{
+    const Q_D(ShardedContext);
+    return d->shards.first()->flags();
+}
+
+
+/**
+ * @brief Set the flags used to open the shards.
+ *
+ * @sa Context::setFlags()
+ */
+void ShardedContext::setFlags(unsigned int flags)
+{
+    Q_D(ShardedContext);
+    for (auto shard : d->shards) {
+        shard->setFlags(flags);
+    }
+}
+
+
+/**
+ * @brief The maximum number of named databases in each shard.
+ *
+ * @sa Context::maxDBs()
+ */
+unsigned int ShardedContext::maxDBs() const
+{
+    const Q_D(ShardedContext);
+    return d->shards.first()->maxDBs();
+}
+
+
+/**
+ * @brief Set the maximum number of named databases in each shard.
+ *
+ * @sa Context::setMaxDBs()
+ */
+void ShardedContext::setMaxDBs(unsigned int maxDBs)
+{
+    Q_D(ShardedContext);
+    for (auto shard : d->shards) {
+        shard->setMaxDBs(maxDBs);
+    }
+}
+
+
+/**
+ * @brief The maximum number of readers of each shard.
+ *
+ * @sa Context::maxReaders()
+ */
+unsigned int ShardedContext::maxReaders() const
+{
+    const Q_D(ShardedContext);
+    return d->shards.first()->maxReaders();
+}
+
+
+/**
+ * @brief Set the maximum number of readers of each shard.
+ *
+ * @sa Context::setMaxReaders()
+ */
+void ShardedContext::setMaxReaders(unsigned int maxReaders)
+{
+    Q_D(ShardedContext);
+    for (auto shard : d->shards) {
+        shard->setMaxReaders(maxReaders);
+    }
+}
+
+
+/**
+ * @brief The size of the memory map of each shard.
+ *
+ * @sa Context::mapSize()
+ */
+size_t ShardedContext::mapSize() const
+{
+    const Q_D(ShardedContext);
+    return d->shards.first()->mapSize();
+}
+
+
+/**
+ * @brief Set the size of the memory map of each shard.
+ *
+ * This limits the size of each shard, so the total size of the data is
+ * limited to shardCount() times the @p mapSize.
+ *
+ * @sa Context::setMapSize()
+ */
+void ShardedContext::setMapSize(size_t mapSize)
+{
+    Q_D(ShardedContext);
+    for (auto shard : d->shards) {
+        shard->setMapSize(mapSize);
+    }
+}
+
+
+/**
+ * @brief Indicates if all shards are open.
+ */
+bool ShardedContext::isOpen() const
+{
+    const Q_D(ShardedContext);
+    for (auto shard : d->shards) {
+        if (!shard->isOpen()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * @brief Open all shards.
+ *
+ * Creates the directories of the shards if needed. Returns true if all
+ * shards could be opened or false otherwise.
+ *
+ * The number of shards is stored in the path() when opening the context
+ * for the first time. Opening it with another number of shards fails with
+ * Errors::Incompatible.
+ */
+bool ShardedContext::open()
+{
+    Q_D(ShardedContext);
+    if (d->path.isEmpty()) {
+        d->lastError = Errors::InvalidPath;
+        d->lastErrorString = QObject::tr("Empty path passed to sharded "
+                                         "context");
+        return false;
+    }
+    if (!QDir().mkpath(d->path)) {
+        d->lastError = Errors::InvalidPath;
+        d->lastErrorString = QObject::tr("Failed to create directory %1")
+                .arg(d->path);
+        return false;
+    }
+    if (!d->checkShardCount(flags() & Context::ReadOnly)) {
+        return false;
+    }
+    auto subDirs = !(flags() & Context::NoSubDir);
+    for (int i = 0; i < d->shards.size(); ++i) {
+        auto shard = d->shards.at(i);
+        if (shard->isOpen()) {
+            continue;
+        }
+        auto path = subDirs ? shard->path() : d->path;
+        if (!QDir().mkpath(path)) {
+            d->lastError = Errors::InvalidPath;
+            d->lastErrorString = QObject::tr("Failed to create directory %1")
+                    .arg(path);
+            return false;
+        }
+        if (!shard->open()) {
+            d->lastError = shard->lastError();
+            d->lastErrorString = shard->lastErrorString();
+            return false;
+        }
+    }
+    clearLastError();
+    return true;
+}
+
+
+/**
+ * @brief The number of shards.
+ */
+int ShardedContext::shardCount() const
+{
+    const Q_D(ShardedContext);
+    return d->shards.size();
+}
+
+
+/**
+ * @brief The shard with the given @p index.
+ *
+ * Returns a null pointer if the @p index is out of range. The returned
+ * context is owned by the sharded context.
+ */
+Context *ShardedContext::shard(int index) const
+{
+    const Q_D(ShardedContext);
+    return d->shards.value(index, nullptr);
+}
+
+
+/**
+ * @brief The index of the shard the @p key belongs to.
+ */
+int ShardedContext::shardFor(const QByteArray &key) const
+{
+    const Q_D(ShardedContext);
+    return qBound(0, d->partitioner->shard(key, d->shards.size()),
+                  d->shards.size() - 1);
+}
+
+
+/**
+ * @brief The partitioner mapping keys to shards.
+ */
+QSharedPointer<Partitioner> ShardedContext::partitioner() const
+{
+    const Q_D(ShardedContext);
+    return d->partitioner;
+}
+
+} // namespace QLMDB
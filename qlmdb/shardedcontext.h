@@ -0,0 +1,77 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHARDEDCONTEXT_H
+#define SHARDEDCONTEXT_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+
+#include "partitioner.h"
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Context;
+class ShardedContextPrivate;
+
+class QLMDBSHARED_EXPORT ShardedContext
+{
+public:
+    explicit ShardedContext(
+            int shardCount,
+            QSharedPointer<Partitioner> partitioner =
+            QSharedPointer<Partitioner>());
+    virtual ~ShardedContext();
+
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    QString path() const;
+    void setPath(const QString &path);
+
+    unsigned int flags() const;
+    void setFlags(unsigned int flags);
+
+    unsigned int maxDBs() const;
+    void setMaxDBs(unsigned int maxDBs);
+
+    unsigned int maxReaders() const;
+    void setMaxReaders(unsigned int maxReaders);
+
+    size_t mapSize() const;
+    void setMapSize(size_t mapSize);
+
+    bool isOpen() const;
+    bool open();
+
+    int shardCount() const;
+    Context *shard(int index) const;
+    int shardFor(const QByteArray &key) const;
+    QSharedPointer<Partitioner> partitioner() const;
+
+private:
+    QScopedPointer<ShardedContextPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ShardedContext)
+};
+
+} // namespace QLMDB
+
+#endif // SHARDEDCONTEXT_H
@@ -0,0 +1,98 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QFile>
+#include <QObject>
+
+#include "errors.h"
+#include "shardedcontextprivate.h"
+
+namespace QLMDB {
+
+// The file in the directory of the context storing the number of shards:
+const char *ShardedContextPrivate::ShardCountFileName = "shards";
+
+ShardedContextPrivate::ShardedContextPrivate() :
+    shards(),
+    partitioner(),
+    path(),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+ShardedContextPrivate::~ShardedContextPrivate()
+{
+    qDeleteAll(shards);
+}
+
+/**
+ * @brief Check the number of shards against the one the context has.
+ *
+ * The number of shards is stored in the directory of the context when it
+ * is opened for the first time (unless @p readOnly is set). Opening it
+ * with a different number later on fails, as keys would be looked up in
+ * the wrong shards then.
+ */
+bool ShardedContextPrivate::checkShardCount(bool readOnly)
+{
+    QFile file(QDir(path).filePath(ShardCountFileName));
+    if (file.exists()) {
+        bool ok = false;
+        int count = 0;
+        if (file.open(QIODevice::ReadOnly)) {
+            count = file.readAll().trimmed().toInt(&ok);
+        }
+        if (!ok) {
+            lastError = Errors::Invalid;
+            lastErrorString = QObject::tr("Failed to read the number of "
+                                          "shards from %1")
+                    .arg(file.fileName());
+            return false;
+        }
+        if (count != shards.size()) {
+            lastError = Errors::Incompatible;
+            lastErrorString = QObject::tr("The context has %1 shards, but "
+                                          "has been opened with %2")
+                    .arg(count).arg(shards.size());
+            return false;
+        }
+    } else if (!readOnly) {
+        auto data = QByteArray::number(shards.size()) + "\n";
+        if (!file.open(QIODevice::WriteOnly) ||
+                file.write(data) != data.size()) {
+            lastError = Errors::InvalidPath;
+            lastErrorString = QObject::tr("Failed to write the number of "
+                                          "shards to %1")
+                    .arg(file.fileName());
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief The path of the shard with the given @p index.
+ */
+QString ShardedContextPrivate::shardPath(const QString &path, int index)
+{
+    return QDir(path).filePath(QStringLiteral("shard-%1").arg(index));
+}
+
+} // namespace QLMDB
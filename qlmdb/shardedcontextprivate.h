@@ -0,0 +1,50 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHARDEDCONTEXTPRIVATE_H
+#define SHARDEDCONTEXTPRIVATE_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "context.h"
+#include "partitioner.h"
+
+namespace QLMDB {
+
+//! @private
+class ShardedContextPrivate
+{
+public:
+    ShardedContextPrivate();
+    ~ShardedContextPrivate();
+
+    QVector<Context*> shards;
+    QSharedPointer<Partitioner> partitioner;
+    QString path;
+    int lastError;
+    QString lastErrorString;
+
+    static const char *ShardCountFileName;
+
+    bool checkShardCount(bool readOnly);
+    static QString shardPath(const QString &path, int index);
+};
+
+} // namespace QLMDB
+
+#endif // SHARDEDCONTEXTPRIVATE_H
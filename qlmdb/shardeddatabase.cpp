@@ -0,0 +1,373 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QObject>
+#include <QVector>
+
+#include "databaseprivate.h"
+#include "errors.h"
+#include "shardedcontext.h"
+#include "shardeddatabase.h"
+#include "shardeddatabaseprivate.h"
+
+namespace QLMDB {
+
+/**
+ * @class ShardedDatabase
+ * @brief A database spread across the shards of a ShardedContext.
+ *
+ * The database with the given name is opened in each shard. Entries are
+ * stored in the shard their key is mapped to by the partitioner of the
+ * context. The API follows the one of Database:
+ *
+ * ```
+ * ShardedDatabase users(ctx, "users");
+ * users.put("alice", aliceData);
+ * auto data = users.get("alice");
+ * ```
+ *
+ * Each write runs in a transaction of the shard it affects. Writes to
+ * different shards, e.g. from different threads, run in parallel. The batch
+ * overload of put() splits the items by shard and writes them in parallel,
+ * one transaction per shard. Hence, a batch is atomic per shard, but not as
+ * a whole.
+ *
+ * Use scan() and scanPrefix() to iterate over entries of all shards. The
+ * entries are merged, so they are visited in key order regardless of the
+ * partitioner. This requires the default key comparison, so the database
+ * must not use Database::ReverseKey, Database::IntegerKeys or a custom key
+ * comparison function.
+ *
+ * @note Like for the methods of Database which do not take a Transaction,
+ * the methods of this class must not be called when another Transaction
+ * is active in the same thread in one of the shards.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Opens the database @p name in each shard of the @p context, which must
+ * be open. The @p flags are passed on to Context::database(). If they or
+ * the database in one of the shards select a key order other than the
+ * default one, the database is invalid and lastError() is
+ * Errors::InvalidParameter.
+ */
+ShardedDatabase::ShardedDatabase(ShardedContext &context, const QString &name,
+                                 unsigned int flags) :
+    d_ptr(new ShardedDatabasePrivate)
+{
+    Q_D(ShardedDatabase);
+    if (flags & (Database::ReverseKey | Database::IntegerKeys)) {
+        d->setError(Errors::InvalidParameter,
+                    QObject::tr("Sharded databases require the default "
+                                "key order"));
+        return;
+    }
+    QVector<Database*> shards;
+    for (int i = 0; i < context.shardCount(); ++i) {
+        auto shard = context.shard(i);
+        auto database = shard->isOpen() ? shard->database(name, flags)
+                                        : nullptr;
+        if (database == nullptr) {
+            d->setError(shard->lastError() != Errors::NoError
+                        ? shard->lastError() : Errors::InvalidParameter,
+                        QObject::tr("Failed to open database in shard %1")
+                        .arg(i));
+            return;
+        }
+        bool defaultOrder = false;
+        auto error = database->d_ptr->hasDefaultKeyOrder(defaultOrder);
+        if (error != Errors::NoError || !defaultOrder) {
+            d->setError(error != Errors::NoError
+                        ? error : Errors::InvalidParameter,
+                        QObject::tr("The database in shard %1 does not use "
+                                    "the default key order").arg(i));
+            return;
+        }
+        shards << database;
+    }
+    d->shards = shards;
+    d->context = &context;
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ShardedDatabase::~ShardedDatabase()
+{
+}
+
+
+/**
+ * @brief Indicates if the database could be opened in all shards.
+ */
+bool ShardedDatabase::isValid() const
+{
+    const Q_D(ShardedDatabase);
+    return d->context != nullptr;
+}
+
+
+/**
+ * @brief The last error which occurred.
+ */
+int ShardedDatabase::lastError() const
+{
+    const Q_D(ShardedDatabase);
+    return d->lastError;
+}
+
+
+/**
+ * @brief A textual representation of the last error which occurred.
+ */
+QString ShardedDatabase::lastErrorString() const
+{
+    const Q_D(ShardedDatabase);
+    return d->lastErrorString;
+}
+
+
+/**
+ * @brief Reset the last error.
+ */
+void ShardedDatabase::clearLastError()
+{
+    Q_D(ShardedDatabase);
+    d->setError(Errors::NoError, QString());
+}
+
+
+/**
+ * @brief The database in the shard with the given @p index.
+ *
+ * Use it together with ShardedContext::shard() to run operations in a
+ * Transaction of a single shard. Returns a null pointer if the @p index is
+ * out of range.
+ */
+Database *ShardedDatabase::shard(int index) const
+{
+    const Q_D(ShardedDatabase);
+    return d->shards.value(index, nullptr);
+}
+
+
+/**
+ * @brief Store the @p value for the @p key.
+ *
+ * Returns true on success or false otherwise.
+ */
+bool ShardedDatabase::put(const QByteArray &key, const QByteArray &value)
+{
+    Q_D(ShardedDatabase);
+    bool result = false;
+    if (isValid()) {
+        auto database = d->shardFor(key);
+        result = database->put(key, value);
+        d->setError(*database);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Store a batch of @p items.
+ *
+ * The items are grouped by shard. Each group is written in one transaction
+ * of its shard, with the shards being written in parallel. Returns true if
+ * all items could be written. Otherwise, the items of some shards might
+ * have been written nevertheless.
+ */
+bool ShardedDatabase::put(const QList<QPair<QByteArray, QByteArray>> &items)
+{
+    Q_D(ShardedDatabase);
+    if (!isValid()) {
+        return false;
+    }
+    QVector<ShardedDatabasePrivate::Items> groups(d->shards.size());
+    for (const auto &item : items) {
+        groups[d->context->shardFor(item.first)] << item;
+    }
+
+    // Write all but the first group in threads of their own, the first one
+    // in the calling thread:
+    int first = -1;
+    QVector<ShardBatchWriter*> writers;
+    for (int i = 0; i < groups.size(); ++i) {
+        if (groups.at(i).isEmpty()) {
+            continue;
+        }
+        if (first < 0) {
+            first = i;
+        } else {
+            auto writer = new ShardBatchWriter(*d->context->shard(i),
+                                               *d->shards.at(i),
+                                               groups.at(i));
+            writer->start();
+            writers << writer;
+        }
+    }
+    d->setError(Errors::NoError, QString());
+    if (first >= 0) {
+        int error = Errors::NoError;
+        QString errorString;
+        if (!d->put(*d->context->shard(first), *d->shards.at(first),
+                    groups.at(first), error, errorString)) {
+            d->setError(error, errorString);
+        }
+    }
+    for (auto writer : writers) {
+        writer->wait();
+        if (!writer->result && d->lastError == Errors::NoError) {
+            d->setError(writer->error, writer->errorString);
+        }
+    }
+    qDeleteAll(writers);
+    return d->lastError == Errors::NoError;
+}
+
+
+/**
+ * @brief Get the value of the @p key.
+ *
+ * If the key is not in the database, a null byte array is returned and
+ * lastError() is set to Errors::NotFound.
+ */
+QByteArray ShardedDatabase::get(const QByteArray &key)
+{
+    Q_D(ShardedDatabase);
+    QByteArray result;
+    if (isValid()) {
+        auto database = d->shardFor(key);
+        result = database->get(key);
+        d->setError(*database);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Get all values of the @p key.
+ *
+ * This is useful for databases opened with Database::MultiValues.
+ */
+QByteArrayList ShardedDatabase::getAll(const QByteArray &key)
+{
+    Q_D(ShardedDatabase);
+    QByteArrayList result;
+    if (isValid()) {
+        auto database = d->shardFor(key);
+        result = database->getAll(key);
+        d->setError(*database);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p key.
+ *
+ * Returns true on success or false otherwise.
+ */
+bool ShardedDatabase::remove(const QByteArray &key)
+{
+    Q_D(ShardedDatabase);
+    bool result = false;
+    if (isValid()) {
+        auto database = d->shardFor(key);
+        result = database->remove(key);
+        d->setError(*database);
+    }
+    return result;
+}
+
+
+/**
+ * @brief Remove the @p value of the @p key.
+ *
+ * This is useful for databases opened with Database::MultiValues.
+ */
+bool ShardedDatabase::remove(const QByteArray &key, const QByteArray &value)
+{
+    Q_D(ShardedDatabase);
+    bool result = false;
+    if (isValid()) {
+        auto database = d->shardFor(key);
+        result = database->remove(key, value);
+        d->setError(*database);
+    }
+    return result;
+}
+
+
+/**
+ * @brief The number of entries in all shards.
+ */
+size_t ShardedDatabase::count()
+{
+    Q_D(ShardedDatabase);
+    size_t result = 0;
+    if (isValid()) {
+        d->setError(Errors::NoError, QString());
+        for (auto database : d->shards) {
+            result += database->count();
+            if (database->lastError() != Errors::NoError) {
+                d->setError(*database);
+            }
+        }
+    }
+    return result;
+}
+
+
+/**
+ * @brief Visit the entries in a range of keys in all shards.
+ *
+ * Calls the @p visitor for each entry whose key is greater than or equal
+ * to @p begin and less than @p end, in key order. An empty @p begin refers
+ * to the start and an empty @p end to the end of the database. Scanning
+ * stops early if the visitor returns false.
+ *
+ * The key and value passed to the visitor point into the memory maps of
+ * the shards. They are only valid during the call. Each shard is read in a
+ * transaction of its own, so the entries of different shards might be
+ * from different points in time. Returns true on success or false if an
+ * error occurred.
+ */
+bool ShardedDatabase::scan(const QByteArray &begin, const QByteArray &end,
+                           Visitor visitor)
+{
+    Q_D(ShardedDatabase);
+    return isValid() && d->scan(begin, end, false, visitor);
+}
+
+
+/**
+ * @brief Visit the entries with keys starting with the @p prefix.
+ *
+ * This works like scan(), but visits the entries whose keys start with the
+ * given @p prefix.
+ */
+bool ShardedDatabase::scanPrefix(const QByteArray &prefix, Visitor visitor)
+{
+    Q_D(ShardedDatabase);
+    return isValid() && d->scan(prefix, QByteArray(), true, visitor);
+}
+
+} // namespace QLMDB
@@ -0,0 +1,80 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHARDEDDATABASE_H
+#define SHARDEDDATABASE_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QByteArrayList>
+#include <QList>
+#include <QPair>
+#include <QScopedPointer>
+#include <QString>
+
+#include "database.h"
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class ShardedContext;
+class ShardedDatabasePrivate;
+
+class QLMDBSHARED_EXPORT ShardedDatabase
+{
+public:
+    /**
+     * @brief A function visiting the entries found by a scan.
+     *
+     * Return true to continue or false to stop scanning.
+     */
+    typedef std::function<bool(const QByteArray &key,
+                               const QByteArray &value)> Visitor;
+
+    explicit ShardedDatabase(ShardedContext &context,
+                             const QString &name = QString(),
+                             unsigned int flags = Database::Create);
+    virtual ~ShardedDatabase();
+
+    bool isValid() const;
+    int lastError() const;
+    QString lastErrorString() const;
+    void clearLastError();
+
+    Database *shard(int index) const;
+
+    bool put(const QByteArray &key, const QByteArray &value);
+    bool put(const QList<QPair<QByteArray, QByteArray>> &items);
+    QByteArray get(const QByteArray &key);
+    QByteArrayList getAll(const QByteArray &key);
+    bool remove(const QByteArray &key);
+    bool remove(const QByteArray &key, const QByteArray &value);
+    size_t count();
+
+    bool scan(const QByteArray &begin, const QByteArray &end,
+              Visitor visitor);
+    bool scanPrefix(const QByteArray &prefix, Visitor visitor);
+
+private:
+    QScopedPointer<ShardedDatabasePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ShardedDatabase)
+};
+
+} // namespace QLMDB
+
+#endif // SHARDEDDATABASE_H
@@ -0,0 +1,196 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <queue>
+#include <vector>
+
+#include <QObject>
+
+#include "cursor.h"
+#include "errors.h"
+#include "shardeddatabaseprivate.h"
+#include "transaction.h"
+
+namespace QLMDB {
+
+namespace {
+
+// The current entry of one of the shards during a scan. The key and value
+// point into the memory map of the shard.
+struct ScanEntry
+{
+    QByteArray key;
+    QByteArray value;
+    int shard;
+};
+
+// Orders entries like LMDB's default key comparison, so the entry with the
+// smallest key is on top of the queue:
+struct ScanEntryGreater
+{
+    bool operator()(const ScanEntry &a, const ScanEntry &b) const
+    {
+        auto size = static_cast<size_t>(qMin(a.key.size(), b.key.size()));
+        auto result = size > 0 ? std::memcmp(a.key.constData(),
+                                             b.key.constData(), size)
+                               : 0;
+        if (result == 0) {
+            result = a.key.size() - b.key.size();
+        }
+        return result != 0 ? result > 0 : a.shard > b.shard;
+    }
+};
+
+} // namespace
+
+ShardedDatabasePrivate::ShardedDatabasePrivate() :
+    context(nullptr),
+    shards(),
+    lastError(Errors::NoError),
+    lastErrorString()
+{
+
+}
+
+Database *ShardedDatabasePrivate::shardFor(const QByteArray &key) const
+{
+    return shards.at(context->shardFor(key));
+}
+
+/**
+ * @brief Visit the entries of all shards in key order.
+ *
+ * This runs a k-way merge over cursors in all shards, visiting the entries
+ * with keys in the range from @p begin (inclusive) to @p end (exclusive).
+ * If @p prefix is true, the entries with keys starting with @p begin are
+ * visited instead.
+ */
+bool ShardedDatabasePrivate::scan(const QByteArray &begin,
+                                  const QByteArray &end, bool prefix,
+                                  const ShardedDatabase::Visitor &visitor)
+{
+    auto inRange = [&](const QByteArray &key) {
+        if (prefix) {
+            return key.startsWith(begin);
+        }
+        return end.isEmpty() || ScanEntryGreater()(
+                    ScanEntry{end, QByteArray(), 0},
+                    ScanEntry{key, QByteArray(), 0});
+    };
+
+    // The shards are separate environments, so the calling thread can
+    // have a read transaction in each of them:
+    QVector<Transaction*> transactions;
+    QVector<Cursor*> cursors;
+    std::priority_queue<ScanEntry, std::vector<ScanEntry>, ScanEntryGreater>
+            queue;
+    setError(Errors::NoError, QString());
+    for (int i = 0; i < shards.size(); ++i) {
+        auto txn = new Transaction(*context->shard(i), Transaction::ReadOnly);
+        auto cursor = new Cursor(*txn, *shards.at(i));
+        transactions << txn;
+        cursors << cursor;
+        auto item = begin.isEmpty() ? cursor->first()
+                                    : cursor->findFirstAfter(begin);
+        if (item.isValid()) {
+            if (inRange(item.key())) {
+                queue.push({item.key(), item.value(), i});
+            }
+        } else if (cursor->lastError() != Errors::NoError &&
+                   cursor->lastError() != Errors::NotFound) {
+            setError(cursor->lastError(), cursor->lastErrorString());
+            break;
+        }
+    }
+    while (lastError == Errors::NoError && !queue.empty()) {
+        auto entry = queue.top();
+        queue.pop();
+        if (!visitor(entry.key, entry.value)) {
+            break;
+        }
+        auto cursor = cursors.at(entry.shard);
+        auto item = cursor->next();
+        if (item.isValid()) {
+            if (inRange(item.key())) {
+                queue.push({item.key(), item.value(), entry.shard});
+            }
+        } else if (cursor->lastError() != Errors::NoError &&
+                   cursor->lastError() != Errors::NotFound) {
+            setError(cursor->lastError(), cursor->lastErrorString());
+        }
+    }
+    qDeleteAll(cursors);
+    qDeleteAll(transactions);
+    return lastError == Errors::NoError;
+}
+
+/**
+ * @brief Write the @p items to the @p database in one transaction.
+ */
+bool ShardedDatabasePrivate::put(Context &context, Database &database,
+                                 const Items &items, int &error,
+                                 QString &errorString)
+{
+    Transaction txn(context);
+    for (const auto &item : items) {
+        if (!database.put(txn, item.first, item.second)) {
+            error = database.lastError();
+            errorString = database.lastErrorString();
+            txn.abort();
+            return false;
+        }
+    }
+    if (!txn.commit()) {
+        error = txn.lastError();
+        errorString = txn.lastErrorString();
+        return false;
+    }
+    return true;
+}
+
+void ShardedDatabasePrivate::setError(int error, const QString &errorString)
+{
+    lastError = error;
+    lastErrorString = errorString;
+}
+
+void ShardedDatabasePrivate::setError(const Database &database)
+{
+    setError(database.lastError(), database.lastErrorString());
+}
+
+ShardBatchWriter::ShardBatchWriter(Context &context, Database &database,
+                                   const ShardedDatabasePrivate::Items &items) :
+    QThread(),
+    result(false),
+    error(Errors::NoError),
+    errorString(),
+    context(&context),
+    database(&database),
+    items(items)
+{
+
+}
+
+void ShardBatchWriter::run()
+{
+    result = ShardedDatabasePrivate::put(*context, *database, items, error,
+                                         errorString);
+}
+
+} // namespace QLMDB
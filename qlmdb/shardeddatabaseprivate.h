@@ -0,0 +1,80 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SHARDEDDATABASEPRIVATE_H
+#define SHARDEDDATABASEPRIVATE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QThread>
+#include <QVector>
+
+#include "context.h"
+#include "database.h"
+#include "shardedcontext.h"
+#include "shardeddatabase.h"
+
+namespace QLMDB {
+
+//! @private
+class ShardedDatabasePrivate
+{
+public:
+    typedef QList<QPair<QByteArray, QByteArray>> Items;
+
+    ShardedDatabasePrivate();
+
+    ShardedContext *context;
+    // The databases in the shards (owned by the shards):
+    QVector<Database*> shards;
+    int lastError;
+    QString lastErrorString;
+
+    Database *shardFor(const QByteArray &key) const;
+    bool scan(const QByteArray &begin, const QByteArray &end, bool prefix,
+              const ShardedDatabase::Visitor &visitor);
+    static bool put(Context &context, Database &database, const Items &items,
+                    int &error, QString &errorString);
+    void setError(int error, const QString &errorString);
+    void setError(const Database &database);
+};
+
+
+//! @private
+class ShardBatchWriter : public QThread
+{
+public:
+    ShardBatchWriter(Context &context, Database &database,
+                     const ShardedDatabasePrivate::Items &items);
+
+    bool result;
+    int error;
+    QString errorString;
+
+protected:
+    void run() override;
+
+private:
+    Context *context;
+    Database *database;
+    ShardedDatabasePrivate::Items items;
+};
+
+} // namespace QLMDB
+
+#endif // SHARDEDDATABASEPRIVATE_H
@@ -0,0 +1,381 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QtAlgorithms>
+
+#include "errors.h"
+#include "statistics.h"
+#include "statisticsprivate.h"
+
+namespace QLMDB {
+
+namespace {
+
+// The name of an error code in exported metrics:
+QByteArray errorName(int error)
+{
+    static const QHash<int, QByteArray> names = {
+        {Errors::KeyExists, "KeyExists"},
+        {Errors::NotFound, "NotFound"},
+        {Errors::PageNotFound, "PageNotFound"},
+        {Errors::Corrupted, "Corrupted"},
+        {Errors::Panic, "Panic"},
+        {Errors::VersionMismatch, "VersionMismatch"},
+        {Errors::Invalid, "Invalid"},
+        {Errors::MapFull, "MapFull"},
+        {Errors::DBsFull, "DBsFull"},
+        {Errors::ReadersFull, "ReadersFull"},
+        {Errors::TLSFull, "TLSFull"},
+        {Errors::TooManyTransactions, "TooManyTransactions"},
+        {Errors::CursorFull, "CursorFull"},
+        {Errors::PageFull, "PageFull"},
+        {Errors::MapResized, "MapResized"},
+        {Errors::Incompatible, "Incompatible"},
+        {Errors::BadReaderSlot, "BadReaderSlot"},
+        {Errors::BadTransaction, "BadTransaction"},
+        {Errors::BadValueSize, "BadValueSize"},
+        {Errors::BadDBI, "BadDBI"},
+        {Errors::InvalidParameter, "InvalidParameter"},
+        {Errors::InvalidPath, "InvalidPath"},
+        {Errors::NoAccessToPath, "NoAccessToPath"},
+        {Errors::TemporarilyNotAvailable, "TemporarilyNotAvailable"},
+        {Errors::OutOfMemory, "OutOfMemory"},
+        {Errors::OutOfDiskSpace, "OutOfDiskSpace"},
+        {Errors::IOError, "IOError"}
+    };
+    return names.value(error, QByteArray::number(error));
+}
+
+// Format a duration in nanoseconds as seconds:
+QByteArray seconds(quint64 nanoseconds)
+{
+    return QByteArray::number(static_cast<double>(nanoseconds) / 1e9, 'g', 9);
+}
+
+} // namespace
+
+/**
+ * @class Statistics
+ * @brief A snapshot of the operation statistics of a Context.
+ *
+ * Statistics are opt-in. Once they are enabled via
+ * Context::setStatisticsEnabled(), the context counts the operations
+ * listed in the Operation enum and records how long they took and which
+ * errors they failed with. Context::statistics() returns a snapshot of
+ * the numbers collected so far:
+ *
+ * ```
+ * ctx.setStatisticsEnabled(true);
+ * // ...
+ * auto stats = ctx.statistics();
+ * auto p99 = stats.percentile(Statistics::CommitTransaction, 0.99);
+ * auto notFound = stats.errors(Statistics::Get).value(Errors::NotFound);
+ * ```
+ *
+ * Recording an operation only takes a few relaxed atomic increments.
+ * The counters are spread over several stripes, to which the threads are
+ * assigned, so threads rarely contend for the same cache lines.
+ *
+ * Durations are recorded in log-linear histograms: each power of two is
+ * split into four buckets. This bounds the relative error of percentiles
+ * to 25% while keeping the histograms small. Durations are measured in
+ * nanoseconds.
+ *
+ * Use toPrometheus() to export the numbers to a Prometheus server.
+ */
+
+
+/**
+ * @brief The number of values in the Operation enum.
+ */
+const int Statistics::OperationCount = Statistics::CursorStep + 1;
+
+
+/**
+ * @brief The number of buckets in a histogram().
+ */
+const int Statistics::BucketCount = 160;
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates empty statistics.
+ */
+Statistics::Statistics() :
+    d_ptr(new StatisticsPrivate)
+{
+}
+
+
+/**
+ * @brief Copy constructor.
+ */
+Statistics::Statistics(const Statistics &other) :
+    d_ptr(new StatisticsPrivate(*other.d_ptr))
+{
+}
+
+
+/**
+ * @brief Destructor.
+ */
+Statistics::~Statistics()
+{
+}
+
+
+/**
+ * @brief Assignment operator.
+ */
+Statistics &Statistics::operator =(const Statistics &other)
+{
+    *d_ptr = *other.d_ptr;
+    return *this;
+}
+
+
+/**
+ * @brief The number of times the @p operation has been run.
+ *
+ * This includes failed operations.
+ */
+quint64 Statistics::count(Operation operation) const
+{
+    const Q_D(Statistics);
+    return d->counts.value(operation);
+}
+
+
+/**
+ * @brief The total time (in nanoseconds) spent in the @p operation.
+ */
+quint64 Statistics::totalTime(Operation operation) const
+{
+    const Q_D(Statistics);
+    return d->times.value(operation);
+}
+
+
+/**
+ * @brief The number of times the @p operation failed.
+ *
+ * Note that Errors::NotFound is counted as well, e.g. when getting a key
+ * which does not exist or when a Cursor reaches the end of the database.
+ */
+quint64 Statistics::errorCount(Operation operation) const
+{
+    const Q_D(Statistics);
+    return d->errorCounts.value(operation);
+}
+
+
+/**
+ * @brief The number of failures of the @p operation by error code.
+ *
+ * The keys are the codes in the Errors namespace. Only LMDB's error codes
+ * and small system error codes are counted individually, so the values
+ * might sum up to less than errorCount().
+ */
+QHash<int, quint64> Statistics::errors(Operation operation) const
+{
+    const Q_D(Statistics);
+    return d->errors.value(operation);
+}
+
+
+/**
+ * @brief The latency histogram of the @p operation.
+ *
+ * The result holds the number of operations for each of the BucketCount
+ * buckets.
+ *
+ * @sa bucket(), bucketUpperBound()
+ */
+QVector<quint64> Statistics::histogram(Operation operation) const
+{
+    const Q_D(Statistics);
+    return d->histograms.value(operation);
+}
+
+
+/**
+ * @brief The duration (in nanoseconds) below which a @p percentile of the
+ * operations finished.
+ *
+ * The @p percentile ranges from 0 to 1, e.g. 0.99 yields the 99th
+ * percentile. The result is the upper bound of the histogram bucket the
+ * percentile falls into. If the @p operation has not been recorded, 0 is
+ * returned.
+ */
+quint64 Statistics::percentile(Operation operation, double percentile) const
+{
+    const Q_D(Statistics);
+    auto total = d->counts.value(operation);
+    if (total == 0) {
+        return 0;
+    }
+    auto rank = static_cast<quint64>(qBound(0.0, percentile, 1.0) * total);
+    rank = qBound(Q_UINT64_C(1), rank, total);
+    const auto &histogram = d->histograms.at(operation);
+    quint64 sum = 0;
+    for (int i = 0; i < histogram.size(); ++i) {
+        sum += histogram.at(i);
+        if (sum >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+    return bucketUpperBound(BucketCount - 1);
+}
+
+
+/**
+ * @brief Export the statistics in the Prometheus text format.
+ *
+ * All metric names start with the given @p prefix. The following metrics
+ * are exported, each labeled with the `operation`:
+ *
+ * - `<prefix>_operations_total`: The count() of each operation.
+ * - `<prefix>_errors_total`: The errors() of each operation. The `error`
+ *   label holds the name of the error code, e.g. `NotFound`.
+ * - `<prefix>_operation_duration_seconds`: A histogram of the durations.
+ *   To keep the output small, the buckets are merged into ones whose
+ *   upper bounds are powers of two nanoseconds, from about 1 µs to about
+ *   34 s.
+ */
+QByteArray Statistics::toPrometheus(const QByteArray &prefix) const
+{
+    const Q_D(Statistics);
+    QByteArray result;
+    auto name = prefix + "_operations_total";
+    result += "# HELP " + name + " Number of operations.\n";
+    result += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; ++op) {
+        result += name + "{operation=\"" +
+                operationName(static_cast<Operation>(op)).toUtf8() + "\"} " +
+                QByteArray::number(d->counts.at(op)) + "\n";
+    }
+
+    name = prefix + "_errors_total";
+    result += "# HELP " + name + " Number of failed operations by error.\n";
+    result += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; ++op) {
+        auto errors = d->errors.at(op);
+        auto codes = errors.keys();
+        std::sort(codes.begin(), codes.end());
+        for (auto code : codes) {
+            result += name + "{operation=\"" +
+                    operationName(static_cast<Operation>(op)).toUtf8() +
+                    "\",error=\"" + errorName(code) + "\"} " +
+                    QByteArray::number(errors.value(code)) + "\n";
+        }
+    }
+
+    name = prefix + "_operation_duration_seconds";
+    result += "# HELP " + name + " Duration of operations.\n";
+    result += "# TYPE " + name + " histogram\n";
+    for (int op = 0; op < OperationCount; ++op) {
+        auto label = "operation=\"" +
+                operationName(static_cast<Operation>(op)).toUtf8() + "\"";
+        const auto &histogram = d->histograms.at(op);
+        quint64 sum = 0;
+        int bucket = 0;
+        for (int exponent = 10; exponent <= 35; ++exponent) {
+            auto bound = Q_UINT64_C(1) << exponent;
+            for (; bucket < BucketCount && bucketUpperBound(bucket) <= bound;
+                 ++bucket) {
+                sum += histogram.at(bucket);
+            }
+            result += name + "_bucket{" + label + ",le=\"" + seconds(bound) +
+                    "\"} " + QByteArray::number(sum) + "\n";
+        }
+        // The counts are collected separately from the histograms, so the
+        // total is taken from the latter to keep the buckets monotonic:
+        for (; bucket < BucketCount; ++bucket) {
+            sum += histogram.at(bucket);
+        }
+        result += name + "_bucket{" + label + ",le=\"+Inf\"} " +
+                QByteArray::number(sum) + "\n";
+        result += name + "_sum{" + label + "} " + seconds(d->times.at(op)) +
+                "\n";
+        result += name + "_count{" + label + "} " +
+                QByteArray::number(sum) + "\n";
+    }
+    return result;
+}
+
+
+/**
+ * @brief A name of the @p operation for use in logs and metrics.
+ */
+QString Statistics::operationName(Operation operation)
+{
+    switch (operation) {
+    case BeginTransaction:
+        return QStringLiteral("begin_transaction");
+    case CommitTransaction:
+        return QStringLiteral("commit_transaction");
+    case AbortTransaction:
+        return QStringLiteral("abort_transaction");
+    case Put:
+        return QStringLiteral("put");
+    case Get:
+        return QStringLiteral("get");
+    case Remove:
+        return QStringLiteral("remove");
+    case CursorStep:
+        return QStringLiteral("cursor_step");
+    }
+    return QString();
+}
+
+
+/**
+ * @brief The histogram bucket of a duration of @p nanoseconds.
+ *
+ * Durations below 4 ns have a bucket of their own. Above, each power of
+ * two is split into four buckets of equal width. Durations beyond the
+ * range of the histogram (about 37 minutes) end up in the last bucket.
+ */
+int Statistics::bucket(quint64 nanoseconds)
+{
+    if (nanoseconds < 4) {
+        return static_cast<int>(nanoseconds);
+    }
+    auto exponent =
+            63 - static_cast<int>(qCountLeadingZeroBits(nanoseconds));
+    auto subBucket = static_cast<int>((nanoseconds >> (exponent - 2)) & 3);
+    return qMin(4 * (exponent - 1) + subBucket, BucketCount - 1);
+}
+
+
+/**
+ * @brief The upper bound (exclusive, in nanoseconds) of a @p bucket.
+ */
+quint64 Statistics::bucketUpperBound(int bucket)
+{
+    if (bucket < 4) {
+        return static_cast<quint64>(qMax(bucket, 0) + 1);
+    }
+    auto exponent = bucket / 4 + 1;
+    auto subBucket = static_cast<quint64>(bucket % 4);
+    return (5 + subBucket) << (exponent - 2);
+}
+
+} // namespace QLMDB
@@ -0,0 +1,80 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class StatisticsPrivate;
+
+class QLMDBSHARED_EXPORT Statistics
+{
+    friend class StatisticsRecorder;
+public:
+
+    /**
+     * @brief The operations for which statistics are recorded.
+     */
+    enum Operation {
+        BeginTransaction,  //!< Starting a Transaction.
+        CommitTransaction, //!< Committing a Transaction.
+        AbortTransaction,  //!< Aborting a Transaction.
+        Put,               //!< Storing a value via Database::put().
+        Get,               //!< Reading a value via Database::get().
+        Remove,            //!< Removing values via Database::remove().
+        CursorStep         //!< Positioning a Cursor.
+    };
+
+    static const int OperationCount;
+    static const int BucketCount;
+
+    Statistics();
+    Statistics(const Statistics &other);
+    virtual ~Statistics();
+    Statistics &operator =(const Statistics &other);
+
+    quint64 count(Operation operation) const;
+    quint64 totalTime(Operation operation) const;
+    quint64 errorCount(Operation operation) const;
+    QHash<int, quint64> errors(Operation operation) const;
+    QVector<quint64> histogram(Operation operation) const;
+    quint64 percentile(Operation operation, double percentile) const;
+
+    QByteArray toPrometheus(const QByteArray &prefix = "qlmdb") const;
+
+    static QString operationName(Operation operation);
+    static int bucket(quint64 nanoseconds);
+    static quint64 bucketUpperBound(int bucket);
+
+private:
+    QScopedPointer<StatisticsPrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(Statistics)
+};
+
+} // namespace QLMDB
+
+#endif // STATISTICS_H
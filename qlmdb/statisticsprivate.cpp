@@ -0,0 +1,153 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "errors.h"
+#include "statisticsprivate.h"
+
+namespace QLMDB {
+
+StatisticsPrivate::StatisticsPrivate() :
+    counts(Statistics::OperationCount),
+    times(Statistics::OperationCount),
+    errorCounts(Statistics::OperationCount),
+    errors(Statistics::OperationCount),
+    histograms(Statistics::OperationCount,
+               QVector<quint64>(Statistics::BucketCount))
+{
+
+}
+
+StatisticsRecorder::StatisticsRecorder()
+{
+    reset();
+}
+
+/**
+ * @brief Record an @p operation which took the given @p nanoseconds.
+ *
+ * If the operation failed, @p error is the error code it failed with.
+ */
+void StatisticsRecorder::record(Statistics::Operation operation,
+                                quint64 nanoseconds, int error)
+{
+    auto &s = stripes[stripe()];
+    s.counts[operation].fetch_add(1, std::memory_order_relaxed);
+    s.times[operation].fetch_add(nanoseconds, std::memory_order_relaxed);
+    s.histograms[operation][Statistics::bucket(nanoseconds)].fetch_add(
+                1, std::memory_order_relaxed);
+    if (error != Errors::NoError) {
+        s.errorCounts[operation].fetch_add(1, std::memory_order_relaxed);
+        auto slot = errorSlot(error);
+        if (slot >= 0) {
+            s.errors[operation][slot].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Set all counters to zero.
+ */
+void StatisticsRecorder::reset()
+{
+    for (auto &s : stripes) {
+        for (int op = 0; op < Operations; ++op) {
+            s.counts[op].store(0, std::memory_order_relaxed);
+            s.times[op].store(0, std::memory_order_relaxed);
+            s.errorCounts[op].store(0, std::memory_order_relaxed);
+            for (auto &counter : s.errors[op]) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+            for (auto &counter : s.histograms[op]) {
+                counter.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Sum up the stripes.
+ *
+ * The counters are read one after the other while other threads might
+ * update them, so the snapshot is only approximately consistent.
+ */
+Statistics StatisticsRecorder::snapshot() const
+{
+    Statistics result;
+    auto d = result.d_ptr.data();
+    for (const auto &s : stripes) {
+        for (int op = 0; op < Operations; ++op) {
+            d->counts[op] += s.counts[op].load(std::memory_order_relaxed);
+            d->times[op] += s.times[op].load(std::memory_order_relaxed);
+            d->errorCounts[op] += s.errorCounts[op].load(
+                        std::memory_order_relaxed);
+            for (int slot = 0; slot < ErrorSlots; ++slot) {
+                auto count = s.errors[op][slot].load(
+                            std::memory_order_relaxed);
+                if (count > 0) {
+                    d->errors[op][slotError(slot)] += count;
+                }
+            }
+            auto &histogram = d->histograms[op];
+            for (int bucket = 0; bucket < Buckets; ++bucket) {
+                histogram[bucket] += s.histograms[op][bucket].load(
+                            std::memory_order_relaxed);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief The stripe used by the current thread.
+ *
+ * Threads are assigned to the stripes round robin when they first record
+ * an operation.
+ */
+int StatisticsRecorder::stripe()
+{
+    static std::atomic<unsigned int> next(0);
+    static thread_local int result = static_cast<int>(
+                next.fetch_add(1, std::memory_order_relaxed) % Stripes);
+    return result;
+}
+
+/**
+ * @brief The slot in which an @p error is counted, or -1 if there is none.
+ */
+int StatisticsRecorder::errorSlot(int error)
+{
+    if (error >= MDB_KEYEXIST && error <= MDB_LAST_ERRCODE) {
+        return error - MDB_KEYEXIST;
+    }
+    if (error > 0 && error < SystemErrorCount) {
+        return LmdbErrorCount + error;
+    }
+    return -1;
+}
+
+/**
+ * @brief The error counted in a @p slot.
+ */
+int StatisticsRecorder::slotError(int slot)
+{
+    if (slot < LmdbErrorCount) {
+        return MDB_KEYEXIST + slot;
+    }
+    return slot - LmdbErrorCount;
+}
+
+} // namespace QLMDB
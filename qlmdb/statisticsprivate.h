@@ -0,0 +1,137 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATISTICSPRIVATE_H
+#define STATISTICSPRIVATE_H
+
+#include <atomic>
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QVector>
+
+#include "contextprivate.h"
+#include "statistics.h"
+
+namespace QLMDB {
+
+//! @private
+class StatisticsPrivate
+{
+public:
+    StatisticsPrivate();
+
+    QVector<quint64> counts;
+    QVector<quint64> times;
+    QVector<quint64> errorCounts;
+    QVector<QHash<int, quint64>> errors;
+    QVector<QVector<quint64>> histograms;
+};
+
+
+//! @private
+class StatisticsRecorder
+{
+public:
+    StatisticsRecorder();
+
+    void record(Statistics::Operation operation, quint64 nanoseconds,
+                int error);
+    void reset();
+    Statistics snapshot() const;
+
+private:
+
+    // Threads are spread over several stripes, so concurrent updates
+    // rarely touch the same cache lines. Stripes take several KiB each,
+    // so they do not need to be aligned explicitly:
+    static const int Stripes = 8;
+
+    // Error codes counted individually: LMDB's own codes followed by
+    // small (errno) codes. Other codes only count towards the total.
+    static const int LmdbErrorCount = MDB_LAST_ERRCODE - MDB_KEYEXIST + 1;
+    static const int SystemErrorCount = 128;
+    static const int ErrorSlots = LmdbErrorCount + SystemErrorCount;
+
+    static const int Operations = Statistics::CursorStep + 1;
+    static const int Buckets = 160;
+
+    struct Stripe {
+        std::atomic<quint64> counts[Operations];
+        std::atomic<quint64> times[Operations];
+        std::atomic<quint64> errorCounts[Operations];
+        std::atomic<quint64> errors[Operations][ErrorSlots];
+        std::atomic<quint64> histograms[Operations][Buckets];
+    };
+
+    Stripe stripes[Stripes];
+
+    static int stripe();
+    static int errorSlot(int error);
+    static int slotError(int slot);
+};
+
+
+/**
+ * @private
+ * @brief Measures an operation if statistics are enabled.
+ *
+ * The clock is only read if statistics are enabled when the timer is
+ * created.
+ */
+class OperationTimer
+{
+public:
+    inline OperationTimer(ContextPrivate *context,
+                          Statistics::Operation operation);
+    inline void finish(int error);
+
+private:
+    StatisticsRecorder *recorder;
+    Statistics::Operation operation;
+    QElapsedTimer timer;
+};
+
+
+OperationTimer::OperationTimer(ContextPrivate *context,
+                               Statistics::Operation operation) :
+    recorder(nullptr),
+    operation(operation),
+    timer()
+{
+    if (context->statisticsEnabled.loadAcquire() != 0) {
+        recorder = context->statistics.data();
+        timer.start();
+    }
+}
+
+
+/**
+ * @brief Record the operation, which finished with the given @p error.
+ */
+void OperationTimer::finish(int error)
+{
+    if (recorder != nullptr) {
+        recorder->record(operation,
+                         static_cast<quint64>(timer.nsecsElapsed()), error);
+        recorder = nullptr;
+    }
+}
+
+} // namespace QLMDB
+
+#endif // STATISTICSPRIVATE_H
@@ -0,0 +1,85 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+
+#include "tracing.h"
+
+namespace QLMDB {
+
+namespace {
+
+std::atomic<const Tracing::Hooks*> installedHooks(nullptr);
+
+} // namespace
+
+/**
+ * @class Tracing
+ * @brief Trace points for correlating QLMDB with external profilers.
+ *
+ * If the library is built with the `QLMDB_WITH_TRACING` option, it
+ * contains trace points when transactions begin, are committed or
+ * aborted, when cursors read, write or remove entries and when databases
+ * are opened. Without the option, the trace points compile to nothing and
+ * this class is not available.
+ *
+ * On Linux, if the SystemTap SDT header (`sys/sdt.h`) is found during the
+ * build, each trace point is also a USDT probe in the provider `qlmdb`,
+ * named like the members of Tracing::Hooks. Tools like `perf` can record
+ * them without modifying the application:
+ *
+ * ```
+ * perf buildid-cache --add libqlmdb-qt5.so
+ * perf probe sdt_qlmdb:transactionCommit
+ * perf record -e sdt_qlmdb:transactionCommit -p <pid>
+ * ```
+ *
+ * In addition, an application can install a table of functions which are
+ * called at the trace points:
+ *
+ * ```
+ * static const Tracing::Hooks hooks = {
+ *     nullptr, // transactionBegin
+ *     [](quint64 id, int error) { qDebug() << "Commit" << id << error; },
+ *     nullptr, nullptr, nullptr, nullptr, nullptr
+ * };
+ * Tracing::setHooks(&hooks);
+ * ```
+ */
+
+
+/**
+ * @brief Install the @p hooks called at the trace points.
+ *
+ * The table is not copied, so it must stay valid until other hooks are
+ * installed. Pass a null pointer to remove the hooks. The hooks are
+ * global, i.e. they are called for all contexts.
+ */
+void Tracing::setHooks(const Hooks *hooks)
+{
+    installedHooks.store(hooks, std::memory_order_release);
+}
+
+
+/**
+ * @brief The currently installed hooks, or a null pointer.
+ */
+const Tracing::Hooks *Tracing::hooks()
+{
+    return installedHooks.load(std::memory_order_acquire);
+}
+
+} // namespace QLMDB
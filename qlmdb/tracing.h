@@ -0,0 +1,80 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QtGlobal>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class QLMDBSHARED_EXPORT Tracing
+{
+public:
+
+    /**
+     * @brief Functions called at the trace points of the library.
+     *
+     * Each member may be a null pointer to skip the trace point. The
+     * functions are called in the thread running the operation and must
+     * return quickly.
+     */
+    struct Hooks {
+        /**
+         * @brief A Transaction has been started.
+         *
+         * The @p transactionId is 0 if starting failed with @p error.
+         */
+        void (*transactionBegin)(quint64 transactionId, unsigned int flags,
+                                 int error);
+
+        //! @brief A Transaction has been committed.
+        void (*transactionCommit)(quint64 transactionId, int error);
+
+        //! @brief A Transaction has been aborted.
+        void (*transactionAbort)(quint64 transactionId);
+
+        //! @brief A Cursor has been positioned using the LMDB @p operation.
+        void (*cursorGet)(unsigned int database, int operation, int error);
+
+        //! @brief A value has been written via a Cursor.
+        void (*cursorPut)(unsigned int database, unsigned int flags,
+                          int error);
+
+        //! @brief A value has been removed via a Cursor.
+        void (*cursorRemove)(unsigned int database, unsigned int flags,
+                             int error);
+
+        /**
+         * @brief A Database has been opened.
+         *
+         * The @p name is a null pointer for the default database.
+         */
+        void (*databaseOpen)(const char *name, unsigned int database,
+                             int error);
+    };
+
+    Tracing() = delete;
+
+    static void setHooks(const Hooks *hooks);
+    static const Hooks *hooks();
+};
+
+} // namespace QLMDB
+
+#endif // TRACING_H
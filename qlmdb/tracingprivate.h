@@ -0,0 +1,59 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TRACINGPRIVATE_H
+#define TRACINGPRIVATE_H
+
+/*
+ * QLMDB_TRACE(probe, args...) marks a trace point. The probe is the name of
+ * a member of Tracing::Hooks, the arguments are passed to it. Without
+ * QLMDB_WITH_TRACING, the macro expands to an empty statement and the
+ * arguments are not evaluated.
+ */
+
+#ifdef QLMDB_WITH_TRACING
+
+#include "tracing.h"
+
+#if defined(__has_include)
+#    if __has_include(<sys/sdt.h>)
+#        include <sys/sdt.h>
+#        define QLMDB_TRACE_SDT(probe, ...) \
+            STAP_PROBEV(qlmdb, probe, __VA_ARGS__)
+#    endif
+#endif
+
+#ifndef QLMDB_TRACE_SDT
+#    define QLMDB_TRACE_SDT(probe, ...) do {} while (false)
+#endif
+
+#define QLMDB_TRACE(probe, ...) \
+    do { \
+        QLMDB_TRACE_SDT(probe, __VA_ARGS__); \
+        auto qlmdbTraceHooks = ::QLMDB::Tracing::hooks(); \
+        if (qlmdbTraceHooks != nullptr && \
+                qlmdbTraceHooks->probe != nullptr) { \
+            qlmdbTraceHooks->probe(__VA_ARGS__); \
+        } \
+    } while (false)
+
+#else
+
+#define QLMDB_TRACE(probe, ...) do {} while (false)
+
+#endif // QLMDB_WITH_TRACING
+
+#endif // TRACINGPRIVATE_H
@@ -19,6 +19,8 @@
 #include "context.h"
 #include "contextprivate.h"
 #include "errors.h"
+#include "statisticsprivate.h"
+#include "tracingprivate.h"
 
 namespace QLMDB {
 
@@ -95,13 +97,19 @@ const unsigned int Transaction::ReadOnly = MDB_RDONLY;
  * - #ReadOnly
  */
 Transaction::Transaction(Context &context, unsigned int flags) :
-    d_ptr(new TransactionPrivate(context))
+    d_ptr(new TransactionPrivate(context, flags))
 {
     Q_D(Transaction);
     if (context.isOpen()) {
+        OperationTimer timer(context.d_ptr.data(),
+                             Statistics::BeginTransaction);
         d->lastError = mdb_txn_begin(
                     context.d_ptr->env, nullptr, flags, &d->txn);
+        timer.finish(d->lastError);
         d->handleOpenError();
+        QLMDB_TRACE(transactionBegin, d->id, flags, d->lastError);
+        d->startLifetime();
+        d->track();
     }
 }
 
@@ -115,15 +123,22 @@ Transaction::Transaction(Context &context, unsigned int flags) :
  * Context instead.
  */
 Transaction::Transaction(Transaction &parent, unsigned int flags) :
-    d_ptr(new TransactionPrivate(parent.d_ptr->context))
+    d_ptr(new TransactionPrivate(parent.d_ptr->context, flags))
 {
     Q_D(Transaction);
     if (d->context.isOpen()) {
+        OperationTimer timer(d->context.d_ptr.data(),
+                             Statistics::BeginTransaction);
         d->lastError = mdb_txn_begin(
                     d->context.d_ptr->env,
                     parent.d_ptr->txn,
                     flags, &d->txn);
+        timer.finish(d->lastError);
+        d->parent = parent.d_ptr->txn;
         d->handleOpenError();
+        QLMDB_TRACE(transactionBegin, d->id, flags, d->lastError);
+        d->startLifetime();
+        d->track();
     }
 }
 
@@ -142,8 +157,12 @@ Transaction::~Transaction()
 {
     Q_D(Transaction);
     if (d->valid) {
+        // This resets the transaction if the watchdog asked to:
         commit();
     }
+    if (d->reset) {
+        mdb_txn_abort(d->txn);
+    }
 }
 
 
@@ -152,6 +171,13 @@ Transaction::~Transaction()
  *
  * This property is true if the transaction is valid, i.e. it has been
  * created with an opened Context or a valid Transaction as parent.
+ *
+ * If the watchdog of the context asked to reset the transaction, this
+ * happens the next time the transaction is used by its owner (i.e. a
+ * Database or Cursor operation runs in it, or it is committed or
+ * aborted). Only then this property becomes false.
+ *
+ * @sa Context::startWatchdog()
  */
 bool Transaction::isValid() const
 {
@@ -200,8 +226,21 @@ bool Transaction::commit()
 {
     bool result = false;
     Q_D(Transaction);
-    if (d->valid) {
-        d->lastError = mdb_txn_commit(d->txn);
+    if (d->isUsable()) {
+        d->releaseCursors();
+        OperationTimer timer(d->context.d_ptr.data(),
+                             Statistics::CommitTransaction);
+        QElapsedTimer commitTime;
+        if (d->lifetime.isValid()) {
+            commitTime.start();
+        }
+        d->lastError = d->commit();
+        timer.finish(d->lastError);
+        QLMDB_TRACE(transactionCommit, d->id, d->lastError);
+        if (d->lifetime.isValid()) {
+            d->reportIfSlow(commitTime.elapsed());
+        }
+        d->untrack();
         d->valid = false;
         if (d->lastError == 0) {
             result = true;
@@ -237,8 +276,15 @@ bool Transaction::abort()
 {
     bool result = false;
     Q_D(Transaction);
-    if (d->valid) {
-        mdb_txn_abort(d->txn);
+    if (d->isUsable()) {
+        d->releaseCursors();
+        OperationTimer timer(d->context.d_ptr.data(),
+                             Statistics::AbortTransaction);
+        d->abort();
+        timer.finish(Errors::NoError);
+        QLMDB_TRACE(transactionAbort, d->id);
+        d->reportIfSlow(0);
+        d->untrack();
         result = true;
         d->valid = false;
     }
@@ -32,9 +32,13 @@ class DatabasePrivate;
 
 class QLMDBSHARED_EXPORT Transaction
 {
+    friend class BlobStorePrivate;
     friend class Cursor;
     friend class Database;
     friend class DatabasePrivate;
+    friend class DictionaryCodec;
+    friend class Index;
+    friend class IndexPrivate;
 public:
     static const unsigned int ReadOnly;
 
@@ -14,19 +14,43 @@
  * You should have received a copy of the GNU General Public License
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+
 #include <QObject>
+#include <QStringList>
+#include <QThread>
 
+#include "contextprivate.h"
+#include "contextwatcherprivate.h"
+#include "cursor.h"
+#include "cursorprivate.h"
+#include "database.h"
+#include "databaseprivate.h"
 #include "errors.h"
+#include "tracingprivate.h"
+#include "transaction.h"
 #include "transactionprivate.h"
 
 namespace QLMDB {
 
-TransactionPrivate::TransactionPrivate(Context &context) :
+TransactionPrivate::TransactionPrivate(Context &context, unsigned int flags) :
     context(context),
     txn(nullptr),
+    parent(nullptr),
+    flags(flags),
     lastError(0),
     lastErrorString(),
-    valid(false)
+    valid(false),
+    cursors(),
+    id(0),
+    lifetime(),
+    bytesWritten(0),
+    tracked(false),
+    age(),
+    thread(nullptr),
+    stale(false),
+    resetRequested(0),
+    reset(false)
 {
 
 }
@@ -35,6 +59,7 @@ void TransactionPrivate::handleOpenError()
 {
     if (lastError == 0) {
         valid = true;
+        id = static_cast<quint64>(mdb_txn_id(txn));
     } else if (lastError == Errors::Panic) {
         lastErrorString = QObject::tr("Fatal error in environment");
     } else if (lastError == Errors::MapResized) {
@@ -51,4 +76,250 @@ void TransactionPrivate::handleOpenError()
     }
 }
 
+/**
+ * @brief Start measuring the transaction if slow operations are reported.
+ */
+void TransactionPrivate::startLifetime()
+{
+    if (valid && context.d_ptr->slowOperationThreshold.loadAcquire() > 0) {
+        lifetime.start();
+    }
+}
+
+/**
+ * @brief Register the transaction in the context, if tracking is enabled.
+ */
+void TransactionPrivate::track()
+{
+    auto ctx = context.d_ptr.data();
+    if (valid && ctx->transactionTracking.loadAcquire()) {
+        thread = QThread::currentThreadId();
+        age.start();
+        QMutexLocker locker(&ctx->transactionsLock);
+        ctx->transactions.insert(this);
+        tracked = true;
+    }
+}
+
+/**
+ * @brief Remove the transaction from the context's registry.
+ */
+void TransactionPrivate::untrack()
+{
+    if (tracked) {
+        auto ctx = context.d_ptr.data();
+        QMutexLocker locker(&ctx->transactionsLock);
+        ctx->transactions.remove(this);
+        tracked = false;
+    }
+}
+
+/**
+ * @brief Reset the transaction if the watchdog asked to do so.
+ *
+ * This must be called by the thread owning the transaction. The LMDB
+ * transaction is only reset (not aborted), so cursors still referring to it
+ * fail with Errors::BadTransaction instead of accessing freed memory. It is
+ * freed when the Transaction is destroyed.
+ */
+void TransactionPrivate::handleResetRequest()
+{
+    if (valid && resetRequested.loadAcquire()) {
+        releaseCursors();
+        mdb_txn_reset(txn);
+        QLMDB_TRACE(transactionAbort, id);
+        reportIfSlow(0);
+        untrack();
+        valid = false;
+        reset = true;
+        lastError = Errors::BadTransaction;
+        lastErrorString = QObject::tr("The transaction has been reset by "
+                                      "the watchdog");
+    }
+}
+
+/**
+ * @brief Check if the transaction can be used for an operation.
+ *
+ * Handles a pending reset request first, so this must only be called by
+ * the thread owning the transaction - i.e. by the operations running in
+ * it - and not by Transaction::isValid(), which may be called from
+ * anywhere.
+ */
+bool TransactionPrivate::isUsable()
+{
+    handleResetRequest();
+    return valid;
+}
+
+/**
+ * @brief Report the transaction if it took too long.
+ *
+ * This is called when the transaction ends. Read-only transactions are
+ * reported if they have been open for too long, write transactions if
+ * committing them took @p commitTime milliseconds or more.
+ */
+void TransactionPrivate::reportIfSlow(qint64 commitTime)
+{
+    if (!lifetime.isValid()) {
+        return;
+    }
+    auto threshold = context.d_ptr->slowOperationThreshold.loadAcquire();
+    Context::SlowOperation operation;
+    operation.transactionId = id;
+    operation.bytesWritten = bytesWritten;
+    operation.steps = 0;
+    if (flags & MDB_RDONLY) {
+        operation.type = Context::SlowOperation::ReadTransaction;
+        operation.duration = lifetime.elapsed();
+    } else {
+        operation.type = Context::SlowOperation::Commit;
+        operation.duration = commitTime;
+    }
+    lifetime.invalidate();
+    if (threshold > 0 && operation.duration >= threshold) {
+        context.d_ptr->reportSlowOperation(operation);
+    }
+}
+
+/**
+ * @brief Commit the LMDB transaction.
+ *
+ * If ContextWatcher objects are attached to the context, they are notified
+ * about committed top-level write transactions. The databases modified
+ * by a nested transaction are handed over to its parent.
+ */
+int TransactionPrivate::commit()
+{
+    if (flags & MDB_RDONLY) {
+        return mdb_txn_commit(txn);
+    }
+    auto ctx = context.d_ptr.data();
+    auto databases = ctx->modifiedDatabases.take(txn);
+    if (parent != nullptr) {
+        auto result = mdb_txn_commit(txn);
+        if (result == Errors::NoError && !databases.isEmpty()) {
+            ctx->modifiedDatabases[parent].unite(databases);
+        }
+        return result;
+    }
+    if (ctx->watcherCount.loadAcquire() == 0) {
+        return mdb_txn_commit(txn);
+    }
+
+    // Hold the lock while committing, so watchers polling for changes
+    // cannot mistake this transaction for one made by another process:
+    QMutexLocker locker(&ctx->watchersLock);
+    auto id = static_cast<quint64>(mdb_txn_id(txn));
+    auto result = mdb_txn_commit(txn);
+    MDB_envinfo info;
+    if (result == Errors::NoError &&
+            mdb_env_info(ctx->env, &info) == Errors::NoError &&
+            static_cast<quint64>(info.me_last_txnid) >= id) {
+        // Note: LMDB does not write anything (and does not use up the ID)
+        // if the transaction did not change anything.
+        QStringList names = databases.values();
+        std::sort(names.begin(), names.end());
+        for (auto watcher : ctx->watchers) {
+            watcher->notifyCommitted(id, names);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Abort the LMDB transaction.
+ */
+void TransactionPrivate::abort()
+{
+    if (!(flags & MDB_RDONLY)) {
+        context.d_ptr->modifiedDatabases.remove(txn);
+    }
+    mdb_txn_abort(txn);
+}
+
+/**
+ * @brief Get a cursor on the @p database for use within the transaction.
+ *
+ * The high level functions in the Database class use this to avoid creating
+ * and destroying an LMDB cursor on each call. The cursor is kept until the
+ * transaction ends. For read-only transactions, it is then handed over to
+ * the context, so a later read-only transaction can renew it instead of
+ * opening a new one.
+ *
+ * Returns a null pointer if no cursor could be created.
+ */
+Cursor *TransactionPrivate::cursor(Transaction &transaction, Database &database)
+{
+    Cursor *result = nullptr;
+    if (isUsable() && database.isValid()) {
+        auto db = database.d_ptr->db;
+        result = cursors.value(db, nullptr);
+        if (result != nullptr) {
+            // Another Database object on the same handle might have been
+            // used before:
+            result->d_ptr->database = database.d_ptr.data();
+        } else {
+            if (flags & MDB_RDONLY) {
+                result = context.d_ptr->takeCursor(db);
+                if (result != nullptr) {
+                    result->d_ptr->database = database.d_ptr.data();
+                    if (!result->renew(transaction)) {
+                        delete result;
+                        result = nullptr;
+                    }
+                }
+            }
+            if (result == nullptr) {
+                result = new Cursor(transaction, database);
+                if (!result->isValid()) {
+                    delete result;
+                    result = nullptr;
+                }
+            }
+            if (result != nullptr) {
+                // The cursor is only used for single operations, so do not
+                // report it as a slow scan:
+                result->d_ptr->scanTime.invalidate();
+                result->d_ptr->generation =
+                        context.d_ptr->cursorGeneration(db);
+                cursors.insert(db, result);
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Close the cached cursor for the database @p db.
+ */
+void TransactionPrivate::releaseCursor(MDB_dbi db)
+{
+    delete cursors.take(db);
+}
+
+/**
+ * @brief Release all cached cursors.
+ *
+ * This must be called before the transaction is committed or aborted.
+ * Cursors of read-only transactions are handed over to the context for
+ * later reuse, the ones of read-write transactions are closed.
+ */
+void TransactionPrivate::releaseCursors()
+{
+    for (auto it = cursors.begin(); it != cursors.end(); ++it) {
+        if (flags & MDB_RDONLY) {
+            // The database might be gone until the cursor is reused, which
+            // sets it again:
+            auto cursor = it.value();
+            cursor->d_ptr->database = nullptr;
+            context.d_ptr->putCursor(it.key(), cursor,
+                                     cursor->d_ptr->generation);
+        } else {
+            delete it.value();
+        }
+    }
+    cursors.clear();
+}
+
 } // namespace QLMDB
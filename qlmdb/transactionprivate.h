@@ -19,25 +19,62 @@
 
 #include "lmdb.h"
 
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QString>
 
 #include "context.h"
 
 namespace QLMDB {
 
+class Cursor;
+class Database;
+class Transaction;
+
 //! @private
 class TransactionPrivate
 {
 public:
-    explicit TransactionPrivate(Context &context);
+    explicit TransactionPrivate(Context &context, unsigned int flags);
 
     Context &context;
     MDB_txn *txn;
+    MDB_txn *parent;
+    unsigned int flags;
     int lastError;
     QString lastErrorString;
     bool valid;
+    QHash<MDB_dbi, Cursor*> cursors;
+
+    // The LMDB transaction ID (0 if the transaction is not valid):
+    quint64 id;
+
+    // Measures the transaction if slow operations are reported:
+    QElapsedTimer lifetime;
+    quint64 bytesWritten;
+
+    // Registration in the context, if transactions are tracked. The stale
+    // flag is guarded by the context's lock:
+    bool tracked;
+    QElapsedTimer age;
+    Qt::HANDLE thread;
+    bool stale;
+    QAtomicInt resetRequested;
+    bool reset;
 
     void handleOpenError();
+    void startLifetime();
+    void track();
+    void untrack();
+    void handleResetRequest();
+    bool isUsable();
+    void reportIfSlow(qint64 commitTime);
+    int commit();
+    void abort();
+    Cursor *cursor(Transaction &transaction, Database &database);
+    void releaseCursor(MDB_dbi db);
+    void releaseCursors();
 };
 
 } // namespace QLMDB
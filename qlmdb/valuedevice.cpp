@@ -0,0 +1,237 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include <QObject>
+
+#include "cursor.h"
+#include "database.h"
+#include "transaction.h"
+#include "valuedevice.h"
+#include "valuedeviceprivate.h"
+
+namespace QLMDB {
+
+/**
+ * @class ValueDevice
+ * @brief Read a stored value via the QIODevice interface without copying it.
+ *
+ * Database::get() and friends return a copy of the value stored, which is
+ * wasteful if the value is only fed into a parser and then thrown away.
+ * A ValueDevice instead reads directly from the memory map LMDB uses:
+ *
+ * ```
+ * Transaction txn(ctx, Transaction::ReadOnly);
+ * ValueDevice device(txn, documents, "doc-1");
+ * if (device.open(QIODevice::ReadOnly)) {
+ *     QXmlStreamReader reader(&device);
+ *     // ...
+ * }
+ * ```
+ *
+ * Parsers which take a byte array instead of a device (like
+ * QJsonDocument::fromJson()) can use data(), which refers to the memory map
+ * as well.
+ *
+ * The device must only be used as long as the Transaction the value has
+ * been read in is active. In write transactions, modifying the database
+ * invalidates the device as well. The device is opened unbuffered, as the
+ * whole value is in memory anyway.
+ */
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a device reading the value the @p cursor currently points to. The
+ * cursor can be moved or destroyed afterwards.
+ */
+ValueDevice::ValueDevice(Cursor &cursor, QObject *parent) :
+    QIODevice(parent),
+    d_ptr(new ValueDevicePrivate)
+{
+    Q_D(ValueDevice);
+    auto current = cursor.current();
+    if (current.isValid()) {
+        d->value = current.value();
+        d->found = true;
+    }
+}
+
+
+/**
+ * @brief Constructor.
+ *
+ * Creates a device reading the value of the @p key in the @p database. The
+ * value is looked up in the given @p transaction.
+ */
+ValueDevice::ValueDevice(Transaction &transaction, Database &database,
+                         const QByteArray &key, QObject *parent) :
+    QIODevice(parent),
+    d_ptr(new ValueDevicePrivate)
+{
+    Q_D(ValueDevice);
+    Cursor cursor(transaction, database);
+    auto item = cursor.findKey(key);
+    if (item.isValid()) {
+        d->value = item.value();
+        d->found = true;
+    }
+}
+
+
+/**
+ * @brief Destructor.
+ */
+ValueDevice::~ValueDevice()
+{
+}
+
+
+/**
+ * @brief Indicates if no value has been found.
+ *
+ * In this case, the device cannot be opened.
+ */
+bool ValueDevice::isNull() const
+{
+    const Q_D(ValueDevice);
+    return !d->found;
+}
+
+
+/**
+ * @brief The value read.
+ *
+ * The returned byte array refers to the memory map, i.e. it is only valid
+ * as long as the device is. Modifying it creates a deep copy.
+ */
+QByteArray ValueDevice::data() const
+{
+    const Q_D(ValueDevice);
+    return d->value;
+}
+
+
+/**
+ * @brief Open the device.
+ *
+ * The @p mode must be QIODevice::ReadOnly. Fails if no value has been found.
+ */
+bool ValueDevice::open(OpenMode mode)
+{
+    Q_D(ValueDevice);
+    if (isOpen() || (mode & WriteOnly) || !(mode & ReadOnly)) {
+        setErrorString(QObject::tr("Values can only be opened for reading"));
+        return false;
+    }
+    if (!d->found) {
+        setErrorString(QObject::tr("No value found"));
+        return false;
+    }
+    d->position = 0;
+    return QIODevice::open(mode | Unbuffered);
+}
+
+
+/**
+ * @brief Close the device.
+ */
+void ValueDevice::close()
+{
+    Q_D(ValueDevice);
+    QIODevice::close();
+    d->position = 0;
+}
+
+
+/**
+ * @brief The size of the value.
+ */
+qint64 ValueDevice::size() const
+{
+    const Q_D(ValueDevice);
+    return d->value.size();
+}
+
+
+/**
+ * @brief Move the device to the position @p pos.
+ */
+bool ValueDevice::seek(qint64 pos)
+{
+    Q_D(ValueDevice);
+    if (pos < 0 || pos > size() || !QIODevice::seek(pos)) {
+        return false;
+    }
+    d->position = pos;
+    return true;
+}
+
+
+/**
+ * @brief Copy up to @p maxSize bytes of the value into @p data.
+ */
+qint64 ValueDevice::readData(char *data, qint64 maxSize)
+{
+    Q_D(ValueDevice);
+    auto length = qMin(maxSize, size() - d->position);
+    if (length <= 0) {
+        return 0;
+    }
+    std::memcpy(data, d->value.constData() + d->position,
+                static_cast<size_t>(length));
+    d->position += length;
+    return length;
+}
+
+
+/**
+ * @brief Copy the rest of the current line, but at most @p maxSize bytes.
+ *
+ * This avoids reading the line byte by byte, which QIODevice does for
+ * unbuffered devices.
+ */
+qint64 ValueDevice::readLineData(char *data, qint64 maxSize)
+{
+    Q_D(ValueDevice);
+    auto length = qMin(maxSize, size() - d->position);
+    if (length <= 0) {
+        return 0;
+    }
+    auto start = d->value.constData() + d->position;
+    auto end = static_cast<const char*>(
+                std::memchr(start, '\n', static_cast<size_t>(length)));
+    if (end != nullptr) {
+        length = end - start + 1;
+    }
+    return readData(data, length);
+}
+
+
+/**
+ * @brief Writing is not supported.
+ */
+qint64 ValueDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+} // namespace QLMDB
@@ -0,0 +1,64 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef VALUEDEVICE_H
+#define VALUEDEVICE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QScopedPointer>
+
+#include "qlmdb_global.h"
+
+namespace QLMDB {
+
+class Cursor;
+class Database;
+class Transaction;
+class ValueDevicePrivate;
+
+class QLMDBSHARED_EXPORT ValueDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit ValueDevice(Cursor &cursor, QObject *parent = nullptr);
+    explicit ValueDevice(Transaction &transaction, Database &database,
+                         const QByteArray &key, QObject *parent = nullptr);
+    ~ValueDevice() override;
+
+    bool isNull() const;
+    QByteArray data() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 readLineData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QScopedPointer<ValueDevicePrivate> d_ptr;
+
+    Q_DECLARE_PRIVATE(ValueDevice)
+};
+
+} // namespace QLMDB
+
+#endif // VALUEDEVICE_H
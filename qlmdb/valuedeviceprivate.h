@@ -0,0 +1,40 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef VALUEDEVICEPRIVATE_H
+#define VALUEDEVICEPRIVATE_H
+
+#include <QByteArray>
+
+#include "valuedevice.h"
+
+namespace QLMDB {
+
+//! @private
+class ValueDevicePrivate
+{
+public:
+    ValueDevicePrivate();
+
+    // Refers to the value in the memory map without owning it:
+    QByteArray value;
+    bool found;
+    qint64 position;
+};
+
+} // namespace QLMDB
+
+#endif // VALUEDEVICEPRIVATE_H
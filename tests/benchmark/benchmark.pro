@@ -0,0 +1,7 @@
+TARGET = tst_core_benchmark_test
+SOURCES += \
+    tst_benchmark_test.cpp
+include(../test.pri)
+
+# The benchmarks take a while, so `make check` does not run them:
+CONFIG -= testcase
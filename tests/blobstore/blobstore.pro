@@ -0,0 +1,4 @@
+TARGET = tst_core_blobstore_test
+SOURCES += \
+    tst_blobstore_test.cpp
+include(../test.pri)
@@ -0,0 +1,256 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/blobstore.h"
+#include "qlmdb/context.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+namespace {
+
+QByteArray pattern(int size, int seed = 0)
+{
+    QByteArray result(size, '\0');
+    for (int i = 0; i < size; ++i) {
+        result[i] = static_cast<char>((i * 7 + seed) % 251);
+    }
+    return result;
+}
+
+} // namespace
+
+class Core_BlobStore_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_BlobStore_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void constructor();
+    void putAndGet();
+    void reader();
+    void writer();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_BlobStore_Test::Core_BlobStore_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_BlobStore_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_BlobStore_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_BlobStore_Test::constructor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    BlobStore store(ctx, "blobs");
+    QVERIFY(store.isValid());
+    QVERIFY(store.database()->isValid());
+    QCOMPARE(store.chunkSize(), BlobStore::DefaultChunkSize);
+    store.setChunkSize(0);
+    QCOMPARE(store.chunkSize(), BlobStore::DefaultChunkSize);
+
+    Context closed;
+    BlobStore invalid(closed, "blobs");
+    QVERIFY(!invalid.isValid());
+    QVERIFY(!invalid.put("foo", "bar"));
+}
+
+void Core_BlobStore_Test::putAndGet()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    BlobStore store(ctx, "blobs");
+    store.setChunkSize(100);
+    auto raw = store.database();
+
+    auto large = pattern(1050);
+    QVERIFY(store.put("large", large));
+    QVERIFY(store.put("small", "hello"));
+    QVERIFY(store.put("empty", QByteArray()));
+    QCOMPARE(store.get("large"), large);
+    QCOMPARE(store.get("small"), QByteArray("hello"));
+    QVERIFY(store.get("empty").isEmpty());
+    QCOMPARE(store.lastError(), Errors::NoError);
+    QCOMPARE(store.size("large"), qint64(1050));
+    QCOMPARE(store.size("empty"), qint64(0));
+    QCOMPARE(store.size("missing"), qint64(-1));
+    QVERIFY(store.get("missing").isNull());
+    QCOMPARE(store.lastError(), Errors::NotFound);
+
+    // One entry per chunk plus the metadata of each blob:
+    QCOMPARE(raw->count(), size_t(11 + 1 + 2 + 1));
+
+    // Overwriting removes the old chunks:
+    auto smaller = pattern(250, 1);
+    QVERIFY(store.put("large", smaller));
+    QCOMPARE(store.get("large"), smaller);
+    QCOMPARE(raw->count(), size_t(3 + 1 + 2 + 1));
+
+    QVERIFY(store.remove("large"));
+    QVERIFY(store.get("large").isNull());
+    QVERIFY(!store.remove("large"));
+    QCOMPARE(store.lastError(), Errors::NotFound);
+    QCOMPARE(raw->count(), size_t(2 + 1));
+
+    // Keys which are prefixes of each other do not interfere:
+    QVERIFY(store.put("smal", "foo"));
+    QVERIFY(store.remove("smal"));
+    QCOMPARE(store.get("small"), QByteArray("hello"));
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(store.put(txn, "large", large));
+        QCOMPARE(store.get(txn, "large"), large);
+        QCOMPARE(store.size(txn, "large"), qint64(1050));
+        txn.abort();
+    }
+    QVERIFY(store.get("large").isNull());
+}
+
+void Core_BlobStore_Test::reader()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    BlobStore store(ctx, "blobs");
+    store.setChunkSize(64);
+    auto data = pattern(1000);
+    QVERIFY(store.put("blob", data));
+
+    {
+        BlobReader reader(store, "missing");
+        QVERIFY(!reader.open(QIODevice::ReadOnly));
+    }
+    {
+        BlobReader reader(store, "blob");
+        QVERIFY(!reader.open(QIODevice::WriteOnly));
+        QVERIFY(reader.open(QIODevice::ReadOnly));
+        QCOMPARE(reader.key(), QByteArray("blob"));
+        QCOMPARE(reader.size(), qint64(1000));
+        QCOMPARE(reader.read(10), data.left(10));
+        QCOMPARE(reader.read(100), data.mid(10, 100));
+        QVERIFY(reader.seek(950));
+        QCOMPARE(reader.read(100), data.mid(950));
+        QVERIFY(reader.atEnd());
+        QVERIFY(reader.seek(0));
+        QCOMPARE(reader.readAll(), data);
+        QVERIFY(!reader.seek(1001));
+
+        // Reading fails if the blob is changed in the meantime:
+        QVERIFY(reader.seek(0));
+        QVERIFY(store.put("blob", pattern(1000, 1)));
+        char buffer[10];
+        QCOMPARE(reader.read(buffer, sizeof(buffer)), qint64(-1));
+        QVERIFY(!reader.errorString().isEmpty());
+    }
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        BlobReader reader(store, txn, "blob");
+        QVERIFY(reader.open(QIODevice::ReadOnly));
+        QCOMPARE(reader.readAll(), pattern(1000, 1));
+    }
+}
+
+void Core_BlobStore_Test::writer()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    BlobStore store(ctx, "blobs");
+    store.setChunkSize(16);
+    auto raw = store.database();
+    QVERIFY(store.put("blob", "old"));
+
+    // Data is written in several transactions, but only visible once
+    // committed:
+    auto data = pattern(100000);
+    {
+        BlobWriter writer(store, "blob");
+        QVERIFY(!writer.open(QIODevice::ReadOnly));
+        QVERIFY(writer.open(QIODevice::WriteOnly));
+        QVERIFY(writer.isSequential());
+        for (int i = 0; i < data.size(); i += 1000) {
+            QCOMPARE(writer.write(data.mid(i, 1000)), qint64(1000));
+        }
+        QVERIFY(raw->count() > 2);
+        QCOMPARE(store.get("blob"), QByteArray("old"));
+        QVERIFY(writer.commit());
+        QVERIFY(!writer.isOpen());
+    }
+    QCOMPARE(store.get("blob"), data);
+    QCOMPARE(raw->count(), size_t(100000 / 16 + 1));
+
+    // Data not committed is discarded:
+    {
+        BlobWriter writer(store, "blob");
+        QVERIFY(writer.open(QIODevice::WriteOnly));
+        QVERIFY(writer.write(pattern(50000, 1)) == 50000);
+    }
+    QCOMPARE(store.get("blob"), data);
+    QCOMPARE(raw->count(), size_t(100000 / 16 + 1));
+
+    // Empty blobs:
+    {
+        BlobWriter writer(store, "empty");
+        QVERIFY(writer.open(QIODevice::WriteOnly));
+        QVERIFY(writer.commit());
+    }
+    QCOMPARE(store.size("empty"), qint64(0));
+
+    // Writers committing in between invalidate others:
+    BlobWriter first(store, "blob");
+    BlobWriter second(store, "blob");
+    QVERIFY(first.open(QIODevice::WriteOnly));
+    QVERIFY(second.open(QIODevice::WriteOnly));
+    QVERIFY(first.write(pattern(20000, 2)) == 20000);
+    QVERIFY(second.write(pattern(100, 3)) == 100);
+    QVERIFY(second.commit());
+    QVERIFY(!first.commit());
+    QCOMPARE(store.get("blob"), pattern(100, 3));
+    QCOMPARE(raw->count(), size_t(7 + 1 + 1));
+}
+
+QTEST_APPLESS_MAIN(Core_BlobStore_Test)
+
+#include "tst_blobstore_test.moc"
@@ -0,0 +1,4 @@
+TARGET = tst_core_changelog_test
+SOURCES += \
+    tst_changelog_test.cpp
+include(../test.pri)
@@ -0,0 +1,289 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/changelog.h"
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_ChangeLog_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_ChangeLog_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void disabled();
+    void databaseWrites();
+    void cursorWrites();
+    void bulkOperations();
+    void abortedTransaction();
+    void readAndTruncate();
+    void writeAfterMissedLookup();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_ChangeLog_Test::Core_ChangeLog_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_ChangeLog_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_ChangeLog_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_ChangeLog_Test::disabled()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(!ctx.enableChangeLog());
+    QVERIFY(ctx.open());
+    QVERIFY(!ctx.isChangeLogEnabled());
+    Database db(ctx, "users");
+    QVERIFY(db.put("alice", "berlin"));
+
+    ChangeLog log(ctx);
+    QVERIFY(log.isValid());
+    QVERIFY(log.read(0).isEmpty());
+    QCOMPARE(log.lastSequence(), quint64(0));
+}
+
+void Core_ChangeLog_Test::databaseWrites()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(3);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.enableChangeLog());
+    QVERIFY(ctx.isChangeLogEnabled());
+    Database db(ctx, "users");
+    Database multiDb(ctx, "tags", Database::Create | Database::MultiValues);
+
+    QVERIFY(db.put("alice", "berlin"));
+    QVERIFY(db.remove("alice"));
+    QVERIFY(!db.remove("bob"));
+    QVERIFY(multiDb.put("alice", "admin"));
+    QVERIFY(multiDb.put("alice", "dev"));
+    QVERIFY(multiDb.remove("alice", "admin"));
+    QVERIFY(db.clear());
+
+    ChangeLog log(ctx);
+    QVERIFY(log.isValid());
+    auto entries = log.read(0);
+    QCOMPARE(entries.length(), 6);
+    for (int i = 0; i < entries.length(); ++i) {
+        QCOMPARE(entries[i].sequence, quint64(i + 1));
+    }
+    QCOMPARE(entries[0].operation, ChangeLog::Put);
+    QCOMPARE(entries[0].database, QString("users"));
+    QCOMPARE(entries[0].key, QByteArray("alice"));
+    QCOMPARE(entries[0].value, QByteArray("berlin"));
+    QCOMPARE(entries[1].operation, ChangeLog::Remove);
+    QCOMPARE(entries[1].key, QByteArray("alice"));
+    QVERIFY(entries[1].value.isNull());
+    QCOMPARE(entries[2].database, QString("tags"));
+    QCOMPARE(entries[3].value, QByteArray("dev"));
+    QCOMPARE(entries[4].operation, ChangeLog::Remove);
+    QCOMPARE(entries[4].database, QString("tags"));
+    QCOMPARE(entries[4].value, QByteArray("admin"));
+    QCOMPARE(entries[5].operation, ChangeLog::Clear);
+    QCOMPARE(entries[5].database, QString("users"));
+    QVERIFY(entries[5].key.isEmpty());
+    QCOMPARE(log.lastSequence(), quint64(6));
+}
+
+void Core_ChangeLog_Test::cursorWrites()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(3);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.enableChangeLog());
+    Database db(ctx, "users");
+    Database multiDb(ctx, "tags", Database::Create | Database::MultiValues);
+
+    {
+        Transaction txn(ctx);
+        Cursor cursor(txn, db);
+        QVERIFY(cursor.put("alice", "berlin"));
+        QVERIFY(cursor.findKey("alice").isValid());
+        QVERIFY(cursor.remove());
+
+        Cursor multiCursor(txn, multiDb);
+        QVERIFY(multiCursor.put("alice", "admin"));
+        QVERIFY(multiCursor.put("alice", "dev"));
+        QVERIFY(multiCursor.findKey("alice").isValid());
+        QVERIFY(multiCursor.remove());
+        QVERIFY(multiCursor.findKey("alice").isValid());
+        QVERIFY(multiCursor.remove(Cursor::NoDuplicateData));
+    }
+
+    ChangeLog log(ctx);
+    auto entries = log.read(1);
+    QCOMPARE(entries.length(), 6);
+    QCOMPARE(entries[0].operation, ChangeLog::Put);
+    QCOMPARE(entries[1].operation, ChangeLog::Remove);
+    QVERIFY(entries[1].value.isNull());
+    QCOMPARE(entries[4].operation, ChangeLog::Remove);
+    QCOMPARE(entries[4].value, QByteArray("admin"));
+    QCOMPARE(entries[5].operation, ChangeLog::Remove);
+    QVERIFY(entries[5].value.isNull());
+}
+
+void Core_ChangeLog_Test::bulkOperations()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.enableChangeLog());
+    Database db(ctx, "users");
+    {
+        Transaction txn(ctx);
+        for (int i = 0; i < 100; ++i) {
+            QVERIFY(db.put(txn, QByteArray::number(100 + i), "x"));
+        }
+    }
+    ChangeLog log(ctx);
+    QCOMPARE(log.lastSequence(), quint64(100));
+
+    QCOMPARE(db.removeRange("100", "150"), size_t(50));
+    QCOMPARE(db.removePrefix("19"), size_t(10));
+    QCOMPARE(db.removePrefix("19"), size_t(0));
+
+    auto entries = log.read(101);
+    QCOMPARE(entries.length(), 2);
+    QCOMPARE(entries[0].operation, ChangeLog::RemoveRange);
+    QCOMPARE(entries[0].key, QByteArray("100"));
+    QCOMPARE(entries[0].value, QByteArray("150"));
+    QCOMPARE(entries[1].operation, ChangeLog::RemovePrefix);
+    QCOMPARE(entries[1].key, QByteArray("19"));
+    QVERIFY(entries[1].value.isNull());
+}
+
+void Core_ChangeLog_Test::abortedTransaction()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.enableChangeLog());
+    Database db(ctx, "users");
+    ChangeLog log(ctx);
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.put(txn, "alice", "berlin"));
+        QCOMPARE(log.lastSequence(txn), quint64(1));
+        QCOMPARE(log.read(txn, 0).length(), 1);
+        txn.abort();
+    }
+    QCOMPARE(log.lastSequence(), quint64(0));
+
+    QVERIFY(db.put("bob", "paris"));
+    auto entries = log.read(0);
+    QCOMPARE(entries.length(), 1);
+    QCOMPARE(entries[0].sequence, quint64(1));
+    QCOMPARE(entries[0].key, QByteArray("bob"));
+}
+
+void Core_ChangeLog_Test::readAndTruncate()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.enableChangeLog());
+    Database db(ctx, "users");
+    ChangeLog log(ctx);
+    for (int i = 0; i < 10; ++i) {
+        QVERIFY(db.put(QByteArray::number(i), "x"));
+    }
+
+    auto entries = log.read(4, 3);
+    QCOMPARE(entries.length(), 3);
+    QCOMPARE(entries[0].sequence, quint64(4));
+    QCOMPARE(entries[2].key, QByteArray("5"));
+    QVERIFY(log.read(11).isEmpty());
+    QCOMPARE(log.lastError(), Errors::NoError);
+
+    // Truncating is not logged itself:
+    QCOMPARE(log.truncate(6), size_t(5));
+    QCOMPARE(log.read(0).first().sequence, quint64(6));
+    QCOMPARE(log.lastSequence(), quint64(10));
+
+    // The last entry is kept, so sequence numbers are not reused:
+    QCOMPARE(log.truncate(100), size_t(4));
+    QCOMPARE(log.read(0).length(), 1);
+    QVERIFY(db.put("a", "x"));
+    QCOMPARE(log.lastSequence(), quint64(11));
+}
+
+void Core_ChangeLog_Test::writeAfterMissedLookup()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.enableChangeLog());
+    Database db(ctx, "users");
+
+    {
+        // A failed lookup must not affect the following writes:
+        Transaction txn(ctx);
+        QVERIFY(db.get(txn, "alice").isNull());
+        QCOMPARE(db.lastError(), Errors::NotFound);
+        QVERIFY(db.put(txn, "alice", "berlin"));
+        QVERIFY(db.get(txn, "bob").isNull());
+        QVERIFY(db.remove(txn, "alice"));
+
+        Cursor cursor(txn, db);
+        QVERIFY(!cursor.findKey("bob").isValid());
+        QVERIFY(cursor.put("bob", "paris"));
+    }
+    QCOMPARE(db.get("bob"), QByteArray("paris"));
+
+    ChangeLog log(ctx);
+    auto entries = log.read(0);
+    QCOMPARE(entries.length(), 3);
+    QCOMPARE(entries[0].operation, ChangeLog::Put);
+    QCOMPARE(entries[1].operation, ChangeLog::Remove);
+    QCOMPARE(entries[2].key, QByteArray("bob"));
+}
+
+QTEST_APPLESS_MAIN(Core_ChangeLog_Test)
+
+#include "tst_changelog_test.moc"
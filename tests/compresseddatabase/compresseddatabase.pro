@@ -0,0 +1,4 @@
+TARGET = tst_core_compresseddatabase_test
+SOURCES += \
+    tst_compresseddatabase_test.cpp
+include(../test.pri)
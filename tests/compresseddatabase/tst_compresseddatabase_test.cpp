@@ -0,0 +1,262 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/codec.h"
+#include "qlmdb/compresseddatabase.h"
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+// A codec which strips trailing 'x' characters, for testing purposes:
+class TrimCodec : public Codec
+{
+public:
+    quint8 id() const override { return 42; }
+
+    bool encode(const QByteArray &value, QByteArray &result) const override
+    {
+        int count = 0;
+        while (count < 255 && count < value.size() &&
+               value.at(value.size() - 1 - count) == 'x') {
+            ++count;
+        }
+        result = QByteArray(1, static_cast<char>(count)) +
+                value.left(value.size() - count);
+        return true;
+    }
+
+    bool decode(const QByteArray &data, QByteArray &result) const override
+    {
+        if (data.isEmpty()) {
+            return false;
+        }
+        result = data.mid(1) +
+                QByteArray(static_cast<quint8>(data.at(0)), 'x');
+        return true;
+    }
+};
+
+// Uses the ID reserved for values stored as is:
+class ReservedIdCodec : public TrimCodec
+{
+public:
+    quint8 id() const override { return 0; }
+};
+
+class Core_CompressedDatabase_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_CompressedDatabase_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void constructor();
+    void putAndGet();
+    void cursor();
+    void codecs();
+    void reservedCodecId();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_CompressedDatabase_Test::Core_CompressedDatabase_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_CompressedDatabase_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_CompressedDatabase_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_CompressedDatabase_Test::constructor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    CompressedDatabase db(ctx, "documents");
+    QVERIFY(db.isValid());
+    QVERIFY(db.database()->isValid());
+    QCOMPARE(db.codec()->id(), ZlibCodec::Id);
+    QCOMPARE(db.threshold(), CompressedDatabase::DefaultThreshold);
+
+    Context closed;
+    CompressedDatabase invalid(closed, "documents");
+    QVERIFY(!invalid.isValid());
+    QVERIFY(!invalid.put("foo", "bar"));
+}
+
+void Core_CompressedDatabase_Test::putAndGet()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    CompressedDatabase db(ctx, "documents");
+
+    QByteArray json;
+    for (int i = 0; i < 100; ++i) {
+        json += "{\"id\": " + QByteArray::number(i) + ", \"name\": \"foo\"},";
+    }
+    QByteArray noise;
+    quint32 state = 1;
+    for (int i = 0; i < 1000; ++i) {
+        state = state * 1103515245 + 12345;
+        noise.append(static_cast<char>(state >> 24));
+    }
+
+    QVERIFY(db.put("small", "hello"));
+    QVERIFY(db.put("json", json));
+    QVERIFY(db.put("noise", noise));
+    QVERIFY(db.put("empty", QByteArray()));
+    QCOMPARE(db.get("small"), QByteArray("hello"));
+    QCOMPARE(db.get("json"), json);
+    QCOMPARE(db.get("noise"), noise);
+    QVERIFY(db.get("empty").isEmpty());
+    QCOMPARE(db.lastError(), Errors::NoError);
+    QVERIFY(db.get("missing").isNull());
+    QCOMPARE(db.lastError(), Errors::NotFound);
+
+    // Small and incompressible values are stored as is, others compressed:
+    auto raw = db.database();
+    QCOMPARE(raw->get("small"), QByteArray("\0hello", 6));
+    QCOMPARE(raw->get("noise").at(0), '\0');
+    QCOMPARE(raw->get("noise").size(), noise.size() + 1);
+    QCOMPARE(static_cast<quint8>(raw->get("json").at(0)), ZlibCodec::Id);
+    QVERIFY(raw->get("json").size() < json.size() / 4);
+
+    db.setThreshold(1);
+    QVERIFY(db.put("small", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"));
+    QCOMPARE(static_cast<quint8>(raw->get("small").at(0)), ZlibCodec::Id);
+
+    QVERIFY(db.remove("json"));
+    QVERIFY(db.get("json").isNull());
+    QVERIFY(!db.remove("json"));
+    QCOMPARE(db.lastError(), Errors::NotFound);
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.put(txn, "json", json));
+        QCOMPARE(db.get(txn, "json"), json);
+        txn.abort();
+    }
+    QVERIFY(db.get("json").isNull());
+}
+
+void Core_CompressedDatabase_Test::cursor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    CompressedDatabase db(ctx, "documents");
+    db.setThreshold(1);
+
+    {
+        Transaction txn(ctx);
+        Cursor cursor(txn, *db.database());
+        for (int i = 0; i < 10; ++i) {
+            QVERIFY(cursor.put(QByteArray::number(i),
+                               db.encode(QByteArray(100, 'a' + i))));
+        }
+    }
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        Cursor cursor(txn, *db.database());
+        int count = 0;
+        for (auto item = cursor.first(); item.isValid();
+             item = cursor.next()) {
+            QCOMPARE(db.decode(item.value()), QByteArray(100, 'a' + count));
+            ++count;
+        }
+        QCOMPARE(count, 10);
+    }
+    QVERIFY(db.decode(QByteArray()).isNull());
+    QCOMPARE(db.lastError(), Errors::Corrupted);
+}
+
+void Core_CompressedDatabase_Test::codecs()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    QByteArray value(200, 'x');
+    value[0] = 'a';
+    {
+        CompressedDatabase db(ctx, "documents",
+                              QSharedPointer<Codec>(new TrimCodec));
+        QCOMPARE(db.codec()->id(), quint8(42));
+        QVERIFY(db.put("trimmed", value));
+        QCOMPARE(db.get("trimmed"), value);
+        QCOMPARE(db.database()->get("trimmed").at(0), '\x2a');
+    }
+
+    CompressedDatabase db(ctx, "documents");
+    QVERIFY(db.get("trimmed").isNull());
+    QCOMPARE(db.lastError(), Errors::InvalidParameter);
+    QVERIFY(db.addCodec(QSharedPointer<Codec>(new TrimCodec)));
+    QCOMPARE(db.get("trimmed"), value);
+
+    // New values use the codec passed to the constructor:
+    QVERIFY(db.put("zlib", value));
+    QCOMPARE(static_cast<quint8>(db.database()->get("zlib").at(0)),
+             ZlibCodec::Id);
+}
+
+void Core_CompressedDatabase_Test::reservedCodecId()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    QSharedPointer<Codec> reserved(new ReservedIdCodec);
+
+    CompressedDatabase invalid(ctx, "documents", reserved);
+    QVERIFY(!invalid.isValid());
+    QCOMPARE(invalid.lastError(), Errors::InvalidParameter);
+    QVERIFY(!invalid.put("foo", QByteArray(200, 'x')));
+
+    CompressedDatabase db(ctx, "documents");
+    QVERIFY(db.isValid());
+    QVERIFY(!db.addCodec(reserved));
+    QCOMPARE(db.lastError(), Errors::InvalidParameter);
+    QVERIFY(!db.addCodec(QSharedPointer<Codec>()));
+    QVERIFY(db.put("raw", "foo"));
+    QCOMPARE(db.get("raw"), QByteArray("foo"));
+}
+
+QTEST_APPLESS_MAIN(Core_CompressedDatabase_Test)
+
+#include "tst_compresseddatabase_test.moc"
@@ -14,12 +14,20 @@
  * You should have received a copy of the GNU General Public License
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <QMutex>
 #include <QString>
 #include <QTemporaryDir>
+#include <QThread>
 #include <QtTest>
 
+#include <thread>
+
 #include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
 #include "qlmdb/errors.h"
+#include "qlmdb/scopedaccesspattern.h"
+#include "qlmdb/transaction.h"
 
 using namespace QLMDB;
 
@@ -37,6 +45,12 @@ private Q_SLOTS:
     void open();
     void open_with_empty_path();
     void clearLastError();
+    void database();
+    void slowOperations();
+    void activeTransactions();
+    void watchdog();
+    void warmup();
+    void accessPattern();
 
 private:
 
@@ -91,6 +105,333 @@ void Core_Context_Test::clearLastError()
     QVERIFY(context.lastErrorString().isEmpty());
 }
 
+void Core_Context_Test::database()
+{
+    {
+        Context context;
+        QVERIFY(context.database() == nullptr);
+    }
+
+    Context context;
+    context.setPath(tmpDir->path());
+    context.setMaxDBs(2);
+    QVERIFY(context.open());
+
+    auto db = context.database();
+    QVERIFY(db != nullptr);
+    QVERIFY(db->isValid());
+    QCOMPARE(context.database(), db);
+
+    auto test = context.database("test");
+    QVERIFY(test != nullptr);
+    QVERIFY(test != db);
+    QCOMPARE(context.database("test"), test);
+    QVERIFY(test->put("foo", "bar"));
+
+    {
+        // Looking up an opened database must not need the writer lock:
+        Transaction txn(context);
+        QCOMPARE(context.database("test"), test);
+        QCOMPARE(test->get(txn, QByteArray("foo")), QByteArray("bar"));
+    }
+
+    QVERIFY(context.database("missing", 0) == nullptr);
+    QVERIFY(context.database("missing", 0) == nullptr);
+
+    {
+        // Other objects share the handle without closing it:
+        Database other(context, "test");
+        QVERIFY(other.isValid());
+        QCOMPARE(other.get("foo"), QByteArray("bar"));
+    }
+    QCOMPARE(test->get("foo"), QByteArray("bar"));
+    QVERIFY(test->put("bar", "baz"));
+
+    // Dropping the database via another object invalidates all of them:
+    Database other(context, "test");
+    QVERIFY(other.drop());
+    QVERIFY(!other.isValid());
+    QVERIFY(!test->isValid());
+    auto recreated = context.database("test");
+    QVERIFY(recreated != nullptr);
+    QVERIFY(recreated->isValid());
+    QVERIFY(recreated->get("foo").isNull());
+    QCOMPARE(context.database("test"), recreated);
+}
+
+void Core_Context_Test::slowOperations()
+{
+    Context context;
+    context.setPath(tmpDir->path());
+    context.setMaxDBs(1);
+    QVERIFY(context.open());
+    Database db(context, "slow");
+    QCOMPARE(context.slowOperationThreshold(), 0);
+
+    QList<Context::SlowOperation> reports;
+    context.setSlowOperationHandler(
+                [&](const Context::SlowOperation &operation) {
+        reports << operation;
+    });
+
+    // Nothing is reported unless a threshold is set:
+    {
+        Transaction txn(context, Transaction::ReadOnly);
+        QThread::msleep(30);
+    }
+    QVERIFY(reports.isEmpty());
+
+    context.setSlowOperationThreshold(20);
+    QCOMPARE(context.slowOperationThreshold(), 20);
+    {
+        Transaction txn(context);
+        QVERIFY(db.put(txn, "foo", "bar"));
+        QVERIFY(txn.commit());
+        Transaction fast(context, Transaction::ReadOnly);
+        QCOMPARE(db.get(fast, "foo"), QByteArray("bar"));
+    }
+    QVERIFY(reports.isEmpty());
+
+    {
+        Transaction txn(context, Transaction::ReadOnly);
+        Cursor cursor(txn, db);
+        QVERIFY(cursor.first().isValid());
+        QVERIFY(!cursor.next().isValid());
+        QThread::msleep(30);
+    }
+    QCOMPARE(reports.size(), 2);
+    QCOMPARE(reports.at(0).type, Context::SlowOperation::CursorScan);
+    QCOMPARE(reports.at(0).database, QString("slow"));
+    QCOMPARE(reports.at(0).steps, Q_UINT64_C(2));
+    QVERIFY(reports.at(0).duration >= 20);
+    QCOMPARE(reports.at(1).type, Context::SlowOperation::ReadTransaction);
+    QVERIFY(reports.at(1).duration >= 20);
+    QCOMPARE(reports.at(1).transactionId, reports.at(0).transactionId);
+
+    // Without a handler, reports are logged:
+    reports.clear();
+    context.setSlowOperationHandler(nullptr);
+    {
+        Transaction txn(context, Transaction::ReadOnly);
+        QThread::msleep(30);
+    }
+    QVERIFY(reports.isEmpty());
+
+    context.setSlowOperationHandler(
+                [&](const Context::SlowOperation &operation) {
+        reports << operation;
+    });
+    context.setSlowOperationThreshold(0);
+    {
+        Transaction txn(context, Transaction::ReadOnly);
+        QThread::msleep(30);
+    }
+    QVERIFY(reports.isEmpty());
+}
+
+void Core_Context_Test::activeTransactions()
+{
+    Context context;
+    context.setPath(tmpDir->path());
+    QVERIFY(context.open());
+    QVERIFY(!context.isTransactionTrackingEnabled());
+    {
+        Transaction txn(context, Transaction::ReadOnly);
+        QVERIFY(context.activeTransactions().isEmpty());
+    }
+
+    context.setTransactionTrackingEnabled(true);
+    QVERIFY(context.isTransactionTrackingEnabled());
+    {
+        Transaction reader(context, Transaction::ReadOnly);
+        QThread::msleep(10);
+        QList<Context::TransactionInfo> transactions;
+        Qt::HANDLE writerThread = nullptr;
+        std::thread([&]() {
+            Transaction writer(context);
+            transactions = context.activeTransactions();
+            writerThread = QThread::currentThreadId();
+            writer.abort();
+        }).join();
+        QCOMPARE(transactions.size(), 2);
+        QVERIFY(transactions.at(0).readOnly);
+        QVERIFY(transactions.at(0).age >= 10);
+        QCOMPARE(transactions.at(0).thread, QThread::currentThreadId());
+        QVERIFY(!transactions.at(1).readOnly);
+        QCOMPARE(transactions.at(1).thread, writerThread);
+        QVERIFY(transactions.at(1).transactionId >
+                transactions.at(0).transactionId);
+
+        transactions = context.activeTransactions();
+        QCOMPARE(transactions.size(), 1);
+        QCOMPARE(transactions.at(0).thread, QThread::currentThreadId());
+    }
+    QVERIFY(context.activeTransactions().isEmpty());
+
+    context.setTransactionTrackingEnabled(false);
+    Transaction txn(context, Transaction::ReadOnly);
+    QVERIFY(context.activeTransactions().isEmpty());
+}
+
+void Core_Context_Test::watchdog()
+{
+    Context context;
+    context.setPath(tmpDir->path());
+    context.setMaxDBs(1);
+    QVERIFY(context.open());
+    Database db(context, "watched");
+    QVERIFY(db.put("foo", "bar"));
+
+    QMutex mutex;
+    QList<Context::SlowOperation> reports;
+    auto reportCount = [&]() {
+        QMutexLocker locker(&mutex);
+        return reports.size();
+    };
+    context.setSlowOperationHandler(
+                [&](const Context::SlowOperation &operation) {
+        QMutexLocker locker(&mutex);
+        reports << operation;
+    });
+
+    QVERIFY(!context.isWatchdogRunning());
+    context.startWatchdog(20);
+    QVERIFY(context.isWatchdogRunning());
+    QVERIFY(context.isTransactionTrackingEnabled());
+    {
+        // Write transactions are not reported, old readers only once:
+        Transaction writer(context);
+        QThread::msleep(50);
+        QVERIFY(writer.commit());
+        Transaction reader(context, Transaction::ReadOnly);
+        QTRY_COMPARE(reportCount(), 1);
+        QThread::msleep(50);
+        QCOMPARE(reportCount(), 1);
+        QVERIFY(reader.isValid());
+        QCOMPARE(db.get(reader, "foo"), QByteArray("bar"));
+    }
+    {
+        QMutexLocker locker(&mutex);
+        QCOMPARE(reports.at(0).type, Context::SlowOperation::StaleReader);
+        QVERIFY(reports.at(0).duration >= 20);
+    }
+
+    // Resetting happens when the reader is used the next time, checking
+    // whether it is valid has no effect:
+    context.startWatchdog(20, Context::ResetStaleReaders);
+    {
+        Transaction reader(context, Transaction::ReadOnly);
+        Cursor cursor(reader, db);
+        QVERIFY(cursor.first().isValid());
+        QTRY_COMPARE(reportCount(), 2);
+        QVERIFY(reader.isValid());
+        QCOMPARE(context.activeTransactions().size(), 1);
+        QVERIFY(db.get(reader, "foo").isNull());
+        QVERIFY(!reader.isValid());
+        QCOMPARE(reader.lastError(), Errors::BadTransaction);
+        QVERIFY(!cursor.next().isValid());
+        QCOMPARE(cursor.lastError(), Errors::BadTransaction);
+        QVERIFY(context.activeTransactions().isEmpty());
+    }
+
+    context.stopWatchdog();
+    QVERIFY(!context.isWatchdogRunning());
+    {
+        Transaction reader(context, Transaction::ReadOnly);
+        QThread::msleep(50);
+        QVERIFY(reader.isValid());
+    }
+    QCOMPARE(reportCount(), 2);
+}
+
+void Core_Context_Test::warmup()
+{
+    Context context;
+    QVERIFY(!context.warmup());
+    QCOMPARE(context.lastError(), Errors::InvalidParameter);
+
+    context.setPath(tmpDir->path());
+    context.setMapSize(64 * 1024 * 1024);
+    QVERIFY(context.open());
+    Database db(context);
+    {
+        Transaction txn(context);
+        for (int i = 0; i < 1000; ++i) {
+            QVERIFY(db.put(txn, QByteArray::number(i), QByteArray(4000, 'x')));
+        }
+    }
+
+    quint64 read = 0;
+    quint64 total = 0;
+    QVERIFY(context.warmup(4, [&](quint64 bytesRead, quint64 bytesTotal) {
+        read = bytesRead;
+        total = bytesTotal;
+        return true;
+    }));
+    QCOMPARE(context.lastError(), Errors::NoError);
+    QVERIFY(total >= 4000000);
+    QCOMPARE(read, total);
+
+    QVERIFY(context.warmup());
+
+    // The progress handler can cancel the warmup:
+    QVERIFY(!context.warmup(1, [](quint64, quint64) {
+        return false;
+    }));
+    QCOMPARE(context.lastError(), Errors::NoError);
+}
+
+void Core_Context_Test::accessPattern()
+{
+    {
+        // Without a pattern, NoReadAhead implies random access:
+        Context context;
+        context.setPath(tmpDir->path());
+        context.setFlags(Context::NoReadAhead);
+        QVERIFY(context.open());
+        QCOMPARE(context.accessPattern(), Context::RandomAccess);
+    }
+
+    Context context;
+    context.setPath(tmpDir->path());
+    QCOMPARE(context.accessPattern(), Context::NormalAccess);
+    QVERIFY(context.setAccessPattern(Context::RandomAccess));
+    QVERIFY(context.open());
+    QCOMPARE(context.accessPattern(), Context::RandomAccess);
+    Database db(context);
+    QVERIFY(db.put("foo", "bar"));
+
+#ifdef Q_OS_LINUX
+    QVERIFY(context.setAccessPattern(Context::NormalAccess));
+    QCOMPARE(context.lastError(), Errors::NoError);
+    QCOMPARE(context.accessPattern(), Context::NormalAccess);
+    {
+        ScopedAccessPattern scan(context, Context::SequentialAccess);
+        QVERIFY(scan.isActive());
+        QCOMPARE(context.accessPattern(), Context::SequentialAccess);
+        {
+            ScopedAccessPattern lookups(context, Context::RandomAccess);
+            QCOMPARE(context.accessPattern(), Context::RandomAccess);
+            QCOMPARE(db.get("foo"), QByteArray("bar"));
+        }
+        QCOMPARE(context.accessPattern(), Context::SequentialAccess);
+        scan.restore();
+        QVERIFY(!scan.isActive());
+        QCOMPARE(context.accessPattern(), Context::NormalAccess);
+    }
+    QCOMPARE(context.accessPattern(), Context::NormalAccess);
+
+    // Huge pages for file mappings depend on the kernel configuration:
+    auto hugePages = context.setHugePagesEnabled(true);
+    QCOMPARE(context.isHugePagesEnabled(), hugePages);
+    QVERIFY(context.setHugePagesEnabled(false) || !hugePages);
+#else
+    QVERIFY(!context.setAccessPattern(Context::SequentialAccess));
+    QCOMPARE(context.accessPattern(), Context::RandomAccess);
+#endif
+    QCOMPARE(db.get("foo"), QByteArray("bar"));
+}
+
 QTEST_APPLESS_MAIN(Core_Context_Test)
 
 #include "tst_context_test.moc"
@@ -0,0 +1,4 @@
+TARGET = tst_core_contextwatcher_test
+SOURCES += \
+    tst_contextwatcher_test.cpp
+include(../test.pri)
@@ -0,0 +1,230 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/contextwatcher.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_ContextWatcher_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_ContextWatcher_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void constructor();
+    void committed();
+    void nestedTransactions();
+    void changedExternally();
+    void writeAfterMissedLookup();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_ContextWatcher_Test::Core_ContextWatcher_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_ContextWatcher_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_ContextWatcher_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_ContextWatcher_Test::constructor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ContextWatcher closed(ctx);
+    QVERIFY(!closed.isValid());
+    QCOMPARE(closed.lastTransactionId(), quint64(0));
+
+    QVERIFY(ctx.open());
+    ContextWatcher watcher(ctx);
+    QVERIFY(watcher.isValid());
+    QCOMPARE(watcher.pollInterval(), ContextWatcher::DefaultPollInterval);
+    watcher.setPollInterval(100);
+    QCOMPARE(watcher.pollInterval(), 100);
+    watcher.setPollInterval(0);
+    QCOMPARE(watcher.pollInterval(), 0);
+}
+
+void Core_ContextWatcher_Test::committed()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Database users(ctx, "users");
+    Database tags(ctx, "tags");
+
+    ContextWatcher watcher(ctx);
+    QList<quint64> ids;
+    QList<QStringList> databases;
+    connect(&watcher, &ContextWatcher::committed,
+            [&](quint64 id, const QStringList &names) {
+        ids << id;
+        databases << names;
+    });
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(users.put(txn, "alice", "berlin"));
+        QVERIFY(tags.put(txn, "alice", "admin"));
+        QVERIFY(users.put(txn, "bob", "paris"));
+    }
+    QTRY_COMPARE(ids.length(), 1);
+    QCOMPARE(ids[0], watcher.lastTransactionId());
+    QCOMPARE(databases[0], QStringList({"tags", "users"}));
+
+    // Aborted, read-only and empty transactions are not reported:
+    {
+        Transaction txn(ctx);
+        QVERIFY(users.put(txn, "carol", "rome"));
+        txn.abort();
+    }
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        QCOMPARE(users.get(txn, "alice"), QByteArray("berlin"));
+    }
+    {
+        Transaction txn(ctx);
+    }
+    QCoreApplication::processEvents();
+    QCOMPARE(ids.length(), 1);
+
+    QVERIFY(users.remove("alice"));
+    QTRY_COMPARE(ids.length(), 2);
+    QVERIFY(ids[1] > ids[0]);
+    QCOMPARE(databases[1], QStringList({"users"}));
+    QCOMPARE(ids[1], watcher.lastTransactionId());
+
+    // Local commits must not be reported as external changes:
+    int external = 0;
+    connect(&watcher, &ContextWatcher::changedExternally,
+            [&](quint64) { ++external; });
+    watcher.poll();
+    QCOMPARE(external, 0);
+}
+
+void Core_ContextWatcher_Test::nestedTransactions()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(3);
+    QVERIFY(ctx.open());
+    Database users(ctx, "users");
+    Database tags(ctx, "tags");
+    Database cities(ctx, "cities");
+
+    ContextWatcher watcher(ctx);
+    QList<QStringList> databases;
+    connect(&watcher, &ContextWatcher::committed,
+            [&](quint64, const QStringList &names) { databases << names; });
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(users.put(txn, "alice", "berlin"));
+        {
+            Transaction child(txn);
+            QVERIFY(tags.put(child, "alice", "admin"));
+        }
+        {
+            Transaction child(txn);
+            QVERIFY(cities.put(child, "berlin", "alice"));
+            child.abort();
+        }
+    }
+    QTRY_COMPARE(databases.length(), 1);
+    QCOMPARE(databases[0], QStringList({"tags", "users"}));
+}
+
+void Core_ContextWatcher_Test::changedExternally()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    QVERIFY(ctx.open());
+    ContextWatcher watcher(ctx);
+    watcher.setPollInterval(0);
+    QList<quint64> ids;
+    connect(&watcher, &ContextWatcher::changedExternally,
+            [&](quint64 id) { ids << id; });
+
+    // A second context on the same environment acts like another process:
+    {
+        Context other;
+        other.setPath(tmpDir->path());
+        QVERIFY(other.open());
+        Database db(other);
+        QVERIFY(db.put("alice", "berlin"));
+    }
+    watcher.poll();
+    QCOMPARE(ids.length(), 1);
+    QCOMPARE(ids[0], watcher.lastTransactionId());
+    watcher.poll();
+    QCOMPARE(ids.length(), 1);
+}
+
+void Core_ContextWatcher_Test::writeAfterMissedLookup()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    Database users(ctx, "users");
+    ContextWatcher watcher(ctx);
+    QVERIFY(watcher.isValid());
+
+    {
+        // A failed lookup must not affect the following writes:
+        Transaction txn(ctx);
+        QVERIFY(users.get(txn, "alice").isNull());
+        QCOMPARE(users.lastError(), Errors::NotFound);
+        QVERIFY(users.put(txn, "alice", "berlin"));
+        QVERIFY(users.get(txn, "bob").isNull());
+        QVERIFY(users.remove(txn, "alice"));
+
+        Cursor cursor(txn, users);
+        QVERIFY(!cursor.findKey("bob").isValid());
+        QVERIFY(cursor.put("bob", "paris"));
+    }
+    QVERIFY(users.get("alice").isNull());
+    QCOMPARE(users.get("bob"), QByteArray("paris"));
+}
+
+QTEST_GUILESS_MAIN(Core_ContextWatcher_Test)
+
+#include "tst_contextwatcher_test.moc"
@@ -41,6 +41,9 @@ private Q_SLOTS:
     void put();
     void get();
     void remove();
+    void renew();
+    void rawKeys();
+    void valueCount();
 
 private:
     QTemporaryDir *tmpDir;
@@ -256,6 +259,107 @@ void Core_Cursor_Test::remove()
     }
 }
 
+void Core_Cursor_Test::renew()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QVERIFY(db.isValid());
+    QVERIFY(db.put("a", "foo"));
+    QVERIFY(db.put("b", "bar"));
+
+    QScopedPointer<Cursor> cursor;
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        cursor.reset(new Cursor(txn, db));
+        QVERIFY(cursor->isValid());
+        QCOMPARE(cursor->findKey("a"), Cursor::FindResult("a", "foo"));
+    }
+    QVERIFY(db.put("c", "baz"));
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        QVERIFY(cursor->renew(txn));
+        QCOMPARE(cursor->lastError(), Errors::NoError);
+        QCOMPARE(cursor->last(), Cursor::FindResult("c", "baz"));
+        QCOMPARE(cursor->previous(), Cursor::FindResult("b", "bar"));
+    }
+    {
+        Transaction txn(ctx);
+        Cursor writeCursor(txn, db);
+        QVERIFY(writeCursor.isValid());
+        QVERIFY(!writeCursor.renew(txn));
+        QCOMPARE(writeCursor.lastError(), Errors::InvalidParameter);
+        QVERIFY(!cursor->renew(txn));
+        QCOMPARE(cursor->lastError(), Errors::InvalidParameter);
+    }
+}
+
+void Core_Cursor_Test::rawKeys()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    Transaction txn(ctx);
+    Database db(txn, "test", Database::MultiValues | Database::Create);
+    Cursor cursor(txn, db);
+    QVERIFY(cursor.isValid());
+
+    const char buffer[] = "afoo1foo2bbar1";
+    QVERIFY(cursor.put(buffer, 1, buffer + 1, 4));
+    QVERIFY(cursor.put(buffer, 1, buffer + 5, 4));
+    QVERIFY(cursor.put(buffer + 9, 1, buffer + 10, 4));
+    QCOMPARE(cursor.findKey(buffer, 1), Cursor::FindResult("a", "foo1"));
+    QCOMPARE(cursor.find(buffer, 1, buffer + 5, 4),
+             Cursor::FindResult("a", "foo2"));
+    QCOMPARE(cursor.findNearest(buffer + 9, 1, buffer + 10, 4),
+             Cursor::FindResult("b", "bar1"));
+    QCOMPARE(cursor.findFirstAfter(buffer, 2),
+             Cursor::FindResult("b", "bar1"));
+    QCOMPARE(cursor.findKey(buffer + 1, 1), Cursor::FindResult());
+    QCOMPARE(cursor.lastError(), Errors::NotFound);
+
+#ifdef QLMDB_HAS_STRING_VIEW
+    const std::string_view key("c"), value("baz1");
+    QVERIFY(cursor.put(key, value));
+    QCOMPARE(cursor.findKey(key), Cursor::FindResult("c", "baz1"));
+    QCOMPARE(cursor.find(key, value), Cursor::FindResult("c", "baz1"));
+    QCOMPARE(cursor.findFirstAfter(std::string_view("bb")),
+             Cursor::FindResult("c", "baz1"));
+#endif
+}
+
+void Core_Cursor_Test::valueCount()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Transaction txn(ctx);
+    Database db(txn, "single", Database::Create);
+    Database multiDb(txn, "multi", Database::MultiValues | Database::Create);
+
+    Cursor cursor(txn, db);
+    QCOMPARE(cursor.valueCount(), size_t(0));
+    QVERIFY(cursor.lastError() != Errors::NoError);
+    QVERIFY(cursor.put("a", "foo"));
+    QCOMPARE(cursor.findKey("a"), Cursor::FindResult("a", "foo"));
+    QCOMPARE(cursor.valueCount(), size_t(1));
+
+    Cursor multiCursor(txn, multiDb);
+    QVERIFY(multiCursor.put("a", "foo1"));
+    QVERIFY(multiCursor.put("a", "foo2"));
+    QVERIFY(multiCursor.put("a", "foo3"));
+    QVERIFY(multiCursor.put("b", "bar1"));
+    QCOMPARE(multiCursor.findKey("a"), Cursor::FindResult("a", "foo1"));
+    QCOMPARE(multiCursor.valueCount(), size_t(3));
+    QCOMPARE(multiCursor.findKey("b"), Cursor::FindResult("b", "bar1"));
+    QCOMPARE(multiCursor.valueCount(), size_t(1));
+    QCOMPARE(multiCursor.lastError(), Errors::NoError);
+}
+
 QTEST_APPLESS_MAIN(Core_Cursor_Test)
 
 #include "tst_cursor_test.moc"
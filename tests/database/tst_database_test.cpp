@@ -15,13 +15,20 @@
  * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
 #include <QString>
 #include <QTemporaryDir>
 #include <QtTest>
 
 #include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
 #include "qlmdb/database.h"
 #include "qlmdb/errors.h"
+#include "qlmdb/keybuilder.h"
 #include "qlmdb/transaction.h"
 
 using namespace QLMDB;
@@ -46,6 +53,19 @@ private Q_SLOTS:
     void remove();
     void clear();
     void drop();
+    void cursorReuse();
+    void cursorReuseAfterClose();
+    void rawKeys();
+    void customCompare();
+    void builtinCompareFunctions();
+    void openWithoutWriteTransaction();
+    void openWithinReadTransaction();
+    void openConcurrently();
+    void count();
+    void rangeCount();
+    void rangeCountExact();
+    void prefetch();
+    void removeRange();
 
 private:
 
@@ -162,6 +182,7 @@ void Core_Database_Test::get()
     QCOMPARE(db.get("a"), QByteArray("foo"));
     QCOMPARE(db.get<int>(1), QByteArray("Test"));
     QCOMPARE(db.get("b"), QByteArray());
+    QCOMPARE(db.lastError(), Errors::NotFound);
     QCOMPARE(db.get<int>(2), QByteArray());
 
     {
@@ -280,6 +301,15 @@ void Core_Database_Test::remove()
     QVERIFY(mdb.put("a", "foo3"));
     QVERIFY(mdb.remove("a", "foo1"));
     QCOMPARE(mdb.get("a"), QByteArray("foo2"));
+    QVERIFY(!mdb.remove("a", "foo1"));
+    QCOMPARE(mdb.lastError(), Errors::NotFound);
+
+    QVERIFY(db.put("c", "baz"));
+    QVERIFY(!db.remove("c", "foo"));
+    QCOMPARE(db.lastError(), Errors::NotFound);
+    QCOMPARE(db.get("c"), QByteArray("baz"));
+    QVERIFY(db.remove("c", "baz"));
+    QVERIFY(db.get("c").isNull());
 }
 
 void Core_Database_Test::clear()
@@ -334,6 +364,530 @@ void Core_Database_Test::drop()
 
 }
 
+void Core_Database_Test::cursorReuse()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+
+    Database db(ctx);
+    Database mdb(ctx, "multi", Database::MultiValues | Database::Create);
+
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(db.put<int>(i, QByteArray::number(i)));
+        QVERIFY(mdb.put<int>(i % 10, QByteArray::number(i)));
+    }
+    for (int i = 0; i < 100; ++i) {
+        QCOMPARE(db.get<int>(i), QByteArray::number(i));
+        QCOMPARE(mdb.getAll<int>(i % 10).length(), 10);
+    }
+
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        for (int i = 0; i < 100; ++i) {
+            QCOMPARE(db.get<int>(txn, i), QByteArray::number(i));
+            QVERIFY(mdb.getAll<int>(txn, i % 10).contains(QByteArray::number(i)));
+        }
+    }
+
+    {
+        Transaction txn(ctx);
+        for (int i = 0; i < 100; i += 2) {
+            QVERIFY(db.remove<int>(txn, i));
+        }
+        QVERIFY(db.get<int>(txn, 0).isNull());
+        QCOMPARE(db.get<int>(txn, 1), QByteArray("1"));
+    }
+    QVERIFY(db.get<int>(0).isNull());
+    QCOMPARE(db.get<int>(1), QByteArray("1"));
+
+    QVERIFY(mdb.drop());
+    QVERIFY(!mdb.isValid());
+    QCOMPARE(db.get<int>(99), QByteArray("99"));
+}
+
+void Core_Database_Test::cursorReuseAfterClose()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    // Reporting slow cursors reads the database name when reusing cursors:
+    ctx.setSlowOperationThreshold(60000);
+    auto flags = Database::MultiValues | Database::Create;
+    {
+        Database db(ctx, "multi", flags);
+        QVERIFY(db.put("foo", "bar"));
+    }
+
+    // Cursors cached by a transaction might outlive the database:
+    {
+        QScopedPointer<Database> db(new Database(ctx, "multi", flags));
+        Transaction txn(ctx, Transaction::ReadOnly);
+        QCOMPARE(db->getAll(txn, "foo"), QByteArrayList({"bar"}));
+        db.reset();
+    }
+    for (int i = 0; i < 3; ++i) {
+        Database db(ctx, "multi", flags);
+        QCOMPARE(db.getAll("foo").length(), i + 1);
+        QVERIFY(db.put("foo", QByteArray::number(i)));
+    }
+}
+
+void Core_Database_Test::rawKeys()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+
+    Database db(ctx);
+    Database mdb(ctx, "multi", Database::MultiValues | Database::Create);
+    const char buffer[] = "key1value1key2value2";
+
+    QVERIFY(db.put(buffer, 4, buffer + 4, 6));
+    QVERIFY(mdb.put(buffer, 4, buffer + 4, 6));
+    QVERIFY(mdb.put(buffer, 4, buffer + 14, 6));
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.put(txn, buffer + 10, 4, buffer + 14, 6));
+    }
+    QCOMPARE(db.get(buffer, 4), QByteArray("value1"));
+    QCOMPARE(db.get(QByteArray("key2")), QByteArray("value2"));
+    QCOMPARE(mdb.getAll(buffer, 4),
+             QByteArrayList({"value1", "value2"}));
+    QVERIFY(!db.remove(buffer, 4, buffer + 14, 6));
+    QCOMPARE(db.lastError(), Errors::NotFound);
+    QVERIFY(db.remove(buffer, 4, buffer + 4, 6));
+    QVERIFY(db.get(buffer, 4).isNull());
+    QVERIFY(mdb.remove(buffer, 4, buffer + 4, 6));
+    QCOMPARE(mdb.getAll(buffer, 4), QByteArrayList({"value2"}));
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.remove(txn, buffer + 10, 4));
+        QVERIFY(db.get(txn, buffer + 10, 4).isNull());
+    }
+
+#ifdef QLMDB_HAS_STRING_VIEW
+    const std::string_view key("key3"), value("value3");
+    QVERIFY(db.put(key, value));
+    QCOMPARE(db.get(key), QByteArray("value3"));
+    QCOMPARE(db.getAll(key), QByteArrayList({"value3"}));
+    QVERIFY(db.remove(key, value));
+    QVERIFY(db.get(key).isNull());
+#endif
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    const QByteArrayView keyView("key4"), valueView("value4");
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.put(txn, keyView, valueView));
+        QCOMPARE(db.get(txn, keyView), QByteArray("value4"));
+        QVERIFY(db.remove(txn, keyView));
+    }
+    QVERIFY(db.get(keyView).isNull());
+#endif
+}
+
+void Core_Database_Test::customCompare()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+
+    {
+        Database db(ctx, "numbers", Database::Create,
+                    Database::compareUnsignedBigEndian);
+        QVERIFY(db.isValid());
+        QVERIFY(db.put(QByteArray("\x03\x00", 2), "768"));
+        QVERIFY(db.put(QByteArray("\x02", 1), "2"));
+        QVERIFY(db.put(QByteArray("\x00\x00\x01", 3), "1"));
+        QCOMPARE(db.get(QByteArray("\x01", 1)), QByteArray("1"));
+
+        Transaction txn(ctx, Transaction::ReadOnly);
+        Cursor cursor(txn, db);
+        QCOMPARE(cursor.first().value(), QByteArray("1"));
+        QCOMPARE(cursor.next().value(), QByteArray("2"));
+        QCOMPARE(cursor.next().value(), QByteArray("768"));
+    }
+
+    {
+        Database db(ctx, "names", Database::MultiValues | Database::Create,
+                    Database::compareCaseInsensitiveUtf8,
+                    Database::compareCaseInsensitiveUtf8);
+        QVERIFY(db.isValid());
+        QVERIFY(db.put("bob", "b"));
+        QVERIFY(db.put("Alice", "c"));
+        QVERIFY(db.put("alice", "B"));
+        QVERIFY(db.put("alice", "a"));
+
+        Transaction txn(ctx, Transaction::ReadOnly);
+        Cursor cursor(txn, db);
+        QCOMPARE(cursor.first(), Cursor::FindResult("Alice", "c"));
+        QCOMPARE(cursor.next(), Cursor::FindResult("alice", "a"));
+        QCOMPARE(cursor.next(), Cursor::FindResult("alice", "B"));
+        QCOMPARE(cursor.next(), Cursor::FindResult("bob", "b"));
+    }
+}
+
+void Core_Database_Test::builtinCompareFunctions()
+{
+    auto compare = [](Database::CompareFunction fn,
+            const QByteArray &a, const QByteArray &b) {
+        Database::Item itemA = {static_cast<size_t>(a.size()), a.constData()};
+        Database::Item itemB = {static_cast<size_t>(b.size()), b.constData()};
+        return fn(&itemA, &itemB);
+    };
+    auto fromDouble = [](double value) {
+        return QByteArray(reinterpret_cast<const char*>(&value),
+                          sizeof(value));
+    };
+    auto fromFloat = [](float value) {
+        return QByteArray(reinterpret_cast<const char*>(&value),
+                          sizeof(value));
+    };
+
+    QVERIFY(compare(Database::compareUnsignedBigEndian,
+                    QByteArray(), QByteArray("\x00", 1)) == 0);
+    QVERIFY(compare(Database::compareUnsignedBigEndian,
+                    QByteArray("\xFF", 1), QByteArray("\x01\x00", 2)) < 0);
+
+    QList<QByteArray> signedValues = {
+        QByteArray("\x80\x00", 2),         // -32768
+        QByteArray("\xFF\x7F", 2),         // -129
+        QByteArray("\xFF\xFF\x80", 3),    // -128
+        QByteArray("\xFF", 1),              // -1
+        QByteArray(),                       // 0
+        QByteArray("\x01", 1),              // 1
+        QByteArray("\x00\x80", 2),         // 128
+        QByteArray("\x7F\xFF", 2)          // 32767
+    };
+    for (int i = 1; i < signedValues.length(); ++i) {
+        QVERIFY(compare(Database::compareSignedBigEndian,
+                        signedValues[i - 1], signedValues[i]) < 0);
+        QVERIFY(compare(Database::compareSignedBigEndian,
+                        signedValues[i], signedValues[i - 1]) > 0);
+    }
+    QVERIFY(compare(Database::compareSignedBigEndian,
+                    QByteArray("\xFF\xFF", 2), QByteArray("\xFF", 1)) == 0);
+
+    QVERIFY(compare(Database::compareDouble,
+                    fromDouble(-2.5), fromDouble(1.0)) < 0);
+    QVERIFY(compare(Database::compareDouble,
+                    fromDouble(1e10), fromDouble(std::nan(""))) < 0);
+    QVERIFY(compare(Database::compareDouble,
+                    fromDouble(0.0), fromDouble(-0.0)) == 0);
+    QVERIFY(compare(Database::compareFloat,
+                    fromFloat(3.0f), fromFloat(-3.0f)) > 0);
+
+    QVERIFY(compare(Database::compareCaseInsensitiveUtf8, "abc", "ABD") < 0);
+    QVERIFY(compare(Database::compareCaseInsensitiveUtf8, "ab", "ABC") < 0);
+    QVERIFY(compare(Database::compareCaseInsensitiveUtf8, "ABC", "abc") < 0);
+    QVERIFY(compare(Database::compareCaseInsensitiveUtf8,
+                    QString("\u00C4b").toUtf8(),
+                    QString("\u00E4c").toUtf8()) < 0);
+    QVERIFY(compare(Database::compareCaseInsensitiveUtf8,
+                    QString("x\u00E4").toUtf8(), "xb") > 0);
+}
+
+void Core_Database_Test::openWithoutWriteTransaction()
+{
+    {
+        Context ctx;
+        ctx.setPath(tmpDir->path());
+        ctx.setMaxDBs(2);
+        QVERIFY(ctx.open());
+        Database db(ctx, "test");
+        QVERIFY(db.put("foo", "bar"));
+
+        // Opening an existing database must not need the writer lock,
+        // which is held by this thread:
+        Transaction writer(ctx);
+        bool valid = false;
+        bool validWithCreate = false;
+        std::thread thread([&]() {
+            Database readDb(ctx, "test", 0);
+            valid = readDb.isValid();
+            Database createDb(ctx, "test");
+            validWithCreate = createDb.isValid();
+        });
+        thread.join();
+        QVERIFY(valid);
+        QVERIFY(validWithCreate);
+    }
+
+    {
+        Context ctx;
+        ctx.setPath(tmpDir->path());
+        ctx.setMaxDBs(2);
+        ctx.setFlags(Context::ReadOnly);
+        QVERIFY(ctx.open());
+
+        Database db(ctx, "test");
+        QVERIFY(db.isValid());
+        QCOMPARE(db.get("foo"), QByteArray("bar"));
+
+        Database missing(ctx, "missing");
+        QVERIFY(!missing.isValid());
+        QCOMPARE(missing.lastError(), Errors::NotFound);
+
+        Database defaultDb(ctx);
+        QVERIFY(defaultDb.isValid());
+    }
+}
+
+void Core_Database_Test::openWithinReadTransaction()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(3);
+    QVERIFY(ctx.open());
+    {
+        Database db(ctx, "existing");
+        QVERIFY(db.put("foo", "bar"));
+    }
+
+    // This thread cannot start another read transaction, so opening must
+    // fall back to a write transaction:
+    Transaction reader(ctx, Transaction::ReadOnly);
+    QVERIFY(reader.isValid());
+    Database existing(ctx, "existing", 0);
+    QVERIFY(existing.isValid());
+    Database created(ctx, "created");
+    QVERIFY(created.isValid());
+}
+
+void Core_Database_Test::openConcurrently()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(9);
+    QVERIFY(ctx.open());
+    for (int i = 0; i < 4; ++i) {
+        Database db(ctx, QString("db%1").arg(i));
+        QVERIFY(db.isValid());
+    }
+
+    std::atomic<int> valid(0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 8; ++i) {
+        threads.emplace_back([&ctx, &valid, i]() {
+            for (int j = 0; j < 50; ++j) {
+                Database db(ctx, QString("db%1").arg((i + j) % 4), 0);
+                if (db.isValid()) {
+                    ++valid;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    QCOMPARE(valid.load(), 8 * 50);
+}
+
+void Core_Database_Test::count()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QCOMPARE(db.count(), size_t(0));
+    QVERIFY(db.put("a", "foo"));
+    QVERIFY(db.put("b", "bar"));
+    QVERIFY(db.put("b", "baz"));
+    QCOMPARE(db.count(), size_t(2));
+
+    Database multiDb(ctx, "multi", Database::Create | Database::MultiValues);
+    QVERIFY(multiDb.put("a", "foo"));
+    QVERIFY(multiDb.put("b", "bar"));
+    QVERIFY(multiDb.put("b", "baz"));
+    QCOMPARE(multiDb.count(), size_t(3));
+
+    Transaction txn(ctx);
+    QVERIFY(multiDb.remove(txn, "b"));
+    QCOMPARE(multiDb.count(txn), size_t(1));
+}
+
+void Core_Database_Test::rangeCount()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMapSize(64 * 1024 * 1024);
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QCOMPARE(db.rangeCount(QByteArray(), QByteArray()), size_t(0));
+
+    auto key = [](quint32 value) {
+        return KeyBuilder().appendUInt32(value).toByteArray();
+    };
+    {
+        Transaction txn(ctx);
+        for (quint32 i = 0; i < 20000; ++i) {
+            QVERIFY(db.put(txn, key(i * 10), QByteArray()));
+        }
+    }
+
+    // Small ranges are counted exactly:
+    QCOMPARE(db.rangeCount(key(0), key(100)), size_t(10));
+    QCOMPARE(db.rangeCount(key(5), key(101)), size_t(10));
+    QCOMPARE(db.rangeCount(key(199900), QByteArray()), size_t(10));
+    QCOMPARE(db.rangeCount(key(300000), QByteArray()), size_t(0));
+    QCOMPARE(db.rangeCount(key(100), key(100)), size_t(0));
+
+    // Large ranges are estimated:
+    auto all = db.rangeCount(QByteArray(), QByteArray());
+    QCOMPARE(all, size_t(20000));
+    auto half = db.rangeCount(key(0), key(100000));
+    QVERIFY(half >= 9500 && half <= 10500);
+    auto middle = db.rangeCount(key(50000), key(150000));
+    QVERIFY(middle >= 9500 && middle <= 10500);
+    QCOMPARE(db.lastError(), Errors::NoError);
+}
+
+void Core_Database_Test::rangeCountExact()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMapSize(64 * 1024 * 1024);
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+
+    // Integer keys are not ordered like their bytes, so ranges must be
+    // counted exactly:
+    Database integers(ctx, "integers",
+                      Database::Create | Database::IntegerKeys);
+    QVERIFY(integers.isValid());
+    auto integerKey = [](quint32 value) {
+        return QByteArray(reinterpret_cast<const char*>(&value),
+                          sizeof(value));
+    };
+
+    // Keys of varying length, compared as numbers:
+    Database numbers(ctx, "numbers", Database::Create,
+                     Database::compareUnsignedBigEndian);
+    QVERIFY(numbers.isValid());
+    auto numberKey = [](quint32 value) {
+        auto bytes = KeyBuilder().appendUInt32(value).toByteArray();
+        while (bytes.size() > 1 && bytes.at(0) == 0) {
+            bytes.remove(0, 1);
+        }
+        return bytes;
+    };
+
+    {
+        Transaction txn(ctx);
+        for (quint32 i = 0; i < 20000; ++i) {
+            QVERIFY(integers.put(txn, integerKey(i * 10), QByteArray()));
+            QVERIFY(numbers.put(txn, numberKey(i * 10), QByteArray()));
+        }
+    }
+
+    QCOMPARE(integers.rangeCount(integerKey(1000), integerKey(151000)),
+             size_t(15000));
+    QCOMPARE(integers.rangeCount(integerKey(100), QByteArray()),
+             size_t(19990));
+    QCOMPARE(numbers.rangeCount(numberKey(1000), numberKey(151000)),
+             size_t(15000));
+    QCOMPARE(numbers.rangeCount(QByteArray(), numberKey(100000)),
+             size_t(10000));
+    QCOMPARE(numbers.lastError(), Errors::NoError);
+}
+
+void Core_Database_Test::prefetch()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMapSize(64 * 1024 * 1024);
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QCOMPARE(db.prefetch(QByteArray(), QByteArray()), size_t(0));
+    QCOMPARE(db.lastError(), Errors::NoError);
+
+    auto key = [](quint32 value) {
+        return KeyBuilder().appendUInt32(value).toByteArray();
+    };
+    {
+        Transaction txn(ctx);
+        for (quint32 i = 0; i < 1000; ++i) {
+            // Some values span several pages:
+            QVERIFY(db.put(txn, key(i), QByteArray(
+                               static_cast<int>(i % 10 == 0 ? 20000 : 10),
+                               'x')));
+        }
+    }
+
+    QCOMPARE(db.prefetch(QByteArray(), QByteArray()), size_t(1000));
+    QCOMPARE(db.prefetch(key(100), key(200)), size_t(100));
+    QCOMPARE(db.prefetch(key(990), QByteArray()), size_t(10));
+    QCOMPARE(db.prefetch(key(2000), QByteArray()), size_t(0));
+    {
+        Transaction txn(ctx, Transaction::ReadOnly);
+        QCOMPARE(db.prefetch(txn, QByteArray(), key(10)), size_t(10));
+    }
+    QCOMPARE(db.lastError(), Errors::NoError);
+}
+
+void Core_Database_Test::removeRange()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    ctx.setMapSize(64 * 1024 * 1024);
+    QVERIFY(ctx.open());
+    Database db(ctx);
+
+    auto key = [](quint32 prefix, quint32 value) {
+        return KeyBuilder().appendUInt32(prefix).appendUInt32(value)
+                .toByteArray();
+    };
+    {
+        Transaction txn(ctx);
+        for (quint32 prefix = 0; prefix < 3; ++prefix) {
+            for (quint32 i = 0; i < 60000; ++i) {
+                QVERIFY(db.put(txn, key(prefix, i), QByteArray()));
+            }
+        }
+    }
+
+    // Spans more than one chunk:
+    QCOMPARE(db.removeRange(key(0, 10), key(1, 10)), size_t(60000));
+    QCOMPARE(db.lastError(), Errors::NoError);
+    QCOMPARE(db.count(), size_t(120000));
+    QCOMPARE(db.get(key(0, 9)), QByteArray(""));
+    QVERIFY(db.get(key(0, 10)).isNull());
+    QVERIFY(db.get(key(1, 9)).isNull());
+    QCOMPARE(db.get(key(1, 10)), QByteArray(""));
+    QCOMPARE(db.removeRange(key(0, 10), key(1, 10)), size_t(0));
+
+    QCOMPARE(db.removePrefix(KeyBuilder().appendUInt32(2).toByteArray()),
+             size_t(60000));
+    QCOMPARE(db.count(), size_t(60000));
+    QCOMPARE(db.removeRange(key(1, 59990), QByteArray()), size_t(10));
+    QCOMPARE(db.count(), size_t(59990));
+
+    {
+        Transaction txn(ctx);
+        QCOMPARE(db.removeRange(txn, QByteArray(), key(1, 0)), size_t(10));
+        QCOMPARE(db.removePrefix(txn, QByteArray()), size_t(59980));
+        QCOMPARE(db.count(txn), size_t(0));
+        txn.abort();
+    }
+    QCOMPARE(db.count(), size_t(59990));
+
+    Database multiDb(ctx, "multi", Database::Create | Database::MultiValues);
+    QVERIFY(multiDb.put("a", "foo"));
+    QVERIFY(multiDb.put("ab", "bar"));
+    QVERIFY(multiDb.put("ab", "baz"));
+    QVERIFY(multiDb.put("b", "qux"));
+    QCOMPARE(multiDb.removePrefix("a"), size_t(3));
+    QCOMPARE(multiDb.getAll("b"), QByteArrayList({"qux"}));
+    QCOMPARE(multiDb.count(), size_t(1));
+}
+
 QTEST_APPLESS_MAIN(Core_Database_Test)
 
 #include "tst_database_test.moc"
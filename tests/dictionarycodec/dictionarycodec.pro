@@ -0,0 +1,4 @@
+TARGET = tst_core_dictionarycodec_test
+SOURCES += \
+    tst_dictionarycodec_test.cpp
+include(../test.pri)
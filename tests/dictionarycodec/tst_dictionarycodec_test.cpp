@@ -0,0 +1,253 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/compresseddatabase.h"
+#include "qlmdb/context.h"
+#include "qlmdb/database.h"
+#include "qlmdb/dictionarycodec.h"
+#include "qlmdb/errors.h"
+
+using namespace QLMDB;
+
+namespace {
+
+QByteArray record(int i)
+{
+    return "{\"id\": " + QByteArray::number(i) +
+            ", \"type\": \"measurement\", \"sensor\": \"temperature-" +
+            QByteArray::number(i % 7) + "\", \"unit\": \"celsius\", "
+            "\"value\": " + QByteArray::number(i * 37 % 1000) +
+            ", \"location\": {\"building\": \"north\", \"floor\": " +
+            QByteArray::number(i % 5) + "}}";
+}
+
+} // namespace
+
+class Core_DictionaryCodec_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_DictionaryCodec_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void constructor();
+    void train();
+    void versions();
+    void decodeUnknownVersion();
+    void buildDictionary();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_DictionaryCodec_Test::Core_DictionaryCodec_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_DictionaryCodec_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_DictionaryCodec_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_DictionaryCodec_Test::constructor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    DictionaryCodec codec(ctx, "dictionaries");
+    QVERIFY(codec.isValid());
+    QCOMPARE(codec.id(), DictionaryCodec::Id);
+    QCOMPARE(codec.currentVersion(), quint16(0));
+
+    // Without a dictionary, values cannot be encoded:
+    QByteArray result;
+    QVERIFY(!codec.encode(record(1), result));
+    QVERIFY(!codec.addDictionary(QByteArray()));
+    QCOMPARE(codec.lastError(), Errors::InvalidParameter);
+
+    Context closed;
+    DictionaryCodec invalid(closed, "dictionaries");
+    QVERIFY(!invalid.isValid());
+    QVERIFY(!invalid.addDictionary("foo"));
+}
+
+void Core_DictionaryCodec_Test::train()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    auto codec = QSharedPointer<DictionaryCodec>::create(ctx, "dictionaries");
+    CompressedDatabase db(ctx, "records", codec);
+    db.setThreshold(32);
+
+    // Without a dictionary, values are stored as is:
+    for (int i = 0; i < 500; ++i) {
+        QVERIFY(db.put(QByteArray::number(i), record(i)));
+    }
+    QCOMPARE(db.database()->get("1").at(0), '\0');
+
+    QVERIFY(codec->train(db, 100));
+    QCOMPARE(codec->currentVersion(), quint16(1));
+    QVERIFY(!codec->dictionary(1).isEmpty());
+    QVERIFY(codec->dictionary(1).size() <=
+            DictionaryCodec::DefaultDictionarySize);
+
+    // Values compress much better using the dictionary than on their own:
+    auto value = record(1000);
+    QVERIFY(db.put("new", value));
+    auto stored = db.database()->get("new");
+    QCOMPARE(static_cast<quint8>(stored.at(0)), DictionaryCodec::Id);
+    QVERIFY(stored.size() < value.size() / 2);
+    QVERIFY(stored.size() < qCompress(value).size() / 2);
+    QCOMPARE(db.get("new"), value);
+    QCOMPARE(db.get("1"), record(1));
+
+    // A codec with a dictionary compresses values with nothing in common:
+    QByteArray result;
+    QVERIFY(codec->encode(QByteArray(), result));
+    QByteArray decoded("foo");
+    QVERIFY(codec->decode(result, decoded));
+    QVERIFY(decoded.isEmpty());
+}
+
+void Core_DictionaryCodec_Test::versions()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    QByteArrayList samples;
+    for (int i = 0; i < 100; ++i) {
+        samples << record(i);
+    }
+    QByteArray v1;
+    QByteArray v2;
+
+    DictionaryCodec codec(ctx, "dictionaries");
+    QVERIFY(codec.train(samples));
+    QCOMPARE(codec.currentVersion(), quint16(1));
+    QVERIFY(codec.encode(record(1), v1));
+
+    // Other codecs load existing dictionaries on construction or reload:
+    DictionaryCodec other(ctx, "dictionaries");
+    QCOMPARE(other.currentVersion(), quint16(1));
+    QVERIFY(other.addDictionary("\"unit\": \"fahrenheit\""));
+    QCOMPARE(other.currentVersion(), quint16(2));
+    QVERIFY(other.encode(record(2), v2));
+
+    QByteArray result;
+    QVERIFY(!codec.decode(v2, result));
+    QVERIFY(codec.reload());
+    QCOMPARE(codec.currentVersion(), quint16(2));
+    QVERIFY(codec.decode(v2, result));
+    QCOMPARE(result, record(2));
+
+    // Values compressed with older dictionaries can still be read:
+    QVERIFY(other.decode(v1, result));
+    QCOMPARE(result, record(1));
+
+    // Unknown versions and broken data fail:
+    QByteArray broken = v1;
+    broken[0] = '\x7f';
+    QVERIFY(!codec.decode(broken, result));
+    QVERIFY(!codec.decode(v1.left(1), result));
+    QVERIFY(!codec.decode(v1.left(v1.size() - 2), result));
+}
+
+void Core_DictionaryCodec_Test::decodeUnknownVersion()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    QByteArrayList samples;
+    for (int i = 0; i < 100; ++i) {
+        samples << record(i);
+    }
+
+    auto codec = QSharedPointer<DictionaryCodec>::create(ctx, "dictionaries");
+    CompressedDatabase db(ctx, "records", codec);
+    db.setThreshold(32);
+    QVERIFY(codec->train(samples));
+    QVERIFY(db.put("1", record(1)));
+
+    // Values compressed with dictionaries added elsewhere are decoded after
+    // loading them on demand, in the transaction they are read in:
+    auto writerCodec = QSharedPointer<DictionaryCodec>::create(
+                ctx, "dictionaries");
+    CompressedDatabase writer(ctx, "records", writerCodec);
+    writer.setThreshold(32);
+    QVERIFY(writerCodec->addDictionary("\"unit\": \"fahrenheit\""));
+    QVERIFY(writer.put("2", record(2)));
+    QVERIFY(writerCodec->addDictionary("\"unit\": \"kelvin\""));
+    QVERIFY(writer.put("3", record(3)));
+    QCOMPARE(codec->currentVersion(), quint16(1));
+    QCOMPARE(db.get("2"), record(2));
+    QCOMPARE(db.lastError(), Errors::NoError);
+    QCOMPARE(codec->currentVersion(), quint16(3));
+
+    // ... or in a transaction of their own:
+    QVERIFY(writerCodec->addDictionary("\"unit\": \"rankine\""));
+    QVERIFY(writer.put("4", record(4)));
+    auto stored = db.database()->get("4");
+    QCOMPARE(db.decode(stored), record(4));
+    QCOMPARE(codec->currentVersion(), quint16(4));
+
+    // Missing dictionaries are reported as such, broken values as corrupted:
+    stored[1] = '\x7f';
+    QVERIFY(db.database()->put("5", stored));
+    QVERIFY(db.get("5").isNull());
+    QCOMPARE(db.lastError(), Errors::NotFound);
+    stored = db.database()->get("1");
+    QVERIFY(db.database()->put("6", stored.left(stored.size() - 2)));
+    QVERIFY(db.get("6").isNull());
+    QCOMPARE(db.lastError(), Errors::Corrupted);
+}
+
+void Core_DictionaryCodec_Test::buildDictionary()
+{
+    QVERIFY(DictionaryCodec::buildDictionary({}, 1024).isEmpty());
+    QCOMPARE(DictionaryCodec::buildDictionary({"foo", "bar"}, 1024),
+             QByteArray("foobar"));
+
+    QByteArrayList samples;
+    for (int i = 0; i < 1000; ++i) {
+        samples << record(i);
+    }
+    auto dictionary = DictionaryCodec::buildDictionary(samples, 1024);
+    QVERIFY(!dictionary.isEmpty());
+    QVERIFY(dictionary.size() <= 1024);
+    QVERIFY(dictionary.contains("measurement"));
+}
+
+QTEST_APPLESS_MAIN(Core_DictionaryCodec_Test)
+
+#include "tst_dictionarycodec_test.moc"
@@ -0,0 +1,4 @@
+TARGET = tst_core_expiringdatabase_test
+SOURCES += \
+    tst_expiringdatabase_test.cpp
+include(../test.pri)
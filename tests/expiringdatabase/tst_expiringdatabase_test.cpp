@@ -0,0 +1,222 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDateTime>
+#include <QString>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/expiringdatabase.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_ExpiringDatabase_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_ExpiringDatabase_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void constructor();
+    void putAndGet();
+    void remove();
+    void removeExpired();
+    void sweeper();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_ExpiringDatabase_Test::Core_ExpiringDatabase_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_ExpiringDatabase_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_ExpiringDatabase_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_ExpiringDatabase_Test::constructor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+
+    ExpiringDatabase unnamed(ctx, QString());
+    QVERIFY(!unnamed.isValid());
+    QCOMPARE(unnamed.lastError(), Errors::InvalidParameter);
+
+    ExpiringDatabase db(ctx, "test");
+    QVERIFY(db.isValid());
+    QCOMPARE(db.lastError(), Errors::NoError);
+}
+
+void Core_ExpiringDatabase_Test::putAndGet()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    ExpiringDatabase db(ctx, "test");
+
+    QVERIFY(db.put("forever", "foo"));
+    QVERIFY(db.put("later", "bar", 60 * 60 * 1000));
+    QVERIFY(db.put("soon", "baz", 1));
+    QVERIFY(db.put("empty", QByteArray(), 60 * 60 * 1000));
+    QThread::msleep(20);
+
+    QCOMPARE(db.get("forever"), QByteArray("foo"));
+    QCOMPARE(db.get("later"), QByteArray("bar"));
+    QCOMPARE(db.get("empty"), QByteArray(""));
+    QVERIFY(db.get("soon").isNull());
+    QCOMPARE(db.lastError(), Errors::NotFound);
+    QVERIFY(db.get("missing").isNull());
+    QCOMPARE(db.lastError(), Errors::NotFound);
+
+    QVERIFY(!db.expiresAt("forever").isValid());
+    auto expiry = db.expiresAt("later").toMSecsSinceEpoch();
+    auto now = QDateTime::currentMSecsSinceEpoch();
+    QVERIFY(expiry > now && expiry <= now + 60 * 60 * 1000);
+
+    // Overwriting replaces the expiry:
+    QVERIFY(db.put("soon", "qux"));
+    QCOMPARE(db.get("soon"), QByteArray("qux"));
+    QVERIFY(!db.expiresAt("soon").isValid());
+    QVERIFY(db.put("forever", "foo", 1));
+    QThread::msleep(20);
+    QVERIFY(db.get("forever").isNull());
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.put(txn, "txn", "value", 60 * 60 * 1000));
+        QCOMPARE(db.get(txn, "txn"), QByteArray("value"));
+        txn.abort();
+    }
+    QVERIFY(db.get("txn").isNull());
+
+    // Values without an expiry have not been written by an ExpiringDatabase:
+    Database data(ctx, "test");
+    QVERIFY(data.put("short", "abc"));
+    QVERIFY(db.get("short").isNull());
+    QCOMPARE(db.lastError(), Errors::Corrupted);
+    QVERIFY(!db.expiresAt("short").isValid());
+    QCOMPARE(db.lastError(), Errors::Corrupted);
+}
+
+void Core_ExpiringDatabase_Test::remove()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    ExpiringDatabase db(ctx, "test");
+
+    QVERIFY(db.put("a", "foo", 1));
+    QVERIFY(db.put("b", "bar"));
+    QVERIFY(db.remove("a"));
+    QVERIFY(db.remove("b"));
+    QVERIFY(!db.remove("c"));
+    QCOMPARE(db.lastError(), Errors::NotFound);
+
+    Database index(ctx, "test.expiry");
+    QThread::msleep(20);
+    QCOMPARE(index.count(), size_t(0));
+    QCOMPARE(db.removeExpired(), size_t(0));
+}
+
+void Core_ExpiringDatabase_Test::removeExpired()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    ExpiringDatabase db(ctx, "test");
+
+    {
+        Transaction txn(ctx);
+        for (int i = 0; i < 250; ++i) {
+            QVERIFY(db.put(txn, QByteArray::number(i), "expired", 1));
+        }
+        for (int i = 250; i < 300; ++i) {
+            QVERIFY(db.put(txn, QByteArray::number(i), "valid",
+                           60 * 60 * 1000));
+        }
+        QVERIFY(db.put(txn, "forever", "valid"));
+    }
+    QThread::msleep(20);
+
+    {
+        Transaction txn(ctx);
+        QCOMPARE(db.removeExpired(txn, 10), size_t(10));
+    }
+    QCOMPARE(db.removeExpired(100), size_t(240));
+    QCOMPARE(db.lastError(), Errors::NoError);
+    QCOMPARE(db.removeExpired(100), size_t(0));
+
+    Database data(ctx, "test");
+    Database index(ctx, "test.expiry");
+    QCOMPARE(data.count(), size_t(51));
+    QCOMPARE(index.count(), size_t(50));
+    QCOMPARE(db.get("260"), QByteArray("valid"));
+    QCOMPARE(db.get("forever"), QByteArray("valid"));
+}
+
+void Core_ExpiringDatabase_Test::sweeper()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    ExpiringDatabase db(ctx, "test");
+    Database data(ctx, "test");
+
+    QVERIFY(!db.isSweeperRunning());
+    db.startSweeper(10, 16);
+    QVERIFY(db.isSweeperRunning());
+    {
+        Transaction txn(ctx);
+        for (int i = 0; i < 100; ++i) {
+            QVERIFY(db.put(txn, QByteArray::number(i), "value", 1));
+        }
+        QVERIFY(db.put(txn, "forever", "value"));
+    }
+    for (int i = 0; i < 500 && data.count() > 1; ++i) {
+        QThread::msleep(10);
+    }
+    QCOMPARE(data.count(), size_t(1));
+    db.stopSweeper();
+    QVERIFY(!db.isSweeperRunning());
+    QCOMPARE(db.get("forever"), QByteArray("value"));
+}
+
+QTEST_APPLESS_MAIN(Core_ExpiringDatabase_Test)
+
+#include "tst_expiringdatabase_test.moc"
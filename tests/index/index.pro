@@ -0,0 +1,4 @@
+TARGET = tst_core_index_test
+SOURCES += \
+    tst_index_test.cpp
+include(../test.pri)
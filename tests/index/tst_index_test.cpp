@@ -0,0 +1,262 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/index.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_Index_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_Index_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void constructor();
+    void putAndRemove();
+    void cursor();
+    void bulkOperations();
+    void rebuild();
+    void failedUpdate();
+
+private:
+    QTemporaryDir *tmpDir;
+
+    // Values are stored as "city:tag1,tag2,...". The index keys are the
+    // city and the tags:
+    static QByteArrayList cityKey(const QByteArray &key,
+                                  const QByteArray &value);
+    static QByteArrayList tagKeys(const QByteArray &key,
+                                  const QByteArray &value);
+};
+
+Core_Index_Test::Core_Index_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_Index_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_Index_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_Index_Test::constructor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(4);
+    QVERIFY(ctx.open());
+    Database db(ctx, "users");
+
+    Index index(db, "users.city", &Core_Index_Test::cityKey);
+    QVERIFY(index.isValid());
+
+    Index unnamed(db, QString(), &Core_Index_Test::cityKey);
+    QVERIFY(!unnamed.isValid());
+    QCOMPARE(unnamed.lastError(), Errors::InvalidParameter);
+
+    Database multiDb(ctx, "multi", Database::Create | Database::MultiValues);
+    Index multiIndex(multiDb, "multi.city", &Core_Index_Test::cityKey);
+    QVERIFY(!multiIndex.isValid());
+    QCOMPARE(multiIndex.lastError(), Errors::InvalidParameter);
+}
+
+void Core_Index_Test::putAndRemove()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(3);
+    QVERIFY(ctx.open());
+    Database db(ctx, "users");
+    Index byCity(db, "users.city", &Core_Index_Test::cityKey);
+    Index byTag(db, "users.tag", &Core_Index_Test::tagKeys);
+
+    QVERIFY(db.put("alice", "berlin:admin,dev"));
+    QVERIFY(db.put("bob", "paris:dev"));
+    QVERIFY(db.put("carol", "berlin:"));
+    QCOMPARE(byCity.find("berlin"), QByteArrayList({"alice", "carol"}));
+    QCOMPARE(byCity.find("paris"), QByteArrayList({"bob"}));
+    QCOMPARE(byTag.find("dev"), QByteArrayList({"alice", "bob"}));
+    QVERIFY(byTag.find("ops").isEmpty());
+    QCOMPARE(byTag.lastError(), Errors::NotFound);
+
+    // Overwriting only updates changed index keys:
+    QVERIFY(db.put("alice", "paris:dev,ops"));
+    QCOMPARE(byCity.find("berlin"), QByteArrayList({"carol"}));
+    QCOMPARE(byCity.find("paris"), QByteArrayList({"alice", "bob"}));
+    QCOMPARE(byTag.find("admin"), QByteArrayList());
+    QCOMPARE(byTag.find("dev"), QByteArrayList({"alice", "bob"}));
+    QCOMPARE(byTag.find("ops"), QByteArrayList({"alice"}));
+
+    QVERIFY(db.remove("bob"));
+    QCOMPARE(byCity.find("paris"), QByteArrayList({"alice"}));
+    QCOMPARE(byTag.find("dev"), QByteArrayList({"alice"}));
+    QVERIFY(!db.remove("alice", "berlin:"));
+    QVERIFY(db.remove("alice", "paris:dev,ops"));
+    QVERIFY(byCity.find("paris").isEmpty());
+    QVERIFY(byTag.find("ops").isEmpty());
+
+    QCOMPARE(byCity.findRange(QByteArray(), QByteArray()),
+             QByteArrayList({"carol"}));
+
+    {
+        Transaction txn(ctx);
+        QVERIFY(db.put(txn, "dave", "rome:ops"));
+        QCOMPARE(byCity.find(txn, "rome"), QByteArrayList({"dave"}));
+        txn.abort();
+    }
+    QVERIFY(byCity.find("rome").isEmpty());
+}
+
+void Core_Index_Test::cursor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Database db(ctx, "users");
+    Index byCity(db, "users.city", &Core_Index_Test::cityKey);
+
+    {
+        Transaction txn(ctx);
+        Cursor cursor(txn, db);
+        QVERIFY(cursor.put("alice", "berlin:"));
+        QVERIFY(cursor.put("bob", "paris:"));
+        QVERIFY(cursor.findKey("alice").isValid());
+        QVERIFY(cursor.put("alice", "rome:", 0));
+        QVERIFY(cursor.findKey("bob").isValid());
+        QVERIFY(cursor.remove());
+
+        // The index cannot be updated from reserved space:
+        QVERIFY(!cursor.put("carol", QByteArray(10, ' '), Cursor::Reserve));
+        QCOMPARE(cursor.lastError(), Errors::InvalidParameter);
+        QVERIFY(db.get(txn, "carol").isNull());
+    }
+    QVERIFY(byCity.find("berlin").isEmpty());
+    QVERIFY(byCity.find("paris").isEmpty());
+    QCOMPARE(byCity.find("rome"), QByteArrayList({"alice"}));
+}
+
+void Core_Index_Test::bulkOperations()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Database db(ctx, "users");
+    Index byCity(db, "users.city", &Core_Index_Test::cityKey);
+
+    {
+        Transaction txn(ctx);
+        for (int i = 0; i < 1000; ++i) {
+            auto key = QByteArray::number(1000 + i);
+            QVERIFY(db.put(txn, key, "city" + QByteArray::number(i % 10)
+                           + ":"));
+        }
+    }
+    QCOMPARE(byCity.find("city3").length(), 100);
+    QCOMPARE(byCity.findRange("city2", "city4").length(), 200);
+    QCOMPARE(byCity.findRange("city8", QByteArray()).length(), 200);
+
+    QCOMPARE(db.removeRange("1000", "1500"), size_t(500));
+    QCOMPARE(byCity.find("city3").length(), 50);
+    QCOMPARE(byCity.findRange(QByteArray(), QByteArray()).length(), 500);
+    QCOMPARE(db.removePrefix("19"), size_t(100));
+    QCOMPARE(byCity.findRange(QByteArray(), QByteArray()).length(), 400);
+
+    QVERIFY(db.clear());
+    QVERIFY(byCity.findRange(QByteArray(), QByteArray()).isEmpty());
+}
+
+void Core_Index_Test::rebuild()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Database db(ctx, "users");
+    QVERIFY(db.put("alice", "berlin:"));
+    QVERIFY(db.put("bob", "paris:"));
+
+    Index byCity(db, "users.city", &Core_Index_Test::cityKey);
+    QVERIFY(byCity.find("berlin").isEmpty());
+    QVERIFY(byCity.rebuild());
+    QCOMPARE(byCity.find("berlin"), QByteArrayList({"alice"}));
+    QCOMPARE(byCity.find("paris"), QByteArrayList({"bob"}));
+}
+
+void Core_Index_Test::failedUpdate()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(2);
+    QVERIFY(ctx.open());
+    Database db(ctx, "users");
+    Index byCity(db, "users.city", &Core_Index_Test::cityKey);
+
+    // Index keys exceeding LMDB's maximum key size cannot be stored, which
+    // must leave the primary untouched:
+    QVERIFY(db.put("alice", "berlin:"));
+    QVERIFY(!db.put("alice", QByteArray(1024, 'x') + ":"));
+    QCOMPARE(db.get("alice"), QByteArray("berlin:"));
+    QCOMPARE(byCity.find("berlin"), QByteArrayList({"alice"}));
+}
+
+QByteArrayList Core_Index_Test::cityKey(const QByteArray &key,
+                                        const QByteArray &value)
+{
+    Q_UNUSED(key);
+    return QByteArrayList({value.left(value.indexOf(':'))});
+}
+
+QByteArrayList Core_Index_Test::tagKeys(const QByteArray &key,
+                                        const QByteArray &value)
+{
+    Q_UNUSED(key);
+    QByteArrayList result;
+    auto tags = value.mid(value.indexOf(':') + 1);
+    int start = 0;
+    while (start < tags.size()) {
+        auto end = tags.indexOf(',', start);
+        if (end < 0) {
+            end = tags.size();
+        }
+        result << tags.mid(start, end - start);
+        start = end + 1;
+    }
+    return result;
+}
+
+QTEST_APPLESS_MAIN(Core_Index_Test)
+
+#include "tst_index_test.moc"
@@ -0,0 +1,4 @@
+TARGET = tst_core_keybuilder_test
+SOURCES += \
+    tst_keybuilder_test.cpp
+include(../test.pri)
@@ -0,0 +1,280 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <limits>
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/keybuilder.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_KeyBuilder_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_KeyBuilder_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void integers();
+    void floats();
+    void strings();
+    void descending();
+    void reader();
+    void prefixScan();
+
+private:
+    QTemporaryDir *tmpDir;
+
+    static bool lessThan(const KeyBuilder &a, const KeyBuilder &b);
+};
+
+Core_KeyBuilder_Test::Core_KeyBuilder_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_KeyBuilder_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_KeyBuilder_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_KeyBuilder_Test::integers()
+{
+    QList<qint64> values = {
+        std::numeric_limits<qint64>::min(), -1000000, -256, -1, 0, 1, 255,
+        256, 1000000, std::numeric_limits<qint64>::max()
+    };
+    for (int i = 1; i < values.length(); ++i) {
+        KeyBuilder a, b;
+        a.appendInt64(values[i - 1]);
+        b.appendInt64(values[i]);
+        QVERIFY(lessThan(a, b));
+
+        a.clear();
+        b.clear();
+        a.appendInt32(static_cast<qint32>(qBound<qint64>(
+                                              -0x80000000LL, values[i - 1],
+                                              0x7FFFFFFFLL)));
+        b.appendInt32(static_cast<qint32>(qBound<qint64>(
+                                              -0x80000000LL, values[i],
+                                              0x7FFFFFFFLL)));
+        QVERIFY(!lessThan(b, a));
+    }
+
+    KeyBuilder a, b;
+    a.appendUInt32(255);
+    b.appendUInt32(256);
+    QVERIFY(lessThan(a, b));
+    QCOMPARE(a.size(), size_t(4));
+
+    a.clear();
+    b.clear();
+    a.appendUInt64(Q_UINT64_C(0x7FFFFFFFFFFFFFFF));
+    b.appendUInt64(Q_UINT64_C(0x8000000000000000));
+    QVERIFY(lessThan(a, b));
+    QCOMPARE(a.size(), size_t(8));
+}
+
+void Core_KeyBuilder_Test::floats()
+{
+    QList<double> values = {
+        -std::numeric_limits<double>::infinity(), -1e300, -2.5, -1.0,
+        -std::numeric_limits<double>::denorm_min(), 0.0,
+        std::numeric_limits<double>::denorm_min(), 0.5, 1.0, 2.5, 1e300,
+        std::numeric_limits<double>::infinity()
+    };
+    for (int i = 1; i < values.length(); ++i) {
+        KeyBuilder a, b;
+        a.appendDouble(values[i - 1]);
+        b.appendDouble(values[i]);
+        QVERIFY(lessThan(a, b));
+
+        a.clear();
+        b.clear();
+        a.appendFloat(static_cast<float>(values[i - 1]));
+        b.appendFloat(static_cast<float>(values[i]));
+        QVERIFY(!lessThan(b, a));
+    }
+
+    KeyBuilder a, b;
+    a.appendDouble(-0.0);
+    b.appendDouble(0.0);
+    QCOMPARE(a.toByteArray(), b.toByteArray());
+}
+
+void Core_KeyBuilder_Test::strings()
+{
+    QByteArrayList values = {
+        QByteArray(), QByteArray("\0", 1), QByteArray("\0\0", 2),
+        QByteArray("\0a", 2), "a", QByteArray("a\0", 2), "aa", "ab", "b"
+    };
+    for (int i = 1; i < values.length(); ++i) {
+        KeyBuilder a, b;
+        a.appendBytes(values[i - 1]).appendUInt32(0xFFFFFFFF);
+        b.appendBytes(values[i]).appendUInt32(0);
+        QVERIFY(lessThan(a, b));
+    }
+
+    KeyBuilder a, b;
+    a.appendString(QString("abc"));
+    b.appendString(QString("abd"));
+    QVERIFY(lessThan(a, b));
+}
+
+void Core_KeyBuilder_Test::descending()
+{
+    KeyBuilder a, b;
+    a.appendUInt32(1).appendInt64(200, KeyBuilder::Descending);
+    b.appendUInt32(1).appendInt64(100, KeyBuilder::Descending);
+    QVERIFY(lessThan(a, b));
+
+    a.clear();
+    b.clear();
+    a.appendDouble(2.0, KeyBuilder::Descending);
+    b.appendDouble(-2.0, KeyBuilder::Descending);
+    QVERIFY(lessThan(a, b));
+
+    a.clear();
+    b.clear();
+    a.appendBytes("ab", 2, KeyBuilder::Descending).appendUInt32(0);
+    b.appendBytes("a", 1, KeyBuilder::Descending).appendUInt32(0);
+    QVERIFY(lessThan(a, b));
+
+    a.clear();
+    b.clear();
+    a.appendBytes(QByteArray("a\0", 2), KeyBuilder::Descending);
+    b.appendBytes(QByteArray("a"), KeyBuilder::Descending);
+    QVERIFY(lessThan(a, b));
+}
+
+void Core_KeyBuilder_Test::reader()
+{
+    KeyBuilder builder;
+    builder.appendUInt32(42)
+            .appendInt32(-7, KeyBuilder::Descending)
+            .appendUInt64(Q_UINT64_C(1) << 40)
+            .appendInt64(-123456789012LL)
+            .appendFloat(-1.5f)
+            .appendDouble(3.25, KeyBuilder::Descending)
+            .appendBytes(QByteArray("x\0y", 3), KeyBuilder::Descending)
+            .appendString(QString("Hello"));
+
+    KeyReader reader(builder.toByteArray());
+    QCOMPARE(reader.readUInt32(), quint32(42));
+    QCOMPARE(reader.readInt32(KeyBuilder::Descending), qint32(-7));
+    QCOMPARE(reader.readUInt64(), Q_UINT64_C(1) << 40);
+    QCOMPARE(reader.readInt64(), qint64(-123456789012LL));
+    QCOMPARE(reader.readFloat(), -1.5f);
+    QCOMPARE(reader.readDouble(KeyBuilder::Descending), 3.25);
+    QCOMPARE(reader.readBytes(KeyBuilder::Descending),
+             QByteArray("x\0y", 3));
+    QVERIFY(!reader.atEnd());
+    QCOMPARE(reader.readString(), QString("Hello"));
+    QVERIFY(reader.atEnd());
+    QVERIFY(reader.isValid());
+
+    QCOMPARE(reader.readUInt32(), quint32(0));
+    QVERIFY(!reader.isValid());
+
+    KeyReader truncated(builder.data(), 6);
+    QCOMPARE(truncated.readUInt32(), quint32(42));
+    QCOMPARE(truncated.readInt32(), qint32(0));
+    QVERIFY(!truncated.isValid());
+
+    KeyReader unterminated(QByteArray("abc"));
+    QVERIFY(unterminated.readBytes().isNull());
+    QVERIFY(!unterminated.isValid());
+}
+
+void Core_KeyBuilder_Test::prefixScan()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QVERIFY(db.isValid());
+
+    {
+        Transaction txn(ctx);
+        for (quint32 tenant = 0; tenant < 3; ++tenant) {
+            for (qint64 timestamp = -2; timestamp <= 2; ++timestamp) {
+                KeyBuilder key;
+                key.appendUInt32(tenant)
+                        .appendInt64(timestamp, KeyBuilder::Descending);
+                QVERIFY(db.put(txn, key, QByteArray::number(timestamp)));
+            }
+        }
+    }
+
+    Transaction txn(ctx, Transaction::ReadOnly);
+    KeyBuilder prefix;
+    prefix.appendUInt32(1);
+    QCOMPARE(db.get(txn, KeyBuilder(prefix).appendInt64(
+                        0, KeyBuilder::Descending)), QByteArray("0"));
+
+    Cursor cursor(txn, db);
+    QList<qint64> timestamps;
+    for (auto item = cursor.findFirstWithPrefix(prefix); item.isValid();
+         item = cursor.nextWithPrefix(prefix)) {
+        KeyReader reader(item.key());
+        QCOMPARE(reader.readUInt32(), quint32(1));
+        timestamps << reader.readInt64(KeyBuilder::Descending);
+        QVERIFY(reader.atEnd());
+    }
+    QCOMPARE(timestamps, QList<qint64>({2, 1, 0, -1, -2}));
+    QCOMPARE(cursor.lastError(), Errors::NotFound);
+
+    prefix.clear();
+    prefix.appendUInt32(3);
+    QVERIFY(!cursor.findFirstWithPrefix(prefix).isValid());
+    QCOMPARE(cursor.lastError(), Errors::NotFound);
+
+    prefix.clear();
+    int count = 0;
+    for (auto item = cursor.findFirstWithPrefix(prefix); item.isValid();
+         item = cursor.nextWithPrefix(prefix)) {
+        ++count;
+    }
+    QCOMPARE(count, 15);
+}
+
+bool Core_KeyBuilder_Test::lessThan(const KeyBuilder &a, const KeyBuilder &b)
+{
+    auto size = qMin(a.size(), b.size());
+    auto result = std::memcmp(a.data(), b.data(), size);
+    return result < 0 || (result == 0 && a.size() < b.size());
+}
+
+QTEST_APPLESS_MAIN(Core_KeyBuilder_Test)
+
+#include "tst_keybuilder_test.moc"
@@ -0,0 +1,4 @@
+TARGET = tst_core_keyspace_test
+SOURCES += \
+    tst_keyspace_test.cpp
+include(../test.pri)
@@ -0,0 +1,280 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/keyspace.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_Keyspace_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_Keyspace_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void encodeId();
+    void putAndGet();
+    void nested();
+    void scan();
+    void removeRange();
+    void multiValues();
+    void countLarge();
+
+private:
+    QTemporaryDir *tmpDir;
+    Context *context;
+
+    QByteArrayList keys(Keyspace &keyspace, const QByteArray &begin,
+                        const QByteArray &end);
+};
+
+Core_Keyspace_Test::Core_Keyspace_Test() :
+    tmpDir(nullptr),
+    context(nullptr)
+{
+}
+
+void Core_Keyspace_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+    context = new Context();
+    context->setPath(tmpDir->path());
+    context->setMaxDBs(2);
+    QVERIFY(context->open());
+}
+
+void Core_Keyspace_Test::cleanup()
+{
+    delete context;
+    delete tmpDir;
+}
+
+void Core_Keyspace_Test::encodeId()
+{
+    QCOMPARE(Keyspace::encodeId(0), QByteArray(1, '\0'));
+    QCOMPARE(Keyspace::encodeId(1), QByteArray("\x01"));
+    QCOMPARE(Keyspace::encodeId(127), QByteArray("\x7f"));
+    QCOMPARE(Keyspace::encodeId(128), QByteArray("\x80\x01"));
+    QCOMPARE(Keyspace::encodeId(300), QByteArray("\xac\x02"));
+    QCOMPARE(Keyspace::encodeId(Q_UINT64_C(0xffffffffffffffff)),
+             QByteArray(9, '\xff') + QByteArray("\x01"));
+
+    // No encoding may be a prefix of another one:
+    QList<quint64> ids = {0, 1, 127, 128, 255, 256, 16383, 16384,
+                          Q_UINT64_C(1) << 35, Q_UINT64_C(0xffffffffffffffff)};
+    for (auto a : ids) {
+        for (auto b : ids) {
+            if (a != b) {
+                QVERIFY(!Keyspace::encodeId(b).startsWith(
+                            Keyspace::encodeId(a)));
+            }
+        }
+    }
+}
+
+void Core_Keyspace_Test::putAndGet()
+{
+    Database db(*context, "tables");
+    Keyspace a(db, 1);
+    Keyspace b(db, 128);
+    QVERIFY(a.isValid());
+    QCOMPARE(a.database(), &db);
+    QCOMPARE(b.id(), Q_UINT64_C(128));
+    QCOMPARE(b.prefix(), QByteArray("\x80\x01"));
+    QCOMPARE(a.key("foo"), QByteArray("\x01" "foo"));
+
+    QVERIFY(a.put("foo", "a"));
+    QVERIFY(b.put("foo", "b"));
+    QCOMPARE(a.get("foo"), QByteArray("a"));
+    QCOMPARE(b.get("foo"), QByteArray("b"));
+    QCOMPARE(db.get(b.key("foo")), QByteArray("b"));
+    QVERIFY(a.get("bar").isNull());
+    QCOMPARE(a.lastError(), Errors::NotFound);
+    a.clearLastError();
+    QCOMPARE(a.lastError(), Errors::NoError);
+
+    QVERIFY(a.remove("foo"));
+    QVERIFY(a.get("foo").isNull());
+    QCOMPARE(b.get("foo"), QByteArray("b"));
+    QCOMPARE(db.count(), size_t(1));
+
+    {
+        Transaction txn(*context);
+        QVERIFY(a.put(txn, "bar", "1"));
+        QCOMPARE(a.get(txn, "bar"), QByteArray("1"));
+        QVERIFY(txn.commit());
+    }
+    QCOMPARE(a.count(), size_t(1));
+    QCOMPARE(b.count(), size_t(1));
+}
+
+void Core_Keyspace_Test::nested()
+{
+    Database db(*context, "tables");
+    Keyspace tenant1(db, 1);
+    Keyspace tenant2(db, 2);
+    Keyspace orders(tenant1, 1);
+    Keyspace users(tenant1, 2);
+    Keyspace otherOrders(tenant2, 1);
+    QCOMPARE(orders.prefix(), QByteArray("\x01\x01"));
+    QCOMPARE(orders.id(), Q_UINT64_C(1));
+
+    QVERIFY(orders.put("o1", "x"));
+    QVERIFY(users.put("u1", "x"));
+    QVERIFY(otherOrders.put("o1", "y"));
+    QCOMPARE(orders.get("o1"), QByteArray("x"));
+    QCOMPARE(otherOrders.get("o1"), QByteArray("y"));
+    QCOMPARE(tenant1.count(), size_t(2));
+
+    QCOMPARE(tenant1.clear(), size_t(2));
+    QVERIFY(orders.get("o1").isNull());
+    QVERIFY(users.get("u1").isNull());
+    QCOMPARE(otherOrders.get("o1"), QByteArray("y"));
+}
+
+QByteArrayList Core_Keyspace_Test::keys(Keyspace &keyspace,
+                                        const QByteArray &begin,
+                                        const QByteArray &end)
+{
+    QByteArrayList result;
+    keyspace.scan(begin, end, [&](const QByteArray &key, const QByteArray &) {
+        result << QByteArray(key.constData(), key.size());
+        return true;
+    });
+    return result;
+}
+
+void Core_Keyspace_Test::scan()
+{
+    Database db(*context, "tables");
+    Keyspace before(db, 1);
+    Keyspace keyspace(db, 2);
+    Keyspace after(db, 3);
+    QVERIFY(before.put("z", "-"));
+    QVERIFY(after.put("", "-"));
+    QVERIFY(after.put("a", "-"));
+    for (auto key : {"a", "b", "c", "ca", "d"}) {
+        QVERIFY(keyspace.put(key, key));
+    }
+    QVERIFY(keyspace.put("\xff", "ff"));
+    QVERIFY(keyspace.put("\xff\xff", "ffff"));
+
+    QCOMPARE(keys(keyspace, QByteArray(), QByteArray()),
+             QByteArrayList({"a", "b", "c", "ca", "d", "\xff", "\xff\xff"}));
+    QCOMPARE(keys(keyspace, "b", "d"), QByteArrayList({"b", "c", "ca"}));
+    QCOMPARE(keys(keyspace, "c", QByteArray()),
+             QByteArrayList({"c", "ca", "d", "\xff", "\xff\xff"}));
+    QCOMPARE(keyspace.rangeCount("b", "d"), size_t(3));
+
+    QByteArrayList found;
+    QVERIFY(keyspace.scanPrefix("c", [&](const QByteArray &key,
+                                         const QByteArray &value) {
+        found << QByteArray(value.constData(), value.size());
+        return key.startsWith("c");
+    }));
+    QCOMPARE(found, QByteArrayList({"c", "ca"}));
+
+    found.clear();
+    QVERIFY(keyspace.scanPrefix("\xff", [&](const QByteArray &key,
+                                            const QByteArray &) {
+        found << QByteArray(key.constData(), key.size());
+        return true;
+    }));
+    QCOMPARE(found, QByteArrayList({"\xff", "\xff\xff"}));
+
+    found.clear();
+    Transaction txn(*context, Transaction::ReadOnly);
+    QVERIFY(keyspace.scan(txn, QByteArray(), QByteArray(),
+                          [&](const QByteArray &key, const QByteArray &) {
+        found << QByteArray(key.constData(), key.size());
+        return found.size() < 2;
+    }));
+    QCOMPARE(found, QByteArrayList({"a", "b"}));
+}
+
+void Core_Keyspace_Test::removeRange()
+{
+    Database db(*context, "tables");
+    Keyspace before(db, 1);
+    Keyspace keyspace(db, 2);
+    Keyspace after(db, 3);
+    QVERIFY(before.put("z", "-"));
+    QVERIFY(after.put("a", "-"));
+    for (auto key : {"a", "b", "c", "ca", "d"}) {
+        QVERIFY(keyspace.put(key, key));
+    }
+    QCOMPARE(keyspace.removeRange("b", "c"), size_t(1));
+    QCOMPARE(keyspace.removePrefix("c"), size_t(2));
+    QCOMPARE(keyspace.removeRange("c", QByteArray()), size_t(1));
+    QCOMPARE(keys(keyspace, QByteArray(), QByteArray()),
+             QByteArrayList({"a"}));
+    QCOMPARE(keyspace.clear(), size_t(1));
+    QCOMPARE(keyspace.count(), size_t(0));
+    QCOMPARE(before.get("z"), QByteArray("-"));
+    QCOMPARE(after.get("a"), QByteArray("-"));
+    QCOMPARE(db.count(), size_t(2));
+}
+
+void Core_Keyspace_Test::multiValues()
+{
+    Database db(*context, "multi", Database::Create | Database::MultiValues);
+    Keyspace a(db, 1);
+    Keyspace b(db, 2);
+    QVERIFY(a.put("key", "1"));
+    QVERIFY(a.put("key", "2"));
+    QVERIFY(b.put("key", "3"));
+    QCOMPARE(a.getAll("key"), QByteArrayList({"1", "2"}));
+    QVERIFY(a.remove("key", "1"));
+    QCOMPARE(a.getAll("key"), QByteArrayList({"2"}));
+    QCOMPARE(b.getAll("key"), QByteArrayList({"3"}));
+}
+
+void Core_Keyspace_Test::countLarge()
+{
+    Database db(*context);
+    Keyspace a(db, 1);
+    Keyspace b(db, 2);
+    {
+        // Skewed keys, which interpolating would get wrong:
+        Transaction txn(*context);
+        for (int i = 0; i < 10000; ++i) {
+            QVERIFY(a.put(txn, QByteArray::number(i), QByteArray()));
+        }
+        QVERIFY(a.put(txn, "\xff\xff", QByteArray()));
+        QVERIFY(b.put(txn, "x", QByteArray()));
+    }
+    QCOMPARE(a.count(), size_t(10001));
+    QCOMPARE(b.count(), size_t(1));
+    Transaction txn(*context, Transaction::ReadOnly);
+    QCOMPARE(a.count(txn), size_t(10001));
+    QCOMPARE(a.lastError(), Errors::NoError);
+}
+
+QTEST_APPLESS_MAIN(Core_Keyspace_Test)
+
+#include "tst_keyspace_test.moc"
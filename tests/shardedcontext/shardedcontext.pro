@@ -0,0 +1,4 @@
+TARGET = tst_core_shardedcontext_test
+SOURCES += \
+    tst_shardedcontext_test.cpp
+include(../test.pri)
@@ -0,0 +1,261 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QDir>
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/partitioner.h"
+#include "qlmdb/shardedcontext.h"
+#include "qlmdb/shardeddatabase.h"
+
+using namespace QLMDB;
+
+class Core_ShardedContext_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_ShardedContext_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void hashPartitioner();
+    void rangePartitioner();
+    void open();
+    void putAndGet();
+    void batch();
+    void scan();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_ShardedContext_Test::Core_ShardedContext_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_ShardedContext_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_ShardedContext_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_ShardedContext_Test::hashPartitioner()
+{
+    // The hash must never change, otherwise existing data is not found:
+    QCOMPARE(HashPartitioner::hash("", 0), Q_UINT64_C(0xefd01f60ba992926));
+    QCOMPARE(HashPartitioner::hash("foo", 3),
+             Q_UINT64_C(0xaf85ea5569581d4c));
+
+    HashPartitioner partitioner;
+    QCOMPARE(partitioner.shard("foo", 1), 0);
+    QVector<int> counts(4);
+    for (int i = 0; i < 4000; ++i) {
+        auto shard = partitioner.shard(QByteArray::number(i), 4);
+        QVERIFY(shard >= 0 && shard < 4);
+        ++counts[shard];
+    }
+    for (auto count : counts) {
+        QVERIFY(count > 800);
+    }
+}
+
+void Core_ShardedContext_Test::rangePartitioner()
+{
+    RangePartitioner partitioner({"p", "h"});
+    QCOMPARE(partitioner.boundaries(), QByteArrayList({"h", "p"}));
+    QCOMPARE(partitioner.shard("", 3), 0);
+    QCOMPARE(partitioner.shard("a", 3), 0);
+    QCOMPARE(partitioner.shard("h", 3), 1);
+    QCOMPARE(partitioner.shard("hello", 3), 1);
+    QCOMPARE(partitioner.shard("p", 3), 2);
+    QCOMPARE(partitioner.shard("zzz", 3), 2);
+    QCOMPARE(partitioner.shard("zzz", 2), 1);
+}
+
+void Core_ShardedContext_Test::open()
+{
+    ShardedContext ctx(3);
+    QCOMPARE(ctx.shardCount(), 3);
+    QVERIFY(!ctx.isOpen());
+    QVERIFY(!ctx.open());
+    QCOMPARE(ctx.lastError(), Errors::InvalidPath);
+
+    auto path = QDir(tmpDir->path()).filePath("sharded");
+    ctx.setPath(path);
+    ctx.setMaxDBs(2);
+    QCOMPARE(ctx.maxDBs(), 2U);
+    QCOMPARE(ctx.shard(2)->maxDBs(), 2U);
+    QVERIFY(ctx.open());
+    QVERIFY(ctx.isOpen());
+    QVERIFY(ctx.shard(3) == nullptr);
+    for (int i = 0; i < 3; ++i) {
+        QVERIFY(ctx.shard(i)->isOpen());
+        QVERIFY(QDir(QDir(path).filePath(QString("shard-%1").arg(i))).exists());
+    }
+
+    // The number of shards must not change:
+    ShardedContext more(4);
+    more.setPath(path);
+    QVERIFY(!more.open());
+    QCOMPARE(more.lastError(), Errors::Incompatible);
+    QVERIFY(!more.shard(0)->isOpen());
+    ShardedContext same(3);
+    same.setPath(path);
+    QVERIFY(same.open());
+
+    ShardedContext single(0);
+    QCOMPARE(single.shardCount(), 1);
+}
+
+void Core_ShardedContext_Test::putAndGet()
+{
+    ShardedContext ctx(4);
+    ctx.setPath(tmpDir->path());
+    ctx.setMaxDBs(1);
+    QVERIFY(ctx.open());
+    ShardedDatabase db(ctx, "users");
+    QVERIFY(db.isValid());
+
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(db.put("user-" + QByteArray::number(i),
+                       QByteArray::number(i)));
+    }
+    QCOMPARE(db.count(), size_t(100));
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(db.shard(i)->count() > 0);
+    }
+    QCOMPARE(db.get("user-42"), QByteArray("42"));
+    auto shard = db.shard(ctx.shardFor("user-42"));
+    QCOMPARE(shard->get("user-42"), QByteArray("42"));
+    QVERIFY(db.get("missing").isNull());
+    QCOMPARE(db.lastError(), Errors::NotFound);
+    QVERIFY(db.remove("user-42"));
+    QVERIFY(db.get("user-42").isNull());
+    QVERIFY(!db.remove("user-42"));
+    QCOMPARE(db.count(), size_t(99));
+
+    // Each shard only has room for one named database:
+    ShardedDatabase other(ctx, "other");
+    QVERIFY(!other.isValid());
+    QVERIFY(other.lastError() != Errors::NoError);
+
+    // Scanning requires the default key order:
+    ShardedContext ordered(2);
+    ordered.setPath(QDir(tmpDir->path()).filePath("ordered"));
+    ordered.setMaxDBs(1);
+    QVERIFY(ordered.open());
+    ShardedDatabase integers(ordered, "integers",
+                             Database::Create | Database::IntegerKeys);
+    QVERIFY(!integers.isValid());
+    QCOMPARE(integers.lastError(), Errors::InvalidParameter);
+    QVERIFY(ordered.shard(1)->database(
+                "reversed", Database::Create | Database::ReverseKey));
+    ShardedDatabase reversed(ordered, "reversed");
+    QVERIFY(!reversed.isValid());
+    QCOMPARE(reversed.lastError(), Errors::InvalidParameter);
+
+    ShardedContext closed(2);
+    ShardedDatabase invalid(closed);
+    QVERIFY(!invalid.isValid());
+    QVERIFY(!invalid.put("foo", "bar"));
+}
+
+void Core_ShardedContext_Test::batch()
+{
+    ShardedContext ctx(4);
+    ctx.setPath(tmpDir->path());
+    QVERIFY(ctx.open());
+    ShardedDatabase db(ctx);
+
+    QList<QPair<QByteArray, QByteArray>> items;
+    for (int i = 0; i < 1000; ++i) {
+        items << qMakePair(QByteArray::number(i), QByteArray(100, 'x'));
+    }
+    QVERIFY(db.put(items));
+    QCOMPARE(db.count(), size_t(1000));
+    QCOMPARE(db.get("999"), QByteArray(100, 'x'));
+    QVERIFY(db.put(QList<QPair<QByteArray, QByteArray>>()));
+}
+
+void Core_ShardedContext_Test::scan()
+{
+    QSharedPointer<Partitioner> range(
+                new RangePartitioner({"k-3", "k-6"}));
+    for (auto hashed : {false, true}) {
+        // A null partitioner selects the HashPartitioner:
+        ShardedContext ctx(3, hashed ? QSharedPointer<Partitioner>() : range);
+        ctx.setPath(QDir(tmpDir->path()).filePath(hashed ? "hash" : "range"));
+        QVERIFY(ctx.open());
+        ShardedDatabase db(ctx);
+        QByteArrayList expected;
+        for (int i = 0; i < 100; ++i) {
+            auto key = "k-" + QByteArray::number(i);
+            expected << key;
+            QVERIFY(db.put(key, QByteArray::number(i)));
+        }
+        std::sort(expected.begin(), expected.end());
+
+        QByteArrayList keys;
+        QVERIFY(db.scan(QByteArray(), QByteArray(),
+                        [&](const QByteArray &key, const QByteArray &value) {
+            keys << QByteArray(key.constData(), key.size());
+            return key.mid(2) == value;
+        }));
+        QCOMPARE(keys, expected);
+
+        keys.clear();
+        QVERIFY(db.scan("k-2", "k-3",
+                        [&](const QByteArray &key, const QByteArray &) {
+            keys << QByteArray(key.constData(), key.size());
+            return true;
+        }));
+        QCOMPARE(keys.size(), 11);
+        QCOMPARE(keys.first(), QByteArray("k-2"));
+        QCOMPARE(keys.last(), QByteArray("k-29"));
+
+        keys.clear();
+        QVERIFY(db.scanPrefix("k-5",
+                              [&](const QByteArray &key, const QByteArray &) {
+            keys << QByteArray(key.constData(), key.size());
+            return true;
+        }));
+        QCOMPARE(keys.size(), 11);
+
+        keys.clear();
+        QVERIFY(db.scan(QByteArray(), QByteArray(),
+                        [&](const QByteArray &key, const QByteArray &) {
+            keys << QByteArray(key.constData(), key.size());
+            return keys.size() < 5;
+        }));
+        QCOMPARE(keys, expected.mid(0, 5));
+    }
+}
+
+QTEST_APPLESS_MAIN(Core_ShardedContext_Test)
+
+#include "tst_shardedcontext_test.moc"
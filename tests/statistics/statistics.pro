@@ -0,0 +1,4 @@
+TARGET = tst_core_statistics_test
+SOURCES += \
+    tst_statistics_test.cpp
+include(../test.pri)
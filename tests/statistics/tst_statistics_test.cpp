@@ -0,0 +1,270 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QTemporaryDir>
+#include <QThread>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/statistics.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+class Core_Statistics_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_Statistics_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void buckets();
+    void percentile();
+    void disabled();
+    void operations();
+    void threads();
+    void prometheus();
+
+private:
+    QTemporaryDir *tmpDir;
+    Context *context;
+};
+
+Core_Statistics_Test::Core_Statistics_Test() :
+    tmpDir(nullptr),
+    context(nullptr)
+{
+}
+
+void Core_Statistics_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+    context = new Context();
+    context->setPath(tmpDir->path());
+    QVERIFY(context->open());
+}
+
+void Core_Statistics_Test::cleanup()
+{
+    delete context;
+    delete tmpDir;
+}
+
+void Core_Statistics_Test::buckets()
+{
+    QCOMPARE(Statistics::bucket(0), 0);
+    QCOMPARE(Statistics::bucket(3), 3);
+    QCOMPARE(Statistics::bucket(4), 4);
+    QCOMPARE(Statistics::bucket(7), 7);
+    QCOMPARE(Statistics::bucket(8), 8);
+    QCOMPARE(Statistics::bucket(9), 8);
+    QCOMPARE(Statistics::bucket(10), 9);
+    QCOMPARE(Statistics::bucket(Q_UINT64_C(0xffffffffffffffff)),
+             Statistics::BucketCount - 1);
+
+    // Each value lies below the upper bound of its bucket and at or above
+    // the one of the previous bucket:
+    for (quint64 value : {Q_UINT64_C(1), Q_UINT64_C(5), Q_UINT64_C(1000),
+                          Q_UINT64_C(123456), Q_UINT64_C(1000000000)}) {
+        auto bucket = Statistics::bucket(value);
+        QVERIFY(value < Statistics::bucketUpperBound(bucket));
+        QVERIFY(value >= Statistics::bucketUpperBound(bucket - 1));
+    }
+    for (int i = 1; i < Statistics::BucketCount; ++i) {
+        QVERIFY(Statistics::bucketUpperBound(i) >
+                Statistics::bucketUpperBound(i - 1));
+    }
+}
+
+void Core_Statistics_Test::percentile()
+{
+    Statistics empty;
+    QCOMPARE(empty.count(Statistics::Get), Q_UINT64_C(0));
+    QCOMPARE(empty.percentile(Statistics::Get, 0.99), Q_UINT64_C(0));
+    QCOMPARE(empty.histogram(Statistics::Get).size(), Statistics::BucketCount);
+
+    context->setStatisticsEnabled(true);
+    Database db(*context);
+    for (int i = 0; i < 100; ++i) {
+        db.get("missing");
+    }
+    auto stats = context->statistics();
+    QCOMPARE(stats.count(Statistics::Get), Q_UINT64_C(100));
+    auto p50 = stats.percentile(Statistics::Get, 0.5);
+    auto p99 = stats.percentile(Statistics::Get, 0.99);
+    QVERIFY(p50 > 0);
+    QVERIFY(p99 >= p50);
+    QVERIFY(stats.percentile(Statistics::Get, 1.0) >= p99);
+    quint64 sum = 0;
+    for (auto count : stats.histogram(Statistics::Get)) {
+        sum += count;
+    }
+    QCOMPARE(sum, Q_UINT64_C(100));
+}
+
+void Core_Statistics_Test::disabled()
+{
+    QVERIFY(!context->isStatisticsEnabled());
+    Database db(*context);
+    QVERIFY(db.put("foo", "bar"));
+    QCOMPARE(context->statistics().count(Statistics::Put), Q_UINT64_C(0));
+
+    context->setStatisticsEnabled(true);
+    QVERIFY(context->isStatisticsEnabled());
+    QVERIFY(db.put("foo", "bar"));
+    context->setStatisticsEnabled(false);
+    QVERIFY(db.put("foo", "bar"));
+    QCOMPARE(context->statistics().count(Statistics::Put), Q_UINT64_C(1));
+
+    context->resetStatistics();
+    QCOMPARE(context->statistics().count(Statistics::Put), Q_UINT64_C(0));
+}
+
+void Core_Statistics_Test::operations()
+{
+    Database db(*context);
+    context->setStatisticsEnabled(true);
+    {
+        Transaction txn(*context);
+        QVERIFY(db.put(txn, "a", "1"));
+        QVERIFY(db.put(txn, "b", "2"));
+        QVERIFY(txn.commit());
+    }
+    {
+        Transaction txn(*context);
+        QVERIFY(db.remove(txn, "a"));
+        QVERIFY(!db.remove(txn, "a"));
+        QVERIFY(txn.abort());
+    }
+    QCOMPARE(db.get("a"), QByteArray("1"));
+    QVERIFY(db.get("c").isNull());
+    {
+        Transaction txn(*context, Transaction::ReadOnly);
+        Cursor cursor(txn, db);
+        for (auto item = cursor.first(); item.isValid();
+             item = cursor.next()) {
+        }
+    }
+
+    auto stats = context->statistics();
+    QCOMPARE(stats.count(Statistics::BeginTransaction), Q_UINT64_C(5));
+    QCOMPARE(stats.count(Statistics::CommitTransaction), Q_UINT64_C(4));
+    QCOMPARE(stats.count(Statistics::AbortTransaction), Q_UINT64_C(1));
+    QCOMPARE(stats.count(Statistics::Put), Q_UINT64_C(2));
+    QCOMPARE(stats.count(Statistics::Remove), Q_UINT64_C(2));
+    QCOMPARE(stats.errorCount(Statistics::Remove), Q_UINT64_C(1));
+    QCOMPARE(stats.errors(Statistics::Remove).value(Errors::NotFound),
+             Q_UINT64_C(1));
+    QCOMPARE(stats.count(Statistics::Get), Q_UINT64_C(2));
+    QCOMPARE(stats.errors(Statistics::Get).size(), 1);
+    QCOMPARE(stats.errors(Statistics::Get).value(Errors::NotFound),
+             Q_UINT64_C(1));
+    QCOMPARE(stats.count(Statistics::CursorStep), Q_UINT64_C(3));
+    QCOMPARE(stats.errorCount(Statistics::CursorStep), Q_UINT64_C(1));
+    QCOMPARE(stats.errorCount(Statistics::Put), Q_UINT64_C(0));
+    QVERIFY(stats.totalTime(Statistics::CommitTransaction) > 0);
+
+    auto copy = stats;
+    QCOMPARE(copy.count(Statistics::Put), Q_UINT64_C(2));
+    copy = Statistics();
+    QCOMPARE(copy.count(Statistics::Put), Q_UINT64_C(0));
+}
+
+class GetThread : public QThread
+{
+public:
+    explicit GetThread(Database &database) : QThread(), database(database)
+    {
+    }
+
+protected:
+    void run() override
+    {
+        for (int i = 0; i < 1000; ++i) {
+            database.get("foo");
+        }
+    }
+
+private:
+    Database &database;
+};
+
+void Core_Statistics_Test::threads()
+{
+    context->setStatisticsEnabled(true);
+    Database db(*context);
+    QList<GetThread*> threads;
+    for (int i = 0; i < 10; ++i) {
+        threads << new GetThread(db);
+    }
+    for (auto thread : threads) {
+        thread->start();
+    }
+    for (auto thread : threads) {
+        thread->wait();
+    }
+    qDeleteAll(threads);
+    auto stats = context->statistics();
+    QCOMPARE(stats.count(Statistics::Get), Q_UINT64_C(10000));
+    QCOMPARE(stats.errors(Statistics::Get).value(Errors::NotFound),
+             Q_UINT64_C(10000));
+}
+
+void Core_Statistics_Test::prometheus()
+{
+    context->setStatisticsEnabled(true);
+    Database db(*context);
+    QVERIFY(db.put("foo", "bar"));
+    db.get("missing");
+
+    auto text = context->statistics().toPrometheus("app_db");
+    QVERIFY(text.contains("# TYPE app_db_operations_total counter\n"));
+    QVERIFY(text.contains("app_db_operations_total{operation=\"put\"} 1\n"));
+    QVERIFY(text.contains("app_db_errors_total{operation=\"get\","
+                          "error=\"NotFound\"} 1\n"));
+    QVERIFY(text.contains(
+                "# TYPE app_db_operation_duration_seconds histogram\n"));
+    QVERIFY(text.contains("app_db_operation_duration_seconds_bucket{"
+                          "operation=\"put\",le=\"+Inf\"} 1\n"));
+    QVERIFY(text.contains("app_db_operation_duration_seconds_count{"
+                          "operation=\"put\"} 1\n"));
+    QVERIFY(text.contains("app_db_operation_duration_seconds_bucket{"
+                          "operation=\"get\",le=\"1.024e-06\"} "));
+    QVERIFY(text.endsWith("\n"));
+
+    // The buckets are cumulative, up to the total count:
+    qint64 previous = 0;
+    for (const auto &line : text.split('\n')) {
+        if (line.startsWith("app_db_operation_duration_seconds_bucket{"
+                            "operation=\"get\"")) {
+            auto value = line.mid(line.lastIndexOf(' ') + 1).toLongLong();
+            QVERIFY(value >= previous);
+            previous = value;
+        }
+    }
+    QCOMPARE(previous, Q_INT64_C(1));
+}
+
+QTEST_APPLESS_MAIN(Core_Statistics_Test)
+
+#include "tst_statistics_test.moc"
@@ -4,4 +4,19 @@ SUBDIRS += \
     context \
     transaction \
     database \
-    cursor
+    cursor \
+    keybuilder \
+    expiringdatabase \
+    index \
+    changelog \
+    contextwatcher \
+    compresseddatabase \
+    blobstore \
+    valuedevice \
+    shardedcontext \
+    keyspace \
+    statistics \
+    benchmark
+
+qlmdb_with_zlib: SUBDIRS += dictionarycodec
+qlmdb_with_tracing: SUBDIRS += tracing
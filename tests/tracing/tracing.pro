@@ -0,0 +1,4 @@
+TARGET = tst_core_tracing_test
+SOURCES += \
+    tst_tracing_test.cpp
+include(../test.pri)
@@ -0,0 +1,169 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/errors.h"
+#include "qlmdb/tracing.h"
+#include "qlmdb/transaction.h"
+
+using namespace QLMDB;
+
+namespace {
+
+QStringList events;
+
+void transactionBegin(quint64 transactionId, unsigned int flags, int error)
+{
+    events << QString("begin %1 %2 %3").arg(transactionId).arg(
+                  (flags & Transaction::ReadOnly) ? "ro" : "rw").arg(error);
+}
+
+void transactionCommit(quint64 transactionId, int error)
+{
+    events << QString("commit %1 %2").arg(transactionId).arg(error);
+}
+
+void transactionAbort(quint64 transactionId)
+{
+    events << QString("abort %1").arg(transactionId);
+}
+
+void cursorPut(unsigned int, unsigned int, int error)
+{
+    events << QString("put %1").arg(error);
+}
+
+void cursorRemove(unsigned int, unsigned int, int error)
+{
+    events << QString("remove %1").arg(error);
+}
+
+void databaseOpen(const char *name, unsigned int, int error)
+{
+    events << QString("open %1 %2").arg(QString::fromUtf8(name)).arg(error);
+}
+
+int cursorSteps = 0;
+
+void cursorGet(unsigned int, int, int)
+{
+    ++cursorSteps;
+}
+
+} // namespace
+
+class Core_Tracing_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_Tracing_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void hooks();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_Tracing_Test::Core_Tracing_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_Tracing_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+    events.clear();
+    cursorSteps = 0;
+}
+
+void Core_Tracing_Test::cleanup()
+{
+    Tracing::setHooks(nullptr);
+    delete tmpDir;
+}
+
+void Core_Tracing_Test::hooks()
+{
+    Context context;
+    context.setPath(tmpDir->path());
+    context.setMaxDBs(1);
+    QVERIFY(context.open());
+    QVERIFY(Tracing::hooks() == nullptr);
+
+    static const Tracing::Hooks hooks = {
+        transactionBegin,
+        transactionCommit,
+        transactionAbort,
+        cursorGet,
+        cursorPut,
+        cursorRemove,
+        databaseOpen
+    };
+    Tracing::setHooks(&hooks);
+    QVERIFY(Tracing::hooks() == &hooks);
+
+    Database db(context, "traced");
+    QVERIFY(db.isValid());
+    QVERIFY(events.contains("open traced 0"));
+
+    events.clear();
+    {
+        Transaction txn(context);
+        QVERIFY(db.put(txn, "foo", "bar"));
+        Cursor cursor(txn, db);
+        QVERIFY(cursor.put("baz", "qux"));
+        QVERIFY(cursor.first().isValid());
+        QVERIFY(cursor.remove());
+    }
+    QCOMPARE(events.size(), 4);
+    QVERIFY(events.at(0).startsWith("begin "));
+    QVERIFY(events.at(0).endsWith(" rw 0"));
+    auto id = events.at(0).split(' ').at(1);
+    QVERIFY(id != "0");
+    QCOMPARE(events.at(1), QString("put 0"));
+    QCOMPARE(events.at(2), QString("remove 0"));
+    QCOMPARE(events.at(3), "commit " + id + " 0");
+    QVERIFY(cursorSteps >= 1);
+
+    events.clear();
+    {
+        Transaction txn(context, Transaction::ReadOnly);
+        QVERIFY(txn.abort());
+    }
+    QCOMPARE(events.size(), 2);
+    QVERIFY(events.at(0).endsWith(" ro 0"));
+    QVERIFY(events.at(1).startsWith("abort "));
+
+    // Removing the hooks stops calling them:
+    Tracing::setHooks(nullptr);
+    events.clear();
+    QVERIFY(db.put("foo", "baz"));
+    QVERIFY(events.isEmpty());
+}
+
+QTEST_APPLESS_MAIN(Core_Tracing_Test)
+
+#include "tst_tracing_test.moc"
@@ -0,0 +1,123 @@
+/*
+ * This file is part of QLMDB.
+ *
+ * QLMDB is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * QLMDB is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with QLMDB.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QString>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "qlmdb/context.h"
+#include "qlmdb/cursor.h"
+#include "qlmdb/database.h"
+#include "qlmdb/transaction.h"
+#include "qlmdb/valuedevice.h"
+
+using namespace QLMDB;
+
+class Core_ValueDevice_Test : public QObject
+{
+    Q_OBJECT
+
+public:
+    Core_ValueDevice_Test();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void read();
+    void cursor();
+
+private:
+    QTemporaryDir *tmpDir;
+};
+
+Core_ValueDevice_Test::Core_ValueDevice_Test() : tmpDir(nullptr)
+{
+}
+
+void Core_ValueDevice_Test::init()
+{
+    tmpDir = new QTemporaryDir();
+}
+
+void Core_ValueDevice_Test::cleanup()
+{
+    delete tmpDir;
+}
+
+void Core_ValueDevice_Test::read()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QVERIFY(db.put("doc", "first line\nsecond line\nlast"));
+
+    Transaction txn(ctx, Transaction::ReadOnly);
+    {
+        ValueDevice device(txn, db, "missing");
+        QVERIFY(device.isNull());
+        QVERIFY(!device.open(QIODevice::ReadOnly));
+        QVERIFY(!device.errorString().isEmpty());
+    }
+
+    ValueDevice device(txn, db, "doc");
+    QVERIFY(!device.isNull());
+    QCOMPARE(device.data(), QByteArray("first line\nsecond line\nlast"));
+    QVERIFY(!device.open(QIODevice::ReadWrite));
+    QVERIFY(device.open(QIODevice::ReadOnly));
+    QCOMPARE(device.size(), qint64(27));
+    QCOMPARE(device.readLine(), QByteArray("first line\n"));
+    QCOMPARE(device.read(6), QByteArray("second"));
+    QCOMPARE(device.readLine(), QByteArray(" line\n"));
+    QCOMPARE(device.readLine(), QByteArray("last"));
+    QVERIFY(device.atEnd());
+    QVERIFY(device.seek(6));
+    QCOMPARE(device.readAll(), QByteArray("line\nsecond line\nlast"));
+    QVERIFY(!device.seek(28));
+    QCOMPARE(device.write("foo"), qint64(-1));
+    device.close();
+    QVERIFY(!device.isOpen());
+}
+
+void Core_ValueDevice_Test::cursor()
+{
+    Context ctx;
+    ctx.setPath(tmpDir->path());
+    QVERIFY(ctx.open());
+    Database db(ctx);
+    QVERIFY(db.put("a", "foo"));
+    QVERIFY(db.put("b", "bar"));
+
+    Transaction txn(ctx, Transaction::ReadOnly);
+    Cursor cursor(txn, db);
+    {
+        ValueDevice device(cursor);
+        QVERIFY(device.isNull());
+    }
+    QVERIFY(cursor.first().isValid());
+    ValueDevice first(cursor);
+    QVERIFY(cursor.next().isValid());
+    ValueDevice second(cursor);
+    QVERIFY(first.open(QIODevice::ReadOnly));
+    QVERIFY(second.open(QIODevice::ReadOnly));
+    QCOMPARE(first.readAll(), QByteArray("foo"));
+    QCOMPARE(second.readAll(), QByteArray("bar"));
+}
+
+QTEST_APPLESS_MAIN(Core_ValueDevice_Test)
+
+#include "tst_valuedevice_test.moc"
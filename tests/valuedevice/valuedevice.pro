@@ -0,0 +1,4 @@
+TARGET = tst_core_valuedevice_test
+SOURCES += \
+    tst_valuedevice_test.cpp
+include(../test.pri)